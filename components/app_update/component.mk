@@ -1,5 +1,9 @@
 #
 # Component Makefile
 #
-# (Uses default behaviour of compiling all source files in directory, adding 'include' to include path.)
 
+COMPONENT_SRCDIRS := . tinfl
+COMPONENT_PRIV_INCLUDEDIRS := tinfl
+
+# miniz style, several statements per line
+tinfl/tinfl.o: CFLAGS += -Wno-misleading-indentation
@@ -33,9 +33,12 @@
 #include "sys/queue.h"
 #include "crc.h"
 #include "esp_log.h"
+#include "nvs.h"
+#include "tinfl.h"
 
 #ifdef CONFIG_TARGET_PLATFORM_ESP8266
 #include "spi_flash.h"
+#include "esp_sha.h"
 esp_err_t bootloader_flash_read(size_t src_addr, void *dest, size_t size, bool allow_decrypt);
 #endif
 
@@ -43,13 +46,106 @@ esp_err_t bootloader_flash_read(size_t src_addr, void *dest, size_t size, bool a
 #define OTA_MIN(a,b) ((a) <= (b) ? (a) : (b)) 
 #define SUB_TYPE_ID(i) (i & 0x0F) 
 
+#ifdef CONFIG_TARGET_PLATFORM_ESP8266
+#define OTA_IMAGE_CHECKSUM_INITIAL 0xEF
+
+/* Parser state of the image passed to esp_ota_write() */
+typedef enum {
+    OTA_IMAGE_HEADER = 0,
+    OTA_IMAGE_SEGMENT_HEADER,
+    OTA_IMAGE_SEGMENT_DATA,
+    OTA_IMAGE_CHECKSUM,
+    OTA_IMAGE_DIGEST,
+    OTA_IMAGE_DONE,
+} ota_image_state_t;
+
+/* The image is parsed as it is written: the checksum and the SHA-256 digest
+   are computed on the fly, so esp_ota_end() doesn't read the image back */
+typedef struct {
+    ota_image_state_t state;
+    uint32_t offset;                        /* image bytes parsed */
+    uint32_t field_end;                     /* image offset where the current field ends */
+    uint32_t field_len;                     /* length of the current field */
+    uint8_t segment;                        /* index of the current segment */
+    uint8_t segment_count;
+    uint32_t checksum_word;
+    esp_sha_t sha;
+    uint8_t digest[ESP_SHA256_DIGEST_LEN];  /* calculated digest */
+    uint8_t field[ESP_SHA256_DIGEST_LEN];   /* header, checksum or digest being received */
+} ota_image_t;
+#endif
+
+#define OTA_DELTA_BUF_LEN 512
+
+/* Field of the patch commands passed to esp_ota_write_delta() */
+typedef enum {
+    OTA_DELTA_DIFF_LEN = 0,
+    OTA_DELTA_DIFF,
+    OTA_DELTA_EXTRA_LEN,
+    OTA_DELTA_EXTRA,
+    OTA_DELTA_SEEK,
+} ota_delta_state_t;
+
+/* Decompressor of the image passed to esp_ota_write_compressed() or of the
+   patch passed to esp_ota_write_delta() */
+typedef struct {
+    tinfl_decompressor decomp;
+    union {
+        esp_ota_compressed_header_t compressed;
+        esp_ota_delta_header_t delta;
+    } header;                               /* the fields in common are the same */
+    uint32_t header_len;                    /* header bytes received */
+    uint32_t image_len;                     /* image bytes written */
+    uint32_t window_pos;                    /* window offset of the next decompressed byte */
+    bool done;                              /* end of the deflate stream reached */
+    bool is_delta;
+    uint8_t *window;
+    /* patch commands, see gen_delta_ota.py */
+    const esp_partition_t *source;          /* partition of the running app */
+    uint32_t source_pos;                    /* offset of the next source byte */
+    ota_delta_state_t delta_state;
+    uint32_t delta_len;                     /* bytes left in the diff or extra field */
+    uint32_t delta_value;                   /* number being decoded */
+    uint8_t delta_shift;
+    uint8_t buf[];                          /* OTA_DELTA_BUF_LEN bytes for a delta */
+} ota_inflate_t;
+
+#define OTA_RESUME_NAMESPACE "esp_ota"
+#define OTA_RESUME_KEY "checkpoint"
+#define OTA_RESUME_VERSION 1
+#define OTA_RESUME_INTERVAL (CONFIG_APP_UPDATE_RESUME_CHECKPOINT_SECTORS * SPI_FLASH_SEC_SIZE)
+#define OTA_RESUME_BUF_LEN 512
+
+/* Progress of an update begun with esp_ota_begin_resumable(), saved in NVS as it is */
+typedef struct {
+    uint32_t version;                       /* OTA_RESUME_VERSION */
+    uint32_t part_address;
+    uint32_t wrote_size;                    /* image bytes written, a multiple of OTA_RESUME_INTERVAL */
+    uint32_t crc;                           /* CRC32 of the image bytes written */
+    char source_id[ESP_OTA_SOURCE_ID_MAX_LEN + 1];
+#ifdef CONFIG_TARGET_PLATFORM_ESP8266
+    ota_image_t image;                      /* image parser state at wrote_size */
+#endif
+} ota_checkpoint_t;
+
+typedef struct {
+    nvs_handle nvs;
+    ota_checkpoint_t checkpoint;            /* the crc is updated by each write */
+} ota_resume_t;
+
 typedef struct ota_ops_entry_ {
     uint32_t handle;
     const esp_partition_t *part;
     uint32_t erased_size;
     uint32_t wrote_size;
+    bool need_erase;
     uint8_t partial_bytes;
     uint8_t partial_data[16];
+#ifdef CONFIG_TARGET_PLATFORM_ESP8266
+    ota_image_t image;
+#endif
+    ota_inflate_t *inflate;
+    ota_resume_t *resume;
     LIST_ENTRY(ota_ops_entry_) entries;
 } ota_ops_entry_t;
 
@@ -78,6 +174,131 @@ static bool is_ota_partition(const esp_partition_t *p)
             && p->subtype < ESP_PARTITION_SUBTYPE_APP_OTA_MAX);
 }
 
+#ifdef CONFIG_TARGET_PLATFORM_ESP8266
+static void ota_image_start_field(ota_image_t *img, ota_image_state_t state, uint32_t len)
+{
+    img->state = state;
+    img->field_len = len;
+    img->field_end = img->offset + len;
+}
+
+static void ota_image_init(ota_image_t *img)
+{
+    img->checksum_word = OTA_IMAGE_CHECKSUM_INITIAL;
+    esp_sha_init(&img->sha, ESP_SHA256);
+    ota_image_start_field(img, OTA_IMAGE_HEADER, sizeof(esp_image_header_t));
+}
+
+/* XOR the data into the checksum word. Only the XOR of its four bytes is used
+   in the end, so the bytes need not be in their lane */
+static uint32_t ota_image_checksum(uint32_t checksum_word, const uint8_t *data, size_t len)
+{
+    for (; len > 0 && ((uintptr_t)data & 3); len--) {
+        checksum_word ^= *data++;
+    }
+    for (; len >= 4; len -= 4, data += 4) {
+        checksum_word ^= *(const uint32_t *)data;
+    }
+    for (; len > 0; len--) {
+        checksum_word ^= *data++;
+    }
+    return checksum_word;
+}
+
+/* Start the field following the one which has been received */
+static esp_err_t ota_image_next_field(ota_image_t *img, uint32_t max_len)
+{
+    uint8_t checksum;
+
+    switch (img->state) {
+    case OTA_IMAGE_HEADER:
+        img->segment_count = ((const esp_image_header_t *)img->field)->segment_count;
+        if (img->segment_count > ESP_IMAGE_MAX_SEGMENTS) {
+            ESP_LOGE(TAG, "OTA image segment count %d exceeds max %d", img->segment_count, ESP_IMAGE_MAX_SEGMENTS);
+            return ESP_ERR_OTA_VALIDATE_FAILED;
+        }
+        break;
+    case OTA_IMAGE_SEGMENT_HEADER: {
+        esp_image_segment_header_t header;
+
+        memcpy(&header, img->field, sizeof(header));
+        if (header.data_len % 4 != 0 || header.data_len > max_len - img->offset) {
+            ESP_LOGE(TAG, "OTA image segment %d has invalid length 0x%x", img->segment, header.data_len);
+            return ESP_ERR_OTA_VALIDATE_FAILED;
+        }
+        ota_image_start_field(img, OTA_IMAGE_SEGMENT_DATA, header.data_len);
+        if (header.data_len > 0) {
+            return ESP_OK;
+        }
+        break;
+    }
+    case OTA_IMAGE_SEGMENT_DATA:
+        break;
+    case OTA_IMAGE_CHECKSUM:
+        checksum = (img->checksum_word >> 24) ^ (img->checksum_word >> 16) ^ (img->checksum_word >> 8) ^ img->checksum_word;
+        if (checksum != img->field[img->field_len - 1]) {
+            ESP_LOGE(TAG, "OTA image checksum failed. Calculated 0x%x read 0x%x", checksum, img->field[img->field_len - 1]);
+            return ESP_ERR_OTA_VALIDATE_FAILED;
+        }
+        esp_sha_finish(&img->sha, img->digest);
+        ota_image_start_field(img, OTA_IMAGE_DIGEST, ESP_SHA256_DIGEST_LEN);
+        return ESP_OK;
+    case OTA_IMAGE_DIGEST:
+        if (memcmp(img->field, img->digest, ESP_SHA256_DIGEST_LEN) != 0) {
+            ESP_LOGE(TAG, "OTA image hash failed - image is corrupt");
+            return ESP_ERR_OTA_VALIDATE_FAILED;
+        }
+        img->state = OTA_IMAGE_DONE;
+        return ESP_OK;
+    default:
+        return ESP_OK;
+    }
+
+    /* the header or a segment is complete */
+    if (img->state == OTA_IMAGE_SEGMENT_DATA) {
+        img->segment++;
+    }
+    if (img->segment < img->segment_count) {
+        ota_image_start_field(img, OTA_IMAGE_SEGMENT_HEADER, sizeof(esp_image_segment_header_t));
+    } else {
+        /* the checksum is in the last byte of the padding to a 16 byte boundary */
+        ota_image_start_field(img, OTA_IMAGE_CHECKSUM, ((img->offset + 16) & ~15) - img->offset);
+    }
+    return ESP_OK;
+}
+
+/* Parse the next image data, max_len is the size of the partition */
+static esp_err_t ota_image_parse(ota_image_t *img, const uint8_t *data, size_t len, uint32_t max_len)
+{
+    esp_err_t ret;
+
+    while (len > 0 && img->state != OTA_IMAGE_DONE) {
+        size_t n = OTA_MIN(len, img->field_end - img->offset);
+
+        if (img->state == OTA_IMAGE_SEGMENT_DATA) {
+            img->checksum_word = ota_image_checksum(img->checksum_word, data, n);
+        } else {
+            memcpy(img->field + img->field_len - (img->field_end - img->offset), data, n);
+        }
+        if (img->state != OTA_IMAGE_DIGEST) {
+            esp_sha_update(&img->sha, data, n);
+        }
+        img->offset += n;
+        data += n;
+        len -= n;
+
+        if (img->offset == img->field_end) {
+            ret = ota_image_next_field(img, max_len);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+        }
+    }
+
+    return ESP_OK;
+}
+#endif
+
 esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp_ota_handle_t *out_handle)
 {
     ota_ops_entry_t *new_entry;
@@ -101,7 +322,9 @@ esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp
     }
 
     // If input image size is 0 or OTA_SIZE_UNKNOWN, erase entire partition
-    if ((image_size == 0) || (image_size == OTA_SIZE_UNKNOWN)) {
+    if (image_size == OTA_WITH_SEQUENTIAL_WRITES) {
+        // esp_ota_write() erases each sector when the data reaches it
+    } else if ((image_size == 0) || (image_size == OTA_SIZE_UNKNOWN)) {
         ret = esp_partition_erase_range(partition, 0, partition->size);
     } else {
         ret = esp_partition_erase_range(partition, 0, (image_size / SPI_FLASH_SEC_SIZE + 1) * SPI_FLASH_SEC_SIZE);
@@ -118,22 +341,169 @@ esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp
 
     LIST_INSERT_HEAD(&s_ota_ops_entries_head, new_entry, entries);
 
-    if ((image_size == 0) || (image_size == OTA_SIZE_UNKNOWN)) {
+    if (image_size == OTA_WITH_SEQUENTIAL_WRITES) {
+        new_entry->need_erase = true;
+    } else if ((image_size == 0) || (image_size == OTA_SIZE_UNKNOWN)) {
         new_entry->erased_size = partition->size;
     } else {
         new_entry->erased_size = image_size;
     }
 
+#ifdef CONFIG_TARGET_PLATFORM_ESP8266
+    ota_image_init(&new_entry->image);
+#endif
+
     new_entry->part = partition;
     new_entry->handle = ++s_ota_ops_last_handle;
     *out_handle = new_entry->handle;
     return ESP_OK;
 }
 
-esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
+/* Erase the sectors which are not erased yet up to the one containing offset 'end - 1' */
+static esp_err_t ota_erase_to(ota_ops_entry_t *it, uint32_t end)
+{
+    esp_err_t ret;
+
+    end = OTA_MIN((end + SPI_FLASH_SEC_SIZE - 1) & ~(SPI_FLASH_SEC_SIZE - 1), it->part->size);
+    if (end <= it->erased_size) {
+        return ESP_OK;
+    }
+
+    ret = esp_partition_erase_range(it->part, it->erased_size, end - it->erased_size);
+    if (ret == ESP_OK) {
+        it->erased_size = end;
+    }
+    return ret;
+}
+
+static esp_err_t ota_write(ota_ops_entry_t *it, const uint8_t *data_bytes, size_t size)
 {
-    const uint8_t *data_bytes = (const uint8_t *)data;
     esp_err_t ret;
+
+    // must erase the partition before writing to it
+    assert((it->need_erase || it->erased_size > 0) && "must erase the partition before writing to it");
+
+    if(it->wrote_size == 0 && size > 0 && data_bytes[0] != 0xE9) {
+        ESP_LOGE(TAG, "OTA image has invalid magic byte (expected 0xE9, saw 0x%02x", data_bytes[0]);
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+
+#ifdef CONFIG_TARGET_PLATFORM_ESP8266
+    ret = ota_image_parse(&it->image, data_bytes, size, it->part->size);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+#endif
+
+    if (it->need_erase) {
+        // also covers the 16 bytes block which esp_ota_end() may write
+        ret = ota_erase_to(it, it->wrote_size + it->partial_bytes + size);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+#ifdef CONFIG_TARGET_PLATFORM_ESP32
+    if (esp_flash_encryption_enabled()) {
+        /* Can only write 16 byte blocks to flash, so need to cache anything else */
+        size_t copy_len;
+
+        /* check if we have partially written data from earlier */
+        if (it->partial_bytes != 0) {
+            copy_len = OTA_MIN(16 - it->partial_bytes, size);
+            memcpy(it->partial_data + it->partial_bytes, data_bytes, copy_len);
+            it->partial_bytes += copy_len;
+            if (it->partial_bytes != 16) {
+                return ESP_OK; /* nothing to write yet, just filling buffer */
+            }
+            /* write 16 byte to partition */
+            ret = esp_partition_write(it->part, it->wrote_size, it->partial_data, 16);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            it->partial_bytes = 0;
+            memset(it->partial_data, 0xFF, 16);
+            it->wrote_size += 16;
+            data_bytes += copy_len;
+            size -= copy_len;
+        }
+
+        /* check if we need to save trailing data that we're about to write */
+        it->partial_bytes = size % 16;
+        if (it->partial_bytes != 0) {
+            size -= it->partial_bytes;
+            memcpy(it->partial_data, data_bytes + size, it->partial_bytes);
+        }
+    }
+
+#endif
+    ret = esp_partition_write(it->part, it->wrote_size, data_bytes, size);
+    if(ret == ESP_OK){
+        it->wrote_size += size;
+    }
+    return ret;
+}
+
+static void ota_resume_clear(ota_resume_t *r)
+{
+    if (nvs_erase_key(r->nvs, OTA_RESUME_KEY) == ESP_OK) {
+        nvs_commit(r->nvs);
+    }
+}
+
+static void ota_resume_save(ota_ops_entry_t *it)
+{
+    ota_checkpoint_t *checkpoint = &it->resume->checkpoint;
+    esp_err_t ret;
+
+    checkpoint->wrote_size = it->wrote_size;
+#ifdef CONFIG_TARGET_PLATFORM_ESP8266
+    checkpoint->image = it->image;
+#endif
+
+    ret = nvs_set_blob(it->resume->nvs, OTA_RESUME_KEY, checkpoint, sizeof(*checkpoint));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(it->resume->nvs);
+    }
+    if (ret != ESP_OK) {
+        // the data is written all the same, only a reboot would lose more of it
+        ESP_LOGW(TAG, "failed to save OTA checkpoint (0x%x)", ret);
+    }
+}
+
+/* Write in pieces which end on the checkpoint boundaries, so that the parser
+   state saved at a boundary is the one for exactly the data before it */
+static esp_err_t ota_resume_write(ota_ops_entry_t *it, const uint8_t *data_bytes, size_t size)
+{
+    ota_checkpoint_t *checkpoint = &it->resume->checkpoint;
+    esp_err_t ret;
+
+    while (size > 0) {
+        uint32_t pos = it->wrote_size + it->partial_bytes;
+        size_t n = OTA_MIN(size, OTA_RESUME_INTERVAL - pos % OTA_RESUME_INTERVAL);
+
+        ret = ota_write(it, data_bytes, n);
+        if (ret != ESP_OK) {
+            if (ret == ESP_ERR_OTA_VALIDATE_FAILED) {
+                // resuming would fail the same way
+                ota_resume_clear(it->resume);
+            }
+            return ret;
+        }
+        checkpoint->crc = crc32_le(checkpoint->crc, data_bytes, n);
+        data_bytes += n;
+        size -= n;
+
+        if ((pos + n) % OTA_RESUME_INTERVAL == 0) {
+            ota_resume_save(it);
+        }
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
+{
     ota_ops_entry_t *it;
 
     if (data == NULL) {
@@ -144,65 +514,481 @@ esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
     // find ota handle in linked list
     for (it = LIST_FIRST(&s_ota_ops_entries_head); it != NULL; it = LIST_NEXT(it, entries)) {
         if (it->handle == handle) {
-            // must erase the partition before writing to it
-            assert(it->erased_size > 0 && "must erase the partition before writing to it");
+            if (it->resume != NULL) {
+                return ota_resume_write(it, data, size);
+            }
+            return ota_write(it, data, size);
+        }
+    }
+
+    //if go to here ,means don't find the handle
+    ESP_LOGE(TAG,"not found the handle");
+    return ESP_ERR_INVALID_ARG;
+}
+
+/* Continue from the checkpoint if it is for the same update and the partition
+   still holds the data it covers, otherwise drop it */
+static esp_err_t ota_resume_load(ota_ops_entry_t *it)
+{
+    ota_resume_t *r = it->resume;
+    ota_checkpoint_t checkpoint;
+    size_t len = sizeof(checkpoint);
+    uint32_t crc = 0;
+    uint8_t *buf;
+    esp_err_t ret;
+
+    if (nvs_get_blob(r->nvs, OTA_RESUME_KEY, &checkpoint, &len) != ESP_OK) {
+        return ESP_OK;
+    }
+
+    if (len != sizeof(checkpoint)
+        || checkpoint.version != OTA_RESUME_VERSION
+        || checkpoint.part_address != it->part->address
+        || strncmp(checkpoint.source_id, r->checkpoint.source_id, sizeof(checkpoint.source_id)) != 0
+        || checkpoint.wrote_size % OTA_RESUME_INTERVAL != 0
+        || checkpoint.wrote_size > it->part->size
+#ifdef CONFIG_TARGET_PLATFORM_ESP8266
+        || checkpoint.image.offset != checkpoint.wrote_size
+#endif
+        ) {
+        ESP_LOGI(TAG, "OTA checkpoint is for another update, starting over");
+        ota_resume_clear(r);
+        return ESP_OK;
+    }
+
+    buf = malloc(OTA_RESUME_BUF_LEN);
+    if (buf == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (uint32_t off = 0; off < checkpoint.wrote_size; off += OTA_RESUME_BUF_LEN) {
+        size_t n = OTA_MIN(OTA_RESUME_BUF_LEN, checkpoint.wrote_size - off);
+
+        ret = esp_partition_read(it->part, off, buf, n);
+        if (ret != ESP_OK) {
+            free(buf);
+            return ret;
+        }
+        crc = crc32_le(crc, buf, n);
+    }
+    free(buf);
+
+    if (crc != checkpoint.crc) {
+        ESP_LOGW(TAG, "OTA partition does not match the checkpoint, starting over");
+        ota_resume_clear(r);
+        return ESP_OK;
+    }
+
+    ESP_LOGI(TAG, "resuming OTA update at offset 0x%x", checkpoint.wrote_size);
+    r->checkpoint = checkpoint;
+    it->wrote_size = checkpoint.wrote_size;
+    // the sectors after the checkpoint may hold data written before the reboot
+    it->erased_size = checkpoint.wrote_size;
+#ifdef CONFIG_TARGET_PLATFORM_ESP8266
+    it->image = checkpoint.image;
+#endif
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_begin_resumable(const esp_partition_t *partition, const char *source_id, esp_ota_handle_t *out_handle)
+{
+    ota_ops_entry_t *it;
+    ota_resume_t *r;
+    esp_err_t ret;
+
+    if (source_id == NULL || strlen(source_id) > ESP_OTA_SOURCE_ID_MAX_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ret = esp_ota_begin(partition, OTA_WITH_SEQUENTIAL_WRITES, out_handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // esp_ota_begin() inserted the new entry at the head
+    it = LIST_FIRST(&s_ota_ops_entries_head);
+
+    r = (ota_resume_t *) calloc(sizeof(ota_resume_t), 1);
+    if (r == NULL) {
+        esp_ota_end(*out_handle);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ret = nvs_open(OTA_RESUME_NAMESPACE, NVS_READWRITE, &r->nvs);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "failed to open NVS for OTA checkpoints (0x%x)", ret);
+        free(r);
+        esp_ota_end(*out_handle);
+        return ret;
+    }
+
+    r->checkpoint.version = OTA_RESUME_VERSION;
+    r->checkpoint.part_address = partition->address;
+    strcpy(r->checkpoint.source_id, source_id);
+    it->resume = r;
+
+    ret = ota_resume_load(it);
+    if (ret != ESP_OK) {
+        esp_ota_end(*out_handle);
+        return ret;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_get_resume_offset(esp_ota_handle_t handle, size_t *offset)
+{
+    ota_ops_entry_t *it;
+
+    if (offset == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (it = LIST_FIRST(&s_ota_ops_entries_head); it != NULL; it = LIST_NEXT(it, entries)) {
+        if (it->handle == handle) {
+            *offset = it->wrote_size + it->partial_bytes;
+            return ESP_OK;
+        }
+    }
+
+    ESP_LOGE(TAG,"not found the handle");
+    return ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_ota_erase_ahead(esp_ota_handle_t handle)
+{
+    ota_ops_entry_t *it;
+
+    for (it = LIST_FIRST(&s_ota_ops_entries_head); it != NULL; it = LIST_NEXT(it, entries)) {
+        if (it->handle == handle) {
+            if (!it->need_erase) {
+                return ESP_OK;
+            }
+            return ota_erase_to(it, it->wrote_size + it->partial_bytes + SPI_FLASH_SEC_SIZE);
+        }
+    }
+
+    ESP_LOGE(TAG,"not found the handle");
+    return ESP_ERR_INVALID_ARG;
+}
+
+/* Check that the patch applies to the running app, whose digest is appended to it */
+static esp_err_t ota_delta_check_source(ota_inflate_t *z)
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    const esp_partition_pos_t running_pos = {
+        .offset = running->address,
+        .size = running->size,
+    };
+    esp_image_metadata_t data;
+    uint8_t digest[sizeof(z->header.delta.source_digest)];
+    uint32_t digest_offset;
+
+    if (esp_image_load(ESP_IMAGE_VERIFY_SILENT, &running_pos, &data) != ESP_OK) {
+        ESP_LOGE(TAG, "running app image is invalid");
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+
+    /* The digest follows the checksum padding, image_len only counts it when the loader checks it */
+    digest_offset = data.image_len;
+#ifdef CONFIG_ENABLE_BOOT_CHECK_SHA256
+    digest_offset -= sizeof(digest);
+#endif
+    if (esp_partition_read(running, digest_offset, digest, sizeof(digest)) != ESP_OK) {
+        ESP_LOGE(TAG, "running app image is invalid");
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+
+#ifndef CONFIG_ENABLE_BOOT_CHECK_SHA256
+    /* The loader didn't check it, the app may have been flashed without one */
+    {
+        esp_sha_t sha;
+        uint8_t calculated[sizeof(digest)];
+        esp_err_t ret = ESP_OK;
+
+        esp_sha_init(&sha, ESP_SHA256);
+        for (uint32_t offset = 0; offset < digest_offset && ret == ESP_OK; offset += OTA_DELTA_BUF_LEN) {
+            size_t n = OTA_MIN(OTA_DELTA_BUF_LEN, digest_offset - offset);
 
-            if(it->wrote_size == 0 && size > 0 && data_bytes[0] != 0xE9) {
-                ESP_LOGE(TAG, "OTA image has invalid magic byte (expected 0xE9, saw 0x%02x", data_bytes[0]);
+            ret = esp_partition_read(running, offset, z->buf, n);
+            esp_sha_update(&sha, z->buf, n);
+        }
+        esp_sha_finish(&sha, calculated);
+
+        if (ret != ESP_OK || memcmp(digest, calculated, sizeof(digest)) != 0) {
+            ESP_LOGE(TAG, "running app has no SHA-256 appended, it can't be the base of a delta OTA image");
+            return ESP_ERR_OTA_VALIDATE_FAILED;
+        }
+    }
+#endif
+
+    if (memcmp(digest, z->header.delta.source_digest, sizeof(digest)) != 0) {
+        ESP_LOGE(TAG, "delta OTA image is not for the running app");
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+
+    z->source = running;
+    return ESP_OK;
+}
+
+/* Take the header off the compressed data and allocate the window */
+static esp_err_t ota_inflate_header(ota_ops_entry_t *it, const uint8_t **data, size_t *size)
+{
+    ota_inflate_t *z = it->inflate;
+    const esp_ota_compressed_header_t *header = &z->header.compressed;
+    size_t header_size = z->is_delta ? sizeof(esp_ota_delta_header_t) : sizeof(esp_ota_compressed_header_t);
+    size_t n = OTA_MIN(*size, header_size - z->header_len);
+    esp_err_t ret;
+
+    memcpy((uint8_t *)&z->header + z->header_len, *data, n);
+    z->header_len += n;
+    *data += n;
+    *size -= n;
+    if (z->header_len < header_size) {
+        return ESP_OK;
+    }
+
+    if (header->magic != (z->is_delta ? ESP_OTA_DELTA_MAGIC : ESP_OTA_COMPRESSED_MAGIC)) {
+        ESP_LOGE(TAG, "%s OTA image has invalid magic 0x%08x", z->is_delta ? "delta" : "compressed", header->magic);
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    if (header->window_bits < 9 || header->window_bits > CONFIG_APP_UPDATE_COMPRESSED_WINDOW_BITS) {
+        ESP_LOGE(TAG, "compressed OTA image window bits %d, max %d", header->window_bits, CONFIG_APP_UPDATE_COMPRESSED_WINDOW_BITS);
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    if (header->image_size > it->part->size) {
+        ESP_LOGE(TAG, "compressed OTA image size 0x%x exceeds partition size 0x%x", header->image_size, it->part->size);
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    if (z->is_delta) {
+        ret = ota_delta_check_source(z);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    z->window = malloc(1 << header->window_bits);
+    if (z->window == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/* Write the next bytes of the decompressed or rebuilt image */
+static esp_err_t ota_inflate_write(esp_ota_handle_t handle, ota_inflate_t *z, const uint8_t *data, size_t len)
+{
+    esp_err_t ret;
+
+    if (len > z->header.compressed.image_size - z->image_len) {
+        ESP_LOGE(TAG, "compressed OTA image is larger than 0x%x", z->header.compressed.image_size);
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+
+    ret = esp_ota_write(handle, data, len);
+    if (ret == ESP_OK) {
+        z->image_len += len;
+    }
+    return ret;
+}
+
+/* Run the next bytes of the patch commands */
+static esp_err_t ota_delta_apply(esp_ota_handle_t handle, ota_inflate_t *z, const uint8_t *data, size_t len)
+{
+    esp_err_t ret;
+    size_t n;
+
+    while (len > 0) {
+        switch (z->delta_state) {
+        case OTA_DELTA_DIFF_LEN:
+        case OTA_DELTA_EXTRA_LEN:
+        case OTA_DELTA_SEEK:
+            if (z->delta_shift > 28) {
+                ESP_LOGE(TAG, "delta OTA image has an invalid number");
                 return ESP_ERR_OTA_VALIDATE_FAILED;
             }
+            z->delta_value |= (uint32_t)(*data & 0x7f) << z->delta_shift;
+            z->delta_shift += 7;
+            len--;
+            if (*data++ & 0x80) {
+                break;
+            }
 
-#ifdef CONFIG_TARGET_PLATFORM_ESP32
-            if (esp_flash_encryption_enabled()) {
-                /* Can only write 16 byte blocks to flash, so need to cache anything else */
-                size_t copy_len;
-
-                /* check if we have partially written data from earlier */
-                if (it->partial_bytes != 0) {
-                    copy_len = OTA_MIN(16 - it->partial_bytes, size);
-                    memcpy(it->partial_data + it->partial_bytes, data_bytes, copy_len);
-                    it->partial_bytes += copy_len;
-                    if (it->partial_bytes != 16) {
-                        return ESP_OK; /* nothing to write yet, just filling buffer */
-                    }
-                    /* write 16 byte to partition */
-                    ret = esp_partition_write(it->part, it->wrote_size, it->partial_data, 16);
-                    if (ret != ESP_OK) {
-                        return ret;
-                    }
-                    it->partial_bytes = 0;
-                    memset(it->partial_data, 0xFF, 16);
-                    it->wrote_size += 16;
-                    data_bytes += copy_len;
-                    size -= copy_len;
-                }
+            if (z->delta_state == OTA_DELTA_SEEK) {
+                /* zigzag encoded, odd numbers are negative */
+                uint32_t seek = (z->delta_value >> 1) + (z->delta_value & 1);
 
-                /* check if we need to save trailing data that we're about to write */
-                it->partial_bytes = size % 16;
-                if (it->partial_bytes != 0) {
-                    size -= it->partial_bytes;
-                    memcpy(it->partial_data, data_bytes + size, it->partial_bytes);
+                if (z->delta_value & 1 ? seek > z->source_pos : seek > z->source->size - z->source_pos) {
+                    ESP_LOGE(TAG, "delta OTA image seeks out of the running app");
+                    return ESP_ERR_OTA_VALIDATE_FAILED;
                 }
+                z->source_pos = z->delta_value & 1 ? z->source_pos - seek : z->source_pos + seek;
+                z->delta_state = OTA_DELTA_DIFF_LEN;
+            } else {
+                /* DIFF or EXTRA, skipped when empty */
+                z->delta_len = z->delta_value;
+                z->delta_state += z->delta_len > 0 ? 1 : 2;
             }
-
-#endif
-            ret = esp_partition_write(it->part, it->wrote_size, data_bytes, size);
-            if(ret == ESP_OK){
-                it->wrote_size += size;
+            z->delta_value = 0;
+            z->delta_shift = 0;
+            break;
+        case OTA_DELTA_DIFF:
+            n = OTA_MIN(OTA_MIN(len, z->delta_len), OTA_DELTA_BUF_LEN);
+            if (n > z->source->size - z->source_pos) {
+                ESP_LOGE(TAG, "delta OTA image reads out of the running app");
+                return ESP_ERR_OTA_VALIDATE_FAILED;
+            }
+            ret = esp_partition_read(z->source, z->source_pos, z->buf, n);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            for (size_t i = 0; i < n; i++) {
+                z->buf[i] += data[i];
             }
+            ret = ota_inflate_write(handle, z, z->buf, n);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            z->source_pos += n;
+            z->delta_len -= n;
+            data += n;
+            len -= n;
+            if (z->delta_len == 0) {
+                z->delta_state = OTA_DELTA_EXTRA_LEN;
+            }
+            break;
+        case OTA_DELTA_EXTRA:
+            n = OTA_MIN(len, z->delta_len);
+            ret = ota_inflate_write(handle, z, data, n);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            z->delta_len -= n;
+            data += n;
+            len -= n;
+            if (z->delta_len == 0) {
+                z->delta_state = OTA_DELTA_SEEK;
+            }
+            break;
+        }
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t ota_write_inflate(esp_ota_handle_t handle, const void *data, size_t size, bool is_delta)
+{
+    const uint8_t *data_bytes = (const uint8_t *)data;
+    ota_ops_entry_t *it;
+    ota_inflate_t *z;
+    tinfl_status status;
+    esp_err_t ret;
+
+    if (data == NULL) {
+        ESP_LOGE(TAG, "write data is invalid");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (it = LIST_FIRST(&s_ota_ops_entries_head); it != NULL; it = LIST_NEXT(it, entries)) {
+        if (it->handle == handle) {
+            break;
+        }
+    }
+
+    if (it == NULL) {
+        ESP_LOGE(TAG,"not found the handle");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (it->resume != NULL) {
+        ESP_LOGE(TAG, "resumable update only takes esp_ota_write()");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (it->inflate == NULL) {
+        if (it->wrote_size > 0 || it->partial_bytes > 0) {
+            ESP_LOGE(TAG, "handle was written with esp_ota_write()");
+            return ESP_ERR_INVALID_ARG;
+        }
+        it->inflate = calloc(1, sizeof(ota_inflate_t) + (is_delta ? OTA_DELTA_BUF_LEN : 0));
+        if (it->inflate == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        it->inflate->is_delta = is_delta;
+        tinfl_init(&it->inflate->decomp);
+    } else if (it->inflate->is_delta != is_delta) {
+        ESP_LOGE(TAG, "handle was written with esp_ota_write_%s()", it->inflate->is_delta ? "delta" : "compressed");
+        return ESP_ERR_INVALID_ARG;
+    }
+    z = it->inflate;
+
+    if (z->window == NULL) {
+        ret = ota_inflate_header(it, &data_bytes, &size);
+        if (ret != ESP_OK || z->window == NULL) {
             return ret;
         }
     }
 
-    //if go to here ,means don't find the handle
-    ESP_LOGE(TAG,"not found the handle");
-    return ESP_ERR_INVALID_ARG;
+    if (z->done && size > 0) {
+        ESP_LOGE(TAG, "compressed OTA image has trailing data");
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    if (z->done || size == 0) {
+        return ESP_OK;
+    }
+
+    do {
+        size_t window_size = 1 << z->header.compressed.window_bits;
+        size_t in_len = size;
+        size_t out_len = window_size - z->window_pos;
+
+        status = tinfl_decompress(&z->decomp, data_bytes, &in_len, z->window, z->window + z->window_pos, &out_len,
+                                  TINFL_FLAG_HAS_MORE_INPUT);
+        data_bytes += in_len;
+        size -= in_len;
+
+        if (status < TINFL_STATUS_DONE) {
+            ESP_LOGE(TAG, "compressed OTA image is corrupt (%d)", status);
+            return ESP_ERR_OTA_VALIDATE_FAILED;
+        }
+
+        if (out_len > 0) {
+            if (z->is_delta) {
+                ret = ota_delta_apply(handle, z, z->window + z->window_pos, out_len);
+            } else {
+                ret = ota_inflate_write(handle, z, z->window + z->window_pos, out_len);
+            }
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            z->window_pos = (z->window_pos + out_len) & (window_size - 1);
+        }
+        // HAS_MORE_OUTPUT: the window is full and was flushed, continue
+    } while (status == TINFL_STATUS_HAS_MORE_OUTPUT);
+
+    if (status == TINFL_STATUS_DONE) {
+        z->done = true;
+        if (size > 0) {
+            ESP_LOGE(TAG, "compressed OTA image has trailing data");
+            return ESP_ERR_OTA_VALIDATE_FAILED;
+        }
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_write_compressed(esp_ota_handle_t handle, const void *data, size_t size)
+{
+    return ota_write_inflate(handle, data, size, false);
+}
+
+esp_err_t esp_ota_write_delta(esp_ota_handle_t handle, const void *data, size_t size)
+{
+    return ota_write_inflate(handle, data, size, true);
 }
 
 esp_err_t esp_ota_end(esp_ota_handle_t handle)
 {
     ota_ops_entry_t *it;
     esp_err_t ret = ESP_OK;
+    bool incomplete = false;    /* a resumable update keeps its checkpoint */
 
     for (it = LIST_FIRST(&s_ota_ops_entries_head); it != NULL; it = LIST_NEXT(it, entries)) {
         if (it->handle == handle) {
@@ -218,10 +1004,17 @@ esp_err_t esp_ota_end(esp_ota_handle_t handle)
 
     // esp_ota_end() is only valid if some data was written to this handle
     if ((it->erased_size == 0) || (it->wrote_size == 0)) {
+        incomplete = true;
         ret = ESP_ERR_INVALID_ARG;
         goto cleanup;
     }
 
+    if (it->inflate != NULL && (!it->inflate->done || it->inflate->image_len != it->inflate->header.compressed.image_size)) {
+        ESP_LOGE(TAG, "compressed OTA image is incomplete, %d bytes decompressed", it->inflate->image_len);
+        ret = ESP_ERR_OTA_VALIDATE_FAILED;
+        goto cleanup;
+    }
+
     if (it->partial_bytes > 0) {
         /* Write out last 16 bytes, if necessary */
         ret = esp_partition_write(it->part, it->wrote_size, it->partial_data, 16);
@@ -233,6 +1026,20 @@ esp_err_t esp_ota_end(esp_ota_handle_t handle)
         it->partial_bytes = 0;
     }
 
+    uint32_t image_len;
+
+#ifdef CONFIG_TARGET_PLATFORM_ESP8266
+    // The checksum and the digest were checked by esp_ota_write()
+    if (it->image.state != OTA_IMAGE_DONE) {
+        ESP_LOGE(TAG, "OTA image is incomplete, %d bytes parsed", it->image.offset);
+        incomplete = true;
+        ret = ESP_ERR_OTA_VALIDATE_FAILED;
+        goto cleanup;
+    }
+    image_len = it->image.offset;
+#endif
+
+#if !defined(CONFIG_TARGET_PLATFORM_ESP8266) || defined(CONFIG_APP_UPDATE_CHECK_APP_READBACK)
     esp_image_metadata_t data;
     const esp_partition_pos_t part_pos = {
       .offset = it->part->address,
@@ -243,9 +1050,15 @@ esp_err_t esp_ota_end(esp_ota_handle_t handle)
         ret = ESP_ERR_OTA_VALIDATE_FAILED;
         goto cleanup;
     }
+#ifndef CONFIG_TARGET_PLATFORM_ESP8266
+    image_len = data.image_len;
+#endif
+#endif
+
+    ESP_LOGD(TAG, "OTA image length %d", image_len);
 
 #ifdef CONFIG_SECURE_BOOT_ENABLED
-    ret = esp_secure_boot_verify_signature(it->part->address, data.image_len);
+    ret = esp_secure_boot_verify_signature(it->part->address, image_len);
     if (ret != ESP_OK) {
         ret = ESP_ERR_OTA_VALIDATE_FAILED;
         goto cleanup;
@@ -254,6 +1067,17 @@ esp_err_t esp_ota_end(esp_ota_handle_t handle)
 
  cleanup:
     LIST_REMOVE(it, entries);
+    if (it->inflate != NULL) {
+        free(it->inflate->window);
+        free(it->inflate);
+    }
+    if (it->resume != NULL) {
+        if (!incomplete) {
+            ota_resume_clear(it->resume);
+        }
+        nvs_close(it->resume->nvs);
+        free(it->resume);
+    }
     free(it);
     return ret;
 }
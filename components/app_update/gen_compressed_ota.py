@@ -0,0 +1,94 @@
+#!/usr/bin/env python
+#
+# Compressed OTA image generation tool
+#
+# Compresses an app image for esp_ota_write_compressed(): an
+# esp_ota_compressed_header_t followed by the image as a raw deflate
+# stream with a small window, so the device can decompress it in a few KB
+# of RAM while it is downloaded.
+#
+# Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http:#www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+from __future__ import print_function, division
+import argparse
+import struct
+import sys
+import zlib
+
+ESP_IMAGE_HEADER_MAGIC = 0xE9
+ESP_OTA_COMPRESSED_MAGIC = 0x5a41544f    # "OTAZ"
+HEADER_FORMAT = '<IB3xI'                 # magic, window_bits, reserved, image_size
+
+__version__ = '1.0'
+
+
+def compress_image(image, window_bits, level=9):
+    """ Return the compressed OTA image of an app image """
+    compressor = zlib.compressobj(level, zlib.DEFLATED, -window_bits, 9)
+    data = compressor.compress(image) + compressor.flush()
+    return struct.pack(HEADER_FORMAT, ESP_OTA_COMPRESSED_MAGIC, window_bits, len(image)) + data
+
+
+def decompress_image(data):
+    """ Return the app image of a compressed OTA image, as the device does """
+    magic, window_bits, image_size = struct.unpack_from(HEADER_FORMAT, data)
+    if magic != ESP_OTA_COMPRESSED_MAGIC:
+        raise ValueError('Invalid compressed OTA image magic 0x%08x' % magic)
+    decompressor = zlib.decompressobj(-window_bits)
+    image = decompressor.decompress(data[struct.calcsize(HEADER_FORMAT):]) + decompressor.flush()
+    if len(image) != image_size or not getattr(decompressor, 'eof', True) or decompressor.unused_data:
+        raise ValueError('Compressed OTA image is corrupt')
+    return image
+
+
+def download_time(size, link_kbps):
+    return size * 8 / (link_kbps * 1000)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compressed OTA image utility')
+
+    parser.add_argument('--window-bits', '-w', help='log2 of the deflate window, at most CONFIG_APP_UPDATE_COMPRESSED_WINDOW_BITS',
+                        type=int, choices=range(9, 16), default=12)
+    parser.add_argument('--level', '-l', help='Compression level', type=int, choices=range(1, 10), default=9)
+    parser.add_argument('--link-speed', '-s', help='Link speeds in kbit/s to estimate download times at',
+                        type=int, nargs='+', default=[256, 1000])
+    parser.add_argument('--quiet', '-q', help="Don't print the compression ratio", action='store_true')
+    parser.add_argument('input', help='App image', type=argparse.FileType('rb'))
+    parser.add_argument('output', help='Compressed OTA image', type=argparse.FileType('wb'))
+
+    args = parser.parse_args()
+
+    image = args.input.read()
+    if len(image) == 0 or bytearray(image)[0] != ESP_IMAGE_HEADER_MAGIC:
+        print('%s is not an app image' % args.input.name, file=sys.stderr)
+        sys.exit(1)
+
+    data = compress_image(image, args.window_bits, args.level)
+    if decompress_image(data) != image:
+        print('Compressed OTA image does not decompress to %s' % args.input.name, file=sys.stderr)
+        sys.exit(1)
+    args.output.write(data)
+
+    if not args.quiet:
+        print('%s: %d bytes, %s: %d bytes (%.1f%%), %d bytes window' % (
+            args.input.name, len(image), args.output.name, len(data),
+            100 * len(data) / len(image), 1 << args.window_bits))
+        for link_kbps in args.link_speed:
+            print('download at %d kbit/s: %.1f s, compressed %.1f s' % (
+                link_kbps, download_time(len(image), link_kbps), download_time(len(data), link_kbps)))
+
+
+if __name__ == '__main__':
+    main()
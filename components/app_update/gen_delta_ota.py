@@ -0,0 +1,294 @@
+#!/usr/bin/env python
+#
+# Delta OTA image generation tool
+#
+# Makes a patch for esp_ota_write_delta(), which rebuilds a new app image
+# from the running one: an esp_ota_delta_header_t followed by a raw deflate
+# stream of bsdiff style commands.
+#
+# Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http:#www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+from __future__ import print_function, division
+import argparse
+import hashlib
+import struct
+import sys
+import time
+import zlib
+
+from gen_compressed_ota import ESP_IMAGE_HEADER_MAGIC, download_time
+
+ESP_OTA_DELTA_MAGIC = 0x4441544f       # "OTAD"
+HEADER_FORMAT = '<IB3xI32s'            # magic, window_bits, reserved, image_size, source_digest
+DIGEST_LEN = 32
+IMAGE_HEADER_LEN = 8                   # esp_image_header_t
+SEGMENT_HEADER_LEN = 8                 # esp_image_segment_header_t
+
+BLOCK_LEN = 8                          # length of the old image substrings which are indexed
+
+__version__ = '1.0'
+
+# The patch is a sequence of commands, each one made of:
+#
+#   diff length    (LEB128), then as many bytes to add to the old image bytes
+#   extra length   (LEB128), then as many bytes to copy as they are
+#   seek           (zigzag LEB128), added to the old image offset
+#
+# as in bsdiff. Code which only moved or which refers to moved code and data
+# still matches the old image once the differing bytes are allowed inside a
+# match, and the diff bytes are mostly zero so they compress well.
+
+
+def encode_uint(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7f
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return out
+
+
+def encode_int(value):
+    return encode_uint((value << 1) if value >= 0 else ((-value << 1) - 1))
+
+
+def decode_uint(data, pos):
+    value = shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7f) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def decode_int(data, pos):
+    value, pos = decode_uint(data, pos)
+    return (value >> 1) if not value & 1 else -((value + 1) >> 1), pos
+
+
+class Matcher(object):
+    """ Finds matches of the new image in the old one with an index of the
+    old image substrings of BLOCK_LEN bytes """
+
+    def __init__(self, old):
+        self.old = old
+        self.index = {}
+        for i in range(len(old) - BLOCK_LEN, -1, -1):
+            self.index[old[i:i + BLOCK_LEN]] = i
+
+    def match_len(self, new, scan, pos):
+        """ Length of the common prefix of new[scan:] and old[pos:] """
+        old = self.old
+        lo, hi = 0, min(len(new) - scan, len(old) - pos)
+        while lo < hi:
+            mid = (lo + hi + 1) // 2
+            if new[scan:scan + mid] == old[pos:pos + mid]:
+                lo = mid
+            else:
+                hi = mid - 1
+        return lo
+
+    def search(self, new, scan, hint):
+        """ Return (length, old offset) of a long match of new[scan:], trying
+        the old offset given by the current alignment first """
+        best = (0, 0)
+        if 0 <= hint < len(self.old):
+            best = (self.match_len(new, scan, hint), hint)
+        pos = self.index.get(new[scan:scan + BLOCK_LEN])
+        if pos is not None and pos != hint:
+            length = self.match_len(new, scan, pos)
+            if length > best[0]:
+                best = (length, pos)
+        return best
+
+
+def diff(old, new):
+    """ Return the patch commands as (diff bytes, extra bytes, seek) """
+    matcher = Matcher(old)
+    old_len, new_len = len(old), len(new)
+    commands = []
+    scan = length = pos = 0
+    last_scan = last_pos = last_offset = 0
+
+    while scan < new_len:
+        old_score = 0
+        scan += length
+        scsc = scan
+        while scan < new_len:
+            length, pos = matcher.search(new, scan, scan + last_offset)
+            while scsc < scan + length:
+                if scsc + last_offset < old_len and old[scsc + last_offset] == new[scsc]:
+                    old_score += 1
+                scsc += 1
+            if (length == old_score and length != 0) or length > old_score + BLOCK_LEN:
+                break
+            if scan + last_offset < old_len and old[scan + last_offset] == new[scan]:
+                old_score -= 1
+            scan += 1
+
+        if length != old_score or scan == new_len:
+            # extend the previous match forwards and this one backwards,
+            # as long as more than half of the bytes are equal
+            s = best = len_f = i = 0
+            while last_scan + i < scan and last_pos + i < old_len:
+                if old[last_pos + i] == new[last_scan + i]:
+                    s += 1
+                i += 1
+                if s * 2 - i > best * 2 - len_f:
+                    best, len_f = s, i
+
+            len_b = 0
+            if scan < new_len:
+                s = best = 0
+                i = 1
+                while scan >= last_scan + i and pos >= i:
+                    if old[pos - i] == new[scan - i]:
+                        s += 1
+                    if s * 2 - i > best * 2 - len_b:
+                        best, len_b = s, i
+                    i += 1
+
+            if last_scan + len_f > scan - len_b:
+                overlap = (last_scan + len_f) - (scan - len_b)
+                s = best = len_s = 0
+                for i in range(overlap):
+                    if new[last_scan + len_f - overlap + i] == old[last_pos + len_f - overlap + i]:
+                        s += 1
+                    if new[scan - len_b + i] == old[pos - len_b + i]:
+                        s -= 1
+                    if s > best:
+                        best, len_s = s, i + 1
+                len_f += len_s - overlap
+                len_b -= len_s
+
+            diff_bytes = bytearray((n - o) & 0xff for n, o in
+                                   zip(bytearray(new[last_scan:last_scan + len_f]), bytearray(old[last_pos:last_pos + len_f])))
+            extra_bytes = new[last_scan + len_f:scan - len_b]
+            commands.append((diff_bytes, extra_bytes, (pos - len_b) - (last_pos + len_f)))
+
+            last_scan = scan - len_b
+            last_pos = pos - len_b
+            last_offset = pos - scan
+
+    return commands
+
+
+def encode_commands(commands):
+    out = bytearray()
+    for diff_bytes, extra_bytes, seek in commands:
+        out += encode_uint(len(diff_bytes)) + diff_bytes
+        out += encode_uint(len(extra_bytes)) + extra_bytes
+        out += encode_int(seek)
+    return bytes(out)
+
+
+def apply_commands(old, stream, image_size):
+    """ Rebuild the new image from the command stream, as the device does """
+    new = bytearray()
+    stream = bytearray(stream)
+    pos = src = 0
+    while len(new) < image_size:
+        length, pos = decode_uint(stream, pos)
+        new += bytearray((d + o) & 0xff for d, o in zip(stream[pos:pos + length], bytearray(old[src:src + length])))
+        pos += length
+        src += length
+        length, pos = decode_uint(stream, pos)
+        new += stream[pos:pos + length]
+        pos += length
+        seek, pos = decode_int(stream, pos)
+        src += seek
+    if pos != len(stream) or len(new) != image_size:
+        raise ValueError('Delta OTA image is corrupt')
+    return bytes(new)
+
+
+def image_digest(image):
+    """ Return the SHA-256 appended to an app image after the checksum
+    padding, as esptool.py elf2image --version=3 does, or None if it has
+    none """
+    pos = IMAGE_HEADER_LEN
+    if len(image) < pos or bytearray(image)[0] != ESP_IMAGE_HEADER_MAGIC:
+        return None
+    for _ in range(bytearray(image)[1]):
+        if len(image) < pos + SEGMENT_HEADER_LEN:
+            return None
+        _, data_len = struct.unpack_from('<II', image, pos)
+        pos += SEGMENT_HEADER_LEN + data_len
+    pos = (pos + 16) & ~15  # the checksum is in the last byte of the padding
+    digest = image[pos:pos + DIGEST_LEN]
+    if len(digest) != DIGEST_LEN or hashlib.sha256(image[:pos]).digest() != digest:
+        return None
+    return digest
+
+
+def make_patch(old, new, window_bits, level=9):
+    source_digest = image_digest(old)
+    if source_digest is None:
+        raise ValueError('The old image has no SHA-256 appended')
+    stream = encode_commands(diff(old, new))
+    if apply_commands(old, stream, len(new)) != new:
+        raise ValueError('Delta OTA image does not rebuild the new image')
+    compressor = zlib.compressobj(level, zlib.DEFLATED, -window_bits, 9)
+    data = compressor.compress(stream) + compressor.flush()
+    header = struct.pack(HEADER_FORMAT, ESP_OTA_DELTA_MAGIC, window_bits, len(new), source_digest)
+    return header + data
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Delta OTA image utility')
+
+    parser.add_argument('--window-bits', '-w', help='log2 of the deflate window, at most CONFIG_APP_UPDATE_COMPRESSED_WINDOW_BITS',
+                        type=int, choices=range(9, 16), default=12)
+    parser.add_argument('--level', '-l', help='Compression level', type=int, choices=range(1, 10), default=9)
+    parser.add_argument('--link-speed', '-s', help='Link speeds in kbit/s to estimate download times at',
+                        type=int, nargs='+', default=[256, 1000])
+    parser.add_argument('--quiet', '-q', help="Don't print the patch size", action='store_true')
+    parser.add_argument('old', help='App image running on the device', type=argparse.FileType('rb'))
+    parser.add_argument('new', help='App image to update to', type=argparse.FileType('rb'))
+    parser.add_argument('output', help='Delta OTA image', type=argparse.FileType('wb'))
+
+    args = parser.parse_args()
+
+    old = args.old.read()
+    new = args.new.read()
+    # The device finds the running app by this digest, and esp_ota_write() checks the new one
+    for f, image in ((args.old, old), (args.new, new)):
+        if image_digest(image) is None:
+            print('%s is not an app image with a SHA-256 appended (esptool.py elf2image --version=3)' % f.name,
+                  file=sys.stderr)
+            sys.exit(1)
+
+    start = time.time()
+    data = make_patch(old, new, args.window_bits, args.level)
+    args.output.write(data)
+
+    if not args.quiet:
+        compressor = zlib.compressobj(args.level, zlib.DEFLATED, -args.window_bits, 9)
+        compressed_len = len(compressor.compress(new) + compressor.flush())
+        print('%s: %d bytes, compressed %d bytes, %s: %d bytes (%.1f%%), made in %.1f s' % (
+            args.new.name, len(new), compressed_len, args.output.name, len(data),
+            100 * len(data) / len(new), time.time() - start))
+        for link_kbps in args.link_speed:
+            print('download at %d kbit/s: %.1f s, compressed %.1f s, delta %.1f s' % (
+                link_kbps, download_time(len(new), link_kbps), download_time(compressed_len, link_kbps),
+                download_time(len(data), link_kbps)))
+
+
+if __name__ == '__main__':
+    main()
@@ -28,6 +28,41 @@ extern "C"
 #endif
 
 #define OTA_SIZE_UNKNOWN 0xffffffff /*!< Used for esp_ota_begin() if new image size is unknown */
+#define OTA_WITH_SEQUENTIAL_WRITES 0xfffffffe /*!< Used for esp_ota_begin() if new image size is unknown and erase can be done in incremental manner (assuming write operation is in continuous sequence) */
+
+#define ESP_OTA_SOURCE_ID_MAX_LEN 32 /*!< Max length of the source identifier passed to esp_ota_begin_resumable() */
+
+#define ESP_OTA_COMPRESSED_MAGIC 0x5a41544f /*!< "OTAZ", first word of a compressed OTA image */
+
+/**
+ * @brief Header of a compressed OTA image, as made by gen_compressed_ota.py
+ *
+ * It is followed by the image compressed as a raw deflate stream (RFC 1951)
+ * whose back references reach at most 2^window_bits bytes back.
+ */
+typedef struct {
+    uint32_t magic;         /*!< ESP_OTA_COMPRESSED_MAGIC */
+    uint8_t window_bits;    /*!< log2 of the deflate window size */
+    uint8_t reserved[3];    /*!< zero */
+    uint32_t image_size;    /*!< size of the decompressed image */
+} esp_ota_compressed_header_t;
+
+#define ESP_OTA_DELTA_MAGIC 0x4441544f /*!< "OTAD", first word of a delta OTA image */
+
+/**
+ * @brief Header of a delta OTA image, as made by gen_delta_ota.py
+ *
+ * It is followed by bsdiff style patch commands which rebuild the new image
+ * from the running one, compressed as for esp_ota_compressed_header_t. See
+ * gen_delta_ota.py for the command format.
+ */
+typedef struct {
+    uint32_t magic;             /*!< ESP_OTA_DELTA_MAGIC */
+    uint8_t window_bits;        /*!< log2 of the deflate window size */
+    uint8_t reserved[3];        /*!< zero */
+    uint32_t image_size;        /*!< size of the new image */
+    uint8_t source_digest[32];  /*!< SHA-256 appended to the app image the patch applies to */
+} esp_ota_delta_header_t;
 
 #define ESP_ERR_OTA_BASE                         0x1500                     /*!< Base error code for ota_ops api */
 #define ESP_ERR_OTA_PARTITION_CONFLICT           (ESP_ERR_OTA_BASE + 0x01)  /*!< Error if request was to write or erase the current running partition */
@@ -50,11 +85,15 @@ typedef uint32_t esp_ota_handle_t;
  * If image size is not yet known, pass OTA_SIZE_UNKNOWN which will
  * cause the entire partition to be erased.
  *
+ * If OTA_WITH_SEQUENTIAL_WRITES is passed, nothing is erased here: esp_ota_write()
+ * erases each flash sector when the written data first reaches it, so the erase
+ * time is spread over the download instead of blocking before it starts.
+ *
  * On success, this function allocates memory that remains in use
  * until esp_ota_end() is called with the returned handle.
  *
  * @param partition Pointer to info for partition which will receive the OTA update. Required.
- * @param image_size Size of new OTA app image. Partition will be erased in order to receive this size of image. If 0 or OTA_SIZE_UNKNOWN, the entire partition is erased.
+ * @param image_size Size of new OTA app image. Partition will be erased in order to receive this size of image. If 0 or OTA_SIZE_UNKNOWN, the entire partition is erased. If OTA_WITH_SEQUENTIAL_WRITES, the partition is erased by esp_ota_write() as data arrives.
  * @param out_handle On success, returns a handle which should be used for subsequent esp_ota_write() and esp_ota_end() calls.
 
  * @return
@@ -69,6 +108,59 @@ typedef uint32_t esp_ota_handle_t;
  */
 esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t image_size, esp_ota_handle_t* out_handle);
 
+/**
+ * @brief   Commence or resume an OTA update which survives a reboot
+ *
+ * Same as esp_ota_begin() with OTA_WITH_SEQUENTIAL_WRITES, but every
+ * CONFIG_APP_UPDATE_RESUME_CHECKPOINT_SECTORS flash sectors esp_ota_write()
+ * saves a checkpoint in NVS: the image offset reached, the state of the image
+ * checks including the SHA-256 being computed, a CRC32 of the written data and
+ * source_id. If the device reboots before esp_ota_end(), the next call with
+ * the same partition and source_id checks the CRC32 against the partition and
+ * continues from the last checkpoint, so that neither the data before it is
+ * downloaded again nor its sectors erased again. Get the offset the download
+ * has to continue from with esp_ota_get_resume_offset(), e.g. for an HTTP
+ * Range request.
+ *
+ * There is a single checkpoint: beginning a resumable update with another
+ * partition or source_id drops it and starts from offset 0. esp_ota_end()
+ * drops it as well, unless the image is just incomplete. It is also dropped
+ * when esp_ota_write() finds the image invalid.
+ *
+ * nvs_flash_init() has to be called first. Only esp_ota_write() can be used with
+ * the handle, the decompressor state of esp_ota_write_compressed() and
+ * esp_ota_write_delta() is too large to be saved.
+ *
+ * @param partition Pointer to info for partition which will receive the OTA update. Required.
+ * @param source_id Identifies the image being downloaded, e.g. its version or URL and ETag,
+ *                  at most ESP_OTA_SOURCE_ID_MAX_LEN characters. A checkpoint is only resumed with the same source_id.
+ * @param out_handle On success, returns a handle which should be used for subsequent esp_ota_write() and esp_ota_end() calls.
+ *
+ * @return
+ *    - ESP_OK: OTA operation commenced or resumed successfully.
+ *    - ESP_ERR_INVALID_ARG: an argument was NULL, source_id is too long, or partition doesn't point to an OTA app partition.
+ *    - ESP_ERR_NO_MEM: Cannot allocate memory for OTA operation.
+ *    - ESP_ERR_OTA_PARTITION_CONFLICT: Partition holds the currently running firmware, cannot update in place.
+ *    - ESP_ERR_NOT_FOUND: Partition argument not found in partition table.
+ *    - ESP_ERR_NVS_NOT_INITIALIZED or another NVS error: The checkpoint could not be accessed.
+ */
+esp_err_t esp_ota_begin_resumable(const esp_partition_t* partition, const char* source_id, esp_ota_handle_t* out_handle);
+
+/**
+ * @brief   Get the image offset the next esp_ota_write() data is written at
+ *
+ * This is the number of image bytes written so far, which for an update resumed by
+ * esp_ota_begin_resumable() starts at the last checkpoint.
+ *
+ * @param handle  Handle obtained from esp_ota_begin() or esp_ota_begin_resumable()
+ * @param offset  Returns the offset in the image, the data before it must not be written again.
+ *
+ * @return
+ *    - ESP_OK: offset was returned.
+ *    - ESP_ERR_INVALID_ARG: handle is invalid or offset is NULL.
+ */
+esp_err_t esp_ota_get_resume_offset(esp_ota_handle_t handle, size_t* offset);
+
 /**
  * @brief   Write OTA update data to partition
  *
@@ -76,6 +168,10 @@ esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t image_size, esp
  * data is received during the OTA operation. Data is written
  * sequentially to the partition.
  *
+ * On ESP8266 the image is parsed as it is written: the segment headers are
+ * checked and the checksum and the SHA-256 digest appended by esptool.py are
+ * verified on the fly, so esp_ota_end() does not have to read the image back.
+ *
  * @param handle  Handle obtained from esp_ota_begin
  * @param data    Data buffer to write
  * @param size    Size of data buffer in bytes.
@@ -83,12 +179,87 @@ esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t image_size, esp
  * @return
  *    - ESP_OK: Data was written to flash successfully.
  *    - ESP_ERR_INVALID_ARG: handle is invalid.
- *    - ESP_ERR_OTA_VALIDATE_FAILED: First byte of image contains invalid app image magic byte.
+ *    - ESP_ERR_OTA_VALIDATE_FAILED: First byte of image contains invalid app image magic byte, or (on ESP8266) a segment header, the checksum or the digest is invalid.
  *    - ESP_ERR_FLASH_OP_TIMEOUT or ESP_ERR_FLASH_OP_FAIL: Flash write failed.
  *    - ESP_ERR_OTA_SELECT_INFO_INVALID: OTA data partition has invalid contents
  */
 esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size);
 
+/**
+ * @brief   Erase the flash the next OTA update data will be written to
+ *
+ * For an update started with OTA_WITH_SEQUENTIAL_WRITES, erases up to one sector
+ * beyond the current write position, so that the next esp_ota_write() calls do not
+ * have to. Call it while waiting for more data, e.g. before blocking on the socket,
+ * to overlap the erase with the network transfer. It does nothing for other updates.
+ *
+ * @param handle  Handle obtained from esp_ota_begin
+ *
+ * @return
+ *    - ESP_OK: Flash was erased or nothing had to be erased.
+ *    - ESP_ERR_INVALID_ARG: handle is invalid.
+ *    - ESP_ERR_FLASH_OP_TIMEOUT or ESP_ERR_FLASH_OP_FAIL: Flash erase failed.
+ */
+esp_err_t esp_ota_erase_ahead(esp_ota_handle_t handle);
+
+/**
+ * @brief   Write compressed OTA update data to partition
+ *
+ * Same as esp_ota_write(), for a compressed image made by gen_compressed_ota.py
+ * ("make app-compressed"). The data starts with an esp_ota_compressed_header_t.
+ * It is decompressed through a window of 2^window_bits bytes, which is passed
+ * to esp_ota_write() each time it fills up or the input runs out, so the
+ * decompressed image is never held in RAM. The decompressor state takes about
+ * 11 KB of heap on top of the window, both are allocated by the first call
+ * and freed by esp_ota_end().
+ *
+ * All data written with a handle has to go through one of esp_ota_write(),
+ * esp_ota_write_compressed() and esp_ota_write_delta().
+ *
+ * @param handle  Handle obtained from esp_ota_begin
+ * @param data    Compressed data buffer to write
+ * @param size    Size of data buffer in bytes.
+ *
+ * @return
+ *    - ESP_OK: Data was decompressed and written to flash successfully.
+ *    - ESP_ERR_INVALID_ARG: handle is invalid, another write function was used with it or it is resumable.
+ *    - ESP_ERR_NO_MEM: Cannot allocate the decompressor.
+ *    - ESP_ERR_OTA_VALIDATE_FAILED: The header or the compressed data is invalid, the window is larger
+ *      than CONFIG_APP_UPDATE_COMPRESSED_WINDOW_BITS, or the decompressed image failed esp_ota_write() checks.
+ *    - ESP_ERR_FLASH_OP_TIMEOUT or ESP_ERR_FLASH_OP_FAIL: Flash write failed.
+ */
+esp_err_t esp_ota_write_compressed(esp_ota_handle_t handle, const void* data, size_t size);
+
+/**
+ * @brief   Write delta OTA update data to partition
+ *
+ * Same as esp_ota_write_compressed(), for a patch made by gen_delta_ota.py
+ * from the running app image and the new one. The data starts with an
+ * esp_ota_delta_header_t, whose source digest has to match the SHA-256
+ * appended to the running app by esptool.py elf2image --version=3. Without
+ * CONFIG_ENABLE_BOOT_CHECK_SHA256 the loader doesn't check that digest, so
+ * the first call hashes the running app to check it.
+ * The new image is rebuilt by reading the running partition with
+ * esp_partition_read() and passed to esp_ota_write(), so it is validated the
+ * same way. Only 512 bytes of heap are used on top of the decompressor.
+ *
+ * The update partition has to be another one than the running partition, as
+ * esp_ota_begin() requires, e.g. the one returned by esp_ota_get_next_update_partition(NULL).
+ *
+ * @param handle  Handle obtained from esp_ota_begin
+ * @param data    Patch data buffer to write
+ * @param size    Size of data buffer in bytes.
+ *
+ * @return
+ *    - ESP_OK: Data was applied and written to flash successfully.
+ *    - ESP_ERR_INVALID_ARG: handle is invalid, another write function was used with it or it is resumable.
+ *    - ESP_ERR_NO_MEM: Cannot allocate the decompressor.
+ *    - ESP_ERR_OTA_VALIDATE_FAILED: The header or the patch is invalid, the patch was made for another
+ *      app than the running one, or the new image failed esp_ota_write() checks.
+ *    - ESP_ERR_FLASH_OP_TIMEOUT or ESP_ERR_FLASH_OP_FAIL: Flash read or write failed.
+ */
+esp_err_t esp_ota_write_delta(esp_ota_handle_t handle, const void* data, size_t size);
+
 /**
  * @brief Finish OTA update and validate newly written app image.
  *
@@ -96,11 +267,14 @@ esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size);
  *
  * @note After calling esp_ota_end(), the handle is no longer valid and any memory associated with it is freed (regardless of result).
  *
+ * @note For an update begun with esp_ota_begin_resumable(), the checkpoint is kept if the image is
+ *       incomplete, so that it can be resumed after a reboot, and dropped otherwise.
+ *
  * @return
  *    - ESP_OK: Newly written OTA app image is valid.
  *    - ESP_ERR_NOT_FOUND: OTA handle was not found.
  *    - ESP_ERR_INVALID_ARG: Handle was never written to.
- *    - ESP_ERR_OTA_VALIDATE_FAILED: OTA image is invalid (either not a valid app image, or - if secure boot is enabled - signature failed to verify.)
+ *    - ESP_ERR_OTA_VALIDATE_FAILED: OTA image is invalid (either not a valid app image, a truncated compressed or delta image, or - if secure boot is enabled - signature failed to verify.)
  *    - ESP_ERR_INVALID_STATE: If flash encryption is enabled, this result indicates an internal error writing the final encrypted bytes to flash.
  */
 esp_err_t esp_ota_end(esp_ota_handle_t handle);
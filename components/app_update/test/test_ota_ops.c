@@ -8,6 +8,9 @@
 #include <unity.h>
 #include <test_utils.h>
 #include <esp_ota_ops.h>
+#include <esp_image_format.h>
+#include <nvs_flash.h>
+#include <sdkconfig.h>
 
 
 /* These OTA tests currently don't assume an OTA partition exists
@@ -84,3 +87,385 @@ TEST_CASE("esp_ota_get_next_update_partition logic", "[ota]")
     TEST_ASSERT_EQUAL_PTR(ota_0, p);
 }
 
+/* Length of the running app image, including the SHA-256 digest appended by esptool.py */
+static uint32_t test_ota_running_app_len(void)
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    const esp_partition_pos_t running_pos = {
+        .offset = running->address,
+        .size = running->size,
+    };
+    esp_image_metadata_t data;
+
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_image_load(ESP_IMAGE_VERIFY, &running_pos, &data));
+#ifdef CONFIG_ENABLE_BOOT_CHECK_SHA256
+    return data.image_len;
+#else
+    /* the loader only counts the digest when it checks it */
+    return data.image_len + 32;
+#endif
+}
+
+/* Write the running app the way an OTA download would, in MSS sized chunks.
+   The byte at corrupt_offset is flipped, pass UINT32_MAX to keep it intact.
+*/
+static esp_err_t test_ota_write_running_app(esp_ota_handle_t handle, uint32_t image_len, bool erase_ahead, uint32_t corrupt_offset)
+{
+    const size_t chunk_len = 1460;
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    uint8_t *buf = malloc(chunk_len);
+    esp_err_t ret = ESP_OK;
+
+    TEST_ASSERT_NOT_NULL(buf);
+
+    for (size_t off = 0; off < image_len && ret == ESP_OK; off += chunk_len) {
+        size_t len = image_len - off < chunk_len ? image_len - off : chunk_len;
+
+        if (erase_ahead) {
+            TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_erase_ahead(handle));
+        }
+        TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_partition_read(running, off, buf, len));
+        if (corrupt_offset >= off && corrupt_offset < off + len) {
+            buf[corrupt_offset - off] ^= 0x01;
+        }
+        ret = esp_ota_write(handle, buf, len);
+    }
+
+    free(buf);
+    return ret;
+}
+
+/* Copy the running app to the next OTA slot and report how long esp_ota_begin()
+   blocks and the overall throughput for each erase mode. The running app stands
+   in for a downloaded image file, so the numbers only cover the flash side of an
+   update.
+*/
+static void test_ota_copy_running_app(size_t image_size, bool erase_ahead)
+{
+    const esp_partition_t *update = esp_ota_get_next_update_partition(NULL);
+    uint32_t image_len = test_ota_running_app_len();
+    esp_ota_handle_t handle;
+    TickType_t start, begin_ticks, total_ticks;
+
+    TEST_ASSERT_NOT_NULL(update);
+
+    start = xTaskGetTickCount();
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_begin(update, image_size, &handle));
+    begin_ticks = xTaskGetTickCount() - start;
+
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, test_ota_write_running_app(handle, image_len, erase_ahead, UINT32_MAX));
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_end(handle));
+    total_ticks = xTaskGetTickCount() - start;
+
+    printf("%s%s: %u KB, begin %u ms, total %u ms, %u KB/s\n",
+           image_size == OTA_WITH_SEQUENTIAL_WRITES ? "OTA_WITH_SEQUENTIAL_WRITES" : "OTA_SIZE_UNKNOWN",
+           erase_ahead ? " + esp_ota_erase_ahead" : "", image_len / 1024,
+           begin_ticks * portTICK_PERIOD_MS, total_ticks * portTICK_PERIOD_MS,
+           image_len / (total_ticks * portTICK_PERIOD_MS + 1));
+}
+
+TEST_CASE("esp_ota_write() erases incrementally with OTA_WITH_SEQUENTIAL_WRITES", "[ota][timeout=120]")
+{
+    test_ota_copy_running_app(OTA_SIZE_UNKNOWN, false);
+    test_ota_copy_running_app(OTA_WITH_SEQUENTIAL_WRITES, false);
+    test_ota_copy_running_app(OTA_WITH_SEQUENTIAL_WRITES, true);
+}
+
+TEST_CASE("esp_ota_write() rejects corrupted images", "[ota][timeout=60]")
+{
+    const esp_partition_t *update = esp_ota_get_next_update_partition(NULL);
+    uint32_t image_len = test_ota_running_app_len();
+    /* a segment header, segment data, the checksum and the digest */
+    const uint32_t corrupt_offsets[] = { 12, image_len / 2, image_len - 33, image_len - 1 };
+    esp_ota_handle_t handle;
+
+    TEST_ASSERT_NOT_NULL(update);
+
+    for (int i = 0; i < sizeof(corrupt_offsets) / sizeof(corrupt_offsets[0]); i++) {
+        TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_begin(update, OTA_WITH_SEQUENTIAL_WRITES, &handle));
+        TEST_ASSERT_EQUAL_HEX(ESP_ERR_OTA_VALIDATE_FAILED, test_ota_write_running_app(handle, image_len, false, corrupt_offsets[i]));
+        TEST_ASSERT_NOT_EQUAL(ESP_OK, esp_ota_end(handle));
+    }
+
+    /* truncated image */
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_begin(update, OTA_WITH_SEQUENTIAL_WRITES, &handle));
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, test_ota_write_running_app(handle, image_len - 1, false, UINT32_MAX));
+    TEST_ASSERT_EQUAL_HEX(ESP_ERR_OTA_VALIDATE_FAILED, esp_ota_end(handle));
+}
+
+/* There is no compressor on the device, so the tests below send deflate
+   "stored" blocks of an MSS each. This runs all of the decompression path
+   except the Huffman decoding.
+*/
+typedef struct {
+    esp_ota_handle_t handle;
+    esp_err_t (*write)(esp_ota_handle_t handle, const void *data, size_t size);
+    esp_err_t ret;
+    size_t len;
+    uint8_t block[1460];        /* 5 bytes block header, then the data */
+} test_deflate_t;
+
+static void test_deflate_flush(test_deflate_t *d, bool final)
+{
+    d->block[0] = final;        /* BFINAL, BTYPE 0 */
+    d->block[1] = d->len;
+    d->block[2] = d->len >> 8;
+    d->block[3] = ~d->len;
+    d->block[4] = ~d->len >> 8;
+    if (d->ret == ESP_OK) {
+        d->ret = d->write(d->handle, d->block, d->len + 5);
+    }
+    d->len = 0;
+}
+
+static void test_deflate_put(test_deflate_t *d, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    while (len > 0) {
+        size_t n = sizeof(d->block) - 5 - d->len;
+
+        n = len < n ? len : n;
+        memcpy(d->block + 5 + d->len, p, n);
+        d->len += n;
+        p += n;
+        len -= n;
+        if (d->len == sizeof(d->block) - 5) {
+            test_deflate_flush(d, false);
+        }
+    }
+}
+
+static void test_deflate_put_running_app(test_deflate_t *d, uint32_t offset, size_t len)
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    uint8_t buf[256];
+
+    while (len > 0) {
+        size_t n = len < sizeof(buf) ? len : sizeof(buf);
+
+        TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_partition_read(running, offset, buf, n));
+        test_deflate_put(d, buf, n);
+        offset += n;
+        len -= n;
+    }
+}
+
+static void test_deflate_put_zeros(test_deflate_t *d, size_t len)
+{
+    static const uint8_t zeros[256];
+
+    while (len > 0) {
+        size_t n = len < sizeof(zeros) ? len : sizeof(zeros);
+
+        test_deflate_put(d, zeros, n);
+        len -= n;
+    }
+}
+
+static void test_deflate_put_number(test_deflate_t *d, uint32_t value)
+{
+    uint8_t byte;
+
+    do {
+        byte = value & 0x7f;
+        value >>= 7;
+        if (value) {
+            byte |= 0x80;
+        }
+        test_deflate_put(d, &byte, 1);
+    } while (value);
+}
+
+static esp_err_t test_ota_write_running_app_compressed(esp_ota_handle_t handle, uint32_t image_len, uint8_t window_bits)
+{
+    const esp_ota_compressed_header_t header = {
+        .magic = ESP_OTA_COMPRESSED_MAGIC,
+        .window_bits = window_bits,
+        .image_size = image_len,
+    };
+    test_deflate_t *d = calloc(1, sizeof(test_deflate_t));
+    esp_err_t ret;
+
+    TEST_ASSERT_NOT_NULL(d);
+    d->handle = handle;
+    d->write = esp_ota_write_compressed;
+    d->ret = esp_ota_write_compressed(handle, &header, sizeof(header));
+
+    test_deflate_put_running_app(d, 0, image_len);
+    test_deflate_flush(d, true);
+
+    ret = d->ret;
+    free(d);
+    return ret;
+}
+
+TEST_CASE("esp_ota_write_compressed() decompresses into the OTA partition", "[ota][timeout=120]")
+{
+    const esp_partition_t *update = esp_ota_get_next_update_partition(NULL);
+    uint32_t image_len = test_ota_running_app_len();
+    esp_ota_handle_t handle;
+    TickType_t start, ticks;
+
+    TEST_ASSERT_NOT_NULL(update);
+
+    start = xTaskGetTickCount();
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_begin(update, OTA_WITH_SEQUENTIAL_WRITES, &handle));
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, test_ota_write_running_app_compressed(handle, image_len, CONFIG_APP_UPDATE_COMPRESSED_WINDOW_BITS));
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_end(handle));
+    ticks = xTaskGetTickCount() - start;
+
+    printf("esp_ota_write_compressed: %u KB, total %u ms, %u KB/s\n", image_len / 1024,
+           ticks * portTICK_PERIOD_MS, image_len / (ticks * portTICK_PERIOD_MS + 1));
+
+    /* window larger than configured */
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_begin(update, OTA_WITH_SEQUENTIAL_WRITES, &handle));
+    TEST_ASSERT_EQUAL_HEX(ESP_ERR_OTA_VALIDATE_FAILED,
+                          test_ota_write_running_app_compressed(handle, image_len, CONFIG_APP_UPDATE_COMPRESSED_WINDOW_BITS + 1));
+    TEST_ASSERT_NOT_EQUAL(ESP_OK, esp_ota_end(handle));
+
+    /* truncated image */
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_begin(update, OTA_WITH_SEQUENTIAL_WRITES, &handle));
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, test_ota_write_running_app_compressed(handle, image_len - 1, CONFIG_APP_UPDATE_COMPRESSED_WINDOW_BITS));
+    TEST_ASSERT_EQUAL_HEX(ESP_ERR_OTA_VALIDATE_FAILED, esp_ota_end(handle));
+}
+
+/* Write a patch which rebuilds the running app from itself: zero diff bytes
+   for most of it, and a part copied as extra bytes, which the next command
+   seeks over in the running app.
+*/
+static esp_err_t test_ota_write_running_app_delta(esp_ota_handle_t handle, uint32_t image_len, bool wrong_source)
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    const uint32_t extra_offset = image_len / 2, extra_len = 100;
+    esp_ota_delta_header_t header = {
+        .magic = ESP_OTA_DELTA_MAGIC,
+        .window_bits = CONFIG_APP_UPDATE_COMPRESSED_WINDOW_BITS,
+        .image_size = image_len,
+    };
+    test_deflate_t *d = calloc(1, sizeof(test_deflate_t));
+    esp_err_t ret;
+
+    TEST_ASSERT_NOT_NULL(d);
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_partition_read(running, image_len - sizeof(header.source_digest),
+                                                     header.source_digest, sizeof(header.source_digest)));
+    header.source_digest[0] ^= wrong_source;
+
+    d->handle = handle;
+    d->write = esp_ota_write_delta;
+    d->ret = esp_ota_write_delta(handle, &header, sizeof(header));
+
+    test_deflate_put_number(d, extra_offset);
+    test_deflate_put_zeros(d, extra_offset);
+    test_deflate_put_number(d, extra_len);
+    test_deflate_put_running_app(d, extra_offset, extra_len);
+    test_deflate_put_number(d, extra_len * 2);     /* zigzag encoded */
+
+    test_deflate_put_number(d, image_len - extra_offset - extra_len);
+    test_deflate_put_zeros(d, image_len - extra_offset - extra_len);
+    test_deflate_put_number(d, 0);
+    test_deflate_put_number(d, 0);
+    test_deflate_flush(d, true);
+
+    ret = d->ret;
+    free(d);
+    return ret;
+}
+
+TEST_CASE("esp_ota_write_delta() rebuilds the running app into the OTA partition", "[ota][timeout=120]")
+{
+    const esp_partition_t *update = esp_ota_get_next_update_partition(NULL);
+    uint32_t image_len = test_ota_running_app_len();
+    esp_ota_handle_t handle;
+    TickType_t start, ticks;
+
+    TEST_ASSERT_NOT_NULL(update);
+
+    start = xTaskGetTickCount();
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_begin(update, OTA_WITH_SEQUENTIAL_WRITES, &handle));
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, test_ota_write_running_app_delta(handle, image_len, false));
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_end(handle));
+    ticks = xTaskGetTickCount() - start;
+
+    printf("esp_ota_write_delta: %u KB, total %u ms, %u KB/s\n", image_len / 1024,
+           ticks * portTICK_PERIOD_MS, image_len / (ticks * portTICK_PERIOD_MS + 1));
+
+    /* patch for another app */
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_begin(update, OTA_WITH_SEQUENTIAL_WRITES, &handle));
+    TEST_ASSERT_EQUAL_HEX(ESP_ERR_OTA_VALIDATE_FAILED, test_ota_write_running_app_delta(handle, image_len, true));
+    TEST_ASSERT_NOT_EQUAL(ESP_OK, esp_ota_end(handle));
+}
+
+/* Write the running app from offset 'start' up to 'end', as a download resumed with an HTTP Range request */
+static esp_err_t test_ota_write_running_app_range(esp_ota_handle_t handle, uint32_t start, uint32_t end)
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    uint8_t *buf = malloc(1460);
+    esp_err_t ret = ESP_OK;
+
+    TEST_ASSERT_NOT_NULL(buf);
+
+    for (uint32_t off = start; off < end && ret == ESP_OK; off += 1460) {
+        size_t len = end - off < 1460 ? end - off : 1460;
+
+        TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_partition_read(running, off, buf, len));
+        ret = esp_ota_write(handle, buf, len);
+    }
+
+    free(buf);
+    return ret;
+}
+
+TEST_CASE("esp_ota_begin_resumable() resumes an update from its last checkpoint", "[ota][timeout=120]")
+{
+    const esp_partition_t *update = esp_ota_get_next_update_partition(NULL);
+    const uint32_t interval = CONFIG_APP_UPDATE_RESUME_CHECKPOINT_SECTORS * SPI_FLASH_SEC_SIZE;
+    uint32_t image_len = test_ota_running_app_len();
+    uint32_t cut = image_len / 2;
+    esp_ota_handle_t handle;
+    TickType_t start, ticks;
+    size_t offset;
+
+    TEST_ASSERT_NOT_NULL(update);
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, nvs_flash_init());
+
+    /* another source id drops any checkpoint left by a previous run */
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_begin_resumable(update, "test-0", &handle));
+    TEST_ASSERT_NOT_EQUAL(ESP_OK, esp_ota_end(handle));
+
+    /* the download stops half way, and the handle is lost as in a reboot */
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_begin_resumable(update, "test-1", &handle));
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_get_resume_offset(handle, &offset));
+    TEST_ASSERT_EQUAL(0, offset);
+    TEST_ASSERT_EQUAL_HEX(ESP_ERR_INVALID_ARG, esp_ota_write_compressed(handle, "", 0));
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, test_ota_write_running_app_range(handle, 0, cut));
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_get_resume_offset(handle, &offset));
+    TEST_ASSERT_EQUAL(cut, offset);
+    TEST_ASSERT_EQUAL_HEX(ESP_ERR_OTA_VALIDATE_FAILED, esp_ota_end(handle));
+
+    /* it continues from the last checkpoint */
+    start = xTaskGetTickCount();
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_begin_resumable(update, "test-1", &handle));
+    ticks = xTaskGetTickCount() - start;
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_get_resume_offset(handle, &offset));
+    TEST_ASSERT_EQUAL(cut - cut % interval, offset);
+    TEST_ASSERT_NOT_EQUAL(0, offset);
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, test_ota_write_running_app_range(handle, offset, image_len));
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_end(handle));
+
+    printf("esp_ota_begin_resumable: resumed at %u KB of %u KB in %u ms\n", offset / 1024, image_len / 1024,
+           ticks * portTICK_PERIOD_MS);
+
+    /* the checkpoint is dropped with the completed update */
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_begin_resumable(update, "test-1", &handle));
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_get_resume_offset(handle, &offset));
+    TEST_ASSERT_EQUAL(0, offset);
+
+    /* and a checkpoint of another source is not resumed */
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, test_ota_write_running_app_range(handle, 0, cut));
+    TEST_ASSERT_EQUAL_HEX(ESP_ERR_OTA_VALIDATE_FAILED, esp_ota_end(handle));
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_begin_resumable(update, "test-2", &handle));
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_ota_get_resume_offset(handle, &offset));
+    TEST_ASSERT_EQUAL(0, offset);
+    TEST_ASSERT_NOT_EQUAL(ESP_OK, esp_ota_end(handle));
+}
@@ -0,0 +1,93 @@
+#!/usr/bin/env python
+#
+# Write the app images of test_delta_ota_host.c:
+#
+#   base.bin      app image with a SHA-256 appended, running on the device
+#   new.bin       base.bin with code inserted, the addresses behind it shifted
+#                 and a few bytes changed
+#   other.bin     an unrelated app image
+#   nodigest.bin  base.bin without its SHA-256
+#
+# Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http:#www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+from __future__ import print_function, division
+import hashlib
+import random
+import struct
+
+TEXT_ADDR = 0x40210010
+DATA_ADDR = 0x3ffe8000
+
+
+def make_image(segments, digest=True):
+    """ esptool.py elf2image --version=3 layout: header, segments, checksum
+    in the last byte of the padding to 16 bytes, then the SHA-256 """
+    image = bytearray(struct.pack('<BBBBI', 0xE9, len(segments), 2, 0x20, TEXT_ADDR))
+    checksum = 0xEF
+    for addr, data in segments:
+        image += struct.pack('<II', addr, len(data)) + data
+        for b in bytearray(data):
+            checksum ^= b
+    image += bytearray(15 - len(image) % 16) + bytearray([checksum])
+    if digest:
+        image += hashlib.sha256(image).digest()
+    return bytes(image)
+
+
+def make_code(rnd, words):
+    """ Code-like words, with calls to addresses in the code """
+    out = bytearray()
+    for i in range(words):
+        if rnd.random() < 0.2:
+            out += struct.pack('<I', TEXT_ADDR + 4 * rnd.randrange(words))
+        else:
+            out += struct.pack('<I', rnd.getrandbits(16))
+    return out
+
+
+def shift_calls(code, at, shift):
+    """ Move the code after at by shift bytes, and the addresses pointing there """
+    out = bytearray()
+    for i in range(0, len(code), 4):
+        word, = struct.unpack_from('<I', code, i)
+        if TEXT_ADDR + at <= word < TEXT_ADDR + len(code):
+            word += shift
+        out += struct.pack('<I', word)
+    return out
+
+
+def main():
+    rnd = random.Random(45)
+    code = make_code(rnd, 12000)
+    data = bytearray(rnd.getrandbits(8) for _ in range(4000))
+    base = [(TEXT_ADDR, bytes(code)), (DATA_ADDR, bytes(data))]
+
+    at = 20000
+    inserted = make_code(rnd, 256)
+    new_code = shift_calls(code, at, len(inserted))
+    new_code = new_code[:at] + inserted + new_code[at:]
+    for _ in range(20):
+        new_code[rnd.randrange(len(new_code))] ^= 0xff
+    new = [(TEXT_ADDR, bytes(new_code)), (DATA_ADDR, bytes(data))]
+
+    other = [(TEXT_ADDR, bytes(make_code(rnd, 12000))), (DATA_ADDR, bytes(data))]
+
+    for name, segments, digest in (('base.bin', base, True), ('new.bin', new, True),
+                                   ('other.bin', other, True), ('nodigest.bin', base, False)):
+        with open(name, 'wb') as f:
+            f.write(make_image(segments, digest))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,21 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#define CONFIG_TARGET_PLATFORM_ESP8266 1
+#define CONFIG_APP_UPDATE_COMPRESSED_WINDOW_BITS 12
+#define CONFIG_APP_UPDATE_RESUME_CHECKPOINT_SECTORS 8
+
+/* CONFIG_ENABLE_BOOT_CHECK_SHA256 is set by the Makefile */
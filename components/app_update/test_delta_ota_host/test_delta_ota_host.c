@@ -0,0 +1,349 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Applies a patch made by gen_delta_ota.py with esp_ota_write_delta(), on a
+ * simulated flash holding the running app in ota_0, and checks the image
+ * rebuilt in ota_1. The images are written by gen_test_images.py, see the
+ * Makefile. It is built with and without CONFIG_ENABLE_BOOT_CHECK_SHA256,
+ * which changes the image length esp_image_load() returns.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../esp_ota_ops.c"
+
+#define FLASH_SIZE      0x110000
+#define OTADATA_ADDR    0x9000
+#define OTA_0_ADDR      0x10000
+#define OTA_1_ADDR      0x90000
+#define APP_SIZE        0x80000
+#define MAX_IMAGE_LEN   0x20000
+
+static int s_failed;
+
+#define CHECK(cond)     do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            s_failed++; \
+        } \
+    } while (0)
+
+/* Simulated flash and partition table */
+
+static uint8_t s_flash[FLASH_SIZE];
+
+static const esp_partition_t s_partitions[] = {
+    { .type = ESP_PARTITION_TYPE_DATA, .subtype = ESP_PARTITION_SUBTYPE_DATA_OTA,
+      .address = OTADATA_ADDR, .size = 0x2000, .label = "otadata" },
+    { .type = ESP_PARTITION_TYPE_APP, .subtype = ESP_PARTITION_SUBTYPE_APP_OTA_0,
+      .address = OTA_0_ADDR, .size = APP_SIZE, .label = "ota_0" },
+    { .type = ESP_PARTITION_TYPE_APP, .subtype = ESP_PARTITION_SUBTYPE_APP_OTA_1,
+      .address = OTA_1_ADDR, .size = APP_SIZE, .label = "ota_1" },
+};
+
+#define PARTITION_NUM   (sizeof(s_partitions) / sizeof(s_partitions[0]))
+
+static const esp_partition_t *s_running = &s_partitions[1];
+static const esp_partition_t *s_update = &s_partitions[2];
+
+static const esp_partition_t *partition_find(int from, esp_partition_type_t type, esp_partition_subtype_t subtype)
+{
+    for (int i = from; i < PARTITION_NUM; i++) {
+        if (s_partitions[i].type == type && (subtype == ESP_PARTITION_SUBTYPE_ANY || s_partitions[i].subtype == subtype)) {
+            return &s_partitions[i];
+        }
+    }
+    return NULL;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label)
+{
+    return partition_find(0, type, subtype);
+}
+
+/* The iterators are the partitions themselves, only used to count the app partitions */
+esp_partition_iterator_t esp_partition_find(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label)
+{
+    return (esp_partition_iterator_t)partition_find(0, type, subtype);
+}
+
+const esp_partition_t *esp_partition_get(esp_partition_iterator_t iterator)
+{
+    return (const esp_partition_t *)iterator;
+}
+
+esp_partition_iterator_t esp_partition_next(esp_partition_iterator_t iterator)
+{
+    const esp_partition_t *p = (const esp_partition_t *)iterator;
+
+    return (esp_partition_iterator_t)partition_find(p - s_partitions + 1, p->type, ESP_PARTITION_SUBTYPE_ANY);
+}
+
+void esp_partition_iterator_release(esp_partition_iterator_t iterator)
+{
+}
+
+const esp_partition_t *esp_partition_verify(const esp_partition_t *partition)
+{
+    for (int i = 0; i < PARTITION_NUM; i++) {
+        if (s_partitions[i].address == partition->address) {
+            return &s_partitions[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    if (src_offset > partition->size || size > partition->size - src_offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dst, s_flash + partition->address + src_offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+    if (dst_offset > partition->size || size > partition->size - dst_offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    for (size_t i = 0; i < size; i++) {
+        s_flash[partition->address + dst_offset + i] &= ((const uint8_t *)src)[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, uint32_t start_addr, uint32_t size)
+{
+    if (start_addr % SPI_FLASH_SEC_SIZE || size % SPI_FLASH_SEC_SIZE
+        || start_addr > partition->size || size > partition->size - start_addr) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memset(s_flash + partition->address + start_addr, 0xff, size);
+    return ESP_OK;
+}
+
+esp_err_t spi_flash_read(size_t src_addr, void *dest, size_t size)
+{
+    if (src_addr > FLASH_SIZE || size > FLASH_SIZE - src_addr) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dest, s_flash + src_addr, size);
+    return ESP_OK;
+}
+
+esp_err_t spi_flash_write(size_t dest_addr, const void *src, size_t size)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t spi_flash_erase_sector(size_t sector)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t bootloader_flash_read(size_t src_addr, void *dest, size_t size, bool allow_decrypt)
+{
+    return spi_flash_read(src_addr, dest, size);
+}
+
+/* Same image length as the loader: the SHA-256 is checked and counted with CONFIG_ENABLE_BOOT_CHECK_SHA256 */
+esp_err_t esp_image_load(esp_image_load_mode_t mode, const esp_partition_pos_t *part, esp_image_metadata_t *data)
+{
+    const uint8_t *image = s_flash + part->offset;
+    uint32_t len = sizeof(esp_image_header_t);
+
+    memset(data, 0, sizeof(*data));
+    memcpy(&data->image, image, sizeof(data->image));
+    if (data->image.magic != ESP_IMAGE_HEADER_MAGIC || data->image.segment_count > ESP_IMAGE_MAX_SEGMENTS) {
+        return ESP_ERR_IMAGE_INVALID;
+    }
+    for (int i = 0; i < data->image.segment_count; i++) {
+        memcpy(&data->segments[i], image + len, sizeof(data->segments[i]));
+        len += sizeof(data->segments[i]) + data->segments[i].data_len;
+        if (len > part->size) {
+            return ESP_ERR_IMAGE_INVALID;
+        }
+    }
+    len = (len + 16) & ~15;
+
+#ifdef CONFIG_ENABLE_BOOT_CHECK_SHA256
+    uint8_t digest[ESP_SHA256_DIGEST_LEN];
+
+    esp_sha(ESP_SHA256, image, len, digest);
+    if (memcmp(digest, image + len, sizeof(digest)) != 0) {
+        return ESP_ERR_IMAGE_INVALID;
+    }
+    len += sizeof(digest);
+#endif
+
+    data->start_addr = part->offset;
+    data->image_len = len;
+    return ESP_OK;
+}
+
+esp_err_t esp_secure_boot_verify_signature(uint32_t src_addr, uint32_t length)
+{
+    return ESP_OK;
+}
+
+uint32_t crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+/* Only esp_ota_begin_resumable() uses NVS */
+
+esp_err_t nvs_open(const char *name, nvs_open_mode open_mode, nvs_handle *out_handle)
+{
+    return ESP_ERR_NVS_NOT_INITIALIZED;
+}
+
+void nvs_close(nvs_handle handle)
+{
+}
+
+esp_err_t nvs_commit(nvs_handle handle)
+{
+    return ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+esp_err_t nvs_get_blob(nvs_handle handle, const char *key, void *out_value, size_t *length)
+{
+    return ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+esp_err_t nvs_set_blob(nvs_handle handle, const char *key, const void *value, size_t length)
+{
+    return ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+esp_err_t nvs_erase_key(nvs_handle handle, const char *key)
+{
+    return ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+/* Test */
+
+typedef struct {
+    uint8_t data[MAX_IMAGE_LEN];
+    size_t len;
+} test_file_t;
+
+static test_file_t s_base, s_new, s_other, s_nodigest, s_delta;
+
+static void read_file(const char *name, test_file_t *file)
+{
+    FILE *f = fopen(name, "rb");
+
+    if (f == NULL) {
+        printf("can't open %s, run make test\n", name);
+        exit(2);
+    }
+    file->len = fread(file->data, 1, sizeof(file->data), f);
+    fclose(f);
+}
+
+static void flash_running(const test_file_t *image)
+{
+    memset(s_flash, 0xff, sizeof(s_flash));
+    memcpy(s_flash + s_running->address, image->data, image->len);
+}
+
+/* Write the patch in chunks of random sizes, return the first error */
+static esp_err_t apply_delta(const test_file_t *delta, size_t max_chunk)
+{
+    esp_ota_handle_t handle;
+    esp_err_t ret, end_ret;
+    size_t offset = 0;
+
+    ret = esp_ota_begin(s_update, OTA_WITH_SEQUENTIAL_WRITES, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    while (offset < delta->len && ret == ESP_OK) {
+        size_t n = 1 + rand() % max_chunk;
+
+        if (n > delta->len - offset) {
+            n = delta->len - offset;
+        }
+        ret = esp_ota_write_delta(handle, delta->data + offset, n);
+        offset += n;
+    }
+    end_ret = esp_ota_end(handle);
+    return ret != ESP_OK ? ret : end_ret;
+}
+
+static void test_apply(void)
+{
+    const size_t chunks[] = { 1, 7, 100, 1500, sizeof(s_delta.data) };
+
+    for (int i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        flash_running(&s_base);
+        CHECK(apply_delta(&s_delta, chunks[i]) == ESP_OK);
+        CHECK(memcmp(s_flash + s_update->address, s_new.data, s_new.len) == 0);
+    }
+}
+
+static void test_other_app(void)
+{
+    flash_running(&s_other);
+    CHECK(apply_delta(&s_delta, 1500) == ESP_ERR_OTA_VALIDATE_FAILED);
+}
+
+/* The same app flashed without its digest, so the base can't be told */
+static void test_no_digest(void)
+{
+    flash_running(&s_nodigest);
+    CHECK(apply_delta(&s_delta, 1500) == ESP_ERR_OTA_VALIDATE_FAILED);
+}
+
+static void test_corrupt_running_app(void)
+{
+    flash_running(&s_base);
+    s_flash[s_running->address + s_base.len / 2] ^= 1;
+    CHECK(apply_delta(&s_delta, 1500) == ESP_ERR_OTA_VALIDATE_FAILED);
+}
+
+int main(void)
+{
+    read_file("base.bin", &s_base);
+    read_file("new.bin", &s_new);
+    read_file("other.bin", &s_other);
+    read_file("nodigest.bin", &s_nodigest);
+    read_file("delta.bin", &s_delta);
+
+    test_apply();
+    test_other_app();
+    test_no_digest();
+    test_corrupt_running_app();
+
+#ifdef CONFIG_ENABLE_BOOT_CHECK_SHA256
+    printf("With CONFIG_ENABLE_BOOT_CHECK_SHA256: ");
+#else
+    printf("Without CONFIG_ENABLE_BOOT_CHECK_SHA256: ");
+#endif
+    printf("%s\n", s_failed ? "FAILED" : "OK");
+    return s_failed ? 1 : 0;
+}
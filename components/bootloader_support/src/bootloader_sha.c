@@ -171,3 +171,50 @@ void bootloader_sha256_finish(bootloader_sha256_handle_t handle, uint8_t *digest
 #endif
 
 #endif
+
+#ifdef CONFIG_TARGET_PLATFORM_ESP8266
+
+#include "bootloader_sha.h"
+#include <assert.h>
+#include <stdlib.h>
+
+#include "esp_sha.h"
+
+// Both the app and the bootloader use the shared software SHA-256 of the util component
+
+#ifdef BOOTLOADER_BUILD
+static esp_sha_t s_sha;
+#endif
+
+bootloader_sha256_handle_t bootloader_sha256_start()
+{
+#ifdef BOOTLOADER_BUILD
+    esp_sha_t *ctx = &s_sha;
+#else
+    esp_sha_t *ctx = (esp_sha_t *)malloc(sizeof(esp_sha_t));
+    if (!ctx) {
+        return NULL;
+    }
+#endif
+    esp_sha_init(ctx, ESP_SHA256);
+    return ctx;
+}
+
+void bootloader_sha256_data(bootloader_sha256_handle_t handle, const void *data, size_t data_len)
+{
+    assert(handle != NULL);
+    esp_sha_update((esp_sha_t *)handle, data, data_len);
+}
+
+void bootloader_sha256_finish(bootloader_sha256_handle_t handle, uint8_t *digest)
+{
+    assert(handle != NULL);
+    if (digest != NULL) {
+        esp_sha_finish((esp_sha_t *)handle, digest);
+    }
+#ifndef BOOTLOADER_BUILD
+    free(handle);
+#endif
+}
+
+#endif
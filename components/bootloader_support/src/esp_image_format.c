@@ -597,6 +597,10 @@ static void debug_log_hash(const uint8_t *image_hash, const char *label)
 #include <bootloader_random.h>
 #include <bootloader_sha.h>
 
+#ifdef BOOTLOADER_BUILD
+#include <xtensa/hal.h>
+#endif
+
 static const char *TAG = "esp_image";
 
 #define HASH_LEN 32 /* SHA-256 digest length */
@@ -612,6 +616,12 @@ static const char *TAG = "esp_image";
 /* Mmap source address mask */
 #define MMAP_ALIGNED_MASK 0x0000FFFF
 
+#ifdef BOOTLOADER_BUILD
+/* The bootloader runs on the clock the ROM set up, 52 MHz with the 26 MHz crystal,
+   which its console baud rate assumes as well (BOOTLOADER_CONSOLE_CLK_FREQ) */
+#define BOOTLOADER_CPU_CLK_MHZ 52
+#endif
+
 #if defined(BOOTLOADER_BUILD) && defined(BOOTLOADER_UNPACK_APP)
 /* 64 bits of random data to obfuscate loaded RAM with, until verification is complete
    (Means loaded code isn't executable until after the secure boot check.)
@@ -647,8 +657,10 @@ static esp_err_t verify_segment_header(int index, const esp_image_segment_header
 
 static esp_err_t verify_checksum(bootloader_sha256_handle_t sha_handle, uint32_t checksum_word, esp_image_metadata_t *data);
 
-#if defined(CONFIG_SECURE_BOOT_ENABLED) && defined(CONFIG_ENABLE_BOOT_CHECK_SHA256)
+#ifdef CONFIG_ENABLE_BOOT_CHECK_SHA256
+#ifdef CONFIG_SECURE_BOOT_ENABLED
 static esp_err_t __attribute__((unused)) verify_secure_boot_signature(bootloader_sha256_handle_t sha_handle, esp_image_metadata_t *data);
+#endif
 static esp_err_t __attribute__((unused)) verify_simple_hash(bootloader_sha256_handle_t sha_handle, esp_image_metadata_t *data);
 #endif
 
@@ -664,6 +676,9 @@ esp_err_t esp_image_load(esp_image_load_mode_t mode, const esp_partition_pos_t *
     // checksum the image a word at a time. This shaves 30-40ms per MB of image size
     uint32_t checksum_word = ESP_ROM_CHECKSUM_INITIAL;
     bootloader_sha256_handle_t sha_handle = NULL;
+#ifdef BOOTLOADER_BUILD
+    uint32_t start_ccount = xthal_get_ccount();
+#endif
 
     if (data == NULL || part == NULL) {
         return ESP_ERR_INVALID_ARG;
@@ -688,7 +703,8 @@ esp_err_t esp_image_load(esp_image_load_mode_t mode, const esp_partition_pos_t *
     if (1) {
 #else
 #ifdef CONFIG_ENABLE_BOOT_CHECK_SHA256
-    if (data->image.hash_appended) {
+    // App images (esptool.py elf2image --version=3) always have it, the bootloader image never has
+    if (data->start_addr != ESP_BOOTLOADER_OFFSET) {
         sha_handle = bootloader_sha256_start();
         if (sha_handle == NULL) {
             return ESP_ERR_NO_MEM;
@@ -798,6 +814,11 @@ goto err;
     }
 #endif
 
+#ifdef BOOTLOADER_BUILD
+    ESP_LOGI(TAG, "image at 0x%x verified in %u us", data->start_addr,
+             (xthal_get_ccount() - start_ccount) / BOOTLOADER_CPU_CLK_MHZ);
+#endif
+
     // Success!
     return ESP_OK;
 
@@ -924,6 +945,23 @@ err:
     return err;
 }
 
+/* XOR the words of a chunk of segment data into the checksum and add the chunk to the hash */
+static void checksum_and_hash(const uint32_t *src, uint32_t len, bootloader_sha256_handle_t sha_handle, uint32_t *checksum)
+{
+    uint32_t w = *checksum;
+
+    for (int i = 0; i < len / 4; i++) {
+        w ^= src[i];
+    }
+    *checksum = w;
+
+#ifdef CONFIG_ENABLE_BOOT_CHECK_SHA256
+    if (sha_handle != NULL) {
+        bootloader_sha256_data(sha_handle, src, len);
+    }
+#endif
+}
+
 static esp_err_t process_segment_data(intptr_t load_addr, uint32_t data_addr, uint32_t data_len, bool do_load, bootloader_sha256_handle_t sha_handle, uint32_t *checksum)
 {
 #ifdef BOOTLOADER_BUILD
@@ -944,26 +982,9 @@ static esp_err_t process_segment_data(intptr_t load_addr, uint32_t data_addr, ui
     uint32_t *dest = (uint32_t *)load_addr;
 #endif
 
-    const uint32_t *src = data;
-
-    for (int i = 0; i < data_len; i += 4) {
-        int w_i = i/4; // Word index
-        uint32_t w = src[w_i];
-        *checksum ^= w;
-#ifdef BOOTLOADER_BUILD
-        if (do_load) {
-//            dest[w_i] = w ^ ((w_i & 1) ? ram_obfs_value[0] : ram_obfs_value[1]);
-        }
-#endif
-        // SHA_CHUNK determined experimentally as the optimum size
-        // to call bootloader_sha256_data() with. This is a bit
-        // counter-intuitive, but it's ~3ms better than using the
-        // SHA256 block size.
-        const size_t SHA_CHUNK = 1024;
-        if (sha_handle != NULL && i % SHA_CHUNK == 0) {
-//            bootloader_sha256_data(sha_handle, &src[w_i],
-//                                   MIN(SHA_CHUNK, data_len - i));
-        }
+    // Each chunk is hashed right after it is checksummed, while it is still in the flash cache
+    for (uint32_t i = 0; i < data_len; i += MAX_CHECKSUM_READ_SIZE) {
+        checksum_and_hash(data + i / 4, MIN(MAX_CHECKSUM_READ_SIZE, data_len - i), sha_handle, checksum);
     }
 
     bootloader_munmap(data);
@@ -980,7 +1001,6 @@ static esp_err_t process_segment_data(intptr_t load_addr, uint32_t data_addr, ui
         return ESP_FAIL;
     }
 
-    const uint32_t *src = data;
     for (; had_read_size != data_len; ) {
         to_read_size = ((data_len - had_read_size) < MAX_CHECKSUM_READ_SIZE) ? (data_len - had_read_size) : MAX_CHECKSUM_READ_SIZE;
         int ret = ESP_OK;
@@ -993,27 +1013,7 @@ static esp_err_t process_segment_data(intptr_t load_addr, uint32_t data_addr, ui
 
         had_read_size += to_read_size;
 
-        for (int i = 0; i < to_read_size; i += 4) {
-            int w_i = i/4; // Word index
-            uint32_t w = src[w_i];
-            *checksum ^= w;
-    #ifdef BOOTLOADER_BUILD
-            if (do_load) {
-    //            dest[w_i] = w ^ ((w_i & 1) ? ram_obfs_value[0] : ram_obfs_value[1]);
-            }
-    #endif
-            // SHA_CHUNK determined experimentally as the optimum size
-            // to call bootloader_sha256_data() with. This is a bit
-            // counter-intuitive, but it's ~3ms better than using the
-            // SHA256 block size.
-            const size_t SHA_CHUNK = 1024;
-            if (sha_handle != NULL && i % SHA_CHUNK == 0) {
-    //            bootloader_sha256_data(sha_handle, &src[w_i],
-    //                                   MIN(SHA_CHUNK, data_len - i));
-            }
-        }
-
-
+        checksum_and_hash(data, to_read_size, sha_handle, checksum);
     }   // end for
     free(data);
     return ESP_OK;
@@ -1101,9 +1101,7 @@ static esp_err_t verify_checksum(bootloader_sha256_handle_t sha_handle, uint32_t
 #ifdef CONFIG_ENABLE_BOOT_CHECK_SHA256
     if (sha_handle != NULL) {
         bootloader_sha256_data(sha_handle, buf, length - unpadded_length);
-    }
 
-    if (data->image.hash_appended) {
         // Account for the hash in the total image length
         length += HASH_LEN;
     }
@@ -1114,10 +1112,11 @@ static esp_err_t verify_checksum(bootloader_sha256_handle_t sha_handle, uint32_t
     return ESP_OK;
 }
 
-#if defined(CONFIG_SECURE_BOOT_ENABLED) && defined(CONFIG_ENABLE_BOOT_CHECK_SHA256)
+#ifdef CONFIG_ENABLE_BOOT_CHECK_SHA256
 
 static void debug_log_hash(const uint8_t *image_hash, const char *caption);
 
+#ifdef CONFIG_SECURE_BOOT_ENABLED
 static esp_err_t verify_secure_boot_signature(bootloader_sha256_handle_t sha_handle, esp_image_metadata_t *data)
 {
     uint8_t image_hash[HASH_LEN] = { 0 };
@@ -1160,25 +1159,26 @@ static esp_err_t verify_secure_boot_signature(bootloader_sha256_handle_t sha_han
 
     return ESP_OK;
 }
+#endif /* CONFIG_SECURE_BOOT_ENABLED */
 
 static esp_err_t verify_simple_hash(bootloader_sha256_handle_t sha_handle, esp_image_metadata_t *data)
 {
     uint8_t image_hash[HASH_LEN] = { 0 };
+    uint32_t hash[HASH_LEN / sizeof(uint32_t)];
+
     bootloader_sha256_finish(sha_handle, image_hash);
 
     // Log the hash for debugging
     debug_log_hash(image_hash, "Calculated hash");
 
-    // Simple hash for verification only
-    const void *hash = bootloader_mmap(data->start_addr + data->image_len - HASH_LEN, HASH_LEN);
-    if (memcmp(hash, image_hash, HASH_LEN) != 0) {
+    // Simple hash for verification only. It is read rather than mapped, the app runs from the flash cache
+    esp_err_t err = bootloader_flash_read(data->start_addr + data->image_len - HASH_LEN, hash, HASH_LEN, true);
+    if (err != ESP_OK || memcmp(hash, image_hash, HASH_LEN) != 0) {
         ESP_LOGE(TAG, "Image hash failed - image is corrupt");
-        debug_log_hash(hash, "Expected hash");
-        bootloader_munmap(hash);
+        debug_log_hash((const uint8_t *)hash, "Expected hash");
         return ESP_ERR_IMAGE_INVALID;
     }
 
-    bootloader_munmap(hash);
     return ESP_OK;
 }
 
@@ -4,6 +4,8 @@
 
 #include <esp_types.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/param.h>
 #include "string.h"
 #include "rom/ets_sys.h"
 
@@ -17,6 +19,7 @@
 #include "esp_partition.h"
 #include "esp_ota_ops.h"
 #include "esp_image_format.h"
+#include "esp_sha.h"
 
 TEST_CASE("Verify bootloader image in flash", "[bootloader_support]")
 {
@@ -92,3 +95,43 @@ TEST_CASE("Test label_search", "[bootloader_support]")
     check_label_search(25,  "phy, 1234567890123456, nvs1",  "12345678901234567",    true);
 
 }
+
+#ifdef CONFIG_ENABLE_BOOT_CHECK_SHA256
+/* Budget for checking the checksum and the SHA-256 digest of an image */
+#define VERIFY_IMAGE_BUDGET_MS_PER_KB   2
+
+TEST_CASE("Verify unit test app image digest within budget", "[bootloader_support]")
+{
+    esp_image_metadata_t data = { 0 };
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    TEST_ASSERT_NOT_EQUAL(NULL, running);
+    const esp_partition_pos_t running_pos  = {
+        .offset = running->address,
+        .size = running->size,
+    };
+
+    TickType_t start = xTaskGetTickCount();
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_image_load(ESP_IMAGE_VERIFY, &running_pos, &data));
+    uint32_t ms = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+
+    printf("verified %d KB image in %d ms\n", data.image_len / 1024, ms);
+    TEST_ASSERT_TRUE(ms <= (data.image_len / 1024 + 1) * VERIFY_IMAGE_BUDGET_MS_PER_KB);
+
+    /* the image length includes the digest, which covers everything before it */
+    uint8_t *image = malloc(SPI_FLASH_SEC_SIZE);
+    uint8_t digest[32], expected[32];
+    esp_sha_t sha;
+
+    TEST_ASSERT_NOT_NULL(image);
+    esp_sha_init(&sha, ESP_SHA256);
+    for (uint32_t off = 0; off < data.image_len - 32; off += SPI_FLASH_SEC_SIZE) {
+        uint32_t len = MIN(SPI_FLASH_SEC_SIZE, data.image_len - 32 - off);
+        TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_partition_read(running, off, image, len));
+        esp_sha_update(&sha, image, len);
+    }
+    esp_sha_finish(&sha, digest);
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_partition_read(running, data.image_len - 32, expected, 32));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, digest, 32);
+    free(image);
+}
+#endif
@@ -253,8 +253,48 @@ typedef struct
     size_t offset;
     size_t depth; /* How deeply nested (in arrays/objects) is the input at the current offset. */
     internal_hooks hooks;
+    unsigned char *writable; /* same as content when strings are decoded in place, NULL otherwise */
+    cJSON_Arena *arena; /* take nodes from here instead of hooks.allocate if not NULL */
 } parse_buffer;
 
+/* alignment of nodes taken from a cJSON_Arena */
+#define arena_alignment sizeof(double)
+
+/* Take a node from the arena of the parse buffer, or allocate it with the hooks */
+static cJSON *parse_new_item(parse_buffer * const input_buffer)
+{
+    cJSON_Arena *arena = input_buffer->arena;
+    cJSON *node = NULL;
+    size_t start = 0;
+
+    if (arena == NULL)
+    {
+        return cJSON_New_Item(&input_buffer->hooks);
+    }
+
+    /* align relative to the address, the arena buffer itself may be unaligned */
+    start = arena->used + ((arena_alignment - (((size_t)arena->buffer + arena->used) % arena_alignment)) % arena_alignment);
+    if ((start > arena->size) || ((arena->size - start) < sizeof(cJSON)))
+    {
+        return NULL;
+    }
+
+    node = (cJSON*)(void*)(arena->buffer + start);
+    memset(node, '\0', sizeof(cJSON));
+    arena->used = start + sizeof(cJSON);
+
+    return node;
+}
+
+/* Free nodes created by parse_new_item, nodes in an arena are released with the arena */
+static void parse_delete(parse_buffer * const input_buffer, cJSON *item)
+{
+    if (input_buffer->arena == NULL)
+    {
+        cJSON_Delete(item);
+    }
+}
+
 /* check if the given size is left to read in a given parse buffer (starting with 1) */
 #define can_read(buffer, size) ((buffer != NULL) && (((buffer)->offset + size) <= (buffer)->length))
 /* check if the buffer can be accessed at the given index (starting with 0) */
@@ -368,8 +408,21 @@ typedef struct
     cJSON_bool noalloc;
     cJSON_bool format; /* is this print a formatted print */
     internal_hooks hooks;
+    cJSON_Writer *writer; /* flush to this writer instead of growing the buffer if not NULL */
 } printbuffer;
 
+/* hand everything rendered so far to the writer and start over at the beginning of the buffer */
+static cJSON_bool flush_printbuffer(printbuffer * const p)
+{
+    if ((p->offset > 0) && !p->writer->write(p->writer->context, (const char*)p->buffer, p->offset))
+    {
+        return false;
+    }
+    p->offset = 0;
+
+    return true;
+}
+
 /* realloc printbuffer if necessary to have at least "needed" bytes more */
 static unsigned char* ensure(printbuffer * const p, size_t needed)
 {
@@ -399,6 +452,17 @@ static unsigned char* ensure(printbuffer * const p, size_t needed)
         return p->buffer + p->offset;
     }
 
+    if (p->writer != NULL)
+    {
+        needed -= p->offset;
+        if (!flush_printbuffer(p) || (needed > p->length))
+        {
+            return NULL;
+        }
+
+        return p->buffer;
+    }
+
     if (p->noalloc) {
         return NULL;
     }
@@ -733,12 +797,21 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
             goto fail; /* string ended unexpectedly */
         }
 
-        /* This is at most how much we need for the output */
-        allocation_length = (size_t) (input_end - buffer_at_offset(input_buffer)) - skipped_bytes;
-        output = (unsigned char*)input_buffer->hooks.allocate(allocation_length + sizeof(""));
-        if (output == NULL)
+        if (input_buffer->writable != NULL)
         {
-            goto fail; /* allocation failure */
+            /* the unescaped string is never longer than the literal, decode it over the
+             * input; the terminating '\0' at most replaces the closing quote */
+            output = input_buffer->writable + (input_pointer - input_buffer->content);
+        }
+        else
+        {
+            /* This is at most how much we need for the output */
+            allocation_length = (size_t) (input_end - buffer_at_offset(input_buffer)) - skipped_bytes;
+            output = (unsigned char*)input_buffer->hooks.allocate(allocation_length + sizeof(""));
+            if (output == NULL)
+            {
+                goto fail; /* allocation failure */
+            }
         }
     }
 
@@ -804,6 +877,11 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
 
     item->type = cJSON_String;
     item->valuestring = (char*)output;
+    if (input_buffer->writable != NULL)
+    {
+        /* the string lives in the input, cJSON_Delete must not free it */
+        item->type |= cJSON_IsReference;
+    }
 
     input_buffer->offset = (size_t) (input_end - input_buffer->content);
     input_buffer->offset++;
@@ -811,7 +889,7 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     return true;
 
 fail:
-    if (output != NULL)
+    if ((output != NULL) && (input_buffer->writable == NULL))
     {
         input_buffer->hooks.deallocate(output);
     }
@@ -824,6 +902,87 @@ fail:
     return false;
 }
 
+/* Write the escape sequence for a character that can't appear in a JSON string literal as is,
+ * returns the number of bytes written (at most 6 plus a '\0'). */
+static size_t print_escaped_character(const unsigned char character, unsigned char * const output)
+{
+    output[0] = '\\';
+    switch (character)
+    {
+        case '\\':
+            output[1] = '\\';
+            break;
+        case '\"':
+            output[1] = '\"';
+            break;
+        case '\b':
+            output[1] = 'b';
+            break;
+        case '\f':
+            output[1] = 'f';
+            break;
+        case '\n':
+            output[1] = 'n';
+            break;
+        case '\r':
+            output[1] = 'r';
+            break;
+        case '\t':
+            output[1] = 't';
+            break;
+        default:
+            /* escape and print as unicode codepoint */
+            sprintf((char*)output + 1, "u%04x", character);
+            return 6;
+    }
+
+    return 2;
+}
+
+/* Render a string that doesn't fit into the buffer of a cJSON_Writer one character at a time. */
+static cJSON_bool print_string_ptr_streamed(const unsigned char * const input, printbuffer * const output_buffer)
+{
+    const unsigned char *input_pointer = NULL;
+    unsigned char *output_pointer = NULL;
+
+    output_pointer = ensure(output_buffer, 1);
+    if (output_pointer == NULL)
+    {
+        return false;
+    }
+    *output_pointer = '\"';
+    output_buffer->offset++;
+
+    for (input_pointer = input; *input_pointer != '\0'; input_pointer++)
+    {
+        output_pointer = ensure(output_buffer, sizeof("\\u0000"));
+        if (output_pointer == NULL)
+        {
+            return false;
+        }
+
+        if ((*input_pointer > 31) && (*input_pointer != '\"') && (*input_pointer != '\\'))
+        {
+            *output_pointer = *input_pointer;
+            output_buffer->offset++;
+        }
+        else
+        {
+            output_buffer->offset += print_escaped_character(*input_pointer, output_pointer);
+        }
+    }
+
+    output_pointer = ensure(output_buffer, 1);
+    if (output_pointer == NULL)
+    {
+        return false;
+    }
+    output_pointer[0] = '\"';
+    output_pointer[1] = '\0';
+
+    return true;
+}
+
 /* Render the cstring provided to an escaped version that can be printed. */
 static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffer * const output_buffer)
 {
@@ -878,6 +1037,12 @@ static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffe
     }
     output_length = (size_t)(input_pointer - input) + escape_characters;
 
+    if ((output_buffer->writer != NULL) && ((output_length + sizeof("\"\"")) >= output_buffer->length))
+    {
+        /* too long for the fixed buffer of the writer */
+        return print_string_ptr_streamed(input, output_buffer);
+    }
+
     output = ensure(output_buffer, output_length + sizeof("\"\""));
     if (output == NULL)
     {
@@ -898,46 +1063,17 @@ static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffe
     output[0] = '\"';
     output_pointer = output + 1;
     /* copy the string */
-    for (input_pointer = input; *input_pointer != '\0'; (void)input_pointer++, output_pointer++)
+    for (input_pointer = input; *input_pointer != '\0'; input_pointer++)
     {
         if ((*input_pointer > 31) && (*input_pointer != '\"') && (*input_pointer != '\\'))
         {
             /* normal character, copy */
-            *output_pointer = *input_pointer;
+            *output_pointer++ = *input_pointer;
         }
         else
         {
             /* character needs to be escaped */
-            *output_pointer++ = '\\';
-            switch (*input_pointer)
-            {
-                case '\\':
-                    *output_pointer = '\\';
-                    break;
-                case '\"':
-                    *output_pointer = '\"';
-                    break;
-                case '\b':
-                    *output_pointer = 'b';
-                    break;
-                case '\f':
-                    *output_pointer = 'f';
-                    break;
-                case '\n':
-                    *output_pointer = 'n';
-                    break;
-                case '\r':
-                    *output_pointer = 'r';
-                    break;
-                case '\t':
-                    *output_pointer = 't';
-                    break;
-                default:
-                    /* escape and print as unicode codepoint */
-                    sprintf((char*)output_pointer, "u%04x", *input_pointer);
-                    output_pointer += 4;
-                    break;
-            }
+            output_pointer += print_escaped_character(*input_pointer, output_pointer);
         }
     }
     output[output_length + 1] = '\"';
@@ -998,9 +1134,10 @@ static parse_buffer *skip_utf8_bom(parse_buffer * const buffer)
 }
 
 /* Parse an object - create a new root, and populate. */
-CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated)
+static cJSON *parse(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated, char *writable, cJSON_Arena *arena)
 {
-    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 } };
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, NULL, NULL };
+    size_t arena_used = (arena != NULL) ? arena->used : 0;
     cJSON *item = NULL;
 
     /* reset error position */
@@ -1016,8 +1153,10 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return
     buffer.length = strlen((const char*)value) + sizeof("");
     buffer.offset = 0;
     buffer.hooks = global_hooks;
+    buffer.writable = (unsigned char*)writable;
+    buffer.arena = arena;
 
-    item = cJSON_New_Item(&global_hooks);
+    item = parse_new_item(&buffer);
     if (item == NULL) /* memory fail */
     {
         goto fail;
@@ -1048,7 +1187,11 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return
 fail:
     if (item != NULL)
     {
-        cJSON_Delete(item);
+        parse_delete(&buffer, item);
+    }
+    if (arena != NULL)
+    {
+        arena->used = arena_used;
     }
 
     if (value != NULL)
@@ -1077,12 +1220,34 @@ fail:
     return NULL;
 }
 
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated)
+{
+    return parse(value, return_parse_end, require_null_terminated, NULL, NULL);
+}
+
 /* Default options for cJSON_Parse */
 CJSON_PUBLIC(cJSON *) cJSON_Parse(const char *value)
 {
     return cJSON_ParseWithOpts(value, 0, 0);
 }
 
+CJSON_PUBLIC(cJSON *) cJSON_ParseInPlace(char *value, cJSON_Arena *arena)
+{
+    return parse(value, NULL, false, value, arena);
+}
+
+CJSON_PUBLIC(void) cJSON_InitArena(cJSON_Arena *arena, void *buffer, size_t size)
+{
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    arena->buffer = (unsigned char*)buffer;
+    arena->size = (buffer != NULL) ? size : 0;
+    arena->used = 0;
+}
+
 #define cjson_min(a, b) ((a < b) ? a : b)
 
 static unsigned char *print(const cJSON * const item, cJSON_bool format, const internal_hooks * const hooks)
@@ -1162,7 +1327,7 @@ CJSON_PUBLIC(char *) cJSON_PrintUnformatted(const cJSON *item)
 
 CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON_bool fmt)
 {
-    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 }, NULL };
 
     if (prebuffer < 0)
     {
@@ -1192,7 +1357,7 @@ CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON
 
 CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buf, const int len, const cJSON_bool fmt)
 {
-    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 }, NULL };
 
     if ((len < 0) || (buf == NULL))
     {
@@ -1209,6 +1374,333 @@ CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buf, const i
     return print_value(item, &p);
 }
 
+CJSON_PUBLIC(cJSON_bool) cJSON_InitWriter(cJSON_Writer *writer, void *buffer, size_t size, cJSON_WriteFunction write, void *context)
+{
+    if ((writer == NULL) || (buffer == NULL) || (size < CJSON_WRITER_MIN_BUFFER) || (write == NULL))
+    {
+        return false;
+    }
+
+    memset(writer, 0, sizeof(cJSON_Writer));
+    writer->buffer = (unsigned char*)buffer;
+    writer->size = size;
+    writer->write = write;
+    writer->context = context;
+
+    return true;
+}
+
+static cJSON_bool writer_in_object(const cJSON_Writer * const writer)
+{
+    return (writer->depth > 0) && ((writer->objects >> (writer->depth - 1)) & 1);
+}
+
+/* print through the fixed buffer of the writer, flushing whenever it is full */
+static void writer_printbuffer(cJSON_Writer * const writer, printbuffer * const p)
+{
+    memset(p, 0, sizeof(printbuffer));
+    p->buffer = writer->buffer;
+    p->length = writer->size;
+    p->offset = writer->used;
+    p->noalloc = true;
+    p->format = false;
+    p->hooks = global_hooks;
+    p->writer = writer;
+}
+
+static cJSON_bool writer_append(printbuffer * const p, const char *data, size_t length)
+{
+    while (length > 0)
+    {
+        unsigned char *output = NULL;
+        /* leave room for the '\0' ensure() always reserves */
+        size_t chunk = p->length - 1;
+
+        if (chunk > length)
+        {
+            chunk = length;
+        }
+
+        output = ensure(p, chunk);
+        if (output == NULL)
+        {
+            return false;
+        }
+        memcpy(output, data, chunk);
+        p->offset += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+
+    return true;
+}
+
+static cJSON_bool writer_finish(cJSON_Writer * const writer, const printbuffer * const p, const cJSON_bool success)
+{
+    if (!success)
+    {
+        writer->failed = true;
+        return false;
+    }
+
+    writer->used = p->offset;
+    writer->need_separator = true;
+
+    return true;
+}
+
+/* check that a value may go here and write the separator in front of it */
+static cJSON_bool writer_begin_value(cJSON_Writer * const writer, printbuffer * const p)
+{
+    if ((writer == NULL) || writer->failed)
+    {
+        return false;
+    }
+
+    writer_printbuffer(writer, p);
+
+    if (writer_in_object(writer))
+    {
+        /* the key has already written the separator */
+        if (!writer->have_key)
+        {
+            writer->failed = true;
+            return false;
+        }
+        writer->have_key = false;
+    }
+    else if (writer->need_separator)
+    {
+        /* there is only one value at top level */
+        if ((writer->depth == 0) || !writer_append(p, ",", 1))
+        {
+            writer->failed = true;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static cJSON_bool writer_begin(cJSON_Writer * const writer, const cJSON_bool object)
+{
+    printbuffer p;
+
+    if (!writer_begin_value(writer, &p))
+    {
+        return false;
+    }
+
+    if ((writer->depth >= CJSON_WRITER_MAX_DEPTH) || !writer_append(&p, object ? "{" : "[", 1))
+    {
+        writer->failed = true;
+        return false;
+    }
+
+    if (object)
+    {
+        writer->objects |= 1UL << writer->depth;
+    }
+    else
+    {
+        writer->objects &= ~(1UL << writer->depth);
+    }
+    writer->depth++;
+    writer->used = p.offset;
+    writer->need_separator = false;
+
+    return true;
+}
+
+static cJSON_bool writer_end(cJSON_Writer * const writer, const cJSON_bool object)
+{
+    printbuffer p;
+
+    if ((writer == NULL) || writer->failed)
+    {
+        return false;
+    }
+
+    if ((writer->depth == 0) || (writer_in_object(writer) != object) || writer->have_key)
+    {
+        writer->failed = true;
+        return false;
+    }
+
+    writer_printbuffer(writer, &p);
+    writer->depth--;
+
+    return writer_finish(writer, &p, writer_append(&p, object ? "}" : "]", 1));
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterBeginObject(cJSON_Writer *writer)
+{
+    return writer_begin(writer, true);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterEndObject(cJSON_Writer *writer)
+{
+    return writer_end(writer, true);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterBeginArray(cJSON_Writer *writer)
+{
+    return writer_begin(writer, false);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterEndArray(cJSON_Writer *writer)
+{
+    return writer_end(writer, false);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterKey(cJSON_Writer *writer, const char *key)
+{
+    printbuffer p;
+
+    if ((writer == NULL) || writer->failed)
+    {
+        return false;
+    }
+
+    if ((key == NULL) || !writer_in_object(writer) || writer->have_key)
+    {
+        writer->failed = true;
+        return false;
+    }
+
+    writer_printbuffer(writer, &p);
+    if ((writer->need_separator && !writer_append(&p, ",", 1))
+        || !print_string_ptr((const unsigned char*)key, &p))
+    {
+        writer->failed = true;
+        return false;
+    }
+    update_offset(&p);
+
+    if (!writer_append(&p, ":", 1))
+    {
+        writer->failed = true;
+        return false;
+    }
+
+    writer->used = p.offset;
+    writer->need_separator = false;
+    writer->have_key = true;
+
+    return true;
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterString(cJSON_Writer *writer, const char *string)
+{
+    printbuffer p;
+    cJSON_bool success = false;
+
+    if (!writer_begin_value(writer, &p))
+    {
+        return false;
+    }
+
+    success = print_string_ptr((const unsigned char*)string, &p);
+    if (success)
+    {
+        update_offset(&p);
+    }
+
+    return writer_finish(writer, &p, success);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterNumber(cJSON_Writer *writer, double number)
+{
+    printbuffer p;
+    cJSON item;
+
+    if (!writer_begin_value(writer, &p))
+    {
+        return false;
+    }
+
+    memset(&item, 0, sizeof(item));
+    item.type = cJSON_Number;
+    item.valuedouble = number;
+
+    return writer_finish(writer, &p, print_number(&item, &p));
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterBool(cJSON_Writer *writer, cJSON_bool boolean)
+{
+    printbuffer p;
+
+    if (!writer_begin_value(writer, &p))
+    {
+        return false;
+    }
+
+    return writer_finish(writer, &p, boolean ? writer_append(&p, "true", 4) : writer_append(&p, "false", 5));
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterNull(cJSON_Writer *writer)
+{
+    printbuffer p;
+
+    if (!writer_begin_value(writer, &p))
+    {
+        return false;
+    }
+
+    return writer_finish(writer, &p, writer_append(&p, "null", 4));
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterRaw(cJSON_Writer *writer, const char *raw)
+{
+    printbuffer p;
+
+    if (!writer_begin_value(writer, &p))
+    {
+        return false;
+    }
+
+    return writer_finish(writer, &p, (raw != NULL) && writer_append(&p, raw, strlen(raw)));
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterItem(cJSON_Writer *writer, const cJSON *item)
+{
+    printbuffer p;
+    cJSON_bool success = false;
+
+    if (!writer_begin_value(writer, &p))
+    {
+        return false;
+    }
+
+    success = print_value(item, &p);
+    if (success)
+    {
+        update_offset(&p);
+    }
+
+    return writer_finish(writer, &p, success);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterFlush(cJSON_Writer *writer)
+{
+    printbuffer p;
+
+    if ((writer == NULL) || writer->failed)
+    {
+        return false;
+    }
+
+    writer_printbuffer(writer, &p);
+    if (!flush_printbuffer(&p))
+    {
+        writer->failed = true;
+        return false;
+    }
+    writer->used = 0;
+
+    return true;
+}
+
 /* Parser core - when encountering text, process appropriately. */
 static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer)
 {
@@ -1377,7 +1869,7 @@ static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buf
     do
     {
         /* allocate next item */
-        cJSON *new_item = cJSON_New_Item(&(input_buffer->hooks));
+        cJSON *new_item = parse_new_item(input_buffer);
         if (new_item == NULL)
         {
             goto fail; /* allocation failure */
@@ -1426,7 +1918,7 @@ success:
 fail:
     if (head != NULL)
     {
-        cJSON_Delete(head);
+        parse_delete(input_buffer, head);
     }
 
     return false;
@@ -1531,7 +2023,7 @@ static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_bu
     do
     {
         /* allocate next item */
-        cJSON *new_item = cJSON_New_Item(&(input_buffer->hooks));
+        cJSON *new_item = parse_new_item(input_buffer);
         if (new_item == NULL)
         {
             goto fail; /* allocation failure */
@@ -1563,6 +2055,11 @@ static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_bu
         /* swap valuestring and string, because we parsed the name */
         current_item->string = current_item->valuestring;
         current_item->valuestring = NULL;
+        if (input_buffer->writable != NULL)
+        {
+            /* parse_value overwrites the type, so this is set again once the value is parsed */
+            current_item->type = cJSON_StringIsConst;
+        }
 
         if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != ':'))
         {
@@ -1576,6 +2073,10 @@ static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_bu
         {
             goto fail; /* failed to parse value */
         }
+        if (input_buffer->writable != NULL)
+        {
+            current_item->type |= cJSON_StringIsConst;
+        }
         buffer_skip_whitespace(input_buffer);
     }
     while (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ','));
@@ -1597,7 +2098,7 @@ success:
 fail:
     if (head != NULL)
     {
-        cJSON_Delete(head);
+        parse_delete(input_buffer, head);
     }
 
     return false;
@@ -80,6 +80,32 @@ typedef struct cJSON_Hooks
 
 typedef int cJSON_bool;
 
+/* Caller supplied memory that cJSON_ParseInPlace takes nodes from. */
+typedef struct cJSON_Arena
+{
+    unsigned char *buffer;
+    size_t size;
+    size_t used;
+} cJSON_Arena;
+
+/* Receives output of a cJSON_Writer, returns false to abort writing. */
+typedef cJSON_bool (*cJSON_WriteFunction)(void *context, const char *data, size_t length);
+
+/* State of a streaming writer, see cJSON_InitWriter. Treat as opaque. */
+typedef struct cJSON_Writer
+{
+    unsigned char *buffer;
+    size_t size;
+    size_t used;
+    cJSON_WriteFunction write;
+    void *context;
+    size_t depth;
+    unsigned long objects; /* bit n is set if nesting level n is an object */
+    cJSON_bool need_separator;
+    cJSON_bool have_key;
+    cJSON_bool failed;
+} cJSON_Writer;
+
 #if !defined(__WINDOWS__) && (defined(WIN32) || defined(WIN64) || defined(_MSC_VER) || defined(_WIN32))
 #define __WINDOWS__
 #endif
@@ -141,6 +167,14 @@ CJSON_PUBLIC(cJSON *) cJSON_Parse(const char *value);
 /* ParseWithOpts allows you to require (and check) that the JSON is null terminated, and to retrieve the pointer to the final byte parsed. */
 /* If you supply a ptr in return_parse_end and parsing fails, then return_parse_end will contain a pointer to the error so will match cJSON_GetErrorPtr(). */
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated);
+/* Destructive parse: strings and object keys are unescaped inside "value", and valuestring/string point into it
+ * instead of being copied, so "value" must stay alive and unmodified as long as the tree is used.
+ * If arena is NULL, nodes are allocated as usual and the tree is freed with cJSON_Delete.
+ * Otherwise every node is taken from the arena and the whole tree is released at once by reinitializing (or just
+ * dropping) the arena; such a tree, or any item of it, must never be passed to cJSON_Delete. */
+CJSON_PUBLIC(cJSON *) cJSON_ParseInPlace(char *value, cJSON_Arena *arena);
+/* Set up an arena for cJSON_ParseInPlace on top of buffer. Call it again to release all trees parsed into it. */
+CJSON_PUBLIC(void) cJSON_InitArena(cJSON_Arena *arena, void *buffer, size_t size);
 
 /* Render a cJSON entity to text for transfer/storage. */
 CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item);
@@ -151,6 +185,28 @@ CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON
 /* Render a cJSON entity to text using a buffer already allocated in memory with given length. Returns 1 on success and 0 on failure. */
 /* NOTE: cJSON is not always 100% accurate in estimating how much memory it will use, so to be safe allocate 5 bytes more than you actually need */
 CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, const int length, const cJSON_bool format);
+/* Streaming writer: emits unformatted JSON straight to "write" without building a tree, staging output in the
+ * fixed "buffer" (at least CJSON_WRITER_MIN_BUFFER bytes), so memory use does not depend on the document size.
+ * Inside an object every value must be preceded by cJSON_WriterKey. All calls return false once anything failed
+ * (misuse, nesting deeper than CJSON_WRITER_MAX_DEPTH or "write" returning false) and the output is then unusable.
+ * cJSON_WriterFlush hands over whatever is still buffered and must be called at the end of the document. */
+#define CJSON_WRITER_MIN_BUFFER 32
+#define CJSON_WRITER_MAX_DEPTH (sizeof(unsigned long) * 8)
+CJSON_PUBLIC(cJSON_bool) cJSON_InitWriter(cJSON_Writer *writer, void *buffer, size_t size, cJSON_WriteFunction write, void *context);
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterBeginObject(cJSON_Writer *writer);
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterEndObject(cJSON_Writer *writer);
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterBeginArray(cJSON_Writer *writer);
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterEndArray(cJSON_Writer *writer);
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterKey(cJSON_Writer *writer, const char *key);
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterString(cJSON_Writer *writer, const char *string);
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterNumber(cJSON_Writer *writer, double number);
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterBool(cJSON_Writer *writer, cJSON_bool boolean);
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterNull(cJSON_Writer *writer);
+/* Write raw JSON text as is, without validating it. */
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterRaw(cJSON_Writer *writer, const char *raw);
+/* Write an existing tree as one value. Raw items inside it must fit into the buffer. */
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterItem(cJSON_Writer *writer, const cJSON *item);
+CJSON_PUBLIC(cJSON_bool) cJSON_WriterFlush(cJSON_Writer *writer);
 /* Delete a cJSON entity and all subentities. */
 CJSON_PUBLIC(void) cJSON_Delete(cJSON *c);
 
@@ -0,0 +1,223 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "unity/examples/unity_config.h"
+#include "unity/src/unity.h"
+#include "common.h"
+
+static size_t allocations = 0;
+
+static void *counting_malloc(size_t size)
+{
+    allocations++;
+    return malloc(size);
+}
+
+static cJSON_Hooks counting_hooks = { counting_malloc, free };
+
+static void parse_in_place_should_decode_strings_into_the_input(void)
+{
+    char json[] = "{\"na\\u006de\":\"a\\tb\\\"c\\ud83d\\ude00\",\"list\":[\"x\",1,true,null]}";
+    cJSON *tree = NULL;
+    cJSON *name = NULL;
+
+    tree = cJSON_ParseInPlace(json, NULL);
+    TEST_ASSERT_NOT_NULL(tree);
+
+    name = tree->child;
+    TEST_ASSERT_EQUAL_STRING("name", name->string);
+    TEST_ASSERT_EQUAL_STRING("a\tb\"c\xF0\x9F\x98\x80", name->valuestring);
+    TEST_ASSERT_TRUE(name->string >= json && name->string < json + sizeof(json));
+    TEST_ASSERT_TRUE(name->valuestring >= json && name->valuestring < json + sizeof(json));
+    TEST_ASSERT_TRUE(cJSON_IsString(name));
+    TEST_ASSERT_EQUAL_STRING("x", cJSON_GetArrayItem(cJSON_GetObjectItem(tree, "list"), 0)->valuestring);
+
+    /* strings are not owned by the tree */
+    cJSON_Delete(tree);
+}
+
+static void parse_in_place_should_match_regular_parse(void)
+{
+    char name[sizeof("inputs/test") + 20];
+    size_t i;
+
+    for (i = 1; i <= 11; i++)
+    {
+        char *content = NULL;
+        cJSON *expected = NULL;
+        cJSON *actual = NULL;
+
+        sprintf(name, "inputs/test%u", (unsigned int)i);
+        content = read_file(name);
+        TEST_ASSERT_NOT_NULL(content);
+
+        expected = cJSON_Parse(content);
+        actual = cJSON_ParseInPlace(content, NULL);
+        if (expected == NULL)
+        {
+            /* test6 is not JSON */
+            TEST_ASSERT_NULL(actual);
+        }
+        else
+        {
+            TEST_ASSERT_TRUE(cJSON_Compare(expected, actual, true));
+        }
+
+        cJSON_Delete(expected);
+        cJSON_Delete(actual);
+        free(content);
+    }
+}
+
+static void parse_in_place_should_take_nodes_from_the_arena(void)
+{
+    char json[] = "{\"a\":[1,2,{\"b\":\"c\"}],\"d\":\"e\"}";
+    double storage[64];
+    cJSON_Arena arena;
+    cJSON *tree = NULL;
+
+    cJSON_InitArena(&arena, storage, sizeof(storage));
+
+    cJSON_InitHooks(&counting_hooks);
+    allocations = 0;
+    tree = cJSON_ParseInPlace(json, &arena);
+    cJSON_InitHooks(NULL);
+
+    TEST_ASSERT_NOT_NULL(tree);
+    TEST_ASSERT_EQUAL_UINT(0, allocations);
+    TEST_ASSERT_EQUAL_UINT(7 * sizeof(cJSON), arena.used);
+    TEST_ASSERT_TRUE((unsigned char*)tree >= arena.buffer && (unsigned char*)tree < arena.buffer + arena.size);
+    TEST_ASSERT_EQUAL_STRING("c", cJSON_GetObjectItem(cJSON_GetArrayItem(cJSON_GetObjectItem(tree, "a"), 2), "b")->valuestring);
+    TEST_ASSERT_EQUAL_STRING("e", cJSON_GetObjectItem(tree, "d")->valuestring);
+
+    cJSON_InitArena(&arena, storage, sizeof(storage));
+    TEST_ASSERT_EQUAL_UINT(0, arena.used);
+}
+
+static void parse_in_place_should_fail_when_arena_is_exhausted(void)
+{
+    char json[] = "[1,2,3,4]";
+    double storage[(3 * sizeof(cJSON)) / sizeof(double)];
+    cJSON_Arena arena;
+
+    cJSON_InitArena(&arena, storage, sizeof(storage));
+    TEST_ASSERT_NULL(cJSON_ParseInPlace(json, &arena));
+    /* a failed parse gives back what it took */
+    TEST_ASSERT_EQUAL_UINT(0, arena.used);
+
+    cJSON_InitArena(&arena, NULL, 100);
+    TEST_ASSERT_NULL(cJSON_ParseInPlace(json, &arena));
+}
+
+static void parse_in_place_should_handle_errors(void)
+{
+    char unterminated[] = "{\"a\":\"b";
+    char bad_value[] = "{\"a\":x}";
+    char bad_escape[] = "[\"\\q\"]";
+
+    TEST_ASSERT_NULL(cJSON_ParseInPlace(NULL, NULL));
+    TEST_ASSERT_NULL(cJSON_ParseInPlace(unterminated, NULL));
+    TEST_ASSERT_NULL(cJSON_ParseInPlace(bad_value, NULL));
+    TEST_ASSERT_NULL(cJSON_ParseInPlace(bad_escape, NULL));
+}
+
+/* Compare allocation count and time of the regular and the in-place parser on a
+ * shadow-like document, results are printed for reference only. */
+static void parse_in_place_benchmark(void)
+{
+    const size_t rounds = 2000;
+    char *content = read_file("inputs/test5");
+    size_t length = strlen(content) + sizeof("");
+    char *copy = (char*)malloc(length);
+    static double storage[4096];
+    cJSON_Arena arena;
+    size_t regular_allocations, in_place_allocations, arena_allocations;
+    clock_t regular_time, in_place_time, arena_time, start;
+    size_t i;
+
+    TEST_ASSERT_NOT_NULL(content);
+    TEST_ASSERT_NOT_NULL(copy);
+    cJSON_InitHooks(&counting_hooks);
+
+    allocations = 0;
+    start = clock();
+    for (i = 0; i < rounds; i++)
+    {
+        cJSON_Delete(cJSON_Parse(content));
+    }
+    regular_time = clock() - start;
+    regular_allocations = allocations / rounds;
+
+    allocations = 0;
+    start = clock();
+    for (i = 0; i < rounds; i++)
+    {
+        memcpy(copy, content, length);
+        cJSON_Delete(cJSON_ParseInPlace(copy, NULL));
+    }
+    in_place_time = clock() - start;
+    in_place_allocations = allocations / rounds;
+
+    allocations = 0;
+    start = clock();
+    for (i = 0; i < rounds; i++)
+    {
+        memcpy(copy, content, length);
+        cJSON_InitArena(&arena, storage, sizeof(storage));
+        TEST_ASSERT_NOT_NULL(cJSON_ParseInPlace(copy, &arena));
+    }
+    arena_time = clock() - start;
+    arena_allocations = allocations / rounds;
+
+    cJSON_InitHooks(NULL);
+
+    printf("%u bytes: regular %u allocs %.2f us, in place %u allocs %.2f us, arena %u allocs %.2f us\n",
+            (unsigned int)length,
+            (unsigned int)regular_allocations, (double)regular_time * 1e6 / CLOCKS_PER_SEC / (double)rounds,
+            (unsigned int)in_place_allocations, (double)in_place_time * 1e6 / CLOCKS_PER_SEC / (double)rounds,
+            (unsigned int)arena_allocations, (double)arena_time * 1e6 / CLOCKS_PER_SEC / (double)rounds);
+
+    TEST_ASSERT_TRUE(in_place_allocations < regular_allocations);
+    TEST_ASSERT_EQUAL_UINT(0, arena_allocations);
+
+    free(copy);
+    free(content);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(parse_in_place_should_decode_strings_into_the_input);
+    RUN_TEST(parse_in_place_should_match_regular_parse);
+    RUN_TEST(parse_in_place_should_take_nodes_from_the_arena);
+    RUN_TEST(parse_in_place_should_fail_when_arena_is_exhausted);
+    RUN_TEST(parse_in_place_should_handle_errors);
+    RUN_TEST(parse_in_place_benchmark);
+
+    return UNITY_END();
+}
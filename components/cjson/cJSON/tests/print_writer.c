@@ -0,0 +1,247 @@
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity/examples/unity_config.h"
+#include "unity/src/unity.h"
+#include "common.h"
+
+typedef struct
+{
+    char data[4096];
+    size_t length;
+    size_t calls;
+    size_t largest;
+    size_t fail_after;
+} output_t;
+
+static cJSON_bool collect(void *context, const char *data, size_t length)
+{
+    output_t *output = (output_t*)context;
+
+    if ((output->fail_after != 0) && (output->calls >= output->fail_after))
+    {
+        return false;
+    }
+
+    TEST_ASSERT_TRUE(output->length + length < sizeof(output->data));
+    memcpy(output->data + output->length, data, length);
+    output->length += length;
+    output->data[output->length] = '\0';
+    output->calls++;
+    if (length > output->largest)
+    {
+        output->largest = length;
+    }
+
+    return true;
+}
+
+static cJSON_Writer writer;
+static unsigned char buffer[CJSON_WRITER_MIN_BUFFER];
+static output_t output;
+
+static void start_writer(void)
+{
+    memset(&output, 0, sizeof(output));
+    TEST_ASSERT_TRUE(cJSON_InitWriter(&writer, buffer, sizeof(buffer), collect, &output));
+}
+
+static void writer_should_reject_invalid_arguments(void)
+{
+    TEST_ASSERT_FALSE(cJSON_InitWriter(NULL, buffer, sizeof(buffer), collect, &output));
+    TEST_ASSERT_FALSE(cJSON_InitWriter(&writer, NULL, sizeof(buffer), collect, &output));
+    TEST_ASSERT_FALSE(cJSON_InitWriter(&writer, buffer, CJSON_WRITER_MIN_BUFFER - 1, collect, &output));
+    TEST_ASSERT_FALSE(cJSON_InitWriter(&writer, buffer, sizeof(buffer), NULL, &output));
+    TEST_ASSERT_FALSE(cJSON_WriterNull(NULL));
+    TEST_ASSERT_FALSE(cJSON_WriterFlush(NULL));
+}
+
+static void writer_should_write_documents(void)
+{
+    start_writer();
+
+    TEST_ASSERT_TRUE(cJSON_WriterBeginObject(&writer));
+    TEST_ASSERT_TRUE(cJSON_WriterKey(&writer, "name"));
+    TEST_ASSERT_TRUE(cJSON_WriterString(&writer, "a\tb\"c\x01"));
+    TEST_ASSERT_TRUE(cJSON_WriterKey(&writer, "values"));
+    TEST_ASSERT_TRUE(cJSON_WriterBeginArray(&writer));
+    TEST_ASSERT_TRUE(cJSON_WriterNumber(&writer, 1));
+    TEST_ASSERT_TRUE(cJSON_WriterNumber(&writer, -0.5));
+    TEST_ASSERT_TRUE(cJSON_WriterNumber(&writer, 1.0 / 3.0));
+    TEST_ASSERT_TRUE(cJSON_WriterBool(&writer, true));
+    TEST_ASSERT_TRUE(cJSON_WriterBool(&writer, false));
+    TEST_ASSERT_TRUE(cJSON_WriterNull(&writer));
+    TEST_ASSERT_TRUE(cJSON_WriterBeginArray(&writer));
+    TEST_ASSERT_TRUE(cJSON_WriterEndArray(&writer));
+    TEST_ASSERT_TRUE(cJSON_WriterBeginObject(&writer));
+    TEST_ASSERT_TRUE(cJSON_WriterEndObject(&writer));
+    TEST_ASSERT_TRUE(cJSON_WriterEndArray(&writer));
+    TEST_ASSERT_TRUE(cJSON_WriterKey(&writer, "raw"));
+    TEST_ASSERT_TRUE(cJSON_WriterRaw(&writer, "{\"x\":[1,2]}"));
+    TEST_ASSERT_TRUE(cJSON_WriterEndObject(&writer));
+    TEST_ASSERT_TRUE(cJSON_WriterFlush(&writer));
+
+    TEST_ASSERT_EQUAL_STRING("{\"name\":\"a\\tb\\\"c\\u0001\",\"values\":[1,-0.5,0.33333333333333331,true,false,null,[],{}],\"raw\":{\"x\":[1,2]}}", output.data);
+    TEST_ASSERT_TRUE(output.largest < sizeof(buffer));
+}
+
+static void writer_should_split_long_strings(void)
+{
+    char string[200];
+    char *expected = NULL;
+    cJSON *item = NULL;
+
+    memset(string, 'a', sizeof(string) - 1);
+    string[sizeof(string) - 1] = '\0';
+    string[50] = '\n';
+    string[150] = '\x1f';
+
+    start_writer();
+    TEST_ASSERT_TRUE(cJSON_WriterBeginArray(&writer));
+    TEST_ASSERT_TRUE(cJSON_WriterString(&writer, string));
+    TEST_ASSERT_TRUE(cJSON_WriterEndArray(&writer));
+    TEST_ASSERT_TRUE(cJSON_WriterFlush(&writer));
+
+    item = cJSON_CreateArray();
+    cJSON_AddItemToArray(item, cJSON_CreateString(string));
+    expected = cJSON_PrintUnformatted(item);
+    TEST_ASSERT_EQUAL_STRING(expected, output.data);
+    TEST_ASSERT_TRUE(output.largest < sizeof(buffer));
+
+    free(expected);
+    cJSON_Delete(item);
+}
+
+static void writer_should_match_print_unformatted(void)
+{
+    char name[sizeof("inputs/test") + 20];
+    size_t i;
+
+    for (i = 1; i <= 11; i++)
+    {
+        char *content = NULL;
+        char *expected = NULL;
+        cJSON *tree = NULL;
+
+        sprintf(name, "inputs/test%u", (unsigned int)i);
+        content = read_file(name);
+        TEST_ASSERT_NOT_NULL(content);
+
+        tree = cJSON_Parse(content);
+        free(content);
+        if (tree == NULL)
+        {
+            /* test6 is not JSON */
+            continue;
+        }
+
+        start_writer();
+        TEST_ASSERT_TRUE(cJSON_WriterItem(&writer, tree));
+        TEST_ASSERT_TRUE(cJSON_WriterFlush(&writer));
+
+        expected = cJSON_PrintUnformatted(tree);
+        TEST_ASSERT_EQUAL_STRING(expected, output.data);
+        TEST_ASSERT_TRUE(output.largest < sizeof(buffer));
+
+        free(expected);
+        cJSON_Delete(tree);
+    }
+}
+
+static void writer_should_fail_on_misuse(void)
+{
+    size_t i;
+
+    /* value without key in an object */
+    start_writer();
+    TEST_ASSERT_TRUE(cJSON_WriterBeginObject(&writer));
+    TEST_ASSERT_FALSE(cJSON_WriterNumber(&writer, 1));
+    TEST_ASSERT_FALSE(cJSON_WriterEndObject(&writer));
+    TEST_ASSERT_FALSE(cJSON_WriterFlush(&writer));
+
+    /* key in an array */
+    start_writer();
+    TEST_ASSERT_TRUE(cJSON_WriterBeginArray(&writer));
+    TEST_ASSERT_FALSE(cJSON_WriterKey(&writer, "a"));
+
+    /* key without value */
+    start_writer();
+    TEST_ASSERT_TRUE(cJSON_WriterBeginObject(&writer));
+    TEST_ASSERT_TRUE(cJSON_WriterKey(&writer, "a"));
+    TEST_ASSERT_FALSE(cJSON_WriterEndObject(&writer));
+
+    /* mismatched end */
+    start_writer();
+    TEST_ASSERT_TRUE(cJSON_WriterBeginArray(&writer));
+    TEST_ASSERT_FALSE(cJSON_WriterEndObject(&writer));
+
+    /* end without begin */
+    start_writer();
+    TEST_ASSERT_FALSE(cJSON_WriterEndArray(&writer));
+
+    /* two values at top level */
+    start_writer();
+    TEST_ASSERT_TRUE(cJSON_WriterNull(&writer));
+    TEST_ASSERT_FALSE(cJSON_WriterNull(&writer));
+
+    /* too deep */
+    start_writer();
+    for (i = 0; i < CJSON_WRITER_MAX_DEPTH; i++)
+    {
+        TEST_ASSERT_TRUE(cJSON_WriterBeginArray(&writer));
+    }
+    TEST_ASSERT_FALSE(cJSON_WriterBeginArray(&writer));
+}
+
+static void writer_should_fail_when_output_fails(void)
+{
+    size_t i;
+
+    start_writer();
+    output.fail_after = 1;
+
+    TEST_ASSERT_TRUE(cJSON_WriterBeginArray(&writer));
+    for (i = 0; (i < 100) && cJSON_WriterString(&writer, "0123456789"); i++)
+    {
+    }
+    TEST_ASSERT_TRUE(i < 100);
+    TEST_ASSERT_FALSE(cJSON_WriterEndArray(&writer));
+    TEST_ASSERT_FALSE(cJSON_WriterFlush(&writer));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(writer_should_reject_invalid_arguments);
+    RUN_TEST(writer_should_write_documents);
+    RUN_TEST(writer_should_split_long_strings);
+    RUN_TEST(writer_should_match_print_unformatted);
+    RUN_TEST(writer_should_fail_on_misuse);
+    RUN_TEST(writer_should_fail_when_output_fails);
+
+    return UNITY_END();
+}
@@ -101,6 +101,9 @@
 //}}
 
 //DPORT{{
+#define DPORT_CTL_REG               (PERIPHS_DPORT_BASEADDR + 0x14)
+#define DPORT_CTL_DOUBLE_CLK        (BIT(0)) // CPU clock doubled to 160 MHz
+
 #define HOST_INF_SEL                (PERIPHS_DPORT_BASEADDR + 0x28)
 #define DPORT_LINK_DEVICE_SEL       0x000000FF
 #define DPORT_LINK_DEVICE_SEL_S     8
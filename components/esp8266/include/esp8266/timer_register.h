@@ -50,6 +50,12 @@
 #define FRC1_CTRL_DATA_MSB              7
 #define FRC1_CTRL_DATA_LSB              0
 #define FRC1_CTRL_DATA_MASK             0x000000ff
+#define FRC1_CTRL_ENABLE                (BIT(7))
+#define FRC1_CTRL_AUTOLOAD              (BIT(6))
+#define FRC1_CTRL_PRESCALE_1            (0x0 << 2)
+#define FRC1_CTRL_PRESCALE_16           (0x1 << 2)
+#define FRC1_CTRL_PRESCALE_256          (0x2 << 2)
+#define FRC1_CTRL_LEVEL_INT             (BIT(0))
 
 #define FRC1_INT_ADDRESS            (PERIPHS_TIMER_BASEDDR + 0xC)
 #define TIMER_FRC1_INT_CLR_MASK         (BIT(0))
@@ -0,0 +1,82 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+/**
+ * @file esp_cpu_load.h
+ * @brief periodic report of the CPU load and of the run time of each task
+ *
+ * The report is built from the FreeRTOS run time statistics, which count
+ * microseconds with CCOUNT when CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS is
+ * enabled. Each period it gives the CPU load, the time not spent in the idle
+ * task, the share of the interrupt handlers, and the time and load of each
+ * task, busiest first:
+ *
+ *     cpu load 23.4% (isr 2.1%) over 5000 ms
+ *     tiT                  812345 us  16.2%
+ *     ...
+ *
+ * The time of an interrupt handler is also counted in the task it interrupted.
+ * The time spent in light sleep, with CCOUNT stopped, is not counted.
+ */
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Function receiving the lines of the report
+ *
+ * @param line line of the report, without end of line
+ * @param arg  argument given to esp_cpu_load_start
+ */
+typedef void (*esp_cpu_load_sink_t)(const char *line, void *arg);
+
+/**
+ * @brief Start the periodic report of the CPU load
+ *
+ * The report is made by the "cpu_load" task.
+ *
+ * @param period_ms report period in milliseconds
+ * @param sink      function receiving the lines of the report, from the
+ *                  "cpu_load" task, NULL to log them
+ * @param arg       argument of the sink
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the period is shorter than a tick
+ *      - ESP_ERR_INVALID_STATE if the report is started already
+ *      - ESP_ERR_NOT_SUPPORTED without CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+ *      - ESP_ERR_NO_MEM if the task can not be created
+ */
+esp_err_t esp_cpu_load_start(uint32_t period_ms, esp_cpu_load_sink_t sink, void *arg);
+
+/**
+ * @brief Stop the periodic report of the CPU load
+ *
+ * It waits for the report in progress, it must not be called from the sink.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the report is not started
+ */
+esp_err_t esp_cpu_load_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -29,14 +29,15 @@
  * use RTOS notification mechanisms (queues, semaphores, event groups, etc.) to
  * pass information to other tasks.
  *
- * To be implemented: it should be possible to request the callback to be called
- * directly from the ISR. This reduces the latency, but has potential impact on
+ * It is possible to request the callback to be called directly from the ISR,
+ * with ESP_TIMER_ISR. This reduces the latency, but has potential impact on
  * all other callbacks which need to be dispatched. This option should only be
  * used for simple callback functions, which do not take longer than a few
- * microseconds to run.
+ * microseconds to run. Such callbacks may only use the "FromISR" RTOS APIs.
  *
- * Implementation note: on the ESP32, esp_timer APIs use the "legacy" FRC2
- * timer. Timer callbacks are called from a task running on the PRO CPU.
+ * Implementation note: on the ESP8266, esp_timer APIs use the FRC1 timer, which
+ * applications must not use directly. Timer callbacks are called from the
+ * "esp_timer" task, whose stack size is set by CONFIG_ESP_TIMER_TASK_STACK_SIZE.
  */
 
 #include <stdint.h>
@@ -47,11 +48,6 @@
 extern "C" {
 #endif
 
-/**
- * Important: This function is based on FreeRTOS timer not real time hard timer.
- *            Adding this just for some user passing compiling now.
- */
-
 /**
  * @brief Opaque type representing a single esp_timer
  */
@@ -69,13 +65,9 @@ typedef void (*esp_timer_cb_t)(void* arg);
  */
 typedef enum {
     ESP_TIMER_TASK,     //!< Callback is called from timer task
+    ESP_TIMER_ISR,      //!< Callback is called from timer ISR
 
-    /* Not supported for now, provision to allow callbacks to run directly
-     * from an ISR:
-
-        ESP_TIMER_ISR,      //!< Callback is called from timer ISR
-
-     */
+    ESP_TIMER_MAX,      //!< Count of the methods for dispatching timer callback
 } esp_timer_dispatch_t;
 
 /**
@@ -152,11 +144,14 @@ esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
  * Timer should not be running when this function is called. This function will
  * start the timer which will trigger every 'period' microseconds.
  *
+ * A callback which returns late is called again right away for the period it
+ * missed, and the periods after that one which have passed are skipped.
+ *
  * @param timer timer handle created using esp_timer_create
- * @param period timer period, in microseconds
+ * @param period timer period, in microseconds, at least 50
  * @return
  *      - ESP_OK on success
- *      - ESP_ERR_INVALID_ARG if the handle is invalid
+ *      - ESP_ERR_INVALID_ARG if the handle or the period is invalid
  *      - ESP_ERR_INVALID_STATE if the timer is already running
  */
 esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period);
@@ -177,16 +172,72 @@ esp_err_t esp_timer_stop(esp_timer_handle_t timer);
 /**
  * @brief Delete an esp_timer instance
  *
- * The timer must be stopped before deleting. A one-shot timer which has expired
- * does not need to be stopped.
+ * A running timer is stopped first. A callback may delete its own timer.
  *
  * @param timer timer handle allocated using esp_timer_create
  * @return
  *      - ESP_OK on success
- *      - ESP_ERR_INVALID_STATE if the timer is not running
+ *      - ESP_ERR_INVALID_ARG if the handle is invalid
  */
 esp_err_t esp_timer_delete(esp_timer_handle_t timer);
 
+/**
+ * @brief Get time in microseconds since boot
+ *
+ * The time is kept by the FRC1 timer, which counts at 5 MHz independently of
+ * the CPU frequency.
+ *
+ * @return number of microseconds since esp_timer_init was called (this normally
+ *          happens early during application startup).
+ */
+int64_t esp_timer_get_time();
+
+/**
+ * @brief Get the timestamp when the next timeout is expected to occur
+ *
+ * @return Timestamp of the nearest timer event, in microseconds.
+ *         The timebase is the same as for the values returned by esp_timer_get_time,
+ *         INT64_MAX if no timer is armed.
+ */
+int64_t esp_timer_get_next_alarm();
+
+/**
+ * @brief Dump the list of timers to a stream
+ *
+ * If CONFIG_ESP_TIMER_PROFILING option is enabled, this prints the list of all
+ * the existing timers. Otherwise, only the list of active timers is printed.
+ *
+ * The format is:
+ *
+ *   name  disp  period  alarm  armed  triggered  run time  max run  max late
+ *
+ * whereby:
+ *
+ * name — timer name, or NULL
+ * disp — dispatch method, TASK or ISR
+ * period — period of timer, in microseconds, or 0 for one-shot timer
+ * alarm - time of the next alarm, in microseconds since boot, or 0 if the timer
+ *         is not started
+ *
+ * The following fields are printed if CONFIG_ESP_TIMER_PROFILING is defined:
+ *
+ * armed — number of times the timer was armed via esp_timer_start_X
+ * triggered - number of times the callback was called
+ * run time - total time taken by callback to execute, across all calls
+ * max run - longest time taken by one call of the callback
+ * max late - longest delay between the alarm and the call of the callback
+ *
+ * The times are in microseconds. 64-bit values are printed with "%lld", which
+ * the "nano" newlib level does not support.
+ *
+ * @param stream stream (such as stdout) to dump the information to
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the stream is NULL
+ *      - ESP_ERR_NO_MEM if can not allocate temporary buffer for the output
+ */
+esp_err_t esp_timer_dump(FILE* stream);
+
 #ifdef __cplusplus
 }
 #endif
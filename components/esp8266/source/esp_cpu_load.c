@@ -0,0 +1,252 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_cpu_load.h"
+
+#include "FreeRTOS.h"
+#include "freertos/task.h"
+
+#ifdef CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+
+#define CPU_LOAD_TASK_PRIO      (configMAX_PRIORITIES - 2)
+#define CPU_LOAD_TASK_STACK     2048
+#define CPU_LOAD_EXTRA_TASKS    4       /* tasks created between counting and listing them */
+#define CPU_LOAD_LINE_LEN       64
+#define CPU_LOAD_ISR_NUM        16
+
+/* Run time counter of a task at the previous report */
+typedef struct {
+    UBaseType_t number;
+    uint32_t run_time;
+} cpu_load_task_t;
+
+typedef struct {
+    bool valid;
+    uint32_t total;
+    uint64_t isr;
+    cpu_load_task_t *tasks;
+    UBaseType_t num;
+} cpu_load_t;
+
+static const char *TAG = "cpu_load";
+
+static TaskHandle_t s_task;
+static TickType_t s_period;
+static esp_cpu_load_sink_t s_sink;
+static void *s_sink_arg;
+
+static void cpu_load_output(const char *fmt, ...)
+{
+    va_list ap;
+    char line[CPU_LOAD_LINE_LEN];
+
+    va_start(ap, fmt);
+    vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+
+    if (s_sink)
+        s_sink(line, s_sink_arg);
+    else
+        ESP_LOGI(TAG, "%s", line);
+}
+
+static uint32_t cpu_load_permille(uint64_t part, uint32_t whole)
+{
+    return whole ? part * 1000 / whole : 0;
+}
+
+static uint64_t cpu_load_isr_run_time(void)
+{
+    uint64_t run_time = 0;
+
+    for (uint8_t i = 0; i < CPU_LOAD_ISR_NUM; i++)
+        run_time += xPortGetIsrRunTime(i);
+
+    return run_time;
+}
+
+static uint32_t cpu_load_prev_run_time(const cpu_load_t *load, UBaseType_t number)
+{
+    for (UBaseType_t i = 0; i < load->num; i++) {
+        if (load->tasks[i].number == number)
+            return load->tasks[i].run_time;
+    }
+
+    /* Created since the previous report */
+    return 0;
+}
+
+/*
+ * Take a snapshot of the run time counters, and report the difference with
+ * the previous one when asked to. The counters wrap after 71 minutes, but
+ * their differences over a period do not.
+ */
+static void cpu_load_update(cpu_load_t *load, bool report)
+{
+    UBaseType_t num, max_num;
+    uint32_t total, period, idle = 0, busy, isr_load;
+    uint64_t isr;
+    TaskStatus_t *status;
+    cpu_load_task_t *tasks;
+    TaskHandle_t idle_task = xTaskGetIdleTaskHandle();
+
+    max_num = uxTaskGetNumberOfTasks() + CPU_LOAD_EXTRA_TASKS;
+    status = heap_caps_malloc(max_num * sizeof(TaskStatus_t), MALLOC_CAP_8BIT);
+    tasks = heap_caps_malloc(max_num * sizeof(cpu_load_task_t), MALLOC_CAP_8BIT);
+    if (!status || !tasks) {
+        ESP_LOGE(TAG, "No memory for %lu tasks", max_num);
+        load->valid = false;
+        goto exit;
+    }
+
+    num = uxTaskGetSystemState(status, max_num, &total);
+    isr = cpu_load_isr_run_time();
+
+    for (UBaseType_t i = 0; i < num; i++) {
+        tasks[i].number = status[i].xTaskNumber;
+        tasks[i].run_time = status[i].ulRunTimeCounter;
+
+        /* From now on the counter of the status is the time over the period */
+        status[i].ulRunTimeCounter -= cpu_load_prev_run_time(load, status[i].xTaskNumber);
+        if (status[i].xHandle == idle_task)
+            idle = status[i].ulRunTimeCounter;
+    }
+
+    period = total - load->total;
+
+    if (report && load->valid && num && period) {
+        /* Busiest tasks first */
+        for (UBaseType_t i = 1; i < num; i++) {
+            TaskStatus_t s = status[i];
+            UBaseType_t j;
+
+            for (j = i; j > 0 && status[j - 1].ulRunTimeCounter < s.ulRunTimeCounter; j--)
+                status[j] = status[j - 1];
+            status[j] = s;
+        }
+
+        busy = cpu_load_permille(period > idle ? period - idle : 0, period);
+        isr_load = cpu_load_permille(isr - load->isr, period);
+        cpu_load_output("cpu load %u.%u%% (isr %u.%u%%) over %u ms", busy / 10, busy % 10,
+                        isr_load / 10, isr_load % 10, period / 1000);
+
+        for (UBaseType_t i = 0; i < num; i++) {
+            uint32_t task_load = cpu_load_permille(status[i].ulRunTimeCounter, period);
+
+            cpu_load_output("%-16s %10u us %3u.%u%%", status[i].pcTaskName,
+                            status[i].ulRunTimeCounter, task_load / 10, task_load % 10);
+        }
+    }
+
+    heap_caps_free(load->tasks);
+    load->tasks = tasks;
+    load->num = num;
+    load->total = total;
+    load->isr = isr;
+    load->valid = true;
+    tasks = NULL;
+
+exit:
+    heap_caps_free(tasks);
+    heap_caps_free(status);
+}
+
+static void cpu_load_task(void *arg)
+{
+    cpu_load_t load = { 0 };
+    TickType_t wake = xTaskGetTickCount();
+    TickType_t wait;
+
+    cpu_load_update(&load, false);
+
+    while (1) {
+        wake += s_period;
+        wait = wake - xTaskGetTickCount();
+        if (wait > s_period) {
+            /* Late, the next report is due already */
+            wait = 0;
+        }
+
+        if (ulTaskNotifyTake(pdTRUE, wait))
+            break;
+
+        cpu_load_update(&load, true);
+    }
+
+    heap_caps_free(load.tasks);
+
+    s_task = NULL;
+    vTaskDelete(NULL);
+}
+
+esp_err_t esp_cpu_load_start(uint32_t period_ms, esp_cpu_load_sink_t sink, void *arg)
+{
+    TickType_t period = pdMS_TO_TICKS(period_ms);
+
+    if (!period)
+        return ESP_ERR_INVALID_ARG;
+
+    if (s_task)
+        return ESP_ERR_INVALID_STATE;
+
+    s_period = period;
+    s_sink = sink;
+    s_sink_arg = arg;
+
+    if (xTaskCreate(cpu_load_task, "cpu_load", CPU_LOAD_TASK_STACK, NULL,
+                    CPU_LOAD_TASK_PRIO, &s_task) != pdPASS) {
+        ESP_LOGE(TAG, "Create task error");
+        s_task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t esp_cpu_load_stop(void)
+{
+    if (!s_task)
+        return ESP_ERR_INVALID_STATE;
+
+    xTaskNotifyGive(s_task);
+
+    /* The task clears its handle just before deleting itself */
+    while (s_task)
+        vTaskDelay(1);
+
+    return ESP_OK;
+}
+
+#else /* CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS */
+
+esp_err_t esp_cpu_load_start(uint32_t period_ms, esp_cpu_load_sink_t sink, void *arg)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_cpu_load_stop(void)
+{
+    return ESP_ERR_INVALID_STATE;
+}
+
+#endif /* CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS */
@@ -12,42 +12,249 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/queue.h>
+
 #include "esp_timer.h"
 #include "esp_heap_caps.h"
 #include "esp_log.h"
 #include "FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/timers.h"
 
-#define ESP_TIMER_HZ CONFIG_FREERTOS_HZ
+#include "esp_timer_impl.h"
+
+/*
+ * The armed timers are kept in a list per dispatch method, sorted by alarm
+ * time. The hardware alarm is set for the first timer of both lists: its ISR
+ * calls the callbacks of the expired ESP_TIMER_ISR timers, and notifies the
+ * esp_timer task to call those of the ESP_TIMER_TASK timers.
+ */
+
+#ifdef CONFIG_ESP_TIMER_PROFILING
+#define WITH_PROFILING 1
+#endif
+
+#define ESP_TIMER_TASK_PRIO     (configMAX_PRIORITIES - 3)
+
+/* Shortest period of a periodic timer, shorter ones would never leave the ISR */
+#define ESP_TIMER_MIN_PERIOD_US 50
+
+#define ESP_TIMER_DUMP_LINE_LEN 128
 
 struct esp_timer {
-    TimerHandle_t       os_timer;
+    uint64_t                alarm;          //!< Time of the next expiry, 0 if not armed
+    uint64_t                period;         //!< 0 for a one-shot timer
+
+    esp_timer_cb_t          callback;
+
+    void                    *arg;
+
+    esp_timer_dispatch_t    dispatch_method;
 
-    esp_timer_cb_t      cb;
+    const char              *name;
 
-    void                *arg;
+#if WITH_PROFILING
+    uint32_t                times_armed;
 
-    TickType_t          period_ticks;
+    uint32_t                times_triggered;
+
+    uint64_t                total_callback_run_time;
+
+    uint32_t                max_callback_run_time;
+
+    uint32_t                max_lateness;   //!< Longest delay from the alarm to the callback
+#endif
+
+    LIST_ENTRY(esp_timer)   list_entry;
 };
 
+LIST_HEAD(esp_timer_list, esp_timer);
+
+static struct esp_timer_list s_timers[ESP_TIMER_MAX];
+#if WITH_PROFILING
+static struct esp_timer_list s_inactive_timers;
+#endif
+
+static TaskHandle_t s_timer_task;
+
+/* The task has expired timers to process, its list is out of the alarm */
+static bool s_task_notified;
+
+/* Timer whose callback is running, cleared if the callback deletes it */
+static esp_timer_handle_t s_timer_in_callback;
+
 static const char *TAG = "esp_timer";
 
+static inline bool timer_armed(esp_timer_handle_t timer)
+{
+    return timer->alarm > 0;
+}
+
 /**
- * @brief FreeRTOS callback function
+ * @brief Set the hardware alarm for the first timer to expire
  */
-static void esp_timer_callback(TimerHandle_t xTimer)
+static void timer_update_alarm(void)
 {
-    BaseType_t os_ret;
-    struct esp_timer *timer = (struct esp_timer *)pvTimerGetTimerID(xTimer);
+    esp_timer_handle_t isr_first = LIST_FIRST(&s_timers[ESP_TIMER_ISR]);
+    esp_timer_handle_t task_first = LIST_FIRST(&s_timers[ESP_TIMER_TASK]);
+    uint64_t alarm = UINT64_MAX;
 
-    timer->cb(timer->arg);
+    if (isr_first)
+        alarm = isr_first->alarm;
+    if (!s_task_notified && task_first && task_first->alarm < alarm)
+        alarm = task_first->alarm;
+
+    esp_timer_impl_set_alarm(alarm);
+}
+
+/**
+ * @brief Insert the timer in the list of its dispatch method, after the timers
+ *        which expire at the same time or before it
+ */
+static void timer_insert(esp_timer_handle_t timer)
+{
+    struct esp_timer_list *list = &s_timers[timer->dispatch_method];
+    esp_timer_handle_t it, last = NULL;
 
-    if (!timer->period_ticks) {
-        os_ret = xTimerStop(timer->os_timer, 0);
-        if (os_ret != pdPASS) {
-            ESP_LOGE(TAG, "Set timer from periodic to once error");
+    LIST_FOREACH(it, list, list_entry) {
+        if (timer->alarm < it->alarm) {
+            LIST_INSERT_BEFORE(it, timer, list_entry);
+            return;
         }
+        last = it;
+    }
+
+    if (last)
+        LIST_INSERT_AFTER(last, timer, list_entry);
+    else
+        LIST_INSERT_HEAD(list, timer, list_entry);
+}
+
+/**
+ * @brief Remove an armed timer from its list
+ */
+static void timer_disarm(esp_timer_handle_t timer)
+{
+    LIST_REMOVE(timer, list_entry);
+    timer->alarm = 0;
+    timer->period = 0;
+#if WITH_PROFILING
+    LIST_INSERT_HEAD(&s_inactive_timers, timer, list_entry);
+#endif
+}
+
+static esp_err_t timer_arm(esp_timer_handle_t timer, uint64_t timeout, uint64_t period)
+{
+    esp_err_t ret = ESP_OK;
+
+    portENTER_CRITICAL();
+
+    if (timer_armed(timer)) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else {
+#if WITH_PROFILING
+        LIST_REMOVE(timer, list_entry);
+        timer->times_armed++;
+#endif
+        timer->alarm = esp_timer_impl_get_time() + timeout;
+        timer->period = period;
+        timer_insert(timer);
+
+        if (LIST_FIRST(&s_timers[timer->dispatch_method]) == timer)
+            timer_update_alarm();
+    }
+
+    portEXIT_CRITICAL();
+
+    return ret;
+}
+
+/**
+ * @brief Call the callbacks of the expired timers of a dispatch method, then
+ *        set the alarm for the next one
+ */
+static void timer_process_alarms(esp_timer_dispatch_t dispatch_method)
+{
+    struct esp_timer_list *list = &s_timers[dispatch_method];
+    esp_timer_handle_t it;
+    uint64_t now;
+
+    portENTER_CRITICAL();
+
+    if (dispatch_method == ESP_TIMER_TASK)
+        s_task_notified = false;
+
+    now = esp_timer_impl_get_time();
+    while ((it = LIST_FIRST(list)) != NULL && it->alarm <= now) {
+        esp_timer_cb_t callback = it->callback;
+        void *arg = it->arg;
+#if WITH_PROFILING
+        uint64_t start = now;
+
+        it->times_triggered++;
+        if (now - it->alarm > it->max_lateness)
+            it->max_lateness = now - it->alarm;
+#endif
+
+        if (it->period) {
+            LIST_REMOVE(it, list_entry);
+            it->alarm += it->period;
+            /* Skip all but one of the periods which have passed */
+            if (it->alarm <= now)
+                it->alarm = now + it->period;
+            timer_insert(it);
+        } else {
+            timer_disarm(it);
+        }
+
+        s_timer_in_callback = it;
+        portEXIT_CRITICAL();
+
+        callback(arg);
+
+        portENTER_CRITICAL();
+        now = esp_timer_impl_get_time();
+#if WITH_PROFILING
+        if (s_timer_in_callback) {
+            uint32_t run_time = now - start;
+
+            it->total_callback_run_time += run_time;
+            if (run_time > it->max_callback_run_time)
+                it->max_callback_run_time = run_time;
+        }
+#endif
+        s_timer_in_callback = NULL;
+    }
+
+    timer_update_alarm();
+
+    portEXIT_CRITICAL();
+}
+
+static void timer_alarm_handler(void *arg)
+{
+    esp_timer_handle_t task_first = LIST_FIRST(&s_timers[ESP_TIMER_TASK]);
+    BaseType_t task_woken = pdFALSE;
+
+    if (!s_task_notified && task_first && task_first->alarm <= esp_timer_impl_get_time()) {
+        s_task_notified = true;
+        vTaskNotifyGiveFromISR(s_timer_task, &task_woken);
+    }
+
+    timer_process_alarms(ESP_TIMER_ISR);
+
+    if (task_woken == pdTRUE)
+        taskYIELD();
+}
+
+static void timer_task(void *arg)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        timer_process_alarms(ESP_TIMER_TASK);
     }
 }
 
@@ -56,7 +263,25 @@ static void esp_timer_callback(TimerHandle_t xTimer)
  */
 esp_err_t esp_timer_init(void)
 {
-    return ESP_OK;
+    esp_err_t ret;
+
+    if (s_timer_task)
+        return ESP_ERR_INVALID_STATE;
+
+    if (xTaskCreate(timer_task, "esp_timer", CONFIG_ESP_TIMER_TASK_STACK_SIZE, NULL,
+                    ESP_TIMER_TASK_PRIO, &s_timer_task) != pdPASS) {
+        ESP_LOGE(TAG, "Create task error");
+        s_timer_task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    ret = esp_timer_impl_init(timer_alarm_handler);
+    if (ret != ESP_OK) {
+        vTaskDelete(s_timer_task);
+        s_timer_task = NULL;
+    }
+
+    return ret;
 }
 
 /**
@@ -64,6 +289,18 @@ esp_err_t esp_timer_init(void)
  */
 esp_err_t esp_timer_deinit(void)
 {
+    if (!s_timer_task)
+        return ESP_ERR_INVALID_STATE;
+
+    if (!LIST_EMPTY(&s_timers[ESP_TIMER_TASK]) || !LIST_EMPTY(&s_timers[ESP_TIMER_ISR]))
+        return ESP_ERR_INVALID_STATE;
+
+    esp_timer_impl_deinit();
+
+    vTaskDelete(s_timer_task);
+    s_timer_task = NULL;
+    s_task_notified = false;
+
     return ESP_OK;
 }
 
@@ -73,32 +310,31 @@ esp_err_t esp_timer_deinit(void)
 esp_err_t esp_timer_create(const esp_timer_create_args_t* create_args,
                            esp_timer_handle_t* out_handle)
 {
-    assert(create_args);
-    assert(out_handle);
+    esp_timer_handle_t timer;
 
-    TimerHandle_t os_timer;
-    esp_timer_handle_t esp_timer;
+    if (!s_timer_task)
+        return ESP_ERR_INVALID_STATE;
 
-    esp_timer = heap_caps_malloc(sizeof(struct esp_timer), MALLOC_CAP_32BIT);
-    if (!esp_timer)
-        return ESP_ERR_NO_MEM;
+    if (!create_args || !create_args->callback || !out_handle ||
+        (unsigned)create_args->dispatch_method >= ESP_TIMER_MAX)
+        return ESP_ERR_INVALID_ARG;
 
-    esp_timer->cb = create_args->callback;
-    esp_timer->arg = create_args->arg;
-    esp_timer->period_ticks = 0;
-
-    os_timer = xTimerCreate(create_args->name,
-                            portMAX_DELAY,
-                            pdTRUE,
-                            esp_timer,
-                            esp_timer_callback);
-    if (os_timer) {
-        esp_timer->os_timer = os_timer;
-        *out_handle = (esp_timer_handle_t)esp_timer;
-    } else {
-        heap_caps_free(esp_timer);
+    timer = heap_caps_calloc(1, sizeof(struct esp_timer), MALLOC_CAP_32BIT);
+    if (!timer)
         return ESP_ERR_NO_MEM;
-    }
+
+    timer->callback = create_args->callback;
+    timer->arg = create_args->arg;
+    timer->dispatch_method = create_args->dispatch_method;
+    timer->name = create_args->name;
+
+#if WITH_PROFILING
+    portENTER_CRITICAL();
+    LIST_INSERT_HEAD(&s_inactive_timers, timer, list_entry);
+    portEXIT_CRITICAL();
+#endif
+
+    *out_handle = timer;
 
     return ESP_OK;
 }
@@ -108,93 +344,182 @@ esp_err_t esp_timer_create(const esp_timer_create_args_t* create_args,
  */
 esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
 {
-    assert(timer);
+    if (!timer)
+        return ESP_ERR_INVALID_ARG;
 
-    TimerHandle_t os_timer = timer->os_timer;
-    BaseType_t os_ret;
-    uint64_t last_us = timeout_us % (1000 * (1000 / ESP_TIMER_HZ));
-    uint32_t ticks = timeout_us / (1000 * (1000 / ESP_TIMER_HZ));
+    return timer_arm(timer, timeout_us, 0);
+}
 
-    if (last_us || !ticks)
+/**
+ * @brief Start a periodic timer
+ */
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    if (!timer || period < ESP_TIMER_MIN_PERIOD_US)
         return ESP_ERR_INVALID_ARG;
 
-    os_ret = xTimerChangePeriod(os_timer, ticks, portMAX_DELAY);
-    if (os_ret == pdPASS) {
-        TickType_t period_ticks = timer->period_ticks;
+    return timer_arm(timer, period, period);
+}
 
-        timer->period_ticks = 0;
-        os_ret = xTimerStart(os_timer, portMAX_DELAY);
-        if (os_ret != pdPASS) {
-            timer->period_ticks = period_ticks;
-            return ESP_ERR_INVALID_STATE;
-        }
+/**
+ * @brief Stop the timer
+ */
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    esp_err_t ret = ESP_OK;
+
+    if (!timer)
+        return ESP_ERR_INVALID_ARG;
+
+    portENTER_CRITICAL();
+
+    if (timer_armed(timer)) {
+        bool first = LIST_FIRST(&s_timers[timer->dispatch_method]) == timer;
+
+        timer_disarm(timer);
+        if (first)
+            timer_update_alarm();
     } else {
-        return ESP_ERR_INVALID_STATE;
+        ret = ESP_ERR_INVALID_STATE;
     }
 
-    return ESP_OK;
+    portEXIT_CRITICAL();
+
+    return ret;
 }
 
 /**
- * @brief Start a periodic timer
+ * @brief Delete an esp_timer instance
  */
-esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
 {
-    assert(timer);
+    if (!timer)
+        return ESP_ERR_INVALID_ARG;
 
-    TimerHandle_t os_timer = timer->os_timer;
-    BaseType_t os_ret;
-    uint64_t last_us = period % (1000 * (1000 / ESP_TIMER_HZ));
-    uint32_t ticks = period / (1000 * (1000 / ESP_TIMER_HZ));
+    portENTER_CRITICAL();
 
-    if (last_us || !ticks)
-        return ESP_ERR_INVALID_ARG;
+#if WITH_PROFILING
+    LIST_REMOVE(timer, list_entry);
+#else
+    if (timer_armed(timer))
+        LIST_REMOVE(timer, list_entry);
+#endif
 
-    os_ret = xTimerChangePeriod(os_timer, ticks, portMAX_DELAY);
-    if (os_ret == pdPASS) {
-        TickType_t period_ticks = timer->period_ticks;
+    if (s_timer_in_callback == timer)
+        s_timer_in_callback = NULL;
 
-        timer->period_ticks = ticks;
-        os_ret = xTimerStart(os_timer, portMAX_DELAY);
-        if (os_ret != pdPASS) {
-            timer->period_ticks = period_ticks;
-            return ESP_ERR_INVALID_STATE;
-        }
-    } else {
-        return ESP_ERR_INVALID_STATE;
-    }
+    portEXIT_CRITICAL();
+
+    heap_caps_free(timer);
 
     return ESP_OK;
 }
 
 /**
- * @brief Stop the timer
+ * @brief Get time in microseconds since boot
  */
-esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+int64_t esp_timer_get_time(void)
+{
+    return (int64_t)esp_timer_impl_get_time();
+}
+
+/**
+ * @brief Get the timestamp when the next timeout is expected to occur
+ */
+int64_t esp_timer_get_next_alarm(void)
 {
-    assert(timer);
+    esp_timer_handle_t isr_first, task_first;
+    int64_t next_alarm = INT64_MAX;
 
-    TimerHandle_t os_timer = timer->os_timer;
-    BaseType_t os_ret;
+    portENTER_CRITICAL();
 
-    os_ret = xTimerStop(os_timer, portMAX_DELAY);
+    isr_first = LIST_FIRST(&s_timers[ESP_TIMER_ISR]);
+    task_first = LIST_FIRST(&s_timers[ESP_TIMER_TASK]);
+    if (isr_first)
+        next_alarm = isr_first->alarm;
+    if (task_first && (int64_t)task_first->alarm < next_alarm)
+        next_alarm = task_first->alarm;
 
-    return os_ret == pdPASS ? ESP_OK : ESP_ERR_INVALID_STATE;   
+    portEXIT_CRITICAL();
+
+    return next_alarm;
+}
+
+static int timer_print(const struct esp_timer *timer, char *buf, size_t len)
+{
+    const char *name = timer->name ? timer->name : "NULL";
+
+#if WITH_PROFILING
+    return snprintf(buf, len, "%-16.16s  %-4s  %12lld  %12lld  %8u  %8u  %12lld  %8u  %8u\n",
+                    name, timer->dispatch_method == ESP_TIMER_ISR ? "ISR" : "TASK",
+                    (long long)timer->period, (long long)timer->alarm,
+                    (unsigned)timer->times_armed, (unsigned)timer->times_triggered,
+                    (long long)timer->total_callback_run_time,
+                    (unsigned)timer->max_callback_run_time, (unsigned)timer->max_lateness);
+#else
+    return snprintf(buf, len, "%-16.16s  %-4s  %12lld  %12lld\n",
+                    name, timer->dispatch_method == ESP_TIMER_ISR ? "ISR" : "TASK",
+                    (long long)timer->period, (long long)timer->alarm);
+#endif
 }
 
 /**
- * @brief Delete an esp_timer instance
+ * @brief Dump the list of timers to a stream
  */
-esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+esp_err_t esp_timer_dump(FILE* stream)
 {
-    assert(timer);
+    const struct esp_timer_list *lists[] = {
+        &s_timers[ESP_TIMER_TASK],
+        &s_timers[ESP_TIMER_ISR],
+#if WITH_PROFILING
+        &s_inactive_timers,
+#endif
+    };
+    esp_timer_handle_t it;
+    size_t count = 0, len = 0, buf_len, i;
+    char *buf;
+    int n;
+
+    if (!stream)
+        return ESP_ERR_INVALID_ARG;
 
-    TimerHandle_t os_timer = timer->os_timer;
-    BaseType_t os_ret;
+    /*
+     * Printing to the stream in the critical section could block on the UART,
+     * so print the timers to a buffer first.
+     */
+    portENTER_CRITICAL();
+    for (i = 0; i < sizeof(lists) / sizeof(lists[0]); i++) {
+        LIST_FOREACH(it, lists[i], list_entry)
+            count++;
+    }
+    portEXIT_CRITICAL();
 
-    os_ret = xTimerDelete(os_timer, portMAX_DELAY);
-    if (os_ret == pdPASS)
-        heap_caps_free(timer);
+    /* Room for timers created meanwhile */
+    buf_len = (count + 2) * ESP_TIMER_DUMP_LINE_LEN + 1;
+    buf = heap_caps_malloc(buf_len, MALLOC_CAP_8BIT);
+    if (!buf)
+        return ESP_ERR_NO_MEM;
 
-    return os_ret == pdPASS ? ESP_OK : ESP_ERR_INVALID_STATE; 
+    portENTER_CRITICAL();
+    for (i = 0; i < sizeof(lists) / sizeof(lists[0]); i++) {
+        LIST_FOREACH(it, lists[i], list_entry) {
+            if (buf_len - len <= ESP_TIMER_DUMP_LINE_LEN)
+                break;
+            n = timer_print(it, buf + len, ESP_TIMER_DUMP_LINE_LEN);
+            len += n < ESP_TIMER_DUMP_LINE_LEN ? n : ESP_TIMER_DUMP_LINE_LEN - 1;
+        }
+    }
+    portEXIT_CRITICAL();
+
+#if WITH_PROFILING
+    fprintf(stream, "%-16s  %-4s  %12s  %12s  %8s  %8s  %12s  %8s  %8s\n", "name", "disp", "period", "alarm",
+            "armed", "triggered", "run time", "max run", "max late");
+#else
+    fprintf(stream, "%-16s  %-4s  %12s  %12s\n", "name", "disp", "period", "alarm");
+#endif
+    fwrite(buf, 1, len, stream);
+
+    heap_caps_free(buf);
+
+    return ESP_OK;
 }
@@ -0,0 +1,190 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "FreeRTOS.h"
+
+#include "esp8266/eagle_soc.h"
+#include "esp8266/timer_register.h"
+#include "rom/ets_sys.h"
+
+#include "esp_timer_impl.h"
+
+/*
+ * esp_timer runs on FRC1, FRC2 being used by ets_timer.
+ *
+ * FRC1 counts down from its load value at APB_CLK_FREQ / 16 and raises its
+ * interrupt when it passes 0. Without autoload it goes on counting down from
+ * its top, so after an alarm it wraps every FRC1_PERIOD ticks, 1.68 s. Loading
+ * a new value restarts the count, so each alarm is a countdown to it and the
+ * time is the sum of the countdowns: the ISR adds the ticks to the alarm,
+ * setting an alarm adds the part of the countdown which has run. The time is
+ * kept without any alarm too, and survives interrupts being disabled for up to
+ * 1.68 s, even right after a short alarm.
+ *
+ * The APB clock does not change with the CPU frequency, unlike CCOUNT.
+ */
+
+#define FRC1_TICKS_PER_US   ((APB_CLK_FREQ) / 16 / 1000000)
+#define FRC1_PERIOD         (FRC1_COUNT_DATA_MASK + 1)
+#define FRC1_MAX_LOAD       FRC1_LOAD_DATA_MASK
+#define FRC1_MIN_LOAD       (5 * FRC1_TICKS_PER_US)     /* shorter than taking the interrupt */
+
+static uint64_t s_time_us;          /* time at the last load or wrap */
+static uint32_t s_time_ticks;       /* ticks after s_time_us, less than a microsecond */
+static uint32_t s_load;             /* ticks from then to the next wrap */
+
+static esp_timer_alarm_handler_t s_alarm_handler;
+
+static inline uint32_t frc1_count(void)
+{
+    return REG_READ(FRC1_COUNT_ADDRESS) & FRC1_COUNT_DATA_MASK;
+}
+
+static inline uint32_t frc1_wrapped(void)
+{
+    return REG_READ(FRC1_CTRL_ADDRESS) & TIMER_FRC1_INT;
+}
+
+static inline void frc1_add_ticks(uint32_t ticks)
+{
+    ticks += s_time_ticks;
+    s_time_us += ticks / FRC1_TICKS_PER_US;
+    s_time_ticks = ticks % FRC1_TICKS_PER_US;
+}
+
+/*
+ * Ticks counted since the last load or wrap accounted in the time, for a count
+ * which was just read. A wrap whose interrupt is pending is included.
+ */
+static uint32_t frc1_elapsed(uint32_t count)
+{
+    if (frc1_wrapped()) {
+        /* The count may have been read before the wrap */
+        return s_load + FRC1_PERIOD - frc1_count();
+    }
+
+    return s_load - count;
+}
+
+/*
+ * Restart the countdown from the given load value, and add the part of the
+ * previous countdown which has run to the time.
+ *
+ * The counter is loaded right after it steps, so that only the few cycles of
+ * the register write are lost, rather than up to a whole tick each time.
+ */
+static void frc1_load(uint32_t load)
+{
+    uint32_t wrapped, count, prev, elapsed;
+
+    wrapped = frc1_wrapped();
+    prev = frc1_count();
+    while ((count = frc1_count()) == prev)
+        ;
+    REG_WRITE(FRC1_LOAD_ADDRESS, load);
+
+    if (wrapped || (frc1_wrapped() && count > FRC1_PERIOD / 2)) {
+        /* The count was read after a wrap which has not been accounted */
+        elapsed = s_load + FRC1_PERIOD - count;
+    } else {
+        /* No wrap, or one right after the count was read */
+        elapsed = s_load - count;
+    }
+
+    REG_WRITE(FRC1_INT_ADDRESS, FRC1_INT_CLR_MASK);
+    s_load = load;
+    frc1_add_ticks(elapsed);
+}
+
+static void frc1_isr(void *arg)
+{
+    /* Skip a wrap which frc1_load() has accounted already */
+    if (frc1_wrapped()) {
+        REG_WRITE(FRC1_INT_ADDRESS, FRC1_INT_CLR_MASK);
+        frc1_add_ticks(s_load);
+        s_load = FRC1_PERIOD;
+    }
+
+    s_alarm_handler(arg);
+}
+
+esp_err_t esp_timer_impl_init(esp_timer_alarm_handler_t alarm_handler)
+{
+    s_alarm_handler = alarm_handler;
+    s_time_us = 0;
+    s_time_ticks = 0;
+    s_load = FRC1_MAX_LOAD;
+
+    REG_WRITE(FRC1_LOAD_ADDRESS, s_load);
+    REG_WRITE(FRC1_CTRL_ADDRESS, FRC1_CTRL_ENABLE | FRC1_CTRL_PRESCALE_16);
+    REG_WRITE(FRC1_INT_ADDRESS, FRC1_INT_CLR_MASK);
+
+    _xt_isr_attach(ETS_FRC_TIMER1_INUM, frc1_isr, NULL);
+    TM1_EDGE_INT_ENABLE();
+    _xt_isr_unmask(1 << ETS_FRC_TIMER1_INUM);
+
+    return ESP_OK;
+}
+
+void esp_timer_impl_deinit(void)
+{
+    _xt_isr_mask(1 << ETS_FRC_TIMER1_INUM);
+    TM1_EDGE_INT_DISABLE();
+
+    REG_WRITE(FRC1_CTRL_ADDRESS, 0);
+    REG_WRITE(FRC1_INT_ADDRESS, FRC1_INT_CLR_MASK);
+
+    s_alarm_handler = NULL;
+}
+
+void esp_timer_impl_set_alarm(uint64_t timestamp)
+{
+    uint64_t now;
+    uint32_t load;
+
+    portENTER_CRITICAL();
+
+    now = esp_timer_impl_get_time();
+    if (timestamp <= now) {
+        load = FRC1_MIN_LOAD;
+    } else if (timestamp - now >= FRC1_MAX_LOAD / FRC1_TICKS_PER_US) {
+        load = FRC1_MAX_LOAD;
+    } else {
+        load = (uint32_t)(timestamp - now) * FRC1_TICKS_PER_US;
+        if (load < FRC1_MIN_LOAD)
+            load = FRC1_MIN_LOAD;
+    }
+
+    frc1_load(load);
+
+    portEXIT_CRITICAL();
+}
+
+uint64_t esp_timer_impl_get_time(void)
+{
+    uint64_t time_us;
+    uint32_t ticks;
+
+    portENTER_CRITICAL();
+
+    ticks = s_time_ticks + frc1_elapsed(frc1_count());
+    time_us = s_time_us + ticks / FRC1_TICKS_PER_US;
+
+    portEXIT_CRITICAL();
+
+    return time_us;
+}
@@ -0,0 +1,70 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+/**
+ * @file esp_timer_impl.h
+ *
+ * @brief Interface between the esp_timer list of alarms (esp_timer.c) and the
+ *        hardware timer which keeps the time and raises the alarms
+ *        (esp_timer_esp8266.c).
+ */
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Alarm handler, called from the timer ISR
+ */
+typedef void (*esp_timer_alarm_handler_t)(void *arg);
+
+/**
+ * @brief Start the hardware timer and attach its interrupt
+ *
+ * @param alarm_handler function called from the ISR at the alarm. It may also
+ *                      be called earlier, it has to check the time.
+ *
+ * @return
+ *      - ESP_OK on success
+ */
+esp_err_t esp_timer_impl_init(esp_timer_alarm_handler_t alarm_handler);
+
+/**
+ * @brief Stop the hardware timer and detach its interrupt
+ */
+void esp_timer_impl_deinit(void);
+
+/**
+ * @brief Set the time of the next call of the alarm handler
+ *
+ * It replaces the previous alarm. A time which has passed calls the alarm
+ * handler as soon as possible.
+ *
+ * @param timestamp time in microseconds, as returned by esp_timer_impl_get_time
+ */
+void esp_timer_impl_set_alarm(uint64_t timestamp);
+
+/**
+ * @brief Get the time since esp_timer_impl_init, in microseconds
+ */
+uint64_t esp_timer_impl_get_time(void);
+
+#ifdef __cplusplus
+}
+#endif
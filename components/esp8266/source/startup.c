@@ -28,6 +28,8 @@
 #include "esp_wifi_osi.h"
 #include "esp_heap_caps_init.h"
 #include "esp_task_wdt.h"
+#include "esp_timer.h"
+#include "esp_cpu_load.h"
 #include "internal/esp_wifi_internal.h"
 
 #define FLASH_MAP_ADDR 0x40200000
@@ -50,6 +52,8 @@ static void user_init_entry(void *param)
 
     extern void app_main(void);
 
+    assert(esp_timer_init() == ESP_OK);
+
     /* initialize C++ construture function */
     for (func = &__init_array_start; func < &__init_array_end; func++)
         func[0]();
@@ -72,6 +76,10 @@ static void user_init_entry(void *param)
     assert(esp_pthread_init() == 0);
 #endif
 
+#if defined(CONFIG_ESP_CPU_LOAD_REPORT_PERIOD) && CONFIG_ESP_CPU_LOAD_REPORT_PERIOD > 0
+    assert(esp_cpu_load_start(CONFIG_ESP_CPU_LOAD_REPORT_PERIOD * 1000, NULL, NULL) == ESP_OK);
+#endif
+
     app_main();
 
     wifi_task_delete(NULL);
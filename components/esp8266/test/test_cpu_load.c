@@ -0,0 +1,69 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+#include <string.h>
+
+#include <unity.h>
+#include "sdkconfig.h"
+#include "esp_timer.h"
+#include "esp_cpu_load.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#ifdef CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+
+TEST_CASE("Test run time counter against esp_timer", "[cpu_load]")
+{
+    uint32_t start, run_time;
+    int64_t time;
+
+    time = esp_timer_get_time();
+    start = ulPortGetRunTimeCounterValue();
+    vTaskDelay(500 / portTICK_PERIOD_MS);
+    run_time = ulPortGetRunTimeCounterValue() - start;
+    time = esp_timer_get_time() - time;
+
+    TEST_ASSERT_INT32_WITHIN(100, (int32_t)time, (int32_t)run_time);
+}
+
+static void test_cpu_load_sink(const char *line, void *arg)
+{
+    if (!strncmp(line, "cpu load ", 9))
+        xSemaphoreGive((SemaphoreHandle_t)arg);
+}
+
+TEST_CASE("Test CPU load report", "[cpu_load]")
+{
+    SemaphoreHandle_t sem = xSemaphoreCreateBinary();
+
+    TEST_ASSERT_NOT_NULL(sem);
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, esp_cpu_load_start(0, test_cpu_load_sink, sem));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_cpu_load_start(100, test_cpu_load_sink, sem));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_cpu_load_start(100, test_cpu_load_sink, sem));
+
+    for (int i = 0; i < 3; i++)
+        TEST_ASSERT_EQUAL_HEX32(pdPASS, xSemaphoreTake(sem, 1000 / portTICK_PERIOD_MS));
+
+    TEST_ASSERT_EQUAL(ESP_OK, esp_cpu_load_stop());
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_cpu_load_stop());
+    TEST_ASSERT_EQUAL_HEX32(pdFALSE, xSemaphoreTake(sem, 300 / portTICK_PERIOD_MS));
+
+    vSemaphoreDelete(sem);
+}
+
+#endif
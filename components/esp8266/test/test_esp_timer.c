@@ -111,3 +111,49 @@ TEST_CASE("Test esp_timer create and delete once mode", "[log]")
 
     vSemaphoreDelete(sem);
 }
+
+static volatile int64_t s_isr_cb_time;
+
+static void test_isr_timer_cb(void *p)
+{
+    SemaphoreHandle_t sem = (SemaphoreHandle_t)p;
+    BaseType_t task_woken = pdFALSE;
+
+    s_isr_cb_time = esp_timer_get_time();
+    xSemaphoreGiveFromISR(sem, &task_woken);
+}
+
+TEST_CASE("Test esp_timer ISR dispatch and microsecond timeouts", "[esp_timer]")
+{
+    SemaphoreHandle_t sem;
+    esp_timer_handle_t timer;
+    int64_t start;
+    int32_t late;
+
+    sem = xSemaphoreCreateBinary();
+    TEST_ASSERT_NOT_NULL(sem);
+
+    esp_timer_create_args_t timer_args = {
+        .callback = test_isr_timer_cb,
+        .arg = sem,
+        .dispatch_method = ESP_TIMER_ISR,
+        .name = "test_isr_timer",
+    };
+
+    TEST_ESP_OK(esp_timer_create(&timer_args, &timer));
+
+    for (int timeout = 1500; timeout <= 45000; timeout *= 3) {
+        start = esp_timer_get_time();
+        TEST_ESP_OK(esp_timer_start_once(timer, timeout));
+        TEST_ASSERT_EQUAL_HEX32(pdPASS, xSemaphoreTake(sem, portMAX_DELAY));
+        late = (int32_t)(s_isr_cb_time - start) - timeout;
+        TEST_ASSERT_TRUE(late >= 0 && late < 200);
+    }
+
+    start = esp_timer_get_time();
+    vTaskDelay(100 / portTICK_PERIOD_MS);
+    TEST_ASSERT_INT32_WITHIN(20 * 1000, 100 * 1000, (int32_t)(esp_timer_get_time() - start));
+
+    TEST_ESP_OK(esp_timer_delete(timer));
+    vSemaphoreDelete(sem);
+}
@@ -0,0 +1,428 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Checks the list of alarms of esp_timer against a simulated hardware timer:
+ * the time only moves when the test advances it, and the alarm handler is
+ * called exactly at the alarm which esp_timer has set. The esp_timer task
+ * runs whenever it has been notified.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../source/esp_timer.c"
+
+#define TEST_START_US   1000
+#define MAX_CALLS       64
+
+static int s_failed;
+
+#define CHECK(cond)     do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            s_failed++; \
+        } \
+    } while (0)
+
+/* Simulated hardware timer, FreeRTOS and critical sections */
+
+static uint64_t s_now;
+static uint64_t s_alarm = UINT64_MAX;
+static esp_timer_alarm_handler_t s_alarm_handler;
+static int s_task_notified_count;
+static int s_critical_nesting;
+static int s_in_isr;
+
+esp_err_t esp_timer_impl_init(esp_timer_alarm_handler_t alarm_handler)
+{
+    s_alarm_handler = alarm_handler;
+    s_now = TEST_START_US;
+    s_alarm = UINT64_MAX;
+    return ESP_OK;
+}
+
+void esp_timer_impl_deinit(void)
+{
+    s_alarm_handler = NULL;
+}
+
+void esp_timer_impl_set_alarm(uint64_t timestamp)
+{
+    CHECK(s_critical_nesting > 0);
+    s_alarm = timestamp;
+}
+
+uint64_t esp_timer_impl_get_time(void)
+{
+    return s_now;
+}
+
+void sim_enter_critical(void)
+{
+    s_critical_nesting++;
+}
+
+void sim_exit_critical(void)
+{
+    CHECK(s_critical_nesting > 0);
+    s_critical_nesting--;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stack_depth, void *param,
+                       uint32_t priority, TaskHandle_t *created_task)
+{
+    *created_task = (TaskHandle_t)code;
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait)
+{
+    return 0;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_task_woken)
+{
+    CHECK(s_in_isr);
+    s_task_notified_count++;
+    *higher_priority_task_woken = pdTRUE;
+}
+
+static void run_isr(void)
+{
+    s_in_isr = 1;
+    s_alarm_handler(NULL);
+    s_in_isr = 0;
+}
+
+/* Advance the time to 'until', running the ISR at each alarm and the task when it is notified */
+static void advance(uint64_t until)
+{
+    int steps = 0;
+
+    while (s_alarm <= until || s_task_notified_count) {
+        CHECK(++steps < 100000);
+        if (steps >= 100000)
+            break;
+
+        if (s_task_notified_count) {
+            s_task_notified_count--;
+            timer_process_alarms(ESP_TIMER_TASK);
+        } else {
+            if (s_alarm > s_now)
+                s_now = s_alarm;
+            run_isr();
+        }
+    }
+
+    if (until > s_now)
+        s_now = until;
+}
+
+/* Callbacks record who was called, when and from where */
+
+struct call {
+    int         id;
+    uint64_t    time;
+    int         in_isr;
+};
+
+static struct call s_calls[MAX_CALLS];
+static int s_call_count;
+static uint64_t s_callback_run_time;
+static uint64_t s_callback_overrun;
+static esp_timer_handle_t s_delete_in_callback;
+
+static void record_cb(void *arg)
+{
+    CHECK(s_critical_nesting == 0);
+
+    if (s_call_count < MAX_CALLS) {
+        s_calls[s_call_count].id = (intptr_t)arg;
+        s_calls[s_call_count].time = s_now;
+        s_calls[s_call_count].in_isr = s_in_isr;
+    }
+    s_call_count++;
+
+    s_now += s_callback_run_time + s_callback_overrun;
+    s_callback_overrun = 0;
+
+    if (s_delete_in_callback) {
+        CHECK(esp_timer_delete(s_delete_in_callback) == ESP_OK);
+        s_delete_in_callback = NULL;
+    }
+}
+
+static void reset_calls(void)
+{
+    memset(s_calls, 0, sizeof(s_calls));
+    s_call_count = 0;
+    s_callback_run_time = 0;
+}
+
+static esp_timer_handle_t create(int id, esp_timer_dispatch_t dispatch_method, const char *name)
+{
+    esp_timer_create_args_t args = {
+        .callback = record_cb,
+        .arg = (void *)(intptr_t)id,
+        .dispatch_method = dispatch_method,
+        .name = name,
+    };
+    esp_timer_handle_t timer = NULL;
+
+    CHECK(esp_timer_create(&args, &timer) == ESP_OK);
+    CHECK(timer != NULL);
+    return timer;
+}
+
+static void test_init(void)
+{
+    esp_timer_create_args_t args = {
+        .callback = record_cb,
+    };
+    esp_timer_handle_t timer;
+
+    CHECK(esp_timer_create(&args, &timer) == ESP_ERR_INVALID_STATE);
+    CHECK(esp_timer_deinit() == ESP_ERR_INVALID_STATE);
+    CHECK(esp_timer_init() == ESP_OK);
+    CHECK(esp_timer_init() == ESP_ERR_INVALID_STATE);
+
+    CHECK(esp_timer_create(NULL, &timer) == ESP_ERR_INVALID_ARG);
+    CHECK(esp_timer_create(&args, NULL) == ESP_ERR_INVALID_ARG);
+    args.callback = NULL;
+    CHECK(esp_timer_create(&args, &timer) == ESP_ERR_INVALID_ARG);
+    args.callback = record_cb;
+    args.dispatch_method = ESP_TIMER_MAX;
+    CHECK(esp_timer_create(&args, &timer) == ESP_ERR_INVALID_ARG);
+
+    CHECK(esp_timer_get_time() == TEST_START_US);
+    CHECK(esp_timer_get_next_alarm() == INT64_MAX);
+}
+
+/* Timers expire in the order of their alarms, those at the same time in the order they were started */
+static void test_order(void)
+{
+    static const uint64_t timeouts[] = { 500, 100, 300, 100, 200 };
+    static const int order[] = { 1, 3, 4, 2, 0 };
+    esp_timer_handle_t timers[5];
+    uint64_t start = s_now;
+    int i;
+
+    reset_calls();
+    for (i = 0; i < 5; i++) {
+        timers[i] = create(i, ESP_TIMER_ISR, "order");
+        CHECK(esp_timer_start_once(timers[i], timeouts[i]) == ESP_OK);
+    }
+    CHECK(s_alarm == start + 100);
+    CHECK(esp_timer_get_next_alarm() == start + 100);
+
+    advance(start + 1000);
+
+    CHECK(s_call_count == 5);
+    for (i = 0; i < 5; i++) {
+        CHECK(s_calls[i].id == order[i]);
+        CHECK(s_calls[i].time == start + timeouts[order[i]]);
+    }
+    CHECK(s_alarm == UINT64_MAX);
+
+    for (i = 0; i < 5; i++)
+        CHECK(esp_timer_delete(timers[i]) == ESP_OK);
+}
+
+/* Any number of microseconds, not only RTOS ticks, and a spurious alarm calls nothing */
+static void test_microseconds(void)
+{
+    esp_timer_handle_t timer = create(7, ESP_TIMER_TASK, "us");
+    uint64_t start = s_now;
+
+    reset_calls();
+    CHECK(esp_timer_start_once(timer, 1234) == ESP_OK);
+    CHECK(s_alarm == start + 1234);
+
+    advance(start + 1233);
+    run_isr();
+    CHECK(s_task_notified_count == 0);
+    CHECK(s_call_count == 0);
+
+    advance(start + 1234);
+    CHECK(s_call_count == 1);
+    CHECK(s_calls[0].time == start + 1234);
+
+    s_now += 10;
+    CHECK(esp_timer_start_once(timer, 0) == ESP_OK);
+    advance(s_now);
+    CHECK(s_call_count == 2);
+    CHECK(s_calls[1].time == start + 1244);
+
+    CHECK(esp_timer_delete(timer) == ESP_OK);
+}
+
+/* ESP_TIMER_ISR callbacks run in the ISR, ESP_TIMER_TASK ones in the task */
+static void test_dispatch(void)
+{
+    esp_timer_handle_t isr_timer = create(1, ESP_TIMER_ISR, "isr");
+    esp_timer_handle_t task_timer = create(2, ESP_TIMER_TASK, "task");
+    esp_timer_handle_t task_timer2 = create(3, ESP_TIMER_TASK, "task2");
+    uint64_t start = s_now;
+
+    reset_calls();
+    CHECK(esp_timer_start_once(task_timer, 100) == ESP_OK);
+    CHECK(esp_timer_start_once(task_timer2, 150) == ESP_OK);
+    CHECK(esp_timer_start_once(isr_timer, 200) == ESP_OK);
+    CHECK(s_alarm == start + 100);
+
+    /* While the task has yet to run, the alarm is left to the ISR timers */
+    s_now = start + 100;
+    run_isr();
+    CHECK(s_task_notified_count == 1);
+    CHECK(s_call_count == 0);
+    CHECK(s_alarm == start + 200);
+
+    advance(start + 100);
+    CHECK(s_call_count == 1);
+    CHECK(s_calls[0].id == 2 && !s_calls[0].in_isr);
+    CHECK(s_alarm == start + 150);
+
+    advance(start + 300);
+    CHECK(s_call_count == 3);
+    CHECK(s_calls[1].id == 3 && !s_calls[1].in_isr && s_calls[1].time == start + 150);
+    CHECK(s_calls[2].id == 1 && s_calls[2].in_isr && s_calls[2].time == start + 200);
+
+    CHECK(esp_timer_delete(isr_timer) == ESP_OK);
+    CHECK(esp_timer_delete(task_timer) == ESP_OK);
+    CHECK(esp_timer_delete(task_timer2) == ESP_OK);
+}
+
+/* Periodic timers do not drift, and skip the periods their callback overran */
+static void test_periodic(void)
+{
+    esp_timer_handle_t timer = create(4, ESP_TIMER_ISR, "periodic");
+    uint64_t start = s_now;
+    int i;
+
+    reset_calls();
+    CHECK(esp_timer_start_periodic(timer, ESP_TIMER_MIN_PERIOD_US - 1) == ESP_ERR_INVALID_ARG);
+    CHECK(esp_timer_start_periodic(timer, 1000) == ESP_OK);
+    CHECK(esp_timer_start_periodic(timer, 1000) == ESP_ERR_INVALID_STATE);
+    CHECK(esp_timer_start_once(timer, 1000) == ESP_ERR_INVALID_STATE);
+
+    s_callback_run_time = 7;
+    advance(start + 10500);
+    CHECK(s_call_count == 10);
+    for (i = 0; i < 10; i++)
+        CHECK(s_calls[i].time == start + (i + 1) * 1000);
+
+    /* The callback of the 11th period overruns 2.5 of them: the 12th is late, the 13th skipped */
+    s_callback_run_time = 0;
+    s_callback_overrun = 2500;
+    advance(start + 11000);
+    CHECK(s_call_count == 12);
+    CHECK(s_calls[11].time == start + 13500);
+    CHECK(s_alarm == start + 14500);
+    advance(start + 14500);
+    CHECK(s_call_count == 13);
+    CHECK(s_calls[12].time == start + 14500);
+
+    CHECK(esp_timer_stop(timer) == ESP_OK);
+    CHECK(esp_timer_stop(timer) == ESP_ERR_INVALID_STATE);
+    CHECK(s_alarm == UINT64_MAX);
+    advance(start + 20000);
+    CHECK(s_call_count == 13);
+
+    CHECK(timer->times_armed == 1);
+    CHECK(timer->times_triggered == 13);
+    CHECK(timer->max_lateness == 1500);
+    CHECK(timer->max_callback_run_time == 2500);
+    CHECK(timer->total_callback_run_time == 10 * 7 + 2500);
+
+    CHECK(esp_timer_delete(timer) == ESP_OK);
+}
+
+/* Deleting stops a timer, also from its own callback */
+static void test_delete(void)
+{
+    esp_timer_handle_t timer = create(5, ESP_TIMER_TASK, "delete");
+    esp_timer_handle_t timer2 = create(6, ESP_TIMER_TASK, "delete2");
+    uint64_t start = s_now;
+
+    reset_calls();
+    CHECK(esp_timer_start_once(timer, 100) == ESP_OK);
+    CHECK(esp_timer_start_once(timer2, 200) == ESP_OK);
+    CHECK(esp_timer_delete(timer) == ESP_OK);
+    CHECK(esp_timer_deinit() == ESP_ERR_INVALID_STATE);
+    CHECK(s_alarm == start + 200 || s_alarm == start + 100);
+
+    advance(start + 1000);
+    CHECK(s_call_count == 1);
+    CHECK(s_calls[0].id == 6);
+
+    s_delete_in_callback = timer2;
+    CHECK(esp_timer_start_periodic(timer2, 100) == ESP_OK);
+    advance(start + 2000);
+    CHECK(s_call_count == 2);
+    CHECK(s_alarm == UINT64_MAX);
+    CHECK(esp_timer_get_next_alarm() == INT64_MAX);
+}
+
+static void test_dump(void)
+{
+    esp_timer_handle_t armed = create(8, ESP_TIMER_ISR, "armed");
+    esp_timer_handle_t idle = create(9, ESP_TIMER_TASK, NULL);
+    uint64_t start = s_now;
+    char *buf = NULL;
+    size_t len = 0;
+    FILE *stream;
+    char line[128];
+
+    CHECK(esp_timer_start_periodic(armed, 200) == ESP_OK);
+    advance(start + 500);
+
+    stream = open_memstream(&buf, &len);
+    CHECK(esp_timer_dump(NULL) == ESP_ERR_INVALID_ARG);
+    CHECK(esp_timer_dump(stream) == ESP_OK);
+    fclose(stream);
+
+    snprintf(line, sizeof(line), "%-16.16s  %-4s  %12lld  %12lld  %8u  %8u", "armed", "ISR", 200LL,
+             (long long)(start + 600), 1, 2);
+    CHECK(strstr(buf, line) != NULL);
+    CHECK(strstr(buf, "NULL") != NULL);
+    CHECK(strncmp(buf, "name", 4) == 0);
+    free(buf);
+
+    CHECK(esp_timer_delete(armed) == ESP_OK);
+    CHECK(esp_timer_delete(idle) == ESP_OK);
+    CHECK(LIST_EMPTY(&s_inactive_timers));
+}
+
+int main(void)
+{
+    test_init();
+    test_order();
+    test_microseconds();
+    test_dispatch();
+    test_periodic();
+    test_delete();
+    test_dump();
+
+    CHECK(esp_timer_deinit() == ESP_OK);
+    CHECK(s_critical_nesting == 0);
+
+    printf("%s\n", s_failed ? "FAILED" : "OK");
+    return s_failed ? 1 : 0;
+}
@@ -0,0 +1,159 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_freertos_trace.h"
+
+#ifdef CONFIG_FREERTOS_TRACE
+
+#define TRACE_VERSION   1
+#define TRACE_SIZE      CONFIG_FREERTOS_TRACE_BUFFER_SIZE
+
+typedef struct {
+    uint32_t time;
+    uint32_t obj;
+    uint16_t event;
+    uint16_t arg;
+} trace_record_t;
+
+extern char NMIIrqIsOn;
+
+static trace_record_t s_records[TRACE_SIZE];
+static uint32_t s_next;             /* index of the next record */
+static uint32_t s_count;            /* records in the buffer */
+static uint32_t s_lost;             /* records dropped in the NMI */
+static bool s_enabled = true;
+static const void *s_task;          /* task switched in last */
+
+void IRAM_ATTR esp_freertos_trace_record(esp_freertos_trace_event_t event, uint32_t arg, const void *obj)
+{
+    trace_record_t *record;
+
+    /* The NMI can not be held off, and can interrupt a record */
+    if (NMIIrqIsOn) {
+        if (s_enabled)
+            s_lost++;
+        return;
+    }
+
+    vPortEnterCritical();
+
+    if (s_enabled) {
+        record = &s_records[s_next];
+        record->time = ulPortGetRunTimeCounterValue();
+        record->obj = (uint32_t)obj;
+        record->event = event;
+        record->arg = arg;
+
+        if (++s_next == TRACE_SIZE)
+            s_next = 0;
+        if (s_count < TRACE_SIZE)
+            s_count++;
+    }
+
+    vPortExitCritical();
+}
+
+void IRAM_ATTR esp_freertos_trace_task_switched_in(const void *task)
+{
+    if (task == s_task)
+        return;
+
+    s_task = task;
+    esp_freertos_trace_record(ESP_FREERTOS_TRACE_TASK_SWITCH, 0, task);
+}
+
+void esp_freertos_trace_start(void)
+{
+    vPortEnterCritical();
+    s_enabled = true;
+    vPortExitCritical();
+
+    /* Events were missed: restart from the current task */
+    esp_freertos_trace_record(ESP_FREERTOS_TRACE_START, 0, xTaskGetCurrentTaskHandle());
+}
+
+void esp_freertos_trace_stop(void)
+{
+    vPortEnterCritical();
+    s_enabled = false;
+    vPortExitCritical();
+}
+
+void esp_freertos_trace_clear(void)
+{
+    vPortEnterCritical();
+    s_next = 0;
+    s_count = 0;
+    s_lost = 0;
+    vPortExitCritical();
+
+    esp_freertos_trace_record(ESP_FREERTOS_TRACE_START, 0, xTaskGetCurrentTaskHandle());
+}
+
+static void trace_dump_tasks(FILE *stream)
+{
+    UBaseType_t num;
+    TaskStatus_t *tasks;
+
+    num = uxTaskGetNumberOfTasks();
+    tasks = pvPortMalloc(num * sizeof(TaskStatus_t));
+    if (!tasks)
+        return;
+
+    num = uxTaskGetSystemState(tasks, num, NULL);
+    for (UBaseType_t i = 0; i < num; i++)
+        fprintf(stream, "T %08x %s\n", (uint32_t)tasks[i].xHandle, tasks[i].pcTaskName);
+
+    vPortFree(tasks);
+}
+
+esp_err_t esp_freertos_trace_dump(FILE *stream)
+{
+    uint32_t index;
+
+    if (!stream)
+        return ESP_ERR_INVALID_ARG;
+
+    /* The records can be read without lock once it is stopped */
+    esp_freertos_trace_stop();
+
+    fprintf(stream, "--- freertos trace begin %u ---\n", TRACE_VERSION);
+
+    trace_dump_tasks(stream);
+
+    index = (s_next + TRACE_SIZE - s_count) % TRACE_SIZE;
+    for (uint32_t i = 0; i < s_count; i++) {
+        const trace_record_t *record = &s_records[index];
+
+        fprintf(stream, "E %08x %x %x %08x\n", record->time, record->event, record->arg, record->obj);
+
+        if (++index == TRACE_SIZE)
+            index = 0;
+    }
+
+    fprintf(stream, "--- freertos trace end %u ---\n", s_lost);
+    fflush(stream);
+
+    return ferror(stream) ? ESP_FAIL : ESP_OK;
+}
+
+#endif /* CONFIG_FREERTOS_TRACE */
@@ -94,8 +94,16 @@
 #define configMINIMAL_STACK_SIZE	( ( unsigned short ) 768 )
 //#define configTOTAL_HEAP_SIZE		( ( size_t ) ( 17 * 1024 ) )
 #define configMAX_TASK_NAME_LEN		( 16 )
+#ifdef CONFIG_FREERTOS_USE_TRACE_FACILITY
+#define configUSE_TRACE_FACILITY	1
+#else
 #define configUSE_TRACE_FACILITY	0
+#endif
+#ifdef CONFIG_FREERTOS_USE_STATS_FORMATTING_FUNCTIONS
+#define configUSE_STATS_FORMATTING_FUNCTIONS 1
+#else
 #define configUSE_STATS_FORMATTING_FUNCTIONS 0
+#endif
 #define configUSE_16_BIT_TICKS		0
 #define configIDLE_SHOULD_YIELD		1
 
@@ -162,5 +170,34 @@ NVIC value of 255. */
 /* add this to dump task stack information */
 #define configRECORD_STACK_HIGH_ADDRESS 1
 
+#ifdef CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+/* Run time in microseconds, counted with CCOUNT by the port */
+#define configGENERATE_RUN_TIME_STATS 1
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE() ulPortGetRunTimeCounterValue()
+#endif
+
+#if defined(CONFIG_FREERTOS_TRACE) && !defined(__ASSEMBLER__)
+/* Events recorded to the trace buffer, see esp_freertos_trace.h */
+#include "esp_freertos_trace.h"
+
+#define traceTASK_SWITCHED_IN()                 esp_freertos_trace_task_switched_in(pxCurrentTCB)
+#define traceTASK_CREATE(pxNewTCB)              esp_freertos_trace_record(ESP_FREERTOS_TRACE_TASK_CREATE, 0, pxNewTCB)
+#define traceTASK_DELETE(pxTCB)                 esp_freertos_trace_record(ESP_FREERTOS_TRACE_TASK_DELETE, 0, pxTCB)
+
+#define traceQUEUE_CREATE(pxQueue)              esp_freertos_trace_record(ESP_FREERTOS_TRACE_QUEUE_CREATE, (pxQueue)->ucQueueType, pxQueue)
+#define traceQUEUE_DELETE(pxQueue)              esp_freertos_trace_record(ESP_FREERTOS_TRACE_QUEUE_DELETE, 0, pxQueue)
+#define traceQUEUE_SEND(pxQueue)                esp_freertos_trace_record(ESP_FREERTOS_TRACE_QUEUE_SEND, 0, pxQueue)
+#define traceQUEUE_SEND_FAILED(pxQueue)         esp_freertos_trace_record(ESP_FREERTOS_TRACE_QUEUE_SEND_FAILED, 0, pxQueue)
+#define traceQUEUE_SEND_FROM_ISR(pxQueue)       esp_freertos_trace_record(ESP_FREERTOS_TRACE_QUEUE_SEND, 0, pxQueue)
+#define traceQUEUE_SEND_FROM_ISR_FAILED(pxQueue) esp_freertos_trace_record(ESP_FREERTOS_TRACE_QUEUE_SEND_FAILED, 0, pxQueue)
+#define traceQUEUE_RECEIVE(pxQueue)             esp_freertos_trace_record(ESP_FREERTOS_TRACE_QUEUE_RECEIVE, 0, pxQueue)
+#define traceQUEUE_RECEIVE_FAILED(pxQueue)      esp_freertos_trace_record(ESP_FREERTOS_TRACE_QUEUE_RECEIVE_FAILED, 0, pxQueue)
+#define traceQUEUE_RECEIVE_FROM_ISR(pxQueue)    esp_freertos_trace_record(ESP_FREERTOS_TRACE_QUEUE_RECEIVE, 0, pxQueue)
+#define traceQUEUE_RECEIVE_FROM_ISR_FAILED(pxQueue) esp_freertos_trace_record(ESP_FREERTOS_TRACE_QUEUE_RECEIVE_FAILED, 0, pxQueue)
+#define traceBLOCKING_ON_QUEUE_SEND(pxQueue)    esp_freertos_trace_record(ESP_FREERTOS_TRACE_QUEUE_BLOCK_SEND, 0, pxQueue)
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue) esp_freertos_trace_record(ESP_FREERTOS_TRACE_QUEUE_BLOCK_RECEIVE, 0, pxQueue)
+#endif
+
 #endif /* FREERTOS_CONFIG_H */
 
@@ -0,0 +1,132 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __ESP_FREERTOS_TRACE_H__
+#define __ESP_FREERTOS_TRACE_H__
+
+/**
+ * @file esp_freertos_trace.h
+ * @brief trace of the scheduler, queue and interrupt events
+ *
+ * With CONFIG_FREERTOS_TRACE, the FreeRTOS trace macros and the interrupt
+ * dispatcher write a record of each event to a ring buffer in RAM, which keeps
+ * the last CONFIG_FREERTOS_TRACE_BUFFER_SIZE events. The records are time
+ * stamped in microseconds with the run time counter of the port.
+ *
+ * The recording starts at boot. esp_freertos_trace_dump() stops it and writes
+ * the records as text to a stream, such as stdout for the UART or a file opened
+ * on SPIFFS. tools/freertos_trace.py converts the dump, or a serial log
+ * containing it, to a Chrome trace JSON file which chrome://tracing and
+ * Perfetto display as a timeline.
+ *
+ * The tick interrupt and the NMI are not traced. Events in the NMI are
+ * dropped and counted as lost.
+ *
+ * This header is included by FreeRTOSConfig.h, it must not include FreeRTOS
+ * headers.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Events of the trace
+ *
+ * The values are part of the dump format, read by tools/freertos_trace.py.
+ */
+typedef enum {
+    ESP_FREERTOS_TRACE_TASK_SWITCH = 1,         /*!< object: task switched in */
+    ESP_FREERTOS_TRACE_TASK_CREATE,             /*!< object: task */
+    ESP_FREERTOS_TRACE_TASK_DELETE,             /*!< object: task */
+    ESP_FREERTOS_TRACE_QUEUE_CREATE,            /*!< object: queue, argument: queueQUEUE_TYPE_xxx */
+    ESP_FREERTOS_TRACE_QUEUE_DELETE,            /*!< object: queue */
+    ESP_FREERTOS_TRACE_QUEUE_SEND,              /*!< object: queue */
+    ESP_FREERTOS_TRACE_QUEUE_SEND_FAILED,       /*!< object: queue */
+    ESP_FREERTOS_TRACE_QUEUE_RECEIVE,           /*!< object: queue */
+    ESP_FREERTOS_TRACE_QUEUE_RECEIVE_FAILED,    /*!< object: queue */
+    ESP_FREERTOS_TRACE_QUEUE_BLOCK_SEND,        /*!< object: queue the current task blocks on */
+    ESP_FREERTOS_TRACE_QUEUE_BLOCK_RECEIVE,     /*!< object: queue the current task blocks on */
+    ESP_FREERTOS_TRACE_ISR_ENTER,               /*!< argument: interrupt number */
+    ESP_FREERTOS_TRACE_ISR_EXIT,                /*!< argument: interrupt number */
+    ESP_FREERTOS_TRACE_START,                   /*!< object: current task, events before are missing */
+} esp_freertos_trace_event_t;
+
+/**
+ * @brief Start recording events, after the recorded ones
+ */
+void esp_freertos_trace_start(void);
+
+/**
+ * @brief Stop recording events, keeping the recorded ones
+ */
+void esp_freertos_trace_stop(void);
+
+/**
+ * @brief Discard the recorded events and the count of lost ones
+ */
+void esp_freertos_trace_clear(void);
+
+/**
+ * @brief Write the recorded events to a stream
+ *
+ * The recording is stopped, esp_freertos_trace_start() starts it again after
+ * the dump. The dump is made of text lines, between a "--- freertos trace
+ * begin" line and a "--- freertos trace end" line, so that it can be extracted
+ * from a serial log:
+ *
+ *     --- freertos trace begin 1 ---           version of the format
+ *     T 3ffef3c0 IDLE                          task: handle, name
+ *     E 0001e240 1 0 3ffef3c0                  event: time in us, event,
+ *     ...                                      argument, object, in hex
+ *     --- freertos trace end 0 ---             events lost
+ *
+ * The tasks are the ones existing at the time of the dump.
+ *
+ * @param stream stream to write to
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the stream is NULL
+ *      - ESP_FAIL if writing to the stream failed
+ */
+esp_err_t esp_freertos_trace_dump(FILE *stream);
+
+/**
+ * @brief Record an event, called by the trace macros
+ *
+ * @param event event
+ * @param arg   argument of the event
+ * @param obj   task or queue of the event
+ */
+void esp_freertos_trace_record(esp_freertos_trace_event_t event, uint32_t arg, const void *obj);
+
+/**
+ * @brief Record a task switch, called by traceTASK_SWITCHED_IN()
+ *
+ * A switch to the task which was running already is not recorded.
+ *
+ * @param task task switched in
+ */
+void esp_freertos_trace_task_switched_in(const void *task);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ESP_FREERTOS_TRACE_H__ */
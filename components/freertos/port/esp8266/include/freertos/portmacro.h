@@ -208,6 +208,55 @@ typedef struct _xt_isr_entry_ {
     void *  arg;
 } _xt_isr_entry;
 
+/*
+ * @brief set the priority of an interrupt in the dispatcher
+ *
+ * The interrupts pending together are serviced from the highest priority to the
+ * lowest one, and from the lowest number to the highest one at equal priority.
+ * By default the WDT has priority 2, GPIO 1 and the others 0. The tick is not
+ * serviced by the dispatcher.
+ *
+ * @param i interrupt number, ETS_xxx_INUM
+ * @param priority priority, from 0 to 15
+ */
+void _xt_isr_set_priority(uint8_t i, uint8_t priority);
+
+/*
+ * @brief get the priority of an interrupt in the dispatcher
+ *
+ * @param i interrupt number, ETS_xxx_INUM
+ *
+ * @return priority, from 0 to 15
+ */
+uint8_t _xt_isr_get_priority(uint8_t i);
+
+typedef struct _xt_isr_stats_ {
+    uint32_t count;                 /* calls of the handler */
+    uint32_t max_cycles;            /* longest run of the handler, in 80 MHz cycles */
+    uint32_t avg_cycles;            /* average run of the handler, in 80 MHz cycles */
+    uint32_t max_latency_cycles;    /* longest wait behind the handlers serviced before it */
+} _xt_isr_stats;
+
+/*
+ * @brief get the statistics of the handler of an interrupt
+ *
+ * Only with CONFIG_FREERTOS_ISR_STATS. The cycles are counted at 80 MHz,
+ * at a CPU frequency of 80 or 160 MHz, like the run time statistics.
+ *
+ * @param i interrupt number, ETS_xxx_INUM
+ * @param stats statistics
+ *
+ * @return true if the statistics are set, false if not counted
+ */
+bool _xt_isr_get_stats(uint8_t i, _xt_isr_stats *stats);
+
+/*
+ * @brief reset the statistics of the handlers of all interrupts
+ *
+ * The time returned by xPortGetIsrRunTime() is not reset.
+ */
+void _xt_isr_reset_stats(void);
+
 void show_critical_info(void);
 
 /*
@@ -236,6 +285,27 @@ bool interrupt_is_disable(void);
 /* Get tick rate per second */
 uint32_t xPortGetTickRateHz(void);
 
+/*
+ * @brief get the run time counter of the task statistics
+ *
+ * Only with CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS or CONFIG_FREERTOS_TRACE.
+ *
+ * @return microseconds counted with CCOUNT, wrapping after 71 minutes
+ */
+uint32_t ulPortGetRunTimeCounterValue(void);
+
+/*
+ * @brief get the time spent in the handlers of an interrupt
+ *
+ * The time is counted in the interrupted task too. The tick and NMI handlers
+ * are not counted.
+ *
+ * @param inum interrupt number, ETS_xxx_INUM
+ *
+ * @return microseconds, or 0 without CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+ */
+uint64_t xPortGetIsrRunTime(uint8_t inum);
+
 void _xt_enter_first_task(void);
 
 #ifdef __cplusplus
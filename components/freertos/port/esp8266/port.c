@@ -177,8 +177,61 @@ void SoftIsrHdl(void* arg)
     ETS_NMI_UNLOCK();
 }
 
+#if defined(CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS) || defined(CONFIG_FREERTOS_TRACE) || \
+    defined(CONFIG_FREERTOS_ISR_STATS)
+/*
+ * The run time counter counts microseconds with CCOUNT, for the run time
+ * statistics and the time stamps of the trace. CCOUNT runs at the CPU
+ * frequency, 80 or 160 MHz, so its cycles are counted at 80 MHz. It wraps
+ * after 26 s at 160 MHz: the counter is updated at each tick to never miss a
+ * wrap.
+ */
+#define RUN_TIME_CYCLES_PER_US  80
+
+static inline uint32_t run_time_cycles(uint32_t ccount_delta)
+{
+    if (REG_READ(DPORT_CTL_REG) & DPORT_CTL_DOUBLE_CLK)
+        return ccount_delta >> 1;
+
+    return ccount_delta;
+}
+#endif
+
+#if defined(CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS) || defined(CONFIG_FREERTOS_TRACE)
+static uint32_t s_run_time_ccount;
+static uint32_t s_run_time_cycles;
+static uint32_t s_run_time_us;
+
+static inline void run_time_update(uint32_t ccount)
+{
+    uint32_t cycles = s_run_time_cycles + run_time_cycles(ccount - s_run_time_ccount);
+
+    s_run_time_ccount = ccount;
+    s_run_time_us += cycles / RUN_TIME_CYCLES_PER_US;
+    s_run_time_cycles = cycles % RUN_TIME_CYCLES_PER_US;
+}
+
+uint32_t IRAM_ATTR ulPortGetRunTimeCounterValue(void)
+{
+    uint32_t run_time_us;
+
+    vPortEnterCritical();
+
+    run_time_update(xthal_get_ccount());
+    run_time_us = s_run_time_us;
+
+    vPortExitCritical();
+
+    return run_time_us;
+}
+#endif
+
 void xPortSysTickHandle(void)
 {
+#if defined(CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS) || defined(CONFIG_FREERTOS_TRACE)
+    ulPortGetRunTimeCounterValue();
+#endif
+
     if (xTaskIncrementTick() != pdFALSE) {
         vTaskSwitchContext();
     }
@@ -298,7 +351,16 @@ void PortEnableInt_NoNest(void)
 /*-----------------------------------------------------------*/
 void ResetCcountVal(unsigned int cnt_val)
 {
-    asm volatile("wsr a2, ccount");
+#if defined(CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS) || defined(CONFIG_FREERTOS_TRACE)
+    /* Count the run time up to now, and from the new value on */
+    vPortEnterCritical();
+    run_time_update(xthal_get_ccount());
+    s_run_time_ccount = cnt_val;
+    asm volatile("wsr %0, ccount" : : "a"(cnt_val) : "memory");
+    vPortExitCritical();
+#else
+    asm volatile("wsr %0, ccount" : : "a"(cnt_val) : "memory");
+#endif
 }
 
 /*
@@ -318,36 +380,209 @@ bool interrupt_is_disable(void)
 _xt_isr_entry isr[16];
 char _xt_isr_status = 0;
 
+/*
+ * Priorities of the interrupts in the dispatcher, and the interrupts ordered
+ * from the highest priority to the lowest one, the tick excepted. The WDT is
+ * first, to panic before another handler runs, then GPIO.
+ */
+#define ISR_NUM             16
+#define ISR_MAX_PRIORITY    15
+
+static uint8_t isr_priority[ISR_NUM] = {
+    [ETS_WDT_INUM] = 2,
+    [ETS_GPIO_INUM] = 1,
+};
+
+static uint8_t isr_order[ISR_NUM - 1] = {
+    ETS_WDT_INUM, ETS_GPIO_INUM, 0, 1, 2, 3, 5, 7, 9, 10, 11, 12, 13, 14, 15
+};
+
+#if defined(CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS) || defined(CONFIG_FREERTOS_ISR_STATS)
+#define ISR_TIMING 1
+
+/*
+ * Time spent in the handlers of _xt_isr_handler(), in 80 MHz cycles, for
+ * xPortGetIsrRunTime() and _xt_isr_get_stats()
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+    uint64_t reset_cycles;          /* total at the last _xt_isr_reset_stats() */
+    uint32_t max_latency_cycles;
+} isr_stats_t;
+
+static isr_stats_t isr_stats[ISR_NUM];
+#endif
+
 void _xt_isr_attach(uint8_t i, _xt_isr func, void* arg)
 {
     isr[i].handler = func;
     isr[i].arg = arg;
 }
 
-uint16_t _xt_isr_handler(uint16_t i)
+void _xt_isr_set_priority(uint8_t i, uint8_t priority)
 {
-    uint8_t index;
+    int n = 0;
 
-    if (i & (1 << ETS_WDT_INUM)) {
-        index = ETS_WDT_INUM;
-    } else if (i & (1 << ETS_GPIO_INUM)) {
-        index = ETS_GPIO_INUM;
-    } else {
-        index = __builtin_ffs(i) - 1;
+    if (i >= ISR_NUM || i == ETS_MAX_INUM)
+        return;
 
-        if (index == ETS_MAX_INUM) {
-            i &= ~(1 << ETS_MAX_INUM);
-            index = __builtin_ffs(i) - 1;
+    if (priority > ISR_MAX_PRIORITY)
+        priority = ISR_MAX_PRIORITY;
+
+    vPortEnterCritical();
+
+    isr_priority[i] = priority;
+
+    for (int p = ISR_MAX_PRIORITY; p >= 0; p--) {
+        for (int j = 0; j < ISR_NUM; j++) {
+            if (j != ETS_MAX_INUM && isr_priority[j] == p)
+                isr_order[n++] = j;
         }
     }
 
-    _xt_clear_ints(1 << index);
+    vPortExitCritical();
+}
 
-    _xt_isr_status = 1;
+uint8_t _xt_isr_get_priority(uint8_t i)
+{
+    return i < ISR_NUM ? isr_priority[i] : 0;
+}
+
+bool _xt_isr_get_stats(uint8_t i, _xt_isr_stats *stats)
+{
+#ifdef CONFIG_FREERTOS_ISR_STATS
+    if (i >= ISR_NUM || !stats)
+        return false;
+
+    vPortEnterCritical();
+
+    stats->count = isr_stats[i].count;
+    stats->max_cycles = isr_stats[i].max_cycles;
+    stats->avg_cycles = isr_stats[i].count ?
+                        (isr_stats[i].total_cycles - isr_stats[i].reset_cycles) / isr_stats[i].count : 0;
+    stats->max_latency_cycles = isr_stats[i].max_latency_cycles;
+
+    vPortExitCritical();
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+void _xt_isr_reset_stats(void)
+{
+#ifdef CONFIG_FREERTOS_ISR_STATS
+    vPortEnterCritical();
+    for (int i = 0; i < ISR_NUM; i++) {
+        isr_stats[i].count = 0;
+        isr_stats[i].max_cycles = 0;
+        isr_stats[i].reset_cycles = isr_stats[i].total_cycles;
+        isr_stats[i].max_latency_cycles = 0;
+    }
+    vPortExitCritical();
+#endif
+}
+
+uint64_t xPortGetIsrRunTime(uint8_t inum)
+{
+#ifdef CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    uint64_t cycles;
+
+    if (inum >= ISR_NUM)
+        return 0;
+
+    vPortEnterCritical();
+    cycles = isr_stats[inum].total_cycles;
+    vPortExitCritical();
+
+    return cycles / RUN_TIME_CYCLES_PER_US;
+#else
+    return 0;
+#endif
+}
+
+/* Pending and enabled interrupts of level 1, like the vector computes them */
+static inline uint32_t isr_pending(void)
+{
+    uint32_t interrupt, intenable;
+
+    __asm__ __volatile__ ("rsr %0, INTERRUPT" : "=a"(interrupt));
+    __asm__ __volatile__ ("rsr %0, INTENABLE" : "=a"(intenable));
+
+    return interrupt & intenable & XCHAL_INTLEVEL1_MASK;
+}
+
+static inline void isr_call(uint8_t index, uint32_t entry)
+{
+#ifdef ISR_TIMING
+    uint32_t start, cycles, latency;
+    isr_stats_t *stats = &isr_stats[index];
+#endif
+
+#ifdef CONFIG_FREERTOS_TRACE
+    esp_freertos_trace_record(ESP_FREERTOS_TRACE_ISR_ENTER, index, NULL);
+#endif
+
+#ifdef ISR_TIMING
+    start = xthal_get_ccount();
     isr[index].handler(isr[index].arg);
+    cycles = run_time_cycles(xthal_get_ccount() - start);
+    latency = run_time_cycles(start - entry);
+
+    stats->count++;
+    stats->total_cycles += cycles;
+    if (cycles > stats->max_cycles)
+        stats->max_cycles = cycles;
+    if (latency > stats->max_latency_cycles)
+        stats->max_latency_cycles = latency;
+#else
+    isr[index].handler(isr[index].arg);
+#endif
+
+#ifdef CONFIG_FREERTOS_TRACE
+    esp_freertos_trace_record(ESP_FREERTOS_TRACE_ISR_EXIT, index, NULL);
+#endif
+}
+
+/*
+ * Service all the pending interrupts but the tick, in the order of their
+ * priorities. An interrupt raised by the time a handler returns is serviced
+ * in the same entry, before the pending ones of lower priority. Return the
+ * tick interrupt if it was pending, for the vector to handle it.
+ */
+uint16_t _xt_isr_handler(uint16_t i)
+{
+    uint32_t pending = i & ~(1 << ETS_MAX_INUM);
+    uint32_t serviced = 0;
+    uint32_t entry = 0;
+    uint8_t index;
+    int n;
+
+#ifdef ISR_TIMING
+    entry = xthal_get_ccount();
+#endif
+
+    _xt_isr_status = 1;
+
+    while (pending) {
+        for (n = 0; !(pending & (1 << isr_order[n])); n++)
+            ;
+        index = isr_order[n];
+
+        _xt_clear_ints(1 << index);
+        isr_call(index, entry);
+
+        /* Each interrupt once, a level one stuck high comes back after the exit */
+        serviced |= 1 << index;
+        pending = (pending | isr_pending()) & ~serviced & ~(1 << ETS_MAX_INUM);
+    }
+
     _xt_isr_status = 0;
 
-    return i & ~(1 << index);
+    return i & (1 << ETS_MAX_INUM);
 }
 
 int xPortInIsrContext(void)
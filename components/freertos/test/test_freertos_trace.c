@@ -0,0 +1,64 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unity.h>
+#include "sdkconfig.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#ifdef CONFIG_FREERTOS_TRACE
+
+TEST_CASE("Test FreeRTOS trace of a semaphore", "[freertos]")
+{
+    char *buf = NULL, line[32];
+    size_t len = 0;
+    FILE *stream;
+    SemaphoreHandle_t sem = xSemaphoreCreateBinary();
+
+    TEST_ASSERT_NOT_NULL(sem);
+
+    esp_freertos_trace_clear();
+    esp_freertos_trace_start();
+
+    xSemaphoreGive(sem);
+    TEST_ASSERT_EQUAL_HEX32(pdPASS, xSemaphoreTake(sem, portMAX_DELAY));
+    TEST_ASSERT_EQUAL_HEX32(pdFALSE, xSemaphoreTake(sem, 10 / portTICK_PERIOD_MS));
+
+    stream = open_memstream(&buf, &len);
+    TEST_ASSERT_NOT_NULL(stream);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_freertos_trace_dump(stream));
+    fclose(stream);
+
+    TEST_ASSERT_NOT_NULL(strstr(buf, "--- freertos trace begin 1 ---\n"));
+    TEST_ASSERT_NOT_NULL(strstr(buf, "--- freertos trace end 0 ---\n"));
+
+    snprintf(line, sizeof(line), " %x 0 %08x\n", ESP_FREERTOS_TRACE_QUEUE_SEND, (uint32_t)sem);
+    TEST_ASSERT_NOT_NULL(strstr(buf, line));
+    snprintf(line, sizeof(line), " %x 0 %08x\n", ESP_FREERTOS_TRACE_QUEUE_RECEIVE, (uint32_t)sem);
+    TEST_ASSERT_NOT_NULL(strstr(buf, line));
+    snprintf(line, sizeof(line), " %x 0 %08x\n", ESP_FREERTOS_TRACE_QUEUE_BLOCK_RECEIVE, (uint32_t)sem);
+    TEST_ASSERT_NOT_NULL(strstr(buf, line));
+
+    free(buf);
+    vSemaphoreDelete(sem);
+    esp_freertos_trace_start();
+}
+
+#endif
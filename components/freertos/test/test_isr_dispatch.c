@@ -0,0 +1,149 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+#include <string.h>
+
+#include <unity.h>
+#include <xtensa/hal.h>
+#include "sdkconfig.h"
+#include "rom/ets_sys.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+TEST_CASE("Test interrupt dispatcher priorities", "[freertos]")
+{
+    uint8_t prio = _xt_isr_get_priority(ETS_UART_INUM);
+
+    TEST_ASSERT_EQUAL(2, _xt_isr_get_priority(ETS_WDT_INUM));
+    TEST_ASSERT_EQUAL(1, _xt_isr_get_priority(ETS_GPIO_INUM));
+
+    _xt_isr_set_priority(ETS_UART_INUM, 3);
+    TEST_ASSERT_EQUAL(3, _xt_isr_get_priority(ETS_UART_INUM));
+
+    /* The UART is still serviced while preferred to the WDT */
+    vTaskDelay(100 / portTICK_PERIOD_MS);
+
+    _xt_isr_set_priority(ETS_UART_INUM, prio);
+    TEST_ASSERT_EQUAL(prio, _xt_isr_get_priority(ETS_UART_INUM));
+}
+
+/* Edge interrupts with no device, raised with INTSET */
+#define TEST_INUM_A     10
+#define TEST_INUM_B     11
+#define TEST_INUM_C     12
+#define TEST_INUM_D     13
+#define TEST_INUM_MASK  ((1 << TEST_INUM_A) | (1 << TEST_INUM_B) | (1 << TEST_INUM_C) | (1 << TEST_INUM_D))
+
+static uint8_t s_order[8];
+static uint32_t s_pending[8];
+static int s_calls;
+
+static uint32_t test_pending(void)
+{
+    uint32_t interrupt;
+
+    __asm__ __volatile__ ("rsr %0, INTERRUPT" : "=a"(interrupt));
+
+    return interrupt & TEST_INUM_MASK;
+}
+
+static void test_isr(void *arg)
+{
+    uint8_t inum = (uint8_t)(uint32_t)arg;
+
+    if (s_calls < sizeof(s_order)) {
+        s_order[s_calls] = inum;
+        s_pending[s_calls] = test_pending();
+    }
+    s_calls++;
+
+    /* Raised while the dispatcher runs, to be serviced before the lower ones */
+    if (inum == TEST_INUM_D)
+        xthal_set_intset(1 << TEST_INUM_B);
+}
+
+TEST_CASE("Test interrupt dispatcher order", "[freertos]")
+{
+    const uint8_t inums[] = { TEST_INUM_A, TEST_INUM_B, TEST_INUM_C, TEST_INUM_D };
+    const uint8_t order[] = { TEST_INUM_D, TEST_INUM_B, TEST_INUM_A, TEST_INUM_C };
+
+    for (int i = 0; i < sizeof(inums); i++)
+        _xt_isr_attach(inums[i], test_isr, (void *)(uint32_t)inums[i]);
+
+    _xt_isr_set_priority(TEST_INUM_D, 3);
+    _xt_isr_set_priority(TEST_INUM_B, 2);
+    _xt_isr_set_priority(TEST_INUM_A, 1);
+
+    memset(s_order, 0, sizeof(s_order));
+    s_calls = 0;
+    _xt_isr_reset_stats();
+
+    /* Pending together when the interrupts are enabled again */
+    vPortEnterCritical();
+    _xt_isr_unmask(TEST_INUM_MASK);
+    xthal_set_intset((1 << TEST_INUM_A) | (1 << TEST_INUM_C) | (1 << TEST_INUM_D));
+    vPortExitCritical();
+
+    _xt_isr_mask(TEST_INUM_MASK);
+
+    for (int i = 0; i < sizeof(inums); i++) {
+        _xt_isr_set_priority(inums[i], 0);
+        _xt_isr_attach(inums[i], NULL, NULL);
+    }
+
+    /* Each once, in the order of the priorities */
+    TEST_ASSERT_EQUAL(sizeof(order), s_calls);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(order, s_order, sizeof(order));
+
+    /* Serviced in one entry: the next ones are still pending in each handler */
+    TEST_ASSERT_EQUAL_HEX32((1 << TEST_INUM_A) | (1 << TEST_INUM_C), s_pending[0]);
+    TEST_ASSERT_EQUAL_HEX32((1 << TEST_INUM_A) | (1 << TEST_INUM_C), s_pending[1]);
+    TEST_ASSERT_EQUAL_HEX32(1 << TEST_INUM_C, s_pending[2]);
+    TEST_ASSERT_EQUAL_HEX32(0, s_pending[3]);
+
+#ifdef CONFIG_FREERTOS_ISR_STATS
+    for (int i = 0; i < sizeof(inums); i++) {
+        _xt_isr_stats stats;
+
+        TEST_ASSERT_TRUE(_xt_isr_get_stats(inums[i], &stats));
+        TEST_ASSERT_EQUAL(1, stats.count);
+    }
+#endif
+}
+
+#ifdef CONFIG_FREERTOS_ISR_STATS
+
+TEST_CASE("Test interrupt handler statistics", "[freertos]")
+{
+    _xt_isr_stats stats;
+
+    _xt_isr_reset_stats();
+    TEST_ASSERT_TRUE(_xt_isr_get_stats(ETS_SOFT_INUM, &stats));
+    TEST_ASSERT_EQUAL(0, stats.count);
+
+    /* A yield raises the software interrupt */
+    for (int i = 0; i < 10; i++)
+        taskYIELD();
+
+    TEST_ASSERT_TRUE(_xt_isr_get_stats(ETS_SOFT_INUM, &stats));
+    TEST_ASSERT_TRUE(stats.count >= 10);
+    TEST_ASSERT_TRUE(stats.max_cycles >= stats.avg_cycles);
+    TEST_ASSERT_TRUE(stats.avg_cycles > 0);
+
+    TEST_ASSERT_FALSE(_xt_isr_get_stats(16, &stats));
+}
+
+#endif
@@ -58,7 +58,9 @@ enum jsmnerr {
 	/* Invalid character inside JSON string */
 	JSMN_ERROR_INVAL = -2,
 	/* The string is not a full JSON packet, more bytes expected */
-	JSMN_ERROR_PART = -3
+	JSMN_ERROR_PART = -3,
+	/* The path passed to jsmn_find does not exist in the document */
+	JSMN_ERROR_NOENT = -4
 };
 
 /**
@@ -99,6 +101,102 @@ void jsmn_init(jsmn_parser *parser);
 int jsmn_parse(jsmn_parser *parser, const char *js, size_t len,
 		jsmntok_t *tokens, unsigned int num_tokens);
 
+/**
+ * Maximum nesting of objects and arrays the stream tokenizer can follow.
+ */
+#ifndef JSMN_STREAM_MAX_DEPTH
+#define JSMN_STREAM_MAX_DEPTH 32
+#endif
+
+/**
+ * Incremental JSON tokenizer. Unlike jsmn_parser it keeps no token array:
+ * tokens are returned as they are completed in a window of input that the
+ * caller slides over the document, so memory use does not depend on the
+ * document size.
+ *
+ * Token positions are relative to the window passed to jsmn_stream_parse;
+ * base is the offset of the window in the whole document.
+ */
+typedef struct {
+	unsigned int pos; /* offset of the first unconsumed byte in the window */
+	unsigned long base; /* offset of the window in the document */
+	unsigned int depth; /* number of open objects and arrays */
+	unsigned int state; /* what the grammar expects next */
+	unsigned long cut; /* document offset of the window end when a token was last cut by it */
+	unsigned char objects[(JSMN_STREAM_MAX_DEPTH + 7) / 8]; /* bit per level, set for objects */
+} jsmn_stream;
+
+/**
+ * Prepare a stream tokenizer for a new document
+ */
+void jsmn_stream_init(jsmn_stream *stream);
+
+/**
+ * Tokenize the window js[0..len) from stream->pos on, storing up to num_tokens
+ * completed tokens. Returns the number of tokens stored or a negative error;
+ * 0 means the window holds no complete token any more (or the document ended,
+ * see jsmn_stream_done), so more input is needed. If it is called again without
+ * more input after returning 0 for a token cut by the end of the window, the
+ * token does not fit in the window and JSMN_ERROR_NOMEM is returned.
+ *
+ * Strings and primitives are returned once they are complete in the window, a
+ * string used as an object key has size 1. Objects and arrays are returned
+ * twice: when they are opened (end is -1) and when they are closed (start is
+ * -1). A primitive is only complete once the byte after it has been seen.
+ */
+int jsmn_stream_parse(jsmn_stream *stream, const char *js, size_t len,
+		jsmntok_t *tokens, unsigned int num_tokens);
+
+/**
+ * Release the part of the window that has been tokenized. Returns the number
+ * of bytes the caller must drop from the front of the window before appending
+ * more input and calling jsmn_stream_parse again.
+ */
+unsigned int jsmn_stream_consume(jsmn_stream *stream);
+
+/**
+ * Check if the top level value has been completed
+ */
+int jsmn_stream_done(const jsmn_stream *stream);
+
+/**
+ * Path lookup on top of the stream tokenizer. The path is written as
+ * "$.state.desired.led" or "$.list[2].name"; keys are compared without
+ * unescaping.
+ */
+typedef struct {
+	jsmn_stream stream;
+	const char *next; /* first path segment not matched yet */
+	unsigned int matched; /* number of open containers on the path */
+	int index; /* element index in the innermost matched array */
+	int key_matched; /* the last key of the innermost matched object is on the path */
+} jsmn_finder;
+
+/**
+ * Prepare a lookup of path, which must stay valid until the lookup is done
+ */
+void jsmn_find_init(jsmn_finder *finder, const char *path);
+
+/**
+ * Feed the window js[0..len) to a lookup, sliding it with
+ * jsmn_stream_consume(&finder->stream) like for jsmn_stream_parse.
+ * Returns 1 and fills result once the value is found, 0 if more input is
+ * needed, JSMN_ERROR_NOENT if the document does not have the path or another
+ * negative error, JSMN_ERROR_NOMEM for a token larger than the window. A top
+ * level primitive has no end in the stream, only jsmn_find returns it.
+ * If the value is an object or array, only its opening token
+ * is returned and finder->stream can be used to tokenize its contents.
+ */
+int jsmn_find_feed(jsmn_finder *finder, const char *js, size_t len,
+		jsmntok_t *result);
+
+/**
+ * Look up path in the complete document js[0..len) in one pass without
+ * storing tokens. Returns 1 and fills result if found, a negative error
+ * otherwise. For objects and arrays result covers the whole value.
+ */
+int jsmn_find(const char *js, size_t len, const char *path, jsmntok_t *result);
+
 #ifdef __cplusplus
 }
 #endif
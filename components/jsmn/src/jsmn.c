@@ -339,3 +339,456 @@ void jsmn_init(jsmn_parser *parser) {
 	parser->toksuper = -1;
 }
 
+
+/**
+ * What the stream tokenizer expects next.
+ */
+enum {
+	JSMN_STREAM_VALUE = 0,
+	JSMN_STREAM_VALUE_OR_END, /* right after '[' */
+	JSMN_STREAM_KEY,
+	JSMN_STREAM_KEY_OR_END, /* right after '{' */
+	JSMN_STREAM_COLON,
+	JSMN_STREAM_NEXT, /* ',' or the end of the container after a value */
+	JSMN_STREAM_DONE
+};
+
+static int jsmn_stream_in_object(const jsmn_stream *stream) {
+	unsigned int level = stream->depth - 1;
+
+	return stream->depth > 0 && (stream->objects[level / 8] >> (level % 8)) & 1;
+}
+
+static void jsmn_stream_value_done(jsmn_stream *stream) {
+	stream->state = stream->depth > 0 ? JSMN_STREAM_NEXT : JSMN_STREAM_DONE;
+}
+
+static void jsmn_stream_token(jsmntok_t *token, jsmntype_t type,
+		int start, int end) {
+	jsmn_fill_token(token, type, start, end);
+#ifdef JSMN_PARENT_LINKS
+	token->parent = -1;
+#endif
+}
+
+/**
+ * Finds the closing quote of the string starting at js[pos].
+ */
+static int jsmn_stream_string(const char *js, size_t len, unsigned int pos) {
+	unsigned int i;
+	int j;
+
+	for (pos++; pos < len && js[pos] != '\0'; pos++) {
+		if (js[pos] == '\"') {
+			return pos;
+		}
+		if (js[pos] != '\\') {
+			continue;
+		}
+		if (++pos >= len) {
+			return JSMN_ERROR_PART;
+		}
+		switch (js[pos]) {
+			case '\"': case '/' : case '\\' : case 'b' :
+			case 'f' : case 'r' : case 'n'  : case 't' :
+				break;
+			case 'u':
+				for (j = 0; j < 4; j++) {
+					i = pos + 1 + j;
+					if (i >= len) {
+						return JSMN_ERROR_PART;
+					}
+					if (!((js[i] >= 48 && js[i] <= 57) || /* 0-9 */
+								(js[i] >= 65 && js[i] <= 70) || /* A-F */
+								(js[i] >= 97 && js[i] <= 102))) { /* a-f */
+						return JSMN_ERROR_INVAL;
+					}
+				}
+				pos += 4;
+				break;
+			default:
+				return JSMN_ERROR_INVAL;
+		}
+	}
+	return JSMN_ERROR_PART;
+}
+
+/**
+ * Finds the end of the primitive starting at js[pos].
+ */
+static int jsmn_stream_primitive(const char *js, size_t len, unsigned int pos) {
+#ifdef JSMN_STRICT
+	switch (js[pos]) {
+		case '-': case '0': case '1' : case '2': case '3' : case '4':
+		case '5': case '6': case '7' : case '8': case '9':
+		case 't': case 'f': case 'n' :
+			break;
+		default:
+			return JSMN_ERROR_INVAL;
+	}
+#endif
+	for (; pos < len && js[pos] != '\0'; pos++) {
+		switch (js[pos]) {
+			case ':' :
+			case '\t' : case '\r' : case '\n' : case ' ' :
+			case ','  : case ']'  : case '}' :
+				return pos;
+		}
+		if (js[pos] < 32 || js[pos] >= 127) {
+			return JSMN_ERROR_INVAL;
+		}
+	}
+	return JSMN_ERROR_PART;
+}
+
+/**
+ * Stops at a token cut by the end of the window, failing if the caller has not
+ * added input since the last time the same window end cut a token.
+ */
+static int jsmn_stream_cut(jsmn_stream *stream, size_t len, unsigned int count) {
+	if (count > 0) {
+		return count;
+	}
+	if (stream->cut == stream->base + len) {
+		return JSMN_ERROR_NOMEM;
+	}
+	stream->cut = stream->base + len;
+	return 0;
+}
+
+/**
+ * Tokenize the next part of a document.
+ */
+int jsmn_stream_parse(jsmn_stream *stream, const char *js, size_t len,
+		jsmntok_t *tokens, unsigned int num_tokens) {
+	unsigned int count = 0;
+	unsigned int level;
+	int r;
+
+	while (count < num_tokens && stream->pos < len && js[stream->pos] != '\0') {
+		jsmntok_t *token = &tokens[count];
+		char c = js[stream->pos];
+
+		switch (c) {
+			case '\t' : case '\r' : case '\n' : case ' ':
+				stream->pos++;
+				continue;
+			case ':':
+				if (stream->state != JSMN_STREAM_COLON) {
+					return JSMN_ERROR_INVAL;
+				}
+				stream->state = JSMN_STREAM_VALUE;
+				stream->pos++;
+				continue;
+			case ',':
+				if (stream->state != JSMN_STREAM_NEXT) {
+					return JSMN_ERROR_INVAL;
+				}
+				stream->state = jsmn_stream_in_object(stream) ?
+					JSMN_STREAM_KEY : JSMN_STREAM_VALUE;
+				stream->pos++;
+				continue;
+			case '{': case '[':
+				if (stream->state != JSMN_STREAM_VALUE &&
+						stream->state != JSMN_STREAM_VALUE_OR_END) {
+					return JSMN_ERROR_INVAL;
+				}
+				if (stream->depth >= JSMN_STREAM_MAX_DEPTH) {
+					return JSMN_ERROR_NOMEM;
+				}
+				level = stream->depth++;
+				if (c == '{') {
+					stream->objects[level / 8] |= 1 << (level % 8);
+					stream->state = JSMN_STREAM_KEY_OR_END;
+				} else {
+					stream->objects[level / 8] &= ~(1 << (level % 8));
+					stream->state = JSMN_STREAM_VALUE_OR_END;
+				}
+				jsmn_stream_token(token, c == '{' ? JSMN_OBJECT : JSMN_ARRAY,
+						stream->pos, -1);
+				stream->pos++;
+				break;
+			case '}': case ']':
+				if (stream->depth == 0 ||
+						jsmn_stream_in_object(stream) != (c == '}') ||
+						(stream->state != JSMN_STREAM_NEXT &&
+						 stream->state != JSMN_STREAM_KEY_OR_END &&
+						 stream->state != JSMN_STREAM_VALUE_OR_END)) {
+					return JSMN_ERROR_INVAL;
+				}
+				stream->depth--;
+				jsmn_stream_token(token, c == '}' ? JSMN_OBJECT : JSMN_ARRAY,
+						-1, stream->pos + 1);
+				stream->pos++;
+				jsmn_stream_value_done(stream);
+				break;
+			case '\"':
+				r = jsmn_stream_string(js, len, stream->pos);
+				if (r == JSMN_ERROR_PART) {
+					return jsmn_stream_cut(stream, len, count);
+				}
+				if (r < 0) {
+					return r;
+				}
+				jsmn_stream_token(token, JSMN_STRING, stream->pos + 1, r);
+				if (stream->state == JSMN_STREAM_KEY ||
+						stream->state == JSMN_STREAM_KEY_OR_END) {
+					token->size = 1;
+					stream->state = JSMN_STREAM_COLON;
+				} else if (stream->state == JSMN_STREAM_VALUE ||
+						stream->state == JSMN_STREAM_VALUE_OR_END) {
+					jsmn_stream_value_done(stream);
+				} else {
+					return JSMN_ERROR_INVAL;
+				}
+				stream->pos = r + 1;
+				break;
+			default:
+				if (stream->state != JSMN_STREAM_VALUE &&
+						stream->state != JSMN_STREAM_VALUE_OR_END) {
+					return JSMN_ERROR_INVAL;
+				}
+				r = jsmn_stream_primitive(js, len, stream->pos);
+				if (r == JSMN_ERROR_PART) {
+					return jsmn_stream_cut(stream, len, count);
+				}
+				if (r < 0) {
+					return r;
+				}
+				jsmn_stream_token(token, JSMN_PRIMITIVE, stream->pos, r);
+				stream->pos = r;
+				jsmn_stream_value_done(stream);
+				break;
+		}
+		count++;
+	}
+
+	return count;
+}
+
+/**
+ * Drops the tokenized part of the window.
+ */
+unsigned int jsmn_stream_consume(jsmn_stream *stream) {
+	unsigned int consumed = stream->pos;
+
+	stream->base += consumed;
+	stream->pos = 0;
+	return consumed;
+}
+
+int jsmn_stream_done(const jsmn_stream *stream) {
+	return stream->state == JSMN_STREAM_DONE;
+}
+
+void jsmn_stream_init(jsmn_stream *stream) {
+	unsigned int i;
+
+	stream->pos = 0;
+	stream->base = 0;
+	stream->depth = 0;
+	stream->state = JSMN_STREAM_VALUE;
+	stream->cut = 0;
+	for (i = 0; i < sizeof(stream->objects); i++) {
+		stream->objects[i] = 0;
+	}
+}
+
+/**
+ * Returns the array index selected by a "[n]" path segment, -1 if it is not one.
+ */
+static int jsmn_find_index(const char *segment) {
+	int index = 0;
+
+	if (*segment++ != '[' || *segment == ']') {
+		return -1;
+	}
+	for (; *segment != ']'; segment++) {
+		if (*segment < '0' || *segment > '9') {
+			return -1;
+		}
+		index = index * 10 + (*segment - '0');
+	}
+	return index;
+}
+
+/**
+ * Returns the path segment following segment, NULL if segment is malformed.
+ */
+static const char *jsmn_find_skip(const char *segment) {
+	if (*segment == '[') {
+		if (jsmn_find_index(segment) < 0) {
+			return NULL;
+		}
+		while (*segment++ != ']');
+		return segment;
+	}
+	if (*segment != '.') {
+		return NULL;
+	}
+	for (segment++; *segment != '.' && *segment != '[' && *segment != '\0'; segment++);
+	return segment;
+}
+
+/**
+ * Checks if a ".name" path segment selects the key js[0..len).
+ */
+static int jsmn_find_key(const char *segment, const char *js, int len) {
+	int i;
+
+	for (i = 0; i < len; i++) {
+		if (segment[i + 1] != js[i]) {
+			return 0;
+		}
+	}
+	return segment[len + 1] == '.' || segment[len + 1] == '[' ||
+		segment[len + 1] == '\0';
+}
+
+void jsmn_find_init(jsmn_finder *finder, const char *path) {
+	const char *segment;
+
+	jsmn_stream_init(&finder->stream);
+	finder->next = NULL;
+	finder->matched = 0;
+	finder->index = 0;
+	finder->key_matched = 0;
+
+	if (path == NULL || *path != '$') {
+		return;
+	}
+	for (segment = path + 1; segment != NULL && *segment != '\0';
+			segment = jsmn_find_skip(segment));
+	if (segment != NULL) {
+		finder->next = path + 1;
+	}
+}
+
+/**
+ * Walks the tokens of the window, ignoring everything outside the path.
+ */
+int jsmn_find_feed(jsmn_finder *finder, const char *js, size_t len,
+		jsmntok_t *result) {
+	jsmn_stream *stream = &finder->stream;
+	jsmntok_t token;
+	unsigned int parent;
+	int r;
+
+	if (finder->next == NULL) {
+		return JSMN_ERROR_INVAL;
+	}
+
+	for (;;) {
+		r = jsmn_stream_parse(stream, js, len, &token, 1);
+		if (r < 0) {
+			return r;
+		}
+		if (r == 0) {
+			return jsmn_stream_done(stream) ? JSMN_ERROR_NOENT : 0;
+		}
+
+		if (token.start == -1) {
+			/* the innermost container on the path ended without a match */
+			if (stream->depth + 1 == finder->matched) {
+				return JSMN_ERROR_NOENT;
+			}
+			continue;
+		}
+
+		/* depth of the container holding the token */
+		parent = token.end == -1 ? stream->depth - 1 : stream->depth;
+		if (parent != finder->matched) {
+			continue;
+		}
+
+		if (token.type == JSMN_STRING && token.size == 1) {
+			finder->key_matched = *finder->next == '.' &&
+				jsmn_find_key(finder->next, js + token.start, token.end - token.start);
+			continue;
+		}
+
+		/* the top level value always is on the path */
+		if (finder->matched > 0) {
+			if (*finder->next == '.') {
+				if (!finder->key_matched) {
+					continue;
+				}
+				finder->key_matched = 0;
+			} else if (finder->index++ != jsmn_find_index(finder->next)) {
+				continue;
+			}
+			finder->next = jsmn_find_skip(finder->next);
+		}
+
+		if (*finder->next == '\0') {
+			*result = token;
+			return 1;
+		}
+
+		/* the next segment has to select from this value */
+		if (token.end != -1 ||
+				(*finder->next == '.') != (token.type == JSMN_OBJECT)) {
+			return JSMN_ERROR_NOENT;
+		}
+		finder->matched++;
+		finder->index = 0;
+		finder->key_matched = 0;
+	}
+}
+
+/**
+ * Completes a top level primitive ended by the end of the document.
+ */
+static int jsmn_find_last(jsmn_finder *finder, const char *js, size_t len,
+		jsmntok_t *result) {
+	jsmn_stream *stream = &finder->stream;
+	unsigned int end;
+
+	if (stream->state != JSMN_STREAM_VALUE || stream->depth > 0) {
+		return JSMN_ERROR_PART;
+	}
+	for (end = stream->pos; end < len && js[end] != '\0'; end++);
+	if (stream->pos == end || js[stream->pos] == '\"' ||
+			jsmn_stream_primitive(js, end, stream->pos) != JSMN_ERROR_PART) {
+		return JSMN_ERROR_PART;
+	}
+	jsmn_stream_token(result, JSMN_PRIMITIVE, stream->pos, end);
+	stream->pos = end;
+	stream->state = JSMN_STREAM_DONE;
+
+	return *finder->next == '\0' ? 1 : JSMN_ERROR_NOENT;
+}
+
+/**
+ * Looks up a path in a complete document.
+ */
+int jsmn_find(const char *js, size_t len, const char *path, jsmntok_t *result) {
+	jsmn_finder finder;
+	jsmntok_t token;
+	unsigned int depth;
+	int r;
+
+	jsmn_find_init(&finder, path);
+	r = jsmn_find_feed(&finder, js, len, result);
+	if (r == 0) {
+		return jsmn_find_last(&finder, js, len, result);
+	}
+	if (r < 0 || result->end != -1) {
+		return r;
+	}
+
+	/* skip to the end of the object or array */
+	depth = finder.stream.depth;
+	do {
+		r = jsmn_stream_parse(&finder.stream, js, len, &token, 1);
+		if (r < 0) {
+			return r;
+		}
+		if (r == 0) {
+			return JSMN_ERROR_PART;
+		}
+	} while (token.start != -1 || finder.stream.depth >= depth);
+
+	result->end = token.end;
+	return 1;
+}
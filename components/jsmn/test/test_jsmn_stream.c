@@ -0,0 +1,220 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <unity.h>
+#include "jsmn.h"
+
+static const char s_doc[] =
+    "{\"state\": {\"reported\": {\"led\": 0, \"name\": \"a\\\"b\"},"
+    " \"desired\": {\"list\": [1, {\"x\": true}, [2, 3]], \"led\": 1, \"name\": \"lamp\"}},"
+    " \"version\": 42}";
+
+static void check_token(const char *js, const jsmntok_t *t, jsmntype_t type, const char *text)
+{
+    TEST_ASSERT_EQUAL(type, t->type);
+    TEST_ASSERT_EQUAL(strlen(text), t->end - t->start);
+    TEST_ASSERT_EQUAL_MEMORY(text, js + t->start, t->end - t->start);
+}
+
+TEST_CASE("jsmn_find resolves paths in a complete document", "[jsmn]")
+{
+    jsmntok_t t;
+
+    TEST_ASSERT_EQUAL(1, jsmn_find(s_doc, strlen(s_doc), "$.state.desired.led", &t));
+    check_token(s_doc, &t, JSMN_PRIMITIVE, "1");
+    TEST_ASSERT_EQUAL(1, jsmn_find(s_doc, strlen(s_doc), "$.state.reported.name", &t));
+    check_token(s_doc, &t, JSMN_STRING, "a\\\"b");
+    TEST_ASSERT_EQUAL(1, jsmn_find(s_doc, strlen(s_doc), "$.state.desired.list[1].x", &t));
+    check_token(s_doc, &t, JSMN_PRIMITIVE, "true");
+    TEST_ASSERT_EQUAL(1, jsmn_find(s_doc, strlen(s_doc), "$.state.desired.list[2]", &t));
+    check_token(s_doc, &t, JSMN_ARRAY, "[2, 3]");
+    TEST_ASSERT_EQUAL(1, jsmn_find(s_doc, strlen(s_doc), "$.version", &t));
+    check_token(s_doc, &t, JSMN_PRIMITIVE, "42");
+    TEST_ASSERT_EQUAL(1, jsmn_find(s_doc, strlen(s_doc), "$", &t));
+    check_token(s_doc, &t, JSMN_OBJECT, s_doc);
+
+    TEST_ASSERT_EQUAL(JSMN_ERROR_NOENT, jsmn_find(s_doc, strlen(s_doc), "$.state.desired.color", &t));
+    TEST_ASSERT_EQUAL(JSMN_ERROR_NOENT, jsmn_find(s_doc, strlen(s_doc), "$.state.desired.list[3]", &t));
+    TEST_ASSERT_EQUAL(JSMN_ERROR_NOENT, jsmn_find(s_doc, strlen(s_doc), "$.state[0]", &t));
+    TEST_ASSERT_EQUAL(JSMN_ERROR_NOENT, jsmn_find(s_doc, strlen(s_doc), "$.version.x", &t));
+    TEST_ASSERT_EQUAL(JSMN_ERROR_INVAL, jsmn_find(s_doc, strlen(s_doc), "state.desired", &t));
+    TEST_ASSERT_EQUAL(JSMN_ERROR_INVAL, jsmn_find(s_doc, strlen(s_doc), "$.list[x]", &t));
+    TEST_ASSERT_EQUAL(JSMN_ERROR_PART, jsmn_find(s_doc, 30, "$.version", &t));
+    TEST_ASSERT_EQUAL(JSMN_ERROR_INVAL, jsmn_find("{\"a\" 1}", 7, "$.a", &t));
+}
+
+TEST_CASE("jsmn_find resolves a top level primitive", "[jsmn]")
+{
+    jsmntok_t t;
+
+    /* ended by the end of the document, not by a delimiter */
+    TEST_ASSERT_EQUAL(1, jsmn_find("42", 2, "$", &t));
+    check_token("42", &t, JSMN_PRIMITIVE, "42");
+    TEST_ASSERT_EQUAL(1, jsmn_find(" true", 5, "$", &t));
+    check_token(" true", &t, JSMN_PRIMITIVE, "true");
+    TEST_ASSERT_EQUAL(1, jsmn_find("-1 ", 3, "$", &t));
+    check_token("-1 ", &t, JSMN_PRIMITIVE, "-1");
+    TEST_ASSERT_EQUAL(1, jsmn_find("\"s\"", 3, "$", &t));
+    check_token("\"s\"", &t, JSMN_STRING, "s");
+
+    TEST_ASSERT_EQUAL(JSMN_ERROR_NOENT, jsmn_find("42", 2, "$.a", &t));
+    TEST_ASSERT_EQUAL(JSMN_ERROR_PART, jsmn_find(" ", 1, "$", &t));
+    TEST_ASSERT_EQUAL(JSMN_ERROR_PART, jsmn_find("\"s", 2, "$", &t));
+}
+
+/* Feed the document in small pieces through a window of window_size bytes */
+static void stream_document(const char *doc, size_t window_size, size_t chunk)
+{
+    jsmn_stream stream;
+    jsmntok_t tokens[2];
+    char window[32];
+    size_t fed = 0, len = 0, doc_len = strlen(doc);
+    int depth = 0, values = 0, r, i;
+
+    TEST_ASSERT(window_size <= sizeof(window));
+    jsmn_stream_init(&stream);
+
+    while (!jsmn_stream_done(&stream)) {
+        size_t n = jsmn_stream_consume(&stream);
+
+        memmove(window, window + n, len - n);
+        len -= n;
+        n = window_size - len < chunk ? window_size - len : chunk;
+        if (n > doc_len - fed) {
+            n = doc_len - fed;
+        }
+        TEST_ASSERT_MESSAGE(n > 0, "document truncated or token larger than the window");
+        memcpy(window + len, doc + fed, n);
+        len += n;
+        fed += n;
+
+        while ((r = jsmn_stream_parse(&stream, window, len, tokens, 2)) > 0) {
+            for (i = 0; i < r; i++) {
+                if (tokens[i].end == -1) {
+                    depth++;
+                } else if (tokens[i].start == -1) {
+                    depth--;
+                } else {
+                    TEST_ASSERT_EQUAL_MEMORY(doc + stream.base + tokens[i].start, window + tokens[i].start,
+                                             tokens[i].end - tokens[i].start);
+                    values++;
+                }
+            }
+        }
+        TEST_ASSERT_EQUAL(0, r);
+    }
+
+    TEST_ASSERT_EQUAL(0, depth);
+    TEST_ASSERT_EQUAL(19, values);
+}
+
+TEST_CASE("jsmn stream tokenizes a document through a small window", "[jsmn]")
+{
+    stream_document(s_doc, 32, 32);
+    stream_document(s_doc, 16, 5);
+    stream_document(s_doc, 16, 1);
+}
+
+TEST_CASE("jsmn stream fails on a token larger than the window", "[jsmn]")
+{
+    static const char doc[] = "{\"name\": \"a string longer than the window\", \"led\": 1}";
+    jsmn_finder finder;
+    jsmntok_t t;
+    char window[16];
+    size_t fed = 0, len = 0;
+    int r, calls = 0;
+
+    jsmn_find_init(&finder, "$.led");
+    do {
+        size_t n = jsmn_stream_consume(&finder.stream);
+
+        memmove(window, window + n, len - n);
+        len -= n;
+        n = sizeof(window) - len;
+        if (n > sizeof(doc) - 1 - fed) {
+            n = sizeof(doc) - 1 - fed;
+        }
+        memcpy(window + len, doc + fed, n);
+        len += n;
+        fed += n;
+
+        r = jsmn_find_feed(&finder, window, len, &t);
+        TEST_ASSERT(++calls < 10);
+    } while (r == 0);
+
+    /* the window is full of the string, no more input fits */
+    TEST_ASSERT_EQUAL(JSMN_ERROR_NOMEM, r);
+    TEST_ASSERT_EQUAL(sizeof(window), len);
+}
+
+TEST_CASE("jsmn stream rejects malformed documents", "[jsmn]")
+{
+    static const char *bad[] = {
+        "{\"a\":1,}", "[1 2]", "{\"a\"}", "{1:2}", "[1}", "]", "{\"a\":\"\\x\"}", "[1] 2",
+    };
+    jsmn_stream stream;
+    jsmntok_t tokens[8];
+    int r;
+
+    for (int i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        jsmn_stream_init(&stream);
+        do {
+            r = jsmn_stream_parse(&stream, bad[i], strlen(bad[i]), tokens, 8);
+        } while (r > 0);
+        TEST_ASSERT_EQUAL_MESSAGE(JSMN_ERROR_INVAL, r, bad[i]);
+    }
+}
+
+TEST_CASE("jsmn_find_feed finds a value in a multi-kilobyte stream", "[jsmn]")
+{
+    jsmn_finder finder;
+    jsmntok_t t;
+    char window[64];
+    char item[32];
+    size_t len = 0;
+    int i = 0, r = 0, items = 200;
+
+    jsmn_find_init(&finder, "$.state.desired.led");
+
+    /* {"state":{"log":[{"n":0},...,{"n":199}],"desired":{"led":1}}} generated on the fly */
+    while (r == 0) {
+        size_t n = jsmn_stream_consume(&finder.stream);
+
+        memmove(window, window + n, len - n);
+        len -= n;
+        if (i == 0) {
+            strcpy(item, "{\"state\":{\"log\":[");
+        } else if (i <= items) {
+            sprintf(item, "%s{\"n\":%d}", i > 1 ? "," : "", i - 1);
+        } else if (i == items + 1) {
+            strcpy(item, "],\"desired\":{\"led\":1}}}");
+        } else {
+            break;
+        }
+        i++;
+        TEST_ASSERT(len + strlen(item) <= sizeof(window));
+        memcpy(window + len, item, strlen(item));
+        len += strlen(item);
+
+        r = jsmn_find_feed(&finder, window, len, &t);
+    }
+
+    TEST_ASSERT_EQUAL(1, r);
+    check_token(window, &t, JSMN_PRIMITIVE, "1");
+    printf("%lu bytes searched with a %u byte window and %u bytes of state\n",
+           finder.stream.base + len, (unsigned)sizeof(window), (unsigned)sizeof(finder));
+}
@@ -0,0 +1,323 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sdkconfig.h"
+
+#ifdef CONFIG_MQTT_OFFLINE_QUEUE
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_spi_flash.h"
+#include "crc.h"
+
+#include "MQTTOfflineQueue.h"
+
+#define QUEUE_MAGIC             0x5154514d  /* "MQTQ" */
+#define QUEUE_STATE_PENDING     0xffffffff
+#define QUEUE_STATE_DONE        0x00000000
+
+#define QUEUE_ALIGN(x)          (((x) + 3) & ~3)
+#define QUEUE_SECTOR(off)       ((off) & ~(SPI_FLASH_SEC_SIZE - 1))
+#define QUEUE_SECTOR_OFF(off)   ((off) & (SPI_FLASH_SEC_SIZE - 1))
+
+/*
+ * Record layout in flash: header, topic, payload, padding to a 4 byte boundary.
+ * The body is written before the header so that a power loss in the middle of a push
+ * leaves no valid magic behind. Acknowledged records are marked by clearing "state" in
+ * place, which needs no erase.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint16_t topic_len;
+    uint16_t payload_len;
+    uint8_t  qos;
+    uint8_t  retained;
+    uint16_t reserved;
+    uint32_t crc;       /* over the fields above, topic and payload */
+    uint32_t state;
+} queue_record_t;
+
+static const char *TAG = "mqtt_queue";
+
+static inline uint32_t record_size(const queue_record_t *rec)
+{
+    return QUEUE_ALIGN(sizeof(queue_record_t) + rec->topic_len + rec->payload_len);
+}
+
+/* Read the record header at off, return false at the end of the data in this sector */
+static bool read_record(MQTTOfflineQueue* q, uint32_t off, queue_record_t *rec, esp_err_t *err)
+{
+    if (QUEUE_SECTOR_OFF(off) + sizeof(queue_record_t) > SPI_FLASH_SEC_SIZE)
+        return false;
+
+    *err = esp_partition_read(q->partition, off, rec, sizeof(queue_record_t));
+    if (*err != ESP_OK)
+        return false;
+
+    return rec->magic == QUEUE_MAGIC && QUEUE_SECTOR_OFF(off) + record_size(rec) <= SPI_FLASH_SEC_SIZE;
+}
+
+static uint32_t next_sector(MQTTOfflineQueue* q, uint32_t off)
+{
+    off = QUEUE_SECTOR(off) + SPI_FLASH_SEC_SIZE;
+
+    return off >= q->partition->size ? 0 : off;
+}
+
+static esp_err_t sector_tail_is_blank(MQTTOfflineQueue* q, uint32_t off, bool *blank)
+{
+    uint32_t buf[16];
+    uint32_t end = QUEUE_SECTOR(off) + SPI_FLASH_SEC_SIZE;
+
+    *blank = true;
+    while (off < end && *blank) {
+        size_t len = end - off < sizeof(buf) ? end - off : sizeof(buf);
+        esp_err_t ret = esp_partition_read(q->partition, off, buf, len);
+        if (ret != ESP_OK)
+            return ret;
+
+        for (int i = 0; i < len / sizeof(uint32_t); i++) {
+            if (buf[i] != 0xffffffff) {
+                *blank = false;
+                break;
+            }
+        }
+        off += len;
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t mark_done(MQTTOfflineQueue* q, uint32_t off)
+{
+    const uint32_t state = QUEUE_STATE_DONE;
+
+    return esp_partition_write(q->partition, off + offsetof(queue_record_t, state), &state, sizeof(state));
+}
+
+esp_err_t MQTTOfflineQueueInit(MQTTOfflineQueue* q, const char* label)
+{
+    esp_err_t ret = ESP_OK;
+    queue_record_t rec;
+    uint32_t sectors, head = 0;
+    bool found = false;
+
+    if (!label)
+        label = CONFIG_MQTT_OFFLINE_QUEUE_PARTITION_LABEL;
+
+    memset(q, 0, sizeof(MQTTOfflineQueue));
+    q->partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (!q->partition) {
+        ESP_LOGE(TAG, "partition \"%s\" not found", label);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    /* the sector whose first record has the highest sequence number is written last */
+    sectors = q->partition->size / SPI_FLASH_SEC_SIZE;
+    for (uint32_t s = 0; s < sectors; s++) {
+        if (read_record(q, s * SPI_FLASH_SEC_SIZE, &rec, &ret)) {
+            if (!found || (int32_t)(rec.seq - q->next_seq) > 0) {
+                q->next_seq = rec.seq;
+                head = s;
+                found = true;
+            }
+        } else if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    if (!found)
+        return ESP_OK;
+
+    /* walk the ring from the oldest sector to the newest one */
+    for (uint32_t i = 1; i <= sectors; i++) {
+        uint32_t s = (head + i) % sectors;
+        uint32_t off = s * SPI_FLASH_SEC_SIZE;
+
+        while (read_record(q, off, &rec, &ret)) {
+            if (rec.state == QUEUE_STATE_PENDING) {
+                if (!q->pending)
+                    q->read_offset = off;
+                q->pending++;
+            }
+            if (s == head)
+                q->next_seq = rec.seq + 1;
+            off += record_size(&rec);
+        }
+        if (ret != ESP_OK)
+            return ret;
+
+        if (s == head) {
+            bool blank = true;
+
+            if (QUEUE_SECTOR_OFF(off) && (ret = sector_tail_is_blank(q, off, &blank)) != ESP_OK)
+                return ret;
+            /* an interrupted push left garbage behind, continue in a fresh sector */
+            q->write_offset = blank ? off : next_sector(q, off);
+        }
+    }
+
+    if (!q->pending)
+        q->read_offset = q->write_offset;
+
+    ESP_LOGI(TAG, "%u queued messages", q->pending);
+
+    return ESP_OK;
+}
+
+esp_err_t MQTTOfflineQueuePush(MQTTOfflineQueue* q, const char* topicName, MQTTMessage* message)
+{
+    esp_err_t ret;
+    queue_record_t rec;
+    uint32_t off = q->write_offset;
+    size_t topic_len = strlen(topicName);
+
+    if (topic_len > UINT16_MAX || message->payloadlen > UINT16_MAX)
+        return ESP_ERR_INVALID_SIZE;
+
+    memset(&rec, 0xff, sizeof(rec));
+    rec.magic = QUEUE_MAGIC;
+    rec.seq = q->next_seq;
+    rec.topic_len = topic_len;
+    rec.payload_len = message->payloadlen;
+    rec.qos = message->qos;
+    rec.retained = message->retained;
+    if (record_size(&rec) > SPI_FLASH_SEC_SIZE)
+        return ESP_ERR_INVALID_SIZE;
+
+    /* open the next sector when the record does not fit in the current one */
+    if (!QUEUE_SECTOR_OFF(off) || QUEUE_SECTOR_OFF(off) + record_size(&rec) > SPI_FLASH_SEC_SIZE) {
+        if (QUEUE_SECTOR_OFF(off) || off >= q->partition->size)
+            off = next_sector(q, off);
+        if (q->pending && QUEUE_SECTOR(q->read_offset) == off)
+            return ESP_ERR_NO_MEM;
+        if ((ret = esp_partition_erase_range(q->partition, off, SPI_FLASH_SEC_SIZE)) != ESP_OK)
+            return ret;
+    }
+
+    rec.crc = crc32_le(0, (const uint8_t *)&rec, offsetof(queue_record_t, crc));
+    rec.crc = crc32_le(rec.crc, (const uint8_t *)topicName, topic_len);
+    rec.crc = crc32_le(rec.crc, message->payload, message->payloadlen);
+
+    if ((ret = esp_partition_write(q->partition, off + sizeof(rec), topicName, topic_len)) != ESP_OK)
+        return ret;
+    if ((ret = esp_partition_write(q->partition, off + sizeof(rec) + topic_len, message->payload, message->payloadlen)) != ESP_OK)
+        return ret;
+    if ((ret = esp_partition_write(q->partition, off, &rec, sizeof(rec))) != ESP_OK)
+        return ret;
+
+    if (!q->pending)
+        q->read_offset = off;
+    q->pending++;
+    q->next_seq++;
+    q->write_offset = off + record_size(&rec);
+
+    return ESP_OK;
+}
+
+esp_err_t MQTTOfflineQueueReplay(MQTTOfflineQueue* q, MQTTOfflineQueueSendFn send_fn, void* arg,
+                                 unsigned char* buf, size_t buf_size)
+{
+    esp_err_t ret = ESP_OK;
+    uint32_t off = q->read_offset;
+
+    while (q->pending && off != q->write_offset) {
+        queue_record_t rec;
+        MQTTMessage msg;
+        uint32_t crc;
+
+        if (!read_record(q, off, &rec, &ret)) {
+            if (ret != ESP_OK)
+                break;
+            off = next_sector(q, off);
+            continue;
+        }
+
+        if (rec.state != QUEUE_STATE_PENDING) {
+            off += record_size(&rec);
+            continue;
+        }
+
+        if (rec.topic_len + 1 + rec.payload_len > buf_size) {
+            ret = ESP_ERR_INVALID_SIZE;
+            break;
+        }
+        if ((ret = esp_partition_read(q->partition, off + sizeof(rec), buf, rec.topic_len)) != ESP_OK)
+            break;
+        if ((ret = esp_partition_read(q->partition, off + sizeof(rec) + rec.topic_len,
+                                      buf + rec.topic_len + 1, rec.payload_len)) != ESP_OK)
+            break;
+
+        crc = crc32_le(0, (const uint8_t *)&rec, offsetof(queue_record_t, crc));
+        crc = crc32_le(crc, buf, rec.topic_len);
+        crc = crc32_le(crc, buf + rec.topic_len + 1, rec.payload_len);
+        if (crc == rec.crc) {
+            buf[rec.topic_len] = '\0';
+            memset(&msg, 0, sizeof(msg));
+            msg.qos = (enum QoS)rec.qos;
+            msg.retained = rec.retained;
+            msg.payload = buf + rec.topic_len + 1;
+            msg.payloadlen = rec.payload_len;
+
+            if (send_fn(arg, (const char *)buf, &msg) != SUCCESS) {
+                ret = ESP_FAIL;
+                break;
+            }
+        } else {
+            ESP_LOGW(TAG, "drop corrupted message %u", rec.seq);
+        }
+
+        if ((ret = mark_done(q, off)) != ESP_OK)
+            break;
+        q->pending--;
+        off += record_size(&rec);
+    }
+
+    q->read_offset = q->pending ? off : q->write_offset;
+
+    return ret;
+}
+
+static int publish_queued(void* arg, const char* topicName, MQTTMessage* message)
+{
+    return MQTTPublish((MQTTClient*)arg, topicName, message);
+}
+
+esp_err_t MQTTOfflineQueueFlush(MQTTOfflineQueue* q, MQTTClient* c, unsigned char* buf, size_t buf_size)
+{
+    return MQTTOfflineQueueReplay(q, publish_queued, c, buf, buf_size);
+}
+
+int MQTTPublishOrQueue(MQTTClient* c, MQTTOfflineQueue* q, const char* topicName, MQTTMessage* message)
+{
+    if (MQTTIsConnected(c) && !q->pending && MQTTPublish(c, topicName, message) == SUCCESS)
+        return SUCCESS;
+
+    return MQTTOfflineQueuePush(q, topicName, message) == ESP_OK ? SUCCESS : FAILURE;
+}
+
+esp_err_t MQTTOfflineQueueClear(MQTTOfflineQueue* q)
+{
+    esp_err_t ret = esp_partition_erase_range(q->partition, 0, q->partition->size);
+
+    q->write_offset = 0;
+    q->read_offset = 0;
+    q->pending = 0;
+
+    return ret;
+}
+
+#endif /* CONFIG_MQTT_OFFLINE_QUEUE */
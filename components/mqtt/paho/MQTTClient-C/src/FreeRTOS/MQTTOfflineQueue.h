@@ -0,0 +1,144 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#if !defined(MQTTOfflineQueue_H)
+#define MQTTOfflineQueue_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_partition.h"
+#include "MQTTClient.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Flash backed queue of outbound messages.
+ *
+ * Messages are appended as records to a ring log in a dedicated data partition and stay
+ * there until they have been published (QoS0) or acknowledged by the broker (QoS1/2),
+ * so unsent telemetry survives network outages and reboots. Only the ring positions are
+ * kept in RAM; record contents are read back from flash one at a time on replay.
+ *
+ * A record never spans a flash sector, so the largest message that can be queued is a
+ * little less than 4KB (topic and payload together). Sectors are erased lazily when the
+ * write position enters them; the queue is full when the next sector to be opened still
+ * holds the oldest unacknowledged record.
+ *
+ * The queue is not thread safe, calls for one queue must be serialized by the caller.
+ */
+typedef struct MQTTOfflineQueue
+{
+    const esp_partition_t* partition;
+    uint32_t write_offset;      /* where the next record goes */
+    uint32_t read_offset;       /* oldest record not yet acknowledged */
+    uint32_t pending;           /* number of records not yet acknowledged */
+    uint32_t next_seq;
+} MQTTOfflineQueue;
+
+/**
+ * Callback used by MQTTOfflineQueueReplay to send one queued message.
+ * Return SUCCESS once the message has been delivered, anything else stops the replay.
+ */
+typedef int (*MQTTOfflineQueueSendFn)(void* arg, const char* topicName, MQTTMessage* message);
+
+/**
+ * @brief Open the offline queue stored in the data partition with the given label
+ *
+ * The partition is scanned once to recover the ring positions, records queued before a
+ * reboot are kept.
+ *
+ * @param q     - queue object to initialize
+ * @param label - partition label, CONFIG_MQTT_OFFLINE_QUEUE_PARTITION_LABEL if NULL
+ *
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_NOT_FOUND if there is no such partition
+ *     - other errors from esp_partition_read
+ */
+esp_err_t MQTTOfflineQueueInit(MQTTOfflineQueue* q, const char* label);
+
+/**
+ * @brief Append a message to the queue
+ *
+ * @param q         - queue object
+ * @param topicName - topic the message will be published to
+ * @param message   - message to store, message->id is ignored
+ *
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_SIZE if topic and payload do not fit in one flash sector
+ *     - ESP_ERR_NO_MEM if the queue is full
+ *     - other errors from esp_partition_erase_range and esp_partition_write
+ */
+esp_err_t MQTTOfflineQueuePush(MQTTOfflineQueue* q, const char* topicName, MQTTMessage* message);
+
+/**
+ * @brief Send queued messages in order, removing each one once send_fn reports success
+ *
+ * Records which fail their CRC check are dropped.
+ *
+ * @param q        - queue object
+ * @param send_fn  - function called for every pending message
+ * @param arg      - argument passed to send_fn
+ * @param buf      - work buffer the topic and payload of one record are read into
+ * @param buf_size - size of buf, must hold the largest queued topic and payload plus one byte
+ *
+ * @return
+ *     - ESP_OK if the queue was drained
+ *     - ESP_FAIL if send_fn failed, the message stays queued
+ *     - ESP_ERR_INVALID_SIZE if a record does not fit in buf
+ *     - other errors from esp_partition_read and esp_partition_write
+ */
+esp_err_t MQTTOfflineQueueReplay(MQTTOfflineQueue* q, MQTTOfflineQueueSendFn send_fn, void* arg,
+                                 unsigned char* buf, size_t buf_size);
+
+/**
+ * @brief Publish queued messages through a connected client, see MQTTOfflineQueueReplay
+ *
+ * For QoS1/2 messages MQTTPublish only returns SUCCESS after the PUBACK/PUBCOMP, so a
+ * message is removed from flash only once the broker has taken ownership of it.
+ */
+esp_err_t MQTTOfflineQueueFlush(MQTTOfflineQueue* q, MQTTClient* c, unsigned char* buf, size_t buf_size);
+
+/**
+ * @brief Publish a message, or queue it when it cannot be sent now
+ *
+ * The message is queued if the client is disconnected, if older messages are still
+ * queued (to keep ordering) or if MQTTPublish fails.
+ *
+ * @return SUCCESS if the message was published or queued, FAILURE otherwise
+ */
+int MQTTPublishOrQueue(MQTTClient* c, MQTTOfflineQueue* q, const char* topicName, MQTTMessage* message);
+
+/**
+ * @brief Number of messages waiting in the queue
+ */
+static inline uint32_t MQTTOfflineQueueCount(MQTTOfflineQueue* q)
+{
+    return q->pending;
+}
+
+/**
+ * @brief Drop every queued message and erase the partition
+ */
+esp_err_t MQTTOfflineQueueClear(MQTTOfflineQueue* q);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -14,6 +14,7 @@
  *   Allan Stockdill-Mander/Ian Craggs - initial API and implementation and/or initial documentation
  *   Ian Craggs - fix for #96 - check rem_len in readPacket
  *   Ian Craggs - add ability to set message handler separately #6
+ *   Espressif - stream PUBLISH payloads larger than the read buffer to a chunk handler
  *******************************************************************************/
 #include "MQTTClient.h"
 
@@ -71,6 +72,8 @@ void MQTTClientInit(MQTTClient* c, Network* network, unsigned int command_timeou
     c->cleansession = 0;
     c->ping_outstanding = 0;
     c->defaultMessageHandler = NULL;
+    c->chunkMessageHandler = NULL;
+    c->stream_remaining = 0;
     c->next_packetid = 1;
     TimerInit(&c->last_sent);
     TimerInit(&c->last_received);
@@ -108,6 +111,44 @@ exit:
 }
 
 
+/* Read only the variable header (topic name and packet id) of a PUBLISH whose payload does not fit
+ * in readbuf. The remaining length in readbuf is rewritten so that it holds a valid PUBLISH with an
+ * empty payload; the payload itself is left on the network for streamPayload(). */
+static int readPublishHeader(MQTTClient* c, int rem_len, Timer* timer)
+{
+    MQTTHeader header = {0};
+    int len, hdr_len;
+    int rc = FAILURE;
+    unsigned char topiclen[2];
+
+    header.byte = c->readbuf[0];
+    if (c->ipstack->mqttread(c->ipstack, topiclen, 2, TimerLeftMS(timer)) != 2)
+        goto exit;
+
+    hdr_len = 2 + 256 * topiclen[0] + topiclen[1];
+    if (header.bits.qos > 0)
+        hdr_len += 2;
+    if (hdr_len > rem_len)
+        goto exit;
+
+    len = 1 + MQTTPacket_encode(c->readbuf + 1, hdr_len);
+    if (hdr_len >= (c->readbuf_size - len)) /* need room for the topic and at least one payload byte */
+    {
+        rc = BUFFER_OVERFLOW;
+        goto exit;
+    }
+
+    memcpy(c->readbuf + len, topiclen, 2);
+    if (hdr_len > 2 && c->ipstack->mqttread(c->ipstack, c->readbuf + len + 2, hdr_len - 2, TimerLeftMS(timer)) != hdr_len - 2)
+        goto exit;
+
+    c->stream_remaining = rem_len - hdr_len;
+    rc = PUBLISH;
+exit:
+    return rc;
+}
+
+
 static int readPacket(MQTTClient* c, Timer* timer)
 {
     MQTTHeader header = {0};
@@ -126,12 +167,18 @@ static int readPacket(MQTTClient* c, Timer* timer)
 
     if (rem_len > (c->readbuf_size - len))
     {
-        rc = BUFFER_OVERFLOW;
-        goto exit;
+        header.byte = c->readbuf[0];
+        if (header.bits.type != PUBLISH || c->chunkMessageHandler == NULL)
+        {
+            rc = BUFFER_OVERFLOW;
+            goto exit;
+        }
+        /* 3a. too big for readbuf: read the topic now, the payload is streamed later */
+        if ((rc = readPublishHeader(c, rem_len, timer)) != PUBLISH)
+            goto exit;
     }
-
     /* 3. read the rest of the buffer using a callback to supply the rest of the data */
-    if (rem_len > 0 && (rc = c->ipstack->mqttread(c->ipstack, c->readbuf + len, rem_len, TimerLeftMS(timer)) != rem_len)) {
+    else if (rem_len > 0 && (rc = c->ipstack->mqttread(c->ipstack, c->readbuf + len, rem_len, TimerLeftMS(timer)) != rem_len)) {
         rc = 0;
         goto exit;
     }
@@ -209,6 +256,47 @@ int deliverMessage(MQTTClient* c, MQTTString* topicName, MQTTMessage* message)
 }
 
 
+/* Pass the payload of a PUBLISH read by readPublishHeader() to the chunk handler, reusing the
+ * free part of readbuf behind the topic name. Once the header has been consumed the rest of the
+ * packet must be read to keep the stream in sync, so each chunk gets a full command timeout. */
+static int streamPayload(MQTTClient* c, MQTTString* topicName, MQTTMessage* message)
+{
+    int rc = SUCCESS;
+    unsigned char* chunk = (unsigned char*)message->payload;
+    size_t chunk_size = c->readbuf_size - (chunk - c->readbuf);
+    MessageChunkData md;
+
+    md.message = message;
+    md.topicName = topicName;
+    md.offset = 0;
+    md.total_len = c->stream_remaining;
+
+    while (c->stream_remaining > 0)
+    {
+        Timer timer;
+        int len = (c->stream_remaining < chunk_size) ? c->stream_remaining : chunk_size;
+
+        TimerInit(&timer);
+        TimerCountdownMS(&timer, c->command_timeout_ms);
+        if (c->ipstack->mqttread(c->ipstack, chunk, len, TimerLeftMS(&timer)) != len)
+        {
+            rc = FAILURE;
+            break;
+        }
+        c->stream_remaining -= len;
+
+        message->payload = chunk;
+        message->payloadlen = len;
+        if (c->chunkMessageHandler != NULL)
+            c->chunkMessageHandler(&md);
+        md.offset += len;
+    }
+
+    c->stream_remaining = 0;
+    return rc;
+}
+
+
 int keepalive(MQTTClient* c)
 {
     int rc = SUCCESS;
@@ -249,6 +337,7 @@ void MQTTCloseSession(MQTTClient* c)
 {
     c->ping_outstanding = 0;
     c->isconnected = 0;
+    c->stream_remaining = 0;
     if (c->cleansession)
         MQTTCleanSession(c);
 }
@@ -282,9 +371,23 @@ int cycle(MQTTClient* c, Timer* timer)
             msg.payloadlen = 0; /* this is a size_t, but deserialize publish sets this as int */
             if (MQTTDeserialize_publish(&msg.dup, &intQoS, &msg.retained, &msg.id, &topicName,
                (unsigned char**)&msg.payload, (int*)&msg.payloadlen, c->readbuf, c->readbuf_size) != 1)
+            {
+                /* the streamed payload is still on the network: the stream is out of sync */
+                if (c->stream_remaining > 0)
+                {
+                    c->stream_remaining = 0;
+                    rc = FAILURE;
+                }
                 goto exit;
+            }
             msg.qos = (enum QoS)intQoS;
-            deliverMessage(c, &topicName, &msg);
+            if (c->stream_remaining > 0)
+            {
+                if ((rc = streamPayload(c, &topicName, &msg)) != SUCCESS)
+                    goto exit;
+            }
+            else
+                deliverMessage(c, &topicName, &msg);
             if (msg.qos != QOS0)
             {
                 if (msg.qos == QOS1)
@@ -509,6 +612,13 @@ int MQTTSetMessageHandler(MQTTClient* c, const char* topicFilter, messageHandler
 }
 
 
+int MQTTSetChunkMessageHandler(MQTTClient* c, messageChunkHandler messageChunkHandler)
+{
+    c->chunkMessageHandler = messageChunkHandler;
+    return SUCCESS;
+}
+
+
 int MQTTSubscribeWithResults(MQTTClient* c, const char* topicFilter, enum QoS qos,
        messageHandler messageHandler, MQTTSubackData* data)
 {
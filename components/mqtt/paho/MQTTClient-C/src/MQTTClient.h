@@ -102,6 +102,18 @@ typedef struct MQTTSubackData
 
 typedef void (*messageHandler)(MessageData*);
 
+/* A slice of a PUBLISH payload that was too large for the client read buffer.
+ * message->payload and message->payloadlen describe this chunk only. */
+typedef struct MessageChunkData
+{
+    MQTTMessage* message;
+    MQTTString* topicName;
+    size_t offset;      /* offset of this chunk within the whole payload */
+    size_t total_len;   /* length of the whole payload */
+} MessageChunkData;
+
+typedef void (*messageChunkHandler)(MessageChunkData*);
+
 typedef struct MQTTClient
 {
     unsigned int next_packetid,
@@ -122,6 +134,8 @@ typedef struct MQTTClient
     } messageHandlers[MAX_MESSAGE_HANDLERS];      /* Message handlers are indexed by subscription topic */
 
     void (*defaultMessageHandler) (MessageData*);
+    void (*chunkMessageHandler) (MessageChunkData*);
+    size_t stream_remaining;    /* payload bytes of the current PUBLISH still on the network */
 
     Network* ipstack;
     Timer last_sent, last_received;
@@ -175,6 +189,18 @@ DLLExport int MQTTPublish(MQTTClient* client, const char*, MQTTMessage*);
  */
 DLLExport int MQTTSetMessageHandler(MQTTClient* c, const char* topicFilter, messageHandler messageHandler);
 
+/** MQTT SetChunkMessageHandler - set or remove the streaming receive handler
+ *  Incoming PUBLISH packets whose payload does not fit in the read buffer are no longer
+ *  rejected with BUFFER_OVERFLOW: the fixed header, topic and packet id are read into the
+ *  read buffer and the payload is passed to this handler in chunks of at most the remaining
+ *  read buffer space, straight from the network. Packets that fit are still delivered to the
+ *  normal message handlers. The topic name must fit in the read buffer.
+ *  @param client - the client object to use
+ *  @param messageChunkHandler - pointer to the chunk handler function or NULL to remove
+ *  @return success code
+ */
+DLLExport int MQTTSetChunkMessageHandler(MQTTClient* c, messageChunkHandler messageChunkHandler);
+
 /** MQTT Subscribe - send an MQTT subscribe packet and wait for suback before returning.
  *  @param client - the client object to use
  *  @param topicFilter - the topic filter to subscribe to
@@ -0,0 +1,114 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <unity.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#ifdef CONFIG_MQTT_OFFLINE_QUEUE
+
+#include "MQTTOfflineQueue.h"
+
+#define TEST_PAYLOAD_LEN    128
+#define TEST_MSG_NUM        200
+
+static int s_replayed;
+
+static int count_message(void* arg, const char* topicName, MQTTMessage* message)
+{
+    int seq;
+
+    TEST_ASSERT_EQUAL_STRING("test/offline", topicName);
+    TEST_ASSERT_EQUAL(TEST_PAYLOAD_LEN, message->payloadlen);
+    memcpy(&seq, message->payload, sizeof(seq));
+    TEST_ASSERT_EQUAL(s_replayed, seq);
+    s_replayed++;
+
+    return SUCCESS;
+}
+
+static MQTTOfflineQueue* open_queue(MQTTOfflineQueue* q)
+{
+    if (MQTTOfflineQueueInit(q, NULL) != ESP_OK)
+        return NULL;
+    TEST_ASSERT_EQUAL(ESP_OK, MQTTOfflineQueueClear(q));
+
+    return q;
+}
+
+TEST_CASE("MQTT offline queue survives re-open and replays in order", "[mqtt]")
+{
+    MQTTOfflineQueue q;
+    unsigned char payload[TEST_PAYLOAD_LEN] = {0};
+    unsigned char buf[64 + TEST_PAYLOAD_LEN];
+    MQTTMessage msg = { .qos = QOS1, .payload = payload, .payloadlen = sizeof(payload) };
+
+    if (!open_queue(&q))
+        TEST_IGNORE_MESSAGE("no " CONFIG_MQTT_OFFLINE_QUEUE_PARTITION_LABEL " partition");
+
+    for (int i = 0; i < 10; i++) {
+        memcpy(payload, &i, sizeof(i));
+        TEST_ASSERT_EQUAL(ESP_OK, MQTTOfflineQueuePush(&q, "test/offline", &msg));
+    }
+
+    /* simulate a reboot */
+    TEST_ASSERT_EQUAL(ESP_OK, MQTTOfflineQueueInit(&q, NULL));
+    TEST_ASSERT_EQUAL(10, MQTTOfflineQueueCount(&q));
+
+    s_replayed = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, MQTTOfflineQueueReplay(&q, count_message, NULL, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL(10, s_replayed);
+    TEST_ASSERT_EQUAL(0, MQTTOfflineQueueCount(&q));
+
+    TEST_ASSERT_EQUAL(ESP_OK, MQTTOfflineQueueInit(&q, NULL));
+    TEST_ASSERT_EQUAL(0, MQTTOfflineQueueCount(&q));
+}
+
+TEST_CASE("MQTT offline queue push and replay throughput", "[mqtt][timeout=60]")
+{
+    MQTTOfflineQueue q;
+    unsigned char payload[TEST_PAYLOAD_LEN] = {0};
+    unsigned char buf[64 + TEST_PAYLOAD_LEN];
+    MQTTMessage msg = { .qos = QOS1, .payload = payload, .payloadlen = sizeof(payload) };
+    TickType_t start, push_ticks, replay_ticks;
+    int num;
+
+    if (!open_queue(&q))
+        TEST_IGNORE_MESSAGE("no " CONFIG_MQTT_OFFLINE_QUEUE_PARTITION_LABEL " partition");
+
+    start = xTaskGetTickCount();
+    for (num = 0; num < TEST_MSG_NUM; num++) {
+        memcpy(payload, &num, sizeof(num));
+        if (MQTTOfflineQueuePush(&q, "test/offline", &msg) == ESP_ERR_NO_MEM)
+            break;
+    }
+    push_ticks = xTaskGetTickCount() - start;
+    TEST_ASSERT_EQUAL(num, MQTTOfflineQueueCount(&q));
+
+    s_replayed = 0;
+    start = xTaskGetTickCount();
+    TEST_ASSERT_EQUAL(ESP_OK, MQTTOfflineQueueReplay(&q, count_message, NULL, buf, sizeof(buf)));
+    replay_ticks = xTaskGetTickCount() - start;
+    TEST_ASSERT_EQUAL(num, s_replayed);
+
+    printf("%d messages of %d bytes: push %u ms, replay %u ms (%u msg/s)\n", num, TEST_PAYLOAD_LEN,
+           push_ticks * portTICK_PERIOD_MS, replay_ticks * portTICK_PERIOD_MS,
+           replay_ticks ? num * 1000 / (replay_ticks * portTICK_PERIOD_MS) : 0);
+}
+
+#endif /* CONFIG_MQTT_OFFLINE_QUEUE */
@@ -0,0 +1,160 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <unity.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "MQTTClient.h"
+
+#define TEST_READBUF_LEN    64
+#define TEST_PAYLOAD_LEN    300
+
+/* A network reading from a memory stream and keeping what is written */
+static unsigned char s_rx[2 * TEST_PAYLOAD_LEN];
+static int s_rx_len, s_rx_pos;
+static unsigned char s_tx[64];
+static int s_tx_len;
+
+static unsigned char s_payload[TEST_PAYLOAD_LEN];
+static unsigned char s_received[TEST_PAYLOAD_LEN];
+static size_t s_received_len;
+static int s_chunks, s_messages;
+
+static int test_read(Network* n, unsigned char* buf, unsigned int len, unsigned int timeout_ms)
+{
+    int left = s_rx_len - s_rx_pos;
+
+    if (len > left)
+        len = left;
+    memcpy(buf, s_rx + s_rx_pos, len);
+    s_rx_pos += len;
+
+    return len;
+}
+
+static int test_write(Network* n, unsigned char* buf, unsigned int len, unsigned int timeout_ms)
+{
+    if (s_tx_len + len > sizeof(s_tx))
+        return -1;
+    memcpy(s_tx + s_tx_len, buf, len);
+    s_tx_len += len;
+
+    return len;
+}
+
+static void test_chunk(MessageChunkData* md)
+{
+    TEST_ASSERT_EQUAL(TEST_PAYLOAD_LEN, md->total_len);
+    TEST_ASSERT_EQUAL(s_received_len, md->offset);
+    TEST_ASSERT_TRUE(MQTTPacket_equals(md->topicName, "test/stream"));
+    TEST_ASSERT_TRUE(md->offset + md->message->payloadlen <= TEST_PAYLOAD_LEN);
+
+    memcpy(s_received + md->offset, md->message->payload, md->message->payloadlen);
+    s_received_len += md->message->payloadlen;
+    s_chunks++;
+}
+
+static void test_message(MessageData* md)
+{
+    TEST_ASSERT_TRUE(MQTTPacket_equals(md->topicName, "test/small"));
+    TEST_ASSERT_EQUAL(4, md->message->payloadlen);
+    TEST_ASSERT_EQUAL_MEMORY("ping", md->message->payload, 4);
+    s_messages++;
+}
+
+static int add_publish(const char* topic, int qos, unsigned short id, unsigned char* payload, int len)
+{
+    MQTTString topicName = MQTTString_initializer;
+    int rc;
+
+    topicName.cstring = (char*)topic;
+    rc = MQTTSerialize_publish(s_rx + s_rx_len, sizeof(s_rx) - s_rx_len, 0, qos, 0, id, topicName, payload, len);
+    TEST_ASSERT_TRUE(rc > 0);
+    s_rx_len += rc;
+
+    return rc;
+}
+
+static void init_client(MQTTClient* c, Network* n, unsigned char* buf, size_t buf_len, unsigned char* readbuf)
+{
+    memset(n, 0, sizeof(*n));
+    n->mqttread = test_read;
+    n->mqttwrite = test_write;
+
+    s_rx_len = s_rx_pos = s_tx_len = 0;
+    s_received_len = 0;
+    s_chunks = s_messages = 0;
+    memset(s_received, 0, sizeof(s_received));
+    for (int i = 0; i < sizeof(s_payload); i++)
+        s_payload[i] = i * 7;
+
+    MQTTClientInit(c, n, 1000, buf, buf_len, readbuf, TEST_READBUF_LEN);
+    c->isconnected = 1;
+    MQTTSetChunkMessageHandler(c, test_chunk);
+    c->defaultMessageHandler = test_message;
+}
+
+TEST_CASE("MQTT streams a PUBLISH larger than the read buffer", "[mqtt]")
+{
+    MQTTClient c;
+    Network n;
+    unsigned char buf[64], readbuf[TEST_READBUF_LEN];
+
+    init_client(&c, &n, buf, sizeof(buf), readbuf);
+    add_publish("test/stream", 1, 42, s_payload, sizeof(s_payload));
+    add_publish("test/small", 0, 0, (unsigned char*)"ping", 4);
+
+    TEST_ASSERT_EQUAL(SUCCESS, MQTTYield(&c, 20));
+
+    /* the payload in several chunks, then the next packet read in sync */
+    TEST_ASSERT_EQUAL(s_rx_len, s_rx_pos);
+    TEST_ASSERT_EQUAL(TEST_PAYLOAD_LEN, s_received_len);
+    TEST_ASSERT_EQUAL_MEMORY(s_payload, s_received, TEST_PAYLOAD_LEN);
+    TEST_ASSERT_TRUE(s_chunks > 1);
+    TEST_ASSERT_EQUAL(1, s_messages);
+    TEST_ASSERT_EQUAL(0, c.stream_remaining);
+
+    /* the PUBACK of the streamed packet */
+    {
+        unsigned char type, dup;
+        unsigned short id;
+
+        TEST_ASSERT_EQUAL(1, MQTTDeserialize_ack(&type, &dup, &id, s_tx, s_tx_len));
+        TEST_ASSERT_EQUAL(PUBACK, type);
+        TEST_ASSERT_EQUAL(42, id);
+    }
+}
+
+TEST_CASE("MQTT disconnects on a PUBLISH stream cut short", "[mqtt]")
+{
+    MQTTClient c;
+    Network n;
+    unsigned char buf[64], readbuf[TEST_READBUF_LEN];
+
+    init_client(&c, &n, buf, sizeof(buf), readbuf);
+    add_publish("test/stream", 1, 42, s_payload, sizeof(s_payload));
+    s_rx_len -= 10;
+
+    TEST_ASSERT_EQUAL(FAILURE, MQTTYield(&c, 20));
+
+    TEST_ASSERT_EQUAL(0, c.isconnected);
+    TEST_ASSERT_EQUAL(0, c.stream_remaining);
+    TEST_ASSERT_EQUAL(0, s_tx_len);
+    TEST_ASSERT_TRUE(s_received_len < TEST_PAYLOAD_LEN);
+}
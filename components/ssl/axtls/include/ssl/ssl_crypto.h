@@ -39,10 +39,16 @@
 extern "C" {
 #endif
 
+#include "sdkconfig.h"
 #include "ssl/ssl_config.h"
 #include "ssl/ssl_bigint_impl.h"
 #include "ssl/ssl_bigint.h"
 
+#include "esp_sha.h"
+#ifdef CONFIG_SSL_AES_CONSTANT_TIME
+#include "esp_aes.h"
+#endif
+
 #ifndef STDCALL
 #define STDCALL
 #endif
@@ -67,6 +73,13 @@ extern "C" {
 #define AES_BLOCKSIZE           16
 #define AES_IV_SIZE             16
 
+#ifdef CONFIG_SSL_AES_CONSTANT_TIME
+typedef struct aes_key_st 
+{
+    esp_aes_t aes;
+    uint8_t iv[AES_IV_SIZE];
+} AES_CTX;
+#else
 typedef struct aes_key_st 
 {
     uint16_t rounds;
@@ -74,6 +87,7 @@ typedef struct aes_key_st
     uint32_t ks[(AES_MAXROUNDS+1)*8];
     uint8_t iv[AES_IV_SIZE];
 } AES_CTX;
+#endif
 
 typedef enum
 {
@@ -107,17 +121,9 @@ void RC4_crypt(RC4_CTX *s, const uint8_t *msg, uint8_t *data, int length);
 #define SHA1_SIZE   20
 
 /*
- *  This structure will hold context information for the SHA-1
- *  hashing operation
+ *  SHA-1 and SHA-256 are the shared implementation of the util component
  */
-typedef struct 
-{
-    uint32_t Intermediate_Hash[SHA1_SIZE/4]; /* Message Digest */
-    uint32_t Length_Low;            /* Message length in bits */
-    uint32_t Length_High;           /* Message length in bits */
-    uint16_t Message_Block_Index;   /* Index into message block array   */
-    uint8_t Message_Block[64];      /* 512-bit message blocks */
-} SHA1_CTX;
+typedef esp_sha_t SHA1_CTX;
 
 void SHA1_Init(SHA1_CTX *);
 void SHA1_Update(SHA1_CTX *, const uint8_t * msg, int len);
@@ -129,12 +135,7 @@ void SHA1_Final(uint8_t *digest, SHA1_CTX *);
 
 #define SHA256_SIZE   32
 
-typedef struct
-{
-    uint32_t total[2];
-    uint32_t state[8];
-    uint8_t buffer[64];
-} SHA256_CTX;
+typedef esp_sha_t SHA256_CTX;
 
 void SHA256_Init(SHA256_CTX *c);
 void SHA256_Update(SHA256_CTX *, const uint8_t *input, int len);
@@ -40,6 +40,49 @@
 /* all commented out in skeleton mode */
 #ifndef CONFIG_SSL_SKELETON_MODE
 
+#ifdef CONFIG_SSL_AES_CONSTANT_TIME
+
+/*
+ * CBC on top of the shared constant-time AES of the util component. Its key
+ * schedule serves both directions, so AES_convert_key has nothing to do.
+ */
+void AES_set_key(AES_CTX *ctx, const uint8_t *key,
+        const uint8_t *iv, AES_MODE mode)
+{
+    switch (mode)
+    {
+        case AES_MODE_128:
+            esp_aes_set_key(&ctx->aes, key, 128);
+            break;
+
+        case AES_MODE_256:
+            esp_aes_set_key(&ctx->aes, key, 256);
+            break;
+
+        default:        /* fail silently */
+            return;
+    }
+
+    memcpy(ctx->iv, iv, AES_IV_SIZE);
+}
+
+void AES_convert_key(AES_CTX *ctx)
+{
+    (void)ctx;
+}
+
+void AES_cbc_encrypt(AES_CTX *ctx, const uint8_t *msg, uint8_t *out, int length)
+{
+    esp_aes_encrypt_cbc(&ctx->aes, ctx->iv, msg, out, length & ~(AES_BLOCKSIZE - 1));
+}
+
+void AES_cbc_decrypt(AES_CTX *ctx, const uint8_t *msg, uint8_t *out, int length)
+{
+    esp_aes_decrypt_cbc(&ctx->aes, ctx->iv, msg, out, length & ~(AES_BLOCKSIZE - 1));
+}
+
+#else /* CONFIG_SSL_AES_CONSTANT_TIME */
+
 #define rot1(x) (((x) << 24) | ((x) >> 8))
 #define rot2(x) (((x) << 16) | ((x) >> 16))
 #define rot3(x) (((x) <<  8) | ((x) >> 24))
@@ -459,4 +502,6 @@ static void AES_decrypt(const AES_CTX *ctx, uint32_t *data)
     }
 }
 
+#endif /* CONFIG_SSL_AES_CONSTANT_TIME */
+
 #endif
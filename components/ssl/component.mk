@@ -15,6 +15,18 @@ ifdef CONFIG_SSL_USING_MBEDTLS
 COMPONENT_PRIV_INCLUDEDIRS := mbedtls/port/openssl/include/internal mbedtls/port/openssl/include/openssl mbedtls/port/openssl/include/platform
 COMPONENT_ADD_INCLUDEDIRS += mbedtls/mbedtls/include mbedtls/port/esp8266/include mbedtls/port/openssl/include
 COMPONENT_SRCDIRS += mbedtls/mbedtls/library mbedtls/port/esp8266 mbedtls/port/openssl/source/library mbedtls/port/openssl/source/platform
+
+ifdef CONFIG_MBEDTLS_DYNAMIC_BUFFER
+COMPONENT_ADD_LDFLAGS += -Wl,--wrap=mbedtls_ssl_setup
+COMPONENT_ADD_LDFLAGS += -Wl,--wrap=mbedtls_ssl_session_reset
+COMPONENT_ADD_LDFLAGS += -Wl,--wrap=mbedtls_ssl_handshake
+COMPONENT_ADD_LDFLAGS += -Wl,--wrap=mbedtls_ssl_handshake_step
+COMPONENT_ADD_LDFLAGS += -Wl,--wrap=mbedtls_ssl_renegotiate
+COMPONENT_ADD_LDFLAGS += -Wl,--wrap=mbedtls_ssl_read
+COMPONENT_ADD_LDFLAGS += -Wl,--wrap=mbedtls_ssl_write
+COMPONENT_ADD_LDFLAGS += -Wl,--wrap=mbedtls_ssl_close_notify
+COMPONENT_ADD_LDFLAGS += -Wl,--wrap=mbedtls_ssl_free
+endif
 else
 COMPONENT_ADD_INCLUDEDIRS := axtls/include
 COMPONENT_SRCDIRS := axtls/source/ssl axtls/source/crypto
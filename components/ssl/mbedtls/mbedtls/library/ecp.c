@@ -85,6 +85,24 @@ static void mbedtls_zeroize( void *v, size_t n ) {
 static unsigned long add_count, dbl_count, mul_count;
 #endif
 
+#if defined(MBEDTLS_ECP_FIXED_POINT_CACHE)
+/*
+ * Comb tables for the generator of the built-in curves, indexed by group id.
+ * The first multiplication of G on a curve stores its table here and every
+ * group loaded later with mbedtls_ecp_group_load() reuses it read-only, so
+ * ECDHE key generation and ECDSA in the following handshakes skip the
+ * precomputation. The cached tables are never freed, so there is no lock;
+ * a table that loses a race for its slot is freed with its group.
+ */
+static mbedtls_ecp_point *ecp_comb_cache[MBEDTLS_ECP_DP_SECP256K1 + 1];
+
+static int ecp_comb_cacheable( const mbedtls_ecp_group *grp )
+{
+    return( grp->h == 1 && grp->id > MBEDTLS_ECP_DP_NONE &&
+            (size_t) grp->id < sizeof( ecp_comb_cache ) / sizeof( ecp_comb_cache[0] ) );
+}
+#endif /* MBEDTLS_ECP_FIXED_POINT_CACHE */
+
 #if defined(MBEDTLS_ECP_DP_SECP192R1_ENABLED) ||   \
     defined(MBEDTLS_ECP_DP_SECP224R1_ENABLED) ||   \
     defined(MBEDTLS_ECP_DP_SECP256R1_ENABLED) ||   \
@@ -339,7 +357,12 @@ void mbedtls_ecp_group_free( mbedtls_ecp_group *grp )
         mbedtls_mpi_free( &grp->N );
     }
 
+#if defined(MBEDTLS_ECP_FIXED_POINT_CACHE)
+    if( grp->T != NULL &&
+        ! ( ecp_comb_cacheable( grp ) && grp->T == ecp_comb_cache[grp->id] ) )
+#else
     if( grp->T != NULL )
+#endif
     {
         for( i = 0; i < grp->T_size; i++ )
             mbedtls_ecp_point_free( &grp->T[i] );
@@ -1407,6 +1430,15 @@ static int ecp_mul_comb( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
      */
     T = p_eq_g ? grp->T : NULL;
 
+#if defined(MBEDTLS_ECP_FIXED_POINT_CACHE)
+    if( T == NULL && p_eq_g && ecp_comb_cacheable( grp ) &&
+        ( T = ecp_comb_cache[grp->id] ) != NULL )
+    {
+        grp->T = T;
+        grp->T_size = pre_len;
+    }
+#endif
+
     if( T == NULL )
     {
         T = mbedtls_calloc( pre_len, sizeof( mbedtls_ecp_point ) );
@@ -1422,6 +1454,10 @@ static int ecp_mul_comb( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
         {
             grp->T = T;
             grp->T_size = pre_len;
+#if defined(MBEDTLS_ECP_FIXED_POINT_CACHE)
+            if( ecp_comb_cacheable( grp ) && ecp_comb_cache[grp->id] == NULL )
+                ecp_comb_cache[grp->id] = T;
+#endif
         }
     }
 
@@ -0,0 +1,159 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string.h>
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_AES_C) && defined(MBEDTLS_AES_ALT)
+
+#include "mbedtls/aes.h"
+
+/*
+ * mbedTLS AES on top of esp_aes. The key schedule is the same for both
+ * directions, so mbedtls_aes_setkey_dec is mbedtls_aes_setkey_enc, and
+ * CBC decryption and CTR go through the two-block bulk functions.
+ */
+
+void mbedtls_aes_init(mbedtls_aes_context *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_aes_free(mbedtls_aes_context *ctx)
+{
+    if (ctx)
+        esp_aes_clear(ctx);
+}
+
+int mbedtls_aes_setkey_enc(mbedtls_aes_context *ctx, const unsigned char *key, unsigned int keybits)
+{
+    if (esp_aes_set_key(ctx, key, keybits))
+        return MBEDTLS_ERR_AES_INVALID_KEY_LENGTH;
+
+    return 0;
+}
+
+int mbedtls_aes_setkey_dec(mbedtls_aes_context *ctx, const unsigned char *key, unsigned int keybits)
+{
+    return mbedtls_aes_setkey_enc(ctx, key, keybits);
+}
+
+int mbedtls_internal_aes_encrypt(mbedtls_aes_context *ctx, const unsigned char input[16],
+                                 unsigned char output[16])
+{
+    esp_aes_encrypt(ctx, input, output);
+
+    return 0;
+}
+
+int mbedtls_internal_aes_decrypt(mbedtls_aes_context *ctx, const unsigned char input[16],
+                                 unsigned char output[16])
+{
+    esp_aes_decrypt(ctx, input, output);
+
+    return 0;
+}
+
+int mbedtls_aes_crypt_ecb(mbedtls_aes_context *ctx, int mode, const unsigned char input[16],
+                          unsigned char output[16])
+{
+    if (mode == MBEDTLS_AES_ENCRYPT)
+        esp_aes_encrypt(ctx, input, output);
+    else
+        esp_aes_decrypt(ctx, input, output);
+
+    return 0;
+}
+
+#if defined(MBEDTLS_CIPHER_MODE_CBC)
+int mbedtls_aes_crypt_cbc(mbedtls_aes_context *ctx, int mode, size_t length, unsigned char iv[16],
+                          const unsigned char *input, unsigned char *output)
+{
+    int ret;
+
+    if (mode == MBEDTLS_AES_ENCRYPT)
+        ret = esp_aes_encrypt_cbc(ctx, iv, input, output, length);
+    else
+        ret = esp_aes_decrypt_cbc(ctx, iv, input, output, length);
+
+    return ret ? MBEDTLS_ERR_AES_INVALID_INPUT_LENGTH : 0;
+}
+#endif /* MBEDTLS_CIPHER_MODE_CBC */
+
+#if defined(MBEDTLS_CIPHER_MODE_CFB)
+int mbedtls_aes_crypt_cfb128(mbedtls_aes_context *ctx, int mode, size_t length, size_t *iv_off,
+                             unsigned char iv[16], const unsigned char *input, unsigned char *output)
+{
+    size_t n = *iv_off;
+
+    while (length--) {
+        unsigned char c = *input++;
+
+        if (n == 0)
+            esp_aes_encrypt(ctx, iv, iv);
+
+        *output++ = c ^ iv[n];
+        iv[n] = mode == MBEDTLS_AES_DECRYPT ? c : c ^ iv[n];
+
+        n = (n + 1) & 0x0F;
+    }
+
+    *iv_off = n;
+
+    return 0;
+}
+
+int mbedtls_aes_crypt_cfb8(mbedtls_aes_context *ctx, int mode, size_t length, unsigned char iv[16],
+                           const unsigned char *input, unsigned char *output)
+{
+    unsigned char ov[17];
+
+    while (length--) {
+        unsigned char c;
+
+        memcpy(ov, iv, 16);
+        esp_aes_encrypt(ctx, iv, iv);
+
+        if (mode == MBEDTLS_AES_DECRYPT)
+            ov[16] = *input;
+
+        c = *output++ = iv[0] ^ *input++;
+
+        if (mode == MBEDTLS_AES_ENCRYPT)
+            ov[16] = c;
+
+        memcpy(iv, ov + 1, 16);
+    }
+
+    return 0;
+}
+#endif /* MBEDTLS_CIPHER_MODE_CFB */
+
+#if defined(MBEDTLS_CIPHER_MODE_CTR)
+int mbedtls_aes_crypt_ctr(mbedtls_aes_context *ctx, size_t length, size_t *nc_off,
+                          unsigned char nonce_counter[16], unsigned char stream_block[16],
+                          const unsigned char *input, unsigned char *output)
+{
+    esp_aes_crypt_ctr(ctx, nc_off, nonce_counter, stream_block, input, output, length);
+
+    return 0;
+}
+#endif /* MBEDTLS_CIPHER_MODE_CTR */
+
+#endif /* MBEDTLS_AES_C && MBEDTLS_AES_ALT */
@@ -0,0 +1,205 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "mbedtls/platform.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/esp_crt_bundle.h"
+
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+
+/*
+ * Bundle layout, little endian, see tools/make_crt_bundle.py:
+ *
+ *   header     magic, number of certificates, total size
+ *   index      one entry per certificate, sorted by name_hash
+ *   data       DER certificates, each padded to 4 bytes
+ *
+ * name_hash is the 32-bit FNV-1a hash of the DER encoded subject name, which
+ * is compared with the issuer name of the certificate to verify. The header
+ * and the index entries are copied out before they are used, so the bundle
+ * can be used in place at any alignment.
+ */
+#define CRT_BUNDLE_MAGIC        0x42545243  /* "CRTB" */
+
+typedef struct {
+    uint32_t magic;
+    uint32_t count;
+    uint32_t size;
+} crt_bundle_header_t;
+
+typedef struct {
+    uint32_t name_hash;
+    uint32_t offset;
+    uint32_t len;
+} crt_bundle_entry_t;
+
+static const char *TAG = "crt_bundle";
+
+/*
+ * mbedTLS refuses to verify a peer without a CA chain, this empty certificate
+ * never matches an issuer so that the top of every chain reaches the verify
+ * callback flagged MBEDTLS_X509_BADCERT_NOT_TRUSTED.
+ */
+static mbedtls_x509_crt s_crt_bundle_placeholder;
+
+static void crt_bundle_get_header(const uint8_t *bundle, crt_bundle_header_t *header)
+{
+    memcpy(header, bundle, sizeof(*header));
+}
+
+static void crt_bundle_get_entry(const uint8_t *bundle, uint32_t i, crt_bundle_entry_t *entry)
+{
+    memcpy(entry, bundle + sizeof(crt_bundle_header_t) + i * sizeof(*entry), sizeof(*entry));
+}
+
+static uint32_t crt_bundle_name_hash(const unsigned char *name, size_t len)
+{
+    uint32_t hash = 2166136261u;
+
+    while (len--) {
+        hash ^= *name++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/* Check that the bundle entry is a CA, is the issuer of child and has signed it */
+static int crt_bundle_check_issuer(const uint8_t *bundle, const crt_bundle_entry_t *entry, const mbedtls_x509_crt *child)
+{
+    int ret;
+    mbedtls_x509_crt ca;
+    unsigned char hash[MBEDTLS_MD_MAX_SIZE];
+    const mbedtls_md_info_t *md_info = mbedtls_md_info_from_type(child->sig_md);
+
+    if (!md_info)
+        return MBEDTLS_ERR_X509_CERT_VERIFY_FAILED;
+
+    mbedtls_x509_crt_init(&ca);
+
+    ret = mbedtls_x509_crt_parse_der(&ca, bundle + entry->offset, entry->len);
+    if (ret)
+        goto exit;
+
+    if (ca.subject_raw.len != child->issuer_raw.len ||
+        memcmp(ca.subject_raw.p, child->issuer_raw.p, child->issuer_raw.len)) {
+        ret = MBEDTLS_ERR_X509_CERT_VERIFY_FAILED;
+        goto exit;
+    }
+
+    /* as mbedtls_x509_crt_verify requires of a parent, without its exception for v1 roots */
+    if (!ca.ca_istrue) {
+        ESP_LOGD(TAG, "bundle entry is not a CA");
+        ret = MBEDTLS_ERR_X509_CERT_VERIFY_FAILED;
+        goto exit;
+    }
+
+#if defined(MBEDTLS_X509_CHECK_KEY_USAGE)
+    ret = mbedtls_x509_crt_check_key_usage(&ca, MBEDTLS_X509_KU_KEY_CERT_SIGN);
+    if (ret)
+        goto exit;
+#endif
+
+    ret = mbedtls_md(md_info, child->tbs.p, child->tbs.len, hash);
+    if (ret)
+        goto exit;
+
+    ret = mbedtls_pk_verify_ext(child->sig_pk, child->sig_opts, &ca.pk, child->sig_md,
+                                hash, mbedtls_md_get_size(md_info), child->sig.p, child->sig.len);
+
+exit:
+    mbedtls_x509_crt_free(&ca);
+
+    return ret;
+}
+
+static int crt_bundle_verify(void *p_vrfy, mbedtls_x509_crt *crt, int depth, uint32_t *flags)
+{
+    const uint8_t *bundle = p_vrfy;
+    crt_bundle_header_t header;
+    crt_bundle_entry_t entry;
+    uint32_t hash, lo = 0, hi;
+
+    if (!(*flags & MBEDTLS_X509_BADCERT_NOT_TRUSTED))
+        return 0;
+
+    crt_bundle_get_header(bundle, &header);
+    hi = header.count;
+
+    /* first entry with this hash, several CAs may share a subject name */
+    hash = crt_bundle_name_hash(crt->issuer_raw.p, crt->issuer_raw.len);
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+
+        crt_bundle_get_entry(bundle, mid, &entry);
+        if (entry.name_hash < hash)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (; lo < header.count; lo++) {
+        crt_bundle_get_entry(bundle, lo, &entry);
+        if (entry.name_hash != hash)
+            break;
+        if (!crt_bundle_check_issuer(bundle, &entry, crt)) {
+            ESP_LOGD(TAG, "depth %d issued by bundle entry %u", depth, lo);
+            *flags &= ~MBEDTLS_X509_BADCERT_NOT_TRUSTED;
+            return 0;
+        }
+    }
+
+    ESP_LOGD(TAG, "depth %d: no issuer in the bundle", depth);
+
+    return 0;
+}
+
+int esp_crt_bundle_attach(mbedtls_ssl_config *conf, const uint8_t *bundle)
+{
+    crt_bundle_header_t header;
+    crt_bundle_entry_t entry;
+    uint32_t last_hash = 0;
+
+    if (!conf || !bundle)
+        return MBEDTLS_ERR_X509_BAD_INPUT_DATA;
+
+    crt_bundle_get_header(bundle, &header);
+    if (header.magic != CRT_BUNDLE_MAGIC || header.size < sizeof(header) ||
+        header.count > (header.size - sizeof(header)) / sizeof(entry))
+        return MBEDTLS_ERR_X509_BAD_INPUT_DATA;
+
+    for (uint32_t i = 0; i < header.count; i++) {
+        crt_bundle_get_entry(bundle, i, &entry);
+        if (entry.offset > header.size || entry.len > header.size - entry.offset ||
+            entry.name_hash < last_hash) {
+            ESP_LOGE(TAG, "bad bundle entry %u", i);
+            return MBEDTLS_ERR_X509_BAD_INPUT_DATA;
+        }
+        last_hash = entry.name_hash;
+    }
+
+    mbedtls_ssl_conf_ca_chain(conf, &s_crt_bundle_placeholder, NULL);
+    mbedtls_ssl_conf_verify(conf, crt_bundle_verify, (void *)bundle);
+
+    return 0;
+}
+
+#endif /* MBEDTLS_X509_CRT_PARSE_C */
@@ -0,0 +1,420 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+
+#ifdef CONFIG_MBEDTLS_DYNAMIC_BUFFER
+
+#include "esp_log.h"
+
+#include "mbedtls/platform.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/ssl_internal.h"
+#include "mbedtls/esp_mbedtls_dynamic.h"
+
+#if defined(MBEDTLS_ZLIB_SUPPORT)
+#error "CONFIG_MBEDTLS_DYNAMIC_BUFFER does not support MBEDTLS_ZLIB_SUPPORT"
+#endif
+
+/*
+ * The library allocates both record buffers at MBEDTLS_SSL_BUFFER_LEN in
+ * mbedtls_ssl_setup and keeps them until mbedtls_ssl_free. The public entry
+ * points are wrapped at link time (see component.mk) to grow the buffers on
+ * entry and to shrink them back to SSL_BUF_IDLE_LEN once nothing is left in
+ * them. They are not freed: an idle connection keeps a record header and IV
+ * in each, about 60 bytes in all instead of two full records. Calls inside
+ * the library are not wrapped and see full buffers.
+ *
+ * Buffers carry a small header with their size, the in_xxx/out_xxx pointers
+ * of the context are rebased whenever a buffer moves.
+ */
+
+#define TAG "mbedtls_dynamic"
+
+#define SSL_BUF_FULL_LEN    MBEDTLS_SSL_BUFFER_LEN
+/* record header and explicit IV, all in_xxx/out_xxx pointers stay inside it */
+#define SSL_BUF_IDLE_LEN    (MBEDTLS_SSL_HEADER_LEN + MBEDTLS_MAX_IV_LENGTH)
+/* enough to encrypt and send one alert record */
+#define SSL_BUF_ALERT_LEN   (SSL_BUF_IDLE_LEN + 2 + MBEDTLS_SSL_MAC_ADD + MBEDTLS_MAX_BLOCK_LENGTH)
+
+typedef struct ssl_buf {
+    size_t len;
+    size_t peak;        /* largest RX + TX size, only kept in the RX buffer */
+    unsigned char buf[];
+} ssl_buf_t;
+
+#define SSL_BUF(p)  ((ssl_buf_t *)((p) - offsetof(ssl_buf_t, buf)))
+
+#define SSL_RX_PTRS(ssl)    { &(ssl)->in_ctr, &(ssl)->in_hdr, &(ssl)->in_len, &(ssl)->in_iv, \
+                              &(ssl)->in_msg, &(ssl)->in_offt }
+#define SSL_TX_PTRS(ssl)    { &(ssl)->out_ctr, &(ssl)->out_hdr, &(ssl)->out_len, &(ssl)->out_iv, \
+                              &(ssl)->out_msg }
+#define SSL_PTRS_NUM(ptrs)  (sizeof(ptrs) / sizeof(ptrs[0]))
+
+int __real_mbedtls_ssl_setup(mbedtls_ssl_context *ssl, const mbedtls_ssl_config *conf);
+int __real_mbedtls_ssl_session_reset(mbedtls_ssl_context *ssl);
+int __real_mbedtls_ssl_handshake(mbedtls_ssl_context *ssl);
+int __real_mbedtls_ssl_handshake_step(mbedtls_ssl_context *ssl);
+int __real_mbedtls_ssl_read(mbedtls_ssl_context *ssl, unsigned char *buf, size_t len);
+int __real_mbedtls_ssl_write(mbedtls_ssl_context *ssl, const unsigned char *buf, size_t len);
+int __real_mbedtls_ssl_close_notify(mbedtls_ssl_context *ssl);
+void __real_mbedtls_ssl_free(mbedtls_ssl_context *ssl);
+#if defined(MBEDTLS_SSL_RENEGOTIATION)
+int __real_mbedtls_ssl_renegotiate(mbedtls_ssl_context *ssl);
+#endif
+
+static void ssl_zeroize(void *v, size_t n)
+{
+    volatile unsigned char *p = v;
+
+    while (n--)
+        *p++ = 0;
+}
+
+static inline size_t ssl_buf_len(const unsigned char *buf)
+{
+    return SSL_BUF(buf)->len;
+}
+
+/* Copy the first len bytes of old to new and point everything that pointed into old into new */
+static void ssl_buf_rebase(unsigned char *new, unsigned char *old, size_t len,
+                           unsigned char **ptrs[], size_t num)
+{
+    memcpy(new, old, len);
+
+    for (size_t i = 0; i < num; i++) {
+        if (*ptrs[i])
+            *ptrs[i] = new + (*ptrs[i] - old);
+    }
+}
+
+static int ssl_buf_resize(unsigned char **buf, size_t len, unsigned char **ptrs[], size_t num)
+{
+    ssl_buf_t *old = SSL_BUF(*buf);
+    ssl_buf_t *new;
+
+    if (old->len == len)
+        return 0;
+
+    new = mbedtls_calloc(1, sizeof(ssl_buf_t) + len);
+    if (!new) {
+        ESP_LOGE(TAG, "alloc(%u bytes) failed", sizeof(ssl_buf_t) + len);
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+
+    new->len = len;
+    new->peak = old->peak;
+    ssl_buf_rebase(new->buf, old->buf, old->len < len ? old->len : len, ptrs, num);
+
+    ssl_zeroize(old, sizeof(ssl_buf_t) + old->len);
+    mbedtls_free(old);
+    *buf = new->buf;
+
+    return 0;
+}
+
+/* Replace a full size buffer allocated by mbedtls_ssl_setup with an idle one */
+static int ssl_buf_adopt(unsigned char **buf, unsigned char **ptrs[], size_t num)
+{
+    ssl_buf_t *new = mbedtls_calloc(1, sizeof(ssl_buf_t) + SSL_BUF_IDLE_LEN);
+    int ret = 0;
+
+    if (new) {
+        new->len = SSL_BUF_IDLE_LEN;
+        ssl_buf_rebase(new->buf, *buf, SSL_BUF_IDLE_LEN, ptrs, num);
+    } else {
+        ret = MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+
+    ssl_zeroize(*buf, SSL_BUF_FULL_LEN);
+    mbedtls_free(*buf);
+    *buf = new ? new->buf : NULL;
+
+    return ret;
+}
+
+static void ssl_buf_free(unsigned char **buf)
+{
+    if (*buf) {
+        ssl_buf_t *b = SSL_BUF(*buf);
+
+        ssl_zeroize(b, sizeof(ssl_buf_t) + b->len);
+        mbedtls_free(b);
+        *buf = NULL;
+    }
+}
+
+static int ssl_rx_resize(mbedtls_ssl_context *ssl, size_t len)
+{
+    unsigned char **ptrs[] = SSL_RX_PTRS(ssl);
+
+    return ssl_buf_resize(&ssl->in_buf, len, ptrs, SSL_PTRS_NUM(ptrs));
+}
+
+static int ssl_tx_resize(mbedtls_ssl_context *ssl, size_t len)
+{
+    unsigned char **ptrs[] = SSL_TX_PTRS(ssl);
+
+    return ssl_buf_resize(&ssl->out_buf, len, ptrs, SSL_PTRS_NUM(ptrs));
+}
+
+static inline bool ssl_is_dynamic(const mbedtls_ssl_context *ssl)
+{
+    return ssl && ssl->conf && ssl->in_buf && ssl->out_buf;
+}
+
+static inline bool ssl_is_handshaking(const mbedtls_ssl_context *ssl)
+{
+    return ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER && ssl->state != MBEDTLS_SSL_HELLO_REQUEST;
+}
+
+/* Whether sending may make the library read, i.e. start a renegotiation */
+static bool ssl_tx_may_read(const mbedtls_ssl_context *ssl)
+{
+#if defined(MBEDTLS_SSL_RENEGOTIATION)
+    if (ssl->conf->disable_renegotiation == MBEDTLS_SSL_RENEGOTIATION_ENABLED)
+        return true;
+#endif
+    return false;
+}
+
+/* Whether receiving a record may make the library send more than an alert */
+static bool ssl_rx_may_write(const mbedtls_ssl_context *ssl)
+{
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+    if (ssl->conf->transport == MBEDTLS_SSL_TRANSPORT_DATAGRAM)
+        return true;
+#endif
+    return ssl_tx_may_read(ssl);
+}
+
+/* Grow the buffers to at least rx_len/tx_len, or to full size if a handshake has to run */
+static int ssl_buf_enter(mbedtls_ssl_context *ssl, size_t rx_len, size_t tx_len)
+{
+    int ret;
+    ssl_buf_t *rx;
+    size_t total;
+
+    if (ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER) {
+        rx_len = SSL_BUF_FULL_LEN;
+        tx_len = SSL_BUF_FULL_LEN;
+    }
+
+    if (ssl_buf_len(ssl->in_buf) < rx_len && (ret = ssl_rx_resize(ssl, rx_len)) != 0)
+        return ret;
+    if (ssl_buf_len(ssl->out_buf) < tx_len && (ret = ssl_tx_resize(ssl, tx_len)) != 0)
+        return ret;
+
+    rx = SSL_BUF(ssl->in_buf);
+    total = rx->len + ssl_buf_len(ssl->out_buf);
+    if (total > rx->peak)
+        rx->peak = total;
+
+    return 0;
+}
+
+/* Shrink every buffer which holds no pending data, failures just keep the larger buffer */
+static void ssl_buf_leave(mbedtls_ssl_context *ssl, bool handshaking)
+{
+    if (ssl_is_handshaking(ssl))
+        return;
+
+    if (handshaking && ssl->state == MBEDTLS_SSL_HANDSHAKE_OVER) {
+#if defined(CONFIG_MBEDTLS_DYNAMIC_FREE_PEER_CERT) && defined(MBEDTLS_X509_CRT_PARSE_C)
+        if (ssl->session && ssl->session->peer_cert) {
+            mbedtls_x509_crt_free(ssl->session->peer_cert);
+            mbedtls_free(ssl->session->peer_cert);
+            ssl->session->peer_cert = NULL;
+        }
+#endif
+    }
+
+    if (!ssl->in_left && !ssl->in_offt && !ssl->keep_current_message &&
+        !(ssl->in_hslen && ssl->in_hslen < ssl->in_msglen))
+        ssl_rx_resize(ssl, SSL_BUF_IDLE_LEN);
+    if (!ssl->out_left)
+        ssl_tx_resize(ssl, SSL_BUF_IDLE_LEN);
+
+    if (handshaking && ssl->state == MBEDTLS_SSL_HANDSHAKE_OVER) {
+        ESP_LOGD(TAG, "handshake done, record buffers peak %u bytes, idle %u bytes",
+                 SSL_BUF(ssl->in_buf)->peak, ssl_buf_len(ssl->in_buf) + ssl_buf_len(ssl->out_buf));
+    }
+}
+
+int esp_mbedtls_dynamic_get_stats(const mbedtls_ssl_context *ssl, esp_mbedtls_dynamic_stats_t *stats)
+{
+    if (!ssl_is_dynamic(ssl) || !stats)
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+
+    stats->rx_len = ssl_buf_len(ssl->in_buf);
+    stats->tx_len = ssl_buf_len(ssl->out_buf);
+    stats->peak = SSL_BUF(ssl->in_buf)->peak;
+
+    return 0;
+}
+
+int __wrap_mbedtls_ssl_setup(mbedtls_ssl_context *ssl, const mbedtls_ssl_config *conf)
+{
+    int ret = __real_mbedtls_ssl_setup(ssl, conf);
+    int err = 0;
+
+    if (ssl->in_buf) {
+        unsigned char **ptrs[] = SSL_RX_PTRS(ssl);
+
+        err = ssl_buf_adopt(&ssl->in_buf, ptrs, SSL_PTRS_NUM(ptrs));
+    }
+    if (ssl->out_buf) {
+        unsigned char **ptrs[] = SSL_TX_PTRS(ssl);
+
+        if (ssl_buf_adopt(&ssl->out_buf, ptrs, SSL_PTRS_NUM(ptrs)) != 0)
+            err = MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+
+    if (ssl->in_buf && ssl->out_buf)
+        SSL_BUF(ssl->in_buf)->peak = SSL_BUF_FULL_LEN * 2;
+
+    return ret ? ret : err;
+}
+
+int __wrap_mbedtls_ssl_session_reset(mbedtls_ssl_context *ssl)
+{
+    int ret;
+
+    if (!ssl_is_dynamic(ssl))
+        return __real_mbedtls_ssl_session_reset(ssl);
+
+    /* the reset clears both buffers over their full length */
+    if ((ret = ssl_buf_enter(ssl, SSL_BUF_FULL_LEN, SSL_BUF_FULL_LEN)) != 0)
+        return ret;
+    ret = __real_mbedtls_ssl_session_reset(ssl);
+    ssl_buf_leave(ssl, false);
+
+    return ret;
+}
+
+int __wrap_mbedtls_ssl_handshake(mbedtls_ssl_context *ssl)
+{
+    int ret;
+
+    if (!ssl_is_dynamic(ssl))
+        return __real_mbedtls_ssl_handshake(ssl);
+
+    if ((ret = ssl_buf_enter(ssl, SSL_BUF_FULL_LEN, SSL_BUF_FULL_LEN)) != 0)
+        return ret;
+    ret = __real_mbedtls_ssl_handshake(ssl);
+    ssl_buf_leave(ssl, true);
+
+    return ret;
+}
+
+int __wrap_mbedtls_ssl_handshake_step(mbedtls_ssl_context *ssl)
+{
+    int ret;
+
+    if (!ssl_is_dynamic(ssl))
+        return __real_mbedtls_ssl_handshake_step(ssl);
+
+    if ((ret = ssl_buf_enter(ssl, SSL_BUF_FULL_LEN, SSL_BUF_FULL_LEN)) != 0)
+        return ret;
+    ret = __real_mbedtls_ssl_handshake_step(ssl);
+    ssl_buf_leave(ssl, true);
+
+    return ret;
+}
+
+#if defined(MBEDTLS_SSL_RENEGOTIATION)
+int __wrap_mbedtls_ssl_renegotiate(mbedtls_ssl_context *ssl)
+{
+    int ret;
+
+    if (!ssl_is_dynamic(ssl))
+        return __real_mbedtls_ssl_renegotiate(ssl);
+
+    if ((ret = ssl_buf_enter(ssl, SSL_BUF_FULL_LEN, SSL_BUF_FULL_LEN)) != 0)
+        return ret;
+    ret = __real_mbedtls_ssl_renegotiate(ssl);
+    ssl_buf_leave(ssl, true);
+
+    return ret;
+}
+#endif
+
+int __wrap_mbedtls_ssl_read(mbedtls_ssl_context *ssl, unsigned char *buf, size_t len)
+{
+    int ret;
+    bool handshaking;
+
+    if (!ssl_is_dynamic(ssl))
+        return __real_mbedtls_ssl_read(ssl, buf, len);
+
+    handshaking = ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER;
+    ret = ssl_buf_enter(ssl, SSL_BUF_FULL_LEN, ssl_rx_may_write(ssl) ? SSL_BUF_FULL_LEN : SSL_BUF_ALERT_LEN);
+    if (ret != 0)
+        return ret;
+    ret = __real_mbedtls_ssl_read(ssl, buf, len);
+    ssl_buf_leave(ssl, handshaking);
+
+    return ret;
+}
+
+int __wrap_mbedtls_ssl_write(mbedtls_ssl_context *ssl, const unsigned char *buf, size_t len)
+{
+    int ret;
+    bool handshaking;
+
+    if (!ssl_is_dynamic(ssl))
+        return __real_mbedtls_ssl_write(ssl, buf, len);
+
+    handshaking = ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER;
+    ret = ssl_buf_enter(ssl, ssl_tx_may_read(ssl) ? SSL_BUF_FULL_LEN : 0, SSL_BUF_FULL_LEN);
+    if (ret != 0)
+        return ret;
+    ret = __real_mbedtls_ssl_write(ssl, buf, len);
+    ssl_buf_leave(ssl, handshaking);
+
+    return ret;
+}
+
+int __wrap_mbedtls_ssl_close_notify(mbedtls_ssl_context *ssl)
+{
+    int ret;
+
+    if (!ssl_is_dynamic(ssl))
+        return __real_mbedtls_ssl_close_notify(ssl);
+
+    /* nothing is sent before the handshake is over, so no need to grow the buffers then */
+    if (ssl->state == MBEDTLS_SSL_HANDSHAKE_OVER &&
+        (ret = ssl_buf_enter(ssl, 0, SSL_BUF_ALERT_LEN)) != 0)
+        return ret;
+    ret = __real_mbedtls_ssl_close_notify(ssl);
+    ssl_buf_leave(ssl, false);
+
+    return ret;
+}
+
+void __wrap_mbedtls_ssl_free(mbedtls_ssl_context *ssl)
+{
+    if (ssl) {
+        ssl_buf_free(&ssl->in_buf);
+        ssl_buf_free(&ssl->out_buf);
+    }
+
+    __real_mbedtls_ssl_free(ssl);
+}
+
+#endif /* CONFIG_MBEDTLS_DYNAMIC_BUFFER */
@@ -0,0 +1,217 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <errno.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "esp_log.h"
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/esp_mbedtls_reactor.h"
+
+/*
+ * Every connection always waits for its socket to be readable, and also for
+ * it to be writable once a send on it returned MBEDTLS_ERR_SSL_WANT_WRITE, which
+ * the BIO callbacks below record, or when it is added before its handshake.
+ *
+ * Callbacks may remove and free any connection, so the dispatch loop keeps the
+ * next connection to visit in reactor->cursor, which esp_mbedtls_reactor_remove
+ * moves past a connection it unlinks, and never touches the current connection
+ * again once reactor->current has been cleared by its removal.
+ */
+
+#define TAG "mbedtls_reactor"
+
+static int conn_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    esp_mbedtls_conn_t *conn = ctx;
+    int ret = mbedtls_net_send(conn->net, buf, len);
+
+    if (ret == MBEDTLS_ERR_SSL_WANT_WRITE)
+        conn->want_write = 1;
+
+    return ret;
+}
+
+static int conn_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    esp_mbedtls_conn_t *conn = ctx;
+
+    return mbedtls_net_recv(conn->net, buf, len);
+}
+
+void esp_mbedtls_reactor_init(esp_mbedtls_reactor_t *reactor)
+{
+    reactor->conns = NULL;
+    reactor->current = NULL;
+    reactor->cursor = NULL;
+}
+
+int esp_mbedtls_reactor_add(esp_mbedtls_reactor_t *reactor, esp_mbedtls_conn_t *conn,
+                            mbedtls_ssl_context *ssl, mbedtls_net_context *net,
+                            esp_mbedtls_conn_cb_t cb, void *arg)
+{
+    if (net->fd < 0 || net->fd >= FD_SETSIZE || mbedtls_net_set_nonblock(net))
+        return MBEDTLS_ERR_NET_INVALID_CONTEXT;
+
+    conn->ssl = ssl;
+    conn->net = net;
+    conn->cb = cb;
+    conn->arg = arg;
+    conn->handshake = ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER;
+    /* a client sends first, its handshake is started as soon as it can write */
+    conn->want_write = conn->handshake;
+
+    mbedtls_ssl_set_bio(ssl, conn, conn_send, conn_recv, NULL);
+
+    /* added at the head, so not visited by a dispatch loop already running */
+    conn->next = reactor->conns;
+    reactor->conns = conn;
+
+    return 0;
+}
+
+void esp_mbedtls_reactor_remove(esp_mbedtls_reactor_t *reactor, esp_mbedtls_conn_t *conn)
+{
+    esp_mbedtls_conn_t **p;
+
+    for (p = &reactor->conns; *p; p = &(*p)->next) {
+        if (*p == conn)
+            break;
+    }
+    if (!*p)
+        return;
+
+    *p = conn->next;
+    if (reactor->cursor == conn)
+        reactor->cursor = conn->next;
+    if (reactor->current == conn)
+        reactor->current = NULL;
+
+    mbedtls_ssl_set_bio(conn->ssl, conn->net, mbedtls_net_send, mbedtls_net_recv, NULL);
+}
+
+/* Call the callback, return false if it removed the connection */
+static bool conn_event(esp_mbedtls_reactor_t *reactor, esp_mbedtls_conn_t *conn, esp_mbedtls_event_t event, int err)
+{
+    conn->cb(conn, event, err, conn->arg);
+
+    return reactor->current == conn;
+}
+
+static int conn_dispatch(esp_mbedtls_reactor_t *reactor, esp_mbedtls_conn_t *conn, bool readable, bool writable)
+{
+    int ret, events = 0;
+
+    if (conn->handshake) {
+        ret = mbedtls_ssl_handshake(conn->ssl);
+        if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE)
+            return 0;
+
+        if (ret) {
+            ESP_LOGD(TAG, "fd %d handshake failed -0x%x", conn->net->fd, -ret);
+            esp_mbedtls_reactor_remove(reactor, conn);
+            conn->cb(conn, ESP_MBEDTLS_EVENT_ERROR, ret, conn->arg);
+            return 1;
+        }
+
+        conn->handshake = 0;
+        events++;
+        if (!conn_event(reactor, conn, ESP_MBEDTLS_EVENT_CONNECTED, 0))
+            return events;
+
+        /* the last handshake flight may have carried application data */
+        readable = mbedtls_ssl_get_bytes_avail(conn->ssl) > 0;
+        writable = false;
+    }
+
+    if (writable) {
+        events++;
+        if (!conn_event(reactor, conn, ESP_MBEDTLS_EVENT_WRITABLE, 0))
+            return events;
+    }
+
+    if (readable) {
+        events++;
+        conn_event(reactor, conn, ESP_MBEDTLS_EVENT_READABLE, 0);
+    }
+
+    return events;
+}
+
+int esp_mbedtls_reactor_poll(esp_mbedtls_reactor_t *reactor, uint32_t timeout_ms)
+{
+    int ret, maxfd = -1, events = 0;
+    fd_set rfds, wfds;
+    struct timeval tv;
+    esp_mbedtls_conn_t *conn;
+
+    FD_ZERO(&rfds);
+    FD_ZERO(&wfds);
+
+    for (conn = reactor->conns; conn; conn = conn->next) {
+        int fd = conn->net->fd;
+
+        /* decrypted data left over by the last READABLE callback */
+        if (!conn->handshake && mbedtls_ssl_get_bytes_avail(conn->ssl))
+            timeout_ms = 0;
+
+        FD_SET(fd, &rfds);
+        if (conn->want_write)
+            FD_SET(fd, &wfds);
+        if (fd > maxfd)
+            maxfd = fd;
+    }
+
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+    ret = select(maxfd + 1, &rfds, &wfds, NULL, &tv);
+    if (ret < 0) {
+        if (errno == EINTR)
+            return 0;
+
+        ESP_LOGE(TAG, "select failed errno %d", errno);
+        return MBEDTLS_ERR_NET_RECV_FAILED;
+    }
+
+    for (conn = reactor->conns; conn; conn = reactor->cursor) {
+        int fd = conn->net->fd;
+        bool readable, writable;
+
+        reactor->cursor = conn->next;
+
+        readable = FD_ISSET(fd, &rfds) || (!conn->handshake && mbedtls_ssl_get_bytes_avail(conn->ssl));
+        writable = FD_ISSET(fd, &wfds);
+        if (!readable && !writable)
+            continue;
+
+        if (writable)
+            conn->want_write = 0;
+
+        reactor->current = conn;
+        events += conn_dispatch(reactor, conn, readable, writable);
+    }
+
+    reactor->current = NULL;
+    reactor->cursor = NULL;
+
+    return events;
+}
@@ -275,7 +275,11 @@
  *            digests and ciphers instead.
  *
  */
+#ifdef CONFIG_SSL_AES_CONSTANT_TIME
+#define MBEDTLS_AES_ALT
+#else
 //#define MBEDTLS_AES_ALT
+#endif
 //#define MBEDTLS_ARC4_ALT
 //#define MBEDTLS_BLOWFISH_ALT
 //#define MBEDTLS_CAMELLIA_ALT
@@ -290,8 +294,8 @@
 //#define MBEDTLS_MD5_ALT
 //#define MBEDTLS_RIPEMD160_ALT
 //#define MBEDTLS_RSA_ALT
-//#define MBEDTLS_SHA1_ALT
-//#define MBEDTLS_SHA256_ALT
+#define MBEDTLS_SHA1_ALT
+#define MBEDTLS_SHA256_ALT
 //#define MBEDTLS_SHA512_ALT
 //#define MBEDTLS_XTEA_ALT
 /*
@@ -2844,6 +2848,9 @@
 //#define MBEDTLS_ECP_MAX_BITS             521 /**< Maximum bit size of groups */
 //#define MBEDTLS_ECP_WINDOW_SIZE            6 /**< Maximum window size used */
 //#define MBEDTLS_ECP_FIXED_POINT_OPTIM      1 /**< Enable fixed-point speed-up */
+#ifdef CONFIG_MBEDTLS_ECP_FIXED_POINT_CACHE
+#define MBEDTLS_ECP_FIXED_POINT_CACHE        /**< Share the generator comb table of each curve */
+#endif
 
 /* Entropy options */
 //#define MBEDTLS_ENTROPY_MAX_SOURCES                20 /**< Maximum number of sources supported */
@@ -0,0 +1,56 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef _ESP_CRT_BUNDLE_H_
+#define _ESP_CRT_BUNDLE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "mbedtls/ssl.h"
+
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+
+/**
+ * @brief Verify peer certificates against a CA bundle
+ *
+ * The bundle is generated at build time by tools/make_crt_bundle.py from a set
+ * of PEM or DER CA certificates and is usually embedded in the application with
+ * COMPONENT_EMBED_FILES. It holds the DER certificates sorted by a hash of their
+ * subject name, so only the CA that issued the top of the presented chain is
+ * parsed, at handshake time, instead of the whole set at setup time.
+ *
+ * This sets the CA chain and the verify callback of the configuration. The
+ * trusted CA must have the basicConstraints CA flag, and the keyCertSign key
+ * usage if it has a key usage and MBEDTLS_X509_CHECK_KEY_USAGE is enabled, so
+ * v1 roots are not accepted. It is checked for its signature, not for its
+ * validity period or against a CRL.
+ *
+ * @param conf   SSL configuration
+ * @param bundle bundle data, at any alignment, which must stay valid while the
+ *               configuration is in use
+ *
+ * @return 0 on success, MBEDTLS_ERR_X509_BAD_INPUT_DATA if the bundle is malformed
+ */
+int esp_crt_bundle_attach(mbedtls_ssl_config *conf, const uint8_t *bundle);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ESP_CRT_BUNDLE_H_ */
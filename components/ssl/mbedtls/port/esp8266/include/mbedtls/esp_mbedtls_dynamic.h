@@ -0,0 +1,61 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef _ESP_MBEDTLS_DYNAMIC_H_
+#define _ESP_MBEDTLS_DYNAMIC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "sdkconfig.h"
+#include "mbedtls/ssl.h"
+
+#ifdef CONFIG_MBEDTLS_DYNAMIC_BUFFER
+
+/**
+ * @brief Record buffer usage of one SSL context
+ *
+ * With CONFIG_MBEDTLS_DYNAMIC_BUFFER the RX and TX record buffers are only
+ * allocated at full size while mbedtls_ssl_handshake, mbedtls_ssl_read or
+ * mbedtls_ssl_write need them, and are shrunk back to the size of a record
+ * header and IV when the connection is idle again.
+ */
+typedef struct {
+    size_t rx_len;      /*!< current size of the RX record buffer */
+    size_t tx_len;      /*!< current size of the TX record buffer */
+    size_t peak;        /*!< largest RX + TX size since mbedtls_ssl_setup */
+} esp_mbedtls_dynamic_stats_t;
+
+/**
+ * @brief Get the record buffer usage of an SSL context
+ *
+ * Called between two mbedtls_ssl_* calls, rx_len + tx_len is the idle
+ * footprint of the connection.
+ *
+ * @param ssl   SSL context set up with mbedtls_ssl_setup
+ * @param stats filled with the buffer usage
+ *
+ * @return 0 on success, MBEDTLS_ERR_SSL_BAD_INPUT_DATA if the context is not set up
+ */
+int esp_mbedtls_dynamic_get_stats(const mbedtls_ssl_context *ssl, esp_mbedtls_dynamic_stats_t *stats);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ESP_MBEDTLS_DYNAMIC_H_ */
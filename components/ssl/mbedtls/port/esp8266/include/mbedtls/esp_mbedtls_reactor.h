@@ -0,0 +1,135 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef _ESP_MBEDTLS_REACTOR_H_
+#define _ESP_MBEDTLS_REACTOR_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/net_sockets.h"
+
+/**
+ * @brief Events reported to the callback of a connection
+ */
+typedef enum {
+    ESP_MBEDTLS_EVENT_CONNECTED,    /*!< handshake done, application data can be exchanged */
+    ESP_MBEDTLS_EVENT_READABLE,     /*!< data arrived, call mbedtls_ssl_read until it returns MBEDTLS_ERR_SSL_WANT_READ */
+    ESP_MBEDTLS_EVENT_WRITABLE,     /*!< a write which returned MBEDTLS_ERR_SSL_WANT_WRITE can be retried */
+    ESP_MBEDTLS_EVENT_ERROR,        /*!< handshake failed, the connection has been removed from the reactor */
+} esp_mbedtls_event_t;
+
+typedef struct esp_mbedtls_conn esp_mbedtls_conn_t;
+
+/**
+ * @brief Connection callback
+ *
+ * @param conn  connection
+ * @param event what happened
+ * @param err   mbedTLS error code for ESP_MBEDTLS_EVENT_ERROR, 0 otherwise
+ * @param arg   argument given to esp_mbedtls_reactor_add
+ */
+typedef void (*esp_mbedtls_conn_cb_t)(esp_mbedtls_conn_t *conn, esp_mbedtls_event_t event, int err, void *arg);
+
+/**
+ * @brief One TLS connection served by a reactor, owned by the caller
+ */
+struct esp_mbedtls_conn {
+    mbedtls_ssl_context *ssl;       /*!< SSL context, set up with mbedtls_ssl_setup */
+    mbedtls_net_context *net;       /*!< connected socket */
+    esp_mbedtls_conn_cb_t cb;       /*!< event callback */
+    void *arg;                      /*!< callback argument */
+
+    /* private */
+    struct esp_mbedtls_conn *next;
+    uint8_t handshake;
+    uint8_t want_write;
+};
+
+/**
+ * @brief Reactor multiplexing the sockets of several TLS connections
+ */
+typedef struct {
+    esp_mbedtls_conn_t *conns;      /*!< registered connections */
+
+    /* private */
+    esp_mbedtls_conn_t *current;
+    esp_mbedtls_conn_t *cursor;
+} esp_mbedtls_reactor_t;
+
+/**
+ * @brief Initialize a reactor without connections
+ */
+void esp_mbedtls_reactor_init(esp_mbedtls_reactor_t *reactor);
+
+/**
+ * @brief Serve a TLS connection from a reactor
+ *
+ * The socket is switched to non-blocking mode and the BIO callbacks of the SSL
+ * context are replaced, so that mbedtls_ssl_* calls never wait: they return
+ * MBEDTLS_ERR_SSL_WANT_READ or MBEDTLS_ERR_SSL_WANT_WRITE and the reactor
+ * reports the connection again once its socket is ready. If the handshake is
+ * not done yet the reactor drives it and reports ESP_MBEDTLS_EVENT_CONNECTED.
+ *
+ * The reactor, its connections and their SSL contexts are not thread-safe and
+ * must only be used by the task calling esp_mbedtls_reactor_poll, callbacks
+ * included.
+ *
+ * @param reactor reactor
+ * @param conn    connection storage, valid until removed
+ * @param ssl     SSL context
+ * @param net     connected socket
+ * @param cb      event callback
+ * @param arg     callback argument
+ *
+ * @return 0 on success, MBEDTLS_ERR_NET_INVALID_CONTEXT if the socket is not valid
+ */
+int esp_mbedtls_reactor_add(esp_mbedtls_reactor_t *reactor, esp_mbedtls_conn_t *conn,
+                            mbedtls_ssl_context *ssl, mbedtls_net_context *net,
+                            esp_mbedtls_conn_cb_t cb, void *arg);
+
+/**
+ * @brief Stop serving a connection
+ *
+ * May be called from any callback, typically when mbedtls_ssl_read returns 0 or
+ * an error, and the connection storage may be freed right after. The SSL context
+ * goes back to mbedtls_net_send/mbedtls_net_recv; the socket stays non-blocking.
+ * Freeing the SSL context and the socket is up to the caller.
+ */
+void esp_mbedtls_reactor_remove(esp_mbedtls_reactor_t *reactor, esp_mbedtls_conn_t *conn);
+
+/**
+ * @brief Wait for socket activity and dispatch events
+ *
+ * All registered sockets are waited for with a single select() call, then every
+ * ready connection is handled: handshake steps are run and callbacks are called.
+ * Data already decrypted but not read by a READABLE callback is reported again
+ * without waiting.
+ *
+ * @param reactor    reactor
+ * @param timeout_ms longest time to wait, 0 to only check
+ *
+ * @return number of events dispatched, 0 on timeout, MBEDTLS_ERR_NET_RECV_FAILED
+ *         if select() failed
+ */
+int esp_mbedtls_reactor_poll(esp_mbedtls_reactor_t *reactor, uint32_t timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ESP_MBEDTLS_REACTOR_H_ */
@@ -30,7 +30,10 @@
                     read, send, pending, \
                     set_fd, get_fd, \
                     get_verify_result, \
-                    get_state) \
+                    get_state, \
+                    ctx_new, ctx_free, \
+                    get_session, set_session, session_free, \
+                    session_reused, set_hostname) \
         static const SSL_METHOD_FUNC func_name = { \
                 new, \
                 free, \
@@ -43,7 +46,14 @@
                 set_fd, \
                 get_fd, \
                 get_verify_result, \
-                get_state \
+                get_state, \
+                ctx_new, \
+                ctx_free, \
+                get_session, \
+                set_session, \
+                session_free, \
+                session_reused, \
+                set_hostname \
         };
 
 #define IMPLEMENT_TLS_METHOD(ver, mode, fun, func_name) \
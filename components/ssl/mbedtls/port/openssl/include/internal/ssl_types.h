@@ -136,6 +136,11 @@ struct ssl_session_st {
     long time;
 
     X509 *peer;
+
+    const SSL_METHOD *method;
+
+    /* SSL session low-level system arch point */
+    void *session_pm;
 };
 
 struct X509_VERIFY_PARAM_st {
@@ -171,6 +176,9 @@ struct ssl_ctx_st
     int read_ahead;
 
     X509_VERIFY_PARAM param;
+
+    /* SSL context low-level system arch point */
+    void *ctx_pm;
 };
 
 struct ssl_st
@@ -251,6 +259,20 @@ struct ssl_method_func_st {
     long (*ssl_get_verify_result)(const SSL *ssl);
 
     OSSL_HANDSHAKE_STATE (*ssl_get_state)(const SSL *ssl);
+
+    int (*ssl_ctx_new)(SSL_CTX *ctx);
+
+    void (*ssl_ctx_free)(SSL_CTX *ctx);
+
+    int (*ssl_get_session)(SSL *ssl, SSL_SESSION *session);
+
+    int (*ssl_set_session)(SSL *ssl, SSL_SESSION *session);
+
+    void (*ssl_session_free)(SSL_SESSION *session);
+
+    int (*ssl_session_reused)(const SSL *ssl);
+
+    int (*ssl_set_hostname)(SSL *ssl, const char *hostname);
 };
 
 struct x509_method_st {
@@ -1682,6 +1682,62 @@ void SSL_set_time(SSL *ssl, long t);
  */
 void SSL_set_timeout(SSL *ssl, long t);
 
+/**
+ * @brief get a copy of the session negotiated by the SSL, which can be used to resume it
+ *        on a later connection with SSL_set_session
+ *
+ * @param ssl - SSL point
+ *
+ * @return session point, free it with SSL_SESSION_free; NULL if there is no session
+ */
+SSL_SESSION *SSL_get1_session(SSL *ssl);
+
+/**
+ * @brief offer a session saved by SSL_get1_session in the next client handshake
+ *
+ * @param ssl     - SSL point
+ * @param session - session point, the caller keeps its ownership
+ *
+ * @return result
+ *     1 : OK
+ *     0 : failed
+ */
+int SSL_set_session(SSL *ssl, SSL_SESSION *session);
+
+/**
+ * @brief free a session returned by SSL_get1_session
+ *
+ * @param session - session point
+ *
+ * @return none
+ */
+void SSL_SESSION_free(SSL_SESSION *session);
+
+/**
+ * @brief check if the last handshake resumed a session
+ *
+ * @param ssl - SSL point
+ *
+ * @return result
+ *     1 : resumed
+ *     0 : full handshake
+ */
+int SSL_session_reused(SSL *ssl);
+
+/**
+ * @brief set the server name sent in the SNI extension and checked against the server
+ *        certificate; with CONFIG_OPENSSL_SESSION_CACHE_SIZE > 0 it also keys the client
+ *        session cache
+ *
+ * @param ssl  - SSL point
+ * @param name - server host name
+ *
+ * @return result
+ *     1 : OK
+ *     0 : failed
+ */
+int SSL_set_tlsext_host_name(SSL *ssl, const char *name);
+
 /**
  * @brief get SSL statement string
  *
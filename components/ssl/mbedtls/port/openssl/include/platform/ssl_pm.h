@@ -39,6 +39,16 @@ int ssl_pm_get_fd(const SSL *ssl, int mode);
 
 OSSL_HANDSHAKE_STATE ssl_pm_get_state(const SSL *ssl);
 
+int ssl_pm_ctx_new(SSL_CTX *ctx);
+void ssl_pm_ctx_free(SSL_CTX *ctx);
+
+int ssl_pm_get_session(SSL *ssl, SSL_SESSION *session);
+int ssl_pm_set_session(SSL *ssl, SSL_SESSION *session);
+void ssl_pm_session_free(SSL_SESSION *session);
+int ssl_pm_session_reused(const SSL *ssl);
+
+int ssl_pm_set_hostname(SSL *ssl, const char *hostname);
+
 int x509_pm_show_info(X509 *x);
 int x509_pm_new(X509 *x, X509 *m_x);
 void x509_pm_free(X509 *x);
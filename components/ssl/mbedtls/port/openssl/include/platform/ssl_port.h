@@ -20,6 +20,9 @@
 
 #include "esp_system.h"
 #include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 
 #ifdef __cplusplus
  extern "C" {
@@ -35,6 +38,15 @@
 #define ssl_speed_up_enter() rtc_clk_cpu_freq_set(RTC_CPU_FREQ_160M)
 #define ssl_speed_up_exit()  rtc_clk_cpu_freq_set(RTC_CPU_FREQ_80M)
 
+typedef SemaphoreHandle_t ssl_mutex_t;
+
+#define ssl_mutex_new()     xSemaphoreCreateMutex()
+#define ssl_mutex_lock(m)   xSemaphoreTake(m, portMAX_DELAY)
+#define ssl_mutex_unlock(m) xSemaphoreGive(m)
+#define ssl_mutex_free(m)   vSemaphoreDelete(m)
+
+#define ssl_get_time_ms()   (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
 #define SSL_DEBUG_LOG printf
 
 #endif
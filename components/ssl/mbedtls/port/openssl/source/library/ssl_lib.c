@@ -51,8 +51,13 @@ failed1:
 /**
  * @brief free a new SSL session object
  */
-static void SSL_SESSION_free(SSL_SESSION *session)
+void SSL_SESSION_free(SSL_SESSION *session)
 {
+    SSL_ASSERT3(session);
+
+    if (session->session_pm)
+        SSL_METHOD_CALL(session_free, session);
+
     X509_free(session->peer);
     ssl_mem_free(session);
 }
@@ -203,8 +208,15 @@ SSL_CTX* SSL_CTX_new(const SSL_METHOD *method)
 
     ctx->version = method->version;
 
+    if (SSL_METHOD_CALL(ctx_new, ctx)) {
+        SSL_DEBUG(SSL_LIB_ERROR_LEVEL, "SSL_METHOD_CALL(ctx_new) failed");
+        goto failed4;
+    }
+
     return ctx;
 
+failed4:
+    ssl_mem_free(ctx);
 failed3:
     ssl_cert_free(cert);
 failed2:
@@ -220,6 +232,8 @@ void SSL_CTX_free(SSL_CTX* ctx)
 {
     SSL_ASSERT3(ctx);
 
+    SSL_METHOD_CALL(ctx_free, ctx);
+
     ssl_cert_free(ctx->cert);
 
     X509_free(ctx->client_CA);
@@ -463,7 +477,7 @@ int SSL_write(SSL *ssl, const void *buffer, int len)
         else
             bytes = send_bytes;
 
-        ret = SSL_METHOD_CALL(send, ssl, buffer, bytes);
+        ret = SSL_METHOD_CALL(send, ssl, pbuf, bytes);
         if (ret > 0) {
             pbuf += ret;
             send_bytes -= ret;
@@ -1462,6 +1476,69 @@ long SSL_set_timeout(SSL *ssl, long t)
     return t;
 }
 
+/**
+ * @brief get a copy of the SSL session
+ */
+SSL_SESSION *SSL_get1_session(SSL *ssl)
+{
+    SSL_SESSION *session;
+
+    SSL_ASSERT2(ssl);
+
+    session = SSL_SESSION_new();
+    if (!session) {
+        SSL_DEBUG(SSL_LIB_ERROR_LEVEL, "SSL_SESSION_new() return NULL");
+        return NULL;
+    }
+
+    session->method = ssl->method;
+    session->time = ssl->session->time;
+    session->timeout = ssl->session->timeout;
+
+    if (SSL_METHOD_CALL(get_session, ssl, session)) {
+        SSL_DEBUG(SSL_LIB_ERROR_LEVEL, "SSL_METHOD_CALL(get_session) failed");
+        SSL_SESSION_free(session);
+        return NULL;
+    }
+
+    return session;
+}
+
+/**
+ * @brief set the session the SSL tries to resume
+ */
+int SSL_set_session(SSL *ssl, SSL_SESSION *session)
+{
+    SSL_ASSERT1(ssl);
+    SSL_ASSERT1(session);
+
+    if (!session->session_pm)
+        return 0;
+
+    return SSL_METHOD_CALL(set_session, ssl, session) ? 0 : 1;
+}
+
+/**
+ * @brief check if the SSL session was resumed
+ */
+int SSL_session_reused(SSL *ssl)
+{
+    SSL_ASSERT1(ssl);
+
+    return SSL_METHOD_CALL(session_reused, ssl);
+}
+
+/**
+ * @brief set the server name of the SSL
+ */
+int SSL_set_tlsext_host_name(SSL *ssl, const char *name)
+{
+    SSL_ASSERT1(ssl);
+    SSL_ASSERT1(name);
+
+    return SSL_METHOD_CALL(set_hostname, ssl, name) ? 0 : 1;
+}
+
 /**
  * @brief get the verifying result of the SSL certification
  */
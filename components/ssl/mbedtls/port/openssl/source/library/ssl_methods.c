@@ -24,7 +24,10 @@ IMPLEMENT_TLS_METHOD_FUNC(TLS_method_func,
         ssl_pm_read, ssl_pm_send, ssl_pm_pending,
         ssl_pm_set_fd, ssl_pm_get_fd,
         ssl_pm_get_verify_result,
-        ssl_pm_get_state);
+        ssl_pm_get_state,
+        ssl_pm_ctx_new, ssl_pm_ctx_free,
+        ssl_pm_get_session, ssl_pm_set_session, ssl_pm_session_free,
+        ssl_pm_session_reused, ssl_pm_set_hostname);
 
 /**
  * TLS or SSL client method collection
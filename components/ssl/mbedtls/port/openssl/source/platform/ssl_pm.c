@@ -25,11 +25,74 @@
 #include "mbedtls/error.h"
 #include "mbedtls/certs.h"
 #include "mbedtls/esp_debug.h"
+#include "mbedtls/ssl_internal.h"
 
 #define X509_INFO_STRING_LENGTH 3072
 #define OPENSSL_READ_BUFFER_LENGTH_MIN 2048
 #define OPENSSL_READ_BUFFER_LENGTH_MAX 8192
 
+struct ssl_session_cache
+{
+    /* server host name for client sessions, NULL for server sessions */
+    char *host;
+
+    mbedtls_ssl_session session;
+
+    /* DER of the peer certification of server sessions, the session holds none */
+    unsigned char *peer_cert;
+
+    size_t peer_cert_len;
+
+    uint32_t stamp;
+
+    int used;
+};
+
+/* SSL configuration shared by the SSL objects of a context with the same settings */
+struct ssl_conf_pm
+{
+    mbedtls_ssl_config conf;
+
+    int endpoint;
+
+    int version;
+
+    /* certification settings, applied by the first handshake using "conf" */
+    int crt_ready;
+
+    int authmode;
+
+    mbedtls_x509_crt *ca_crt;
+
+    mbedtls_x509_crt *own_crt;
+
+    mbedtls_pk_context *own_pkey;
+
+    /* SSL objects using it, plus one while the context gives it to new SSL objects */
+    int refs;
+};
+
+struct ssl_ctx_pm
+{
+    mbedtls_entropy_context entropy;
+
+    mbedtls_ctr_drbg_context ctr_drbg;
+
+    /* configuration of the latest settings, NULL until the first SSL object */
+    struct ssl_conf_pm *conf;
+
+    /* protects ctr_drbg, the configurations and the session cache */
+    ssl_mutex_t mutex;
+
+    SSL_CTX *ctx;
+
+#if CONFIG_OPENSSL_SESSION_CACHE_SIZE > 0
+    struct ssl_session_cache cache[CONFIG_OPENSSL_SESSION_CACHE_SIZE];
+
+    uint32_t cache_stamp;
+#endif
+};
+
 struct ssl_pm
 {
     /* local socket file description */
@@ -37,13 +100,18 @@ struct ssl_pm
     /* remote client socket file description */
     mbedtls_net_context cl_fd;
 
-    mbedtls_ssl_config conf;
-
-    mbedtls_ctr_drbg_context ctr_drbg;
+    /* configuration in use, shared with the other SSL objects of the context */
+    struct ssl_conf_pm *conf;
 
     mbedtls_ssl_context ssl;
 
-    mbedtls_entropy_context entropy;
+    /* SSL_set_session was called */
+    int session_set;
+
+    /* result and duration of the last handshake */
+    int resumed;
+
+    uint32_t handshake_ms;
 };
 
 struct x509_pm
@@ -64,76 +132,489 @@ struct pkey_pm
 /************************************ SSL arch interface *************************************/
 
 /**
- * @brief create SSL low-level object
+ * @brief random function of the context DRBG, which is shared by all its SSL objects
  */
-int ssl_pm_new(SSL *ssl)
+static int ssl_pm_random(void *p_rng, unsigned char *output, size_t output_len)
 {
-    struct ssl_pm *ssl_pm;
     int ret;
+    struct ssl_ctx_pm *ctx_pm = (struct ssl_ctx_pm *)p_rng;
 
-    const unsigned char pers[] = "OpenSSL PM";
-    size_t pers_len = sizeof(pers);
+    ssl_mutex_lock(ctx_pm->mutex);
+    ret = mbedtls_ctr_drbg_random(&ctx_pm->ctr_drbg, output, output_len);
+    ssl_mutex_unlock(ctx_pm->mutex);
 
-    int endpoint;
-    int version;
+    return ret;
+}
 
-    const SSL_METHOD *method = ssl->method;
+#if CONFIG_OPENSSL_SESSION_CACHE_SIZE > 0
+/**
+ * @brief pick the cache entry of the host, or the least recently used one
+ */
+static struct ssl_session_cache *ssl_pm_cache_slot(struct ssl_ctx_pm *ctx_pm, const char *host,
+                                                   const mbedtls_ssl_session *session)
+{
+    int i;
+    struct ssl_session_cache *cache, *slot = &ctx_pm->cache[0];
+
+    for (i = 0; i < CONFIG_OPENSSL_SESSION_CACHE_SIZE; i++) {
+        cache = &ctx_pm->cache[i];
+
+        if (cache->used) {
+            if (host && cache->host && !strcmp(cache->host, host))
+                return cache;
+            if (!host && !cache->host && cache->session.id_len == session->id_len &&
+                !memcmp(cache->session.id, session->id, session->id_len))
+                return cache;
+        }
 
-    ssl_pm = ssl_mem_zalloc(sizeof(struct ssl_pm));
-    if (!ssl_pm) {
-        SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "no enough memory > (ssl_pm)");
+        if (slot->used && (!cache->used || (int32_t)(cache->stamp - slot->stamp) < 0))
+            slot = cache;
+    }
+
+    return slot;
+}
+
+static void ssl_pm_cache_clear(struct ssl_session_cache *cache)
+{
+    if (cache->host) {
+        mbedtls_ssl_session_free(&cache->session);
+        ssl_mem_free(cache->host);
+    }
+    if (cache->peer_cert)
+        ssl_mem_free(cache->peer_cert);
+    memset(cache, 0, sizeof(struct ssl_session_cache));
+}
+
+static int ssl_pm_cache_expired(struct ssl_ctx_pm *ctx_pm, const mbedtls_ssl_session *session)
+{
+#if defined(MBEDTLS_HAVE_TIME)
+    long timeout = ctx_pm->ctx->session_timeout;
+
+    return timeout > 0 && mbedtls_time(NULL) - session->start > timeout;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief server session cache: look up the session ID the client offers
+ */
+static int ssl_pm_cache_get(void *data, mbedtls_ssl_session *session)
+{
+    int i, ret = -1;
+    struct ssl_ctx_pm *ctx_pm = (struct ssl_ctx_pm *)data;
+
+    ssl_mutex_lock(ctx_pm->mutex);
+
+    for (i = 0; i < CONFIG_OPENSSL_SESSION_CACHE_SIZE; i++) {
+        struct ssl_session_cache *cache = &ctx_pm->cache[i];
+
+        if (!cache->used || cache->host ||
+            cache->session.ciphersuite != session->ciphersuite ||
+            cache->session.compression != session->compression ||
+            cache->session.id_len != session->id_len ||
+            memcmp(cache->session.id, session->id, session->id_len))
+            continue;
+
+        if (ssl_pm_cache_expired(ctx_pm, &cache->session)) {
+            ssl_pm_cache_clear(cache);
+            break;
+        }
+
+        memcpy(session->master, cache->session.master, sizeof(session->master));
+        session->verify_result = cache->session.verify_result;
+
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+        /* restore the peer certification, without the rest of its chain */
+        if (cache->peer_cert) {
+            session->peer_cert = ssl_mem_malloc(sizeof(mbedtls_x509_crt));
+            if (!session->peer_cert) {
+                SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "no enough memory > (peer_cert)");
+                break;
+            }
+
+            mbedtls_x509_crt_init(session->peer_cert);
+            if (mbedtls_x509_crt_parse_der(session->peer_cert, cache->peer_cert, cache->peer_cert_len)) {
+                mbedtls_x509_crt_free(session->peer_cert);
+                ssl_mem_free(session->peer_cert);
+                session->peer_cert = NULL;
+                break;
+            }
+        }
+#endif
+
+        cache->stamp = ++ctx_pm->cache_stamp;
+        ret = 0;
+        break;
+    }
+
+    ssl_mutex_unlock(ctx_pm->mutex);
+
+    return ret;
+}
+
+/**
+ * @brief server session cache: save the negotiated session, with the DER of the peer certification
+ */
+static int ssl_pm_cache_set(void *data, const mbedtls_ssl_session *session)
+{
+    struct ssl_session_cache *cache;
+    struct ssl_ctx_pm *ctx_pm = (struct ssl_ctx_pm *)data;
+    unsigned char *peer_cert = NULL;
+    size_t peer_cert_len = 0;
+
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+    if (session->peer_cert) {
+        peer_cert_len = session->peer_cert->raw.len;
+        peer_cert = ssl_mem_malloc(peer_cert_len);
+        if (!peer_cert) {
+            SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "no enough memory > (peer_cert)");
+            return 1;
+        }
+        memcpy(peer_cert, session->peer_cert->raw.p, peer_cert_len);
+    }
+#endif
+
+    ssl_mutex_lock(ctx_pm->mutex);
+
+    cache = ssl_pm_cache_slot(ctx_pm, NULL, session);
+    ssl_pm_cache_clear(cache);
+
+    memcpy(&cache->session, session, sizeof(mbedtls_ssl_session));
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+    cache->session.peer_cert = NULL;
+#endif
+    cache->peer_cert = peer_cert;
+    cache->peer_cert_len = peer_cert_len;
+#if defined(MBEDTLS_SSL_SESSION_TICKETS) && defined(MBEDTLS_SSL_CLI_C)
+    cache->session.ticket = NULL;
+    cache->session.ticket_len = 0;
+#endif
+    cache->stamp = ++ctx_pm->cache_stamp;
+    cache->used = 1;
+
+    ssl_mutex_unlock(ctx_pm->mutex);
+
+    return 0;
+}
+
+/**
+ * @brief client session cache: offer the last session with the same server
+ */
+static void ssl_pm_cache_load(struct ssl_ctx_pm *ctx_pm, mbedtls_ssl_context *ssl)
+{
+    struct ssl_session_cache *cache;
+
+    ssl_mutex_lock(ctx_pm->mutex);
+
+    cache = ssl_pm_cache_slot(ctx_pm, ssl->hostname, NULL);
+    if (cache->used && cache->host && !strcmp(cache->host, ssl->hostname)) {
+        if (ssl_pm_cache_expired(ctx_pm, &cache->session)) {
+            ssl_pm_cache_clear(cache);
+        } else if (!mbedtls_ssl_set_session(ssl, &cache->session)) {
+            cache->stamp = ++ctx_pm->cache_stamp;
+        }
+    }
+
+    ssl_mutex_unlock(ctx_pm->mutex);
+}
+
+/**
+ * @brief client session cache: save the session negotiated with the server
+ */
+static void ssl_pm_cache_save(struct ssl_ctx_pm *ctx_pm, const mbedtls_ssl_context *ssl)
+{
+    int ret;
+    char *host;
+    mbedtls_ssl_session session;
+    struct ssl_session_cache *cache;
+
+    host = ssl_mem_malloc(ssl_strlen(ssl->hostname) + 1);
+    if (!host) {
+        SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "no enough memory > (host)");
+        return ;
+    }
+    strcpy(host, ssl->hostname);
+
+    /* copying the peer certification takes a while, do it unlocked */
+    mbedtls_ssl_session_init(&session);
+    ret = mbedtls_ssl_get_session(ssl, &session);
+    if (ret) {
+        SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "mbedtls_ssl_get_session() return -0x%x", -ret);
+        mbedtls_ssl_session_free(&session);
+        ssl_mem_free(host);
+        return ;
+    }
+
+    ssl_mutex_lock(ctx_pm->mutex);
+
+    cache = ssl_pm_cache_slot(ctx_pm, host, NULL);
+    ssl_pm_cache_clear(cache);
+
+    cache->host = host;
+    memcpy(&cache->session, &session, sizeof(mbedtls_ssl_session));
+    cache->stamp = ++ctx_pm->cache_stamp;
+    cache->used = 1;
+
+    ssl_mutex_unlock(ctx_pm->mutex);
+}
+#endif
+
+/**
+ * @brief drop a reference to an SSL configuration, the context mutex must be held
+ */
+static void ssl_pm_conf_put(struct ssl_conf_pm *conf_pm)
+{
+    if (--conf_pm->refs)
+        return ;
+
+    mbedtls_ssl_config_free(&conf_pm->conf);
+    ssl_mem_free(conf_pm);
+}
+
+/**
+ * @brief create SSL context low-level object, which seeds the DRBG once for all its SSL objects
+ */
+int ssl_pm_ctx_new(SSL_CTX *ctx)
+{
+    struct ssl_ctx_pm *ctx_pm;
+    int ret;
+
+    const unsigned char pers[] = "OpenSSL PM";
+    size_t pers_len = sizeof(pers);
+
+    ctx_pm = ssl_mem_zalloc(sizeof(struct ssl_ctx_pm));
+    if (!ctx_pm) {
+        SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "no enough memory > (ctx_pm)");
         goto no_mem;
     }
 
-    mbedtls_net_init(&ssl_pm->fd);
-    mbedtls_net_init(&ssl_pm->cl_fd);
+    ctx_pm->mutex = ssl_mutex_new();
+    if (!ctx_pm->mutex) {
+        SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "no enough memory > (mutex)");
+        goto failed1;
+    }
 
-    mbedtls_ssl_config_init(&ssl_pm->conf);
-    mbedtls_ctr_drbg_init(&ssl_pm->ctr_drbg);
-    mbedtls_entropy_init(&ssl_pm->entropy);
-    mbedtls_ssl_init(&ssl_pm->ssl);
+    mbedtls_ctr_drbg_init(&ctx_pm->ctr_drbg);
+    mbedtls_entropy_init(&ctx_pm->entropy);
 
-    ret = mbedtls_ctr_drbg_seed(&ssl_pm->ctr_drbg, mbedtls_entropy_func, &ssl_pm->entropy, pers, pers_len);
+    ret = mbedtls_ctr_drbg_seed(&ctx_pm->ctr_drbg, mbedtls_entropy_func, &ctx_pm->entropy, pers, pers_len);
     if (ret) {
         SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "mbedtls_ctr_drbg_seed() return -0x%x", -ret);
-        goto mbedtls_err1;
+        goto failed2;
     }
 
-    if (method->endpoint) {
-        endpoint = MBEDTLS_SSL_IS_SERVER;
-    } else {
-        endpoint = MBEDTLS_SSL_IS_CLIENT;
-    }
-    ret = mbedtls_ssl_config_defaults(&ssl_pm->conf, endpoint, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+    ctx_pm->ctx = ctx;
+    ctx->ctx_pm = ctx_pm;
+
+    return 0;
+
+failed2:
+    mbedtls_ctr_drbg_free(&ctx_pm->ctr_drbg);
+    mbedtls_entropy_free(&ctx_pm->entropy);
+    ssl_mutex_free(ctx_pm->mutex);
+failed1:
+    ssl_mem_free(ctx_pm);
+no_mem:
+    return -1;
+}
+
+/**
+ * @brief free SSL context low-level object
+ */
+void ssl_pm_ctx_free(SSL_CTX *ctx)
+{
+    struct ssl_ctx_pm *ctx_pm = (struct ssl_ctx_pm *)ctx->ctx_pm;
+
+#if CONFIG_OPENSSL_SESSION_CACHE_SIZE > 0
+    int i;
+
+    for (i = 0; i < CONFIG_OPENSSL_SESSION_CACHE_SIZE; i++)
+        ssl_pm_cache_clear(&ctx_pm->cache[i]);
+#endif
+
+    if (ctx_pm->conf)
+        ssl_pm_conf_put(ctx_pm->conf);
+    mbedtls_ctr_drbg_free(&ctx_pm->ctr_drbg);
+    mbedtls_entropy_free(&ctx_pm->entropy);
+    ssl_mutex_free(ctx_pm->mutex);
+
+    ssl_mem_free(ctx_pm);
+    ctx->ctx_pm = NULL;
+}
+
+/**
+ * @brief set up an SSL configuration for the given endpoint and protocol version
+ */
+static int ssl_pm_conf_setup(mbedtls_ssl_config *conf, struct ssl_ctx_pm *ctx_pm, int endpoint, int ssl_version)
+{
+    int ret;
+    int version;
+
+    ret = mbedtls_ssl_config_defaults(conf, endpoint, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
     if (ret) {
         SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "mbedtls_ssl_config_defaults() return -0x%x", -ret);
-        goto mbedtls_err2;
+        return -1;
     }
 
-    if (TLS_ANY_VERSION != ssl->version) {
-        if (TLS1_2_VERSION == ssl->version)
+    if (TLS_ANY_VERSION != ssl_version) {
+        if (TLS1_2_VERSION == ssl_version)
             version = MBEDTLS_SSL_MINOR_VERSION_3;
-        else if (TLS1_1_VERSION == ssl->version)
+        else if (TLS1_1_VERSION == ssl_version)
             version = MBEDTLS_SSL_MINOR_VERSION_2;
-        else if (TLS1_VERSION == ssl->version)
+        else if (TLS1_VERSION == ssl_version)
             version = MBEDTLS_SSL_MINOR_VERSION_1;
         else
             version = MBEDTLS_SSL_MINOR_VERSION_0;
 
-        mbedtls_ssl_conf_max_version(&ssl_pm->conf, MBEDTLS_SSL_MAJOR_VERSION_3, version);
-        mbedtls_ssl_conf_min_version(&ssl_pm->conf, MBEDTLS_SSL_MAJOR_VERSION_3, version);
+        mbedtls_ssl_conf_max_version(conf, MBEDTLS_SSL_MAJOR_VERSION_3, version);
+        mbedtls_ssl_conf_min_version(conf, MBEDTLS_SSL_MAJOR_VERSION_3, version);
     } else {
-        mbedtls_ssl_conf_max_version(&ssl_pm->conf, MBEDTLS_SSL_MAJOR_VERSION_3, MBEDTLS_SSL_MINOR_VERSION_3);
-        mbedtls_ssl_conf_min_version(&ssl_pm->conf, MBEDTLS_SSL_MAJOR_VERSION_3, MBEDTLS_SSL_MINOR_VERSION_0);
+        mbedtls_ssl_conf_max_version(conf, MBEDTLS_SSL_MAJOR_VERSION_3, MBEDTLS_SSL_MINOR_VERSION_3);
+        mbedtls_ssl_conf_min_version(conf, MBEDTLS_SSL_MAJOR_VERSION_3, MBEDTLS_SSL_MINOR_VERSION_0);
     }
 
-    mbedtls_ssl_conf_rng(&ssl_pm->conf, mbedtls_ctr_drbg_random, &ssl_pm->ctr_drbg);
+    mbedtls_ssl_conf_rng(conf, ssl_pm_random, ctx_pm);
+
+#if CONFIG_OPENSSL_SESSION_CACHE_SIZE > 0
+    if (endpoint == MBEDTLS_SSL_IS_SERVER)
+        mbedtls_ssl_conf_session_cache(conf, ctx_pm, ssl_pm_cache_get, ssl_pm_cache_set);
+#endif
 
 #ifdef CONFIG_MBEDTLS_DEBUG
-    mbedtls_esp_enable_debug_log(&ssl_pm->conf, CONFIG_MBEDTLS_DEBUG_LEVEL);
+    mbedtls_esp_enable_debug_log(conf, CONFIG_MBEDTLS_DEBUG_LEVEL);
 #endif
 
-    ret = mbedtls_ssl_setup(&ssl_pm->ssl, &ssl_pm->conf);
+    return 0;
+}
+
+/**
+ * @brief apply certification settings to an SSL configuration
+ */
+static int ssl_pm_conf_crt(struct ssl_conf_pm *conf_pm, int mode, mbedtls_x509_crt *ca_crt,
+                           mbedtls_x509_crt *own_crt, mbedtls_pk_context *own_pkey)
+{
+    int ret = 0;
+
+    mbedtls_ssl_conf_authmode(&conf_pm->conf, mode);
+
+    if (ca_crt)
+        mbedtls_ssl_conf_ca_chain(&conf_pm->conf, ca_crt, NULL);
+
+    if (own_crt && own_pkey)
+        ret = mbedtls_ssl_conf_own_cert(&conf_pm->conf, own_crt, own_pkey);
+
+    if (ret) {
+        SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "mbedtls_ssl_conf_own_cert() return -0x%x", -ret);
+        return -1;
+    }
+
+    conf_pm->authmode = mode;
+    conf_pm->ca_crt = ca_crt;
+    conf_pm->own_crt = own_crt;
+    conf_pm->own_pkey = own_pkey;
+    conf_pm->crt_ready = 1;
+
+    return 0;
+}
+
+/**
+ * @brief check if an SSL configuration can be used with the given settings
+ */
+static int ssl_pm_conf_match(const struct ssl_conf_pm *conf_pm, int endpoint, int version, int mode,
+                             mbedtls_x509_crt *ca_crt, mbedtls_x509_crt *own_crt, mbedtls_pk_context *own_pkey)
+{
+    if (conf_pm->endpoint != endpoint || conf_pm->version != version)
+        return 0;
+
+    return !conf_pm->crt_ready || (conf_pm->authmode == mode && conf_pm->ca_crt == ca_crt &&
+                                   conf_pm->own_crt == own_crt && conf_pm->own_pkey == own_pkey);
+}
+
+/**
+ * @brief get the configuration new SSL objects of the context use, building one if the
+ *        context has none for these settings yet. The context mutex must be held.
+ */
+static struct ssl_conf_pm *ssl_pm_conf_get(struct ssl_ctx_pm *ctx_pm, int endpoint, int version, int mode,
+                                           mbedtls_x509_crt *ca_crt, mbedtls_x509_crt *own_crt,
+                                           mbedtls_pk_context *own_pkey)
+{
+    struct ssl_conf_pm *conf_pm = ctx_pm->conf;
+
+    if (!conf_pm || !ssl_pm_conf_match(conf_pm, endpoint, version, mode, ca_crt, own_crt, own_pkey)) {
+        /* the context settings changed, the SSL objects of the old ones keep their configuration */
+        conf_pm = ssl_mem_zalloc(sizeof(struct ssl_conf_pm));
+        if (!conf_pm) {
+            SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "no enough memory > (conf_pm)");
+            return NULL;
+        }
+
+        mbedtls_ssl_config_init(&conf_pm->conf);
+        if (ssl_pm_conf_setup(&conf_pm->conf, ctx_pm, endpoint, version)) {
+            mbedtls_ssl_config_free(&conf_pm->conf);
+            ssl_mem_free(conf_pm);
+            return NULL;
+        }
+        conf_pm->endpoint = endpoint;
+        conf_pm->version = version;
+
+        if (ctx_pm->conf)
+            ssl_pm_conf_put(ctx_pm->conf);
+        ctx_pm->conf = conf_pm;
+        conf_pm->refs = 1;
+    }
+
+    conf_pm->refs++;
+
+    return conf_pm;
+}
+
+/**
+ * @brief create SSL low-level object
+ */
+int ssl_pm_new(SSL *ssl)
+{
+    struct ssl_pm *ssl_pm;
+    struct ssl_ctx_pm *ctx_pm = (struct ssl_ctx_pm *)ssl->ctx->ctx_pm;
+    int ret;
+
+    int endpoint;
+
+    const SSL_METHOD *method = ssl->method;
+
+    ssl_pm = ssl_mem_zalloc(sizeof(struct ssl_pm));
+    if (!ssl_pm) {
+        SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "no enough memory > (ssl_pm)");
+        goto no_mem;
+    }
+
+    mbedtls_net_init(&ssl_pm->fd);
+    mbedtls_net_init(&ssl_pm->cl_fd);
+
+    mbedtls_ssl_init(&ssl_pm->ssl);
+
+    if (method->endpoint) {
+        endpoint = MBEDTLS_SSL_IS_SERVER;
+    } else {
+        endpoint = MBEDTLS_SSL_IS_CLIENT;
+    }
+
+    ssl->ssl_pm = ssl_pm;
+
+    /* the certification settings are only known at the handshake, any configuration will do */
+    ssl_mutex_lock(ctx_pm->mutex);
+    if (ctx_pm->conf && ctx_pm->conf->endpoint == endpoint && ctx_pm->conf->version == ssl->version) {
+        ssl_pm->conf = ctx_pm->conf;
+        ssl_pm->conf->refs++;
+    } else {
+        ssl_pm->conf = ssl_pm_conf_get(ctx_pm, endpoint, ssl->version, 0, NULL, NULL, NULL);
+    }
+    ssl_mutex_unlock(ctx_pm->mutex);
+
+    if (!ssl_pm->conf)
+        goto mbedtls_err1;
+
+    ret = mbedtls_ssl_setup(&ssl_pm->ssl, &ssl_pm->conf->conf);
     if (ret) {
         SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "mbedtls_ssl_setup() return -0x%x", -ret);
         goto mbedtls_err2;
@@ -141,16 +622,16 @@ int ssl_pm_new(SSL *ssl)
 
     mbedtls_ssl_set_bio(&ssl_pm->ssl, &ssl_pm->fd, mbedtls_net_send, mbedtls_net_recv, NULL);
 
-    ssl->ssl_pm = ssl_pm;
-
     return 0;
 
 mbedtls_err2:
-    mbedtls_ssl_config_free(&ssl_pm->conf);
-    mbedtls_ctr_drbg_free(&ssl_pm->ctr_drbg);
+    ssl_mutex_lock(ctx_pm->mutex);
+    ssl_pm_conf_put(ssl_pm->conf);
+    ssl_mutex_unlock(ctx_pm->mutex);
 mbedtls_err1:
-    mbedtls_entropy_free(&ssl_pm->entropy);
+    mbedtls_ssl_free(&ssl_pm->ssl);
     ssl_mem_free(ssl_pm);
+    ssl->ssl_pm = NULL;
 no_mem:
     return -1;
 }
@@ -161,29 +642,88 @@ no_mem:
 void ssl_pm_free(SSL *ssl)
 {
     struct ssl_pm *ssl_pm = (struct ssl_pm *)ssl->ssl_pm;
+    struct ssl_ctx_pm *ctx_pm = (struct ssl_ctx_pm *)ssl->ctx->ctx_pm;
 
-    mbedtls_ctr_drbg_free(&ssl_pm->ctr_drbg);
-    mbedtls_entropy_free(&ssl_pm->entropy);
-    mbedtls_ssl_config_free(&ssl_pm->conf);
     mbedtls_ssl_free(&ssl_pm->ssl);
 
+    ssl_mutex_lock(ctx_pm->mutex);
+    ssl_pm_conf_put(ssl_pm->conf);
+    ssl_mutex_unlock(ctx_pm->mutex);
+
     ssl_mem_free(ssl_pm);
     ssl->ssl_pm = NULL;
 }
 
+/**
+ * @brief set the SSL low-level context up again on another configuration, the
+ *        host name and the session to resume are kept
+ */
+static int ssl_pm_setup_again(struct ssl_pm *ssl_pm, struct ssl_conf_pm *conf_pm)
+{
+    int ret;
+    char *hostname;
+    mbedtls_ssl_session *session = NULL;
+
+    /* take them out of the context so that freeing it leaves them alone */
+    hostname = ssl_pm->ssl.hostname;
+    ssl_pm->ssl.hostname = NULL;
+
+    if (ssl_pm->session_set) {
+        session = ssl_pm->ssl.session_negotiate;
+        ssl_pm->ssl.session_negotiate = NULL;
+    }
+
+    mbedtls_ssl_free(&ssl_pm->ssl);
+    mbedtls_ssl_init(&ssl_pm->ssl);
+
+    ret = mbedtls_ssl_setup(&ssl_pm->ssl, &conf_pm->conf);
+    if (ret) {
+        SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "mbedtls_ssl_setup() return -0x%x", -ret);
+        goto out;
+    }
+
+    mbedtls_ssl_set_bio(&ssl_pm->ssl, &ssl_pm->fd, mbedtls_net_send, mbedtls_net_recv, NULL);
+
+    if (hostname) {
+        ret = mbedtls_ssl_set_hostname(&ssl_pm->ssl, hostname);
+        if (ret) {
+            SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "mbedtls_ssl_set_hostname() return -0x%x", -ret);
+            goto out;
+        }
+    }
+
+    if (session) {
+        ret = mbedtls_ssl_set_session(&ssl_pm->ssl, session);
+        if (ret)
+            SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "mbedtls_ssl_set_session() return -0x%x", -ret);
+    }
+
+out:
+    mbedtls_free(hostname);
+    mbedtls_ssl_session_free(session);
+    mbedtls_free(session);
+
+    return ret;
+}
+
 /**
  * @brief reload SSL low-level certification object
  */
 static int ssl_pm_reload_crt(SSL *ssl)
 {
-    int ret;
+    int ret = 0;
     int mode;
     struct ssl_pm *ssl_pm = ssl->ssl_pm;
+    struct ssl_ctx_pm *ctx_pm = (struct ssl_ctx_pm *)ssl->ctx->ctx_pm;
+    struct ssl_conf_pm *conf_pm = ssl_pm->conf;
     struct x509_pm *ca_pm = (struct x509_pm *)ssl->client_CA->x509_pm;
 
     struct pkey_pm *pkey_pm = (struct pkey_pm *)ssl->cert->pkey->pkey_pm;
     struct x509_pm *crt_pm = (struct x509_pm *)ssl->cert->x509->x509_pm;
 
+    mbedtls_x509_crt *ca_crt, *own_crt;
+    mbedtls_pk_context *own_pkey;
+
     if (ssl->verify_mode == SSL_VERIFY_PEER)
         mode = MBEDTLS_SSL_VERIFY_REQUIRED;
     else if (ssl->verify_mode == SSL_VERIFY_FAIL_IF_NO_PEER_CERT)
@@ -193,25 +733,50 @@ static int ssl_pm_reload_crt(SSL *ssl)
     else
         mode = MBEDTLS_SSL_VERIFY_NONE;
 
-    mbedtls_ssl_conf_authmode(&ssl_pm->conf, mode);
-
-    if (ca_pm->x509_crt) {
-        mbedtls_ssl_conf_ca_chain(&ssl_pm->conf, ca_pm->x509_crt, NULL);
-    } else if (ca_pm->ex_crt) {
-        mbedtls_ssl_conf_ca_chain(&ssl_pm->conf, ca_pm->ex_crt, NULL);
-    }
+    if (ca_pm->x509_crt)
+        ca_crt = ca_pm->x509_crt;
+    else
+        ca_crt = ca_pm->ex_crt;
 
     if (crt_pm->x509_crt && pkey_pm->pkey) {
-        ret = mbedtls_ssl_conf_own_cert(&ssl_pm->conf, crt_pm->x509_crt, pkey_pm->pkey);
+        own_crt = crt_pm->x509_crt;
+        own_pkey = pkey_pm->pkey;
     } else if (crt_pm->ex_crt && pkey_pm->ex_pkey) {
-        ret = mbedtls_ssl_conf_own_cert(&ssl_pm->conf, crt_pm->ex_crt, pkey_pm->ex_pkey);
+        own_crt = crt_pm->ex_crt;
+        own_pkey = pkey_pm->ex_pkey;
     } else {
-        ret = 0;
+        own_crt = NULL;
+        own_pkey = NULL;
     }
 
-    if (ret) {
-        SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "mbedtls_ssl_conf_own_cert() return -0x%x", -ret);
-        ret = -1;
+    ssl_mutex_lock(ctx_pm->mutex);
+
+    if (!ssl_pm_conf_match(conf_pm, conf_pm->endpoint, conf_pm->version, mode, ca_crt, own_crt, own_pkey)) {
+        /* settings of this SSL differ from the ones of its configuration, take the matching one */
+        conf_pm = ssl_pm_conf_get(ctx_pm, conf_pm->endpoint, conf_pm->version, mode, ca_crt, own_crt, own_pkey);
+        if (!conf_pm)
+            ret = -1;
+    }
+
+    /* the first handshake using a configuration decides its certification settings */
+    if (!ret && !conf_pm->crt_ready)
+        ret = ssl_pm_conf_crt(conf_pm, mode, ca_crt, own_crt, own_pkey);
+
+    ssl_mutex_unlock(ctx_pm->mutex);
+
+    if (conf_pm && conf_pm != ssl_pm->conf) {
+        struct ssl_conf_pm *old_pm = conf_pm;
+
+        if (!ret) {
+            ret = ssl_pm_setup_again(ssl_pm, conf_pm);
+            /* the context has left its old configuration even if setting it up failed */
+            old_pm = ssl_pm->conf;
+            ssl_pm->conf = conf_pm;
+        }
+
+        ssl_mutex_lock(ctx_pm->mutex);
+        ssl_pm_conf_put(old_pm);
+        ssl_mutex_unlock(ctx_pm->mutex);
     }
 
     return ret;
@@ -221,7 +786,7 @@ static int ssl_pm_reload_crt(SSL *ssl)
  * Perform the mbedtls SSL handshake instead of mbedtls_ssl_handshake.
  * We can add debug here.
  */
-static int mbedtls_handshake( mbedtls_ssl_context *ssl )
+static int mbedtls_handshake( mbedtls_ssl_context *ssl, int *resumed )
 {
     int ret = 0;
 
@@ -230,6 +795,9 @@ static int mbedtls_handshake( mbedtls_ssl_context *ssl )
 
         SSL_DEBUG(SSL_PLATFORM_DEBUG_LEVEL, "ssl ret %d state %d", ret, ssl->state);
 
+        if (ssl->handshake)
+            *resumed = ssl->handshake->resume;
+
         if (ret != 0)
             break;
     }
@@ -240,15 +808,27 @@ static int mbedtls_handshake( mbedtls_ssl_context *ssl )
 int ssl_pm_handshake(SSL *ssl)
 {
     int ret;
+    uint32_t start;
     struct ssl_pm *ssl_pm = (struct ssl_pm *)ssl->ssl_pm;
+#if CONFIG_OPENSSL_SESSION_CACHE_SIZE > 0
+    struct ssl_ctx_pm *ctx_pm = (struct ssl_ctx_pm *)ssl->ctx->ctx_pm;
+#endif
 
     ret = ssl_pm_reload_crt(ssl);
     if (ret)
         return 0;
 
+#if CONFIG_OPENSSL_SESSION_CACHE_SIZE > 0
+    if (ssl_pm->ssl.conf->endpoint == MBEDTLS_SSL_IS_CLIENT && ssl_pm->ssl.hostname && !ssl_pm->session_set)
+        ssl_pm_cache_load(ctx_pm, &ssl_pm->ssl);
+#endif
+
+    ssl_pm->resumed = 0;
+    start = ssl_get_time_ms();
+
     ssl_speed_up_enter();
 
-    while((ret = mbedtls_handshake(&ssl_pm->ssl)) != 0) {
+    while((ret = mbedtls_handshake(&ssl_pm->ssl, &ssl_pm->resumed)) != 0) {
         if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
            break;
         }
@@ -256,6 +836,8 @@ int ssl_pm_handshake(SSL *ssl)
 
     ssl_speed_up_exit();
 
+    ssl_pm->handshake_ms = ssl_get_time_ms() - start;
+
     if (ret) {
         SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "mbedtls_ssl_handshake() return -0x%x", -ret);
         ret = 0;
@@ -263,12 +845,91 @@ int ssl_pm_handshake(SSL *ssl)
         struct x509_pm *x509_pm = (struct x509_pm *)ssl->session->peer->x509_pm;
 
         x509_pm->ex_crt = (mbedtls_x509_crt *)mbedtls_ssl_get_peer_cert(&ssl_pm->ssl);
+
+        SSL_DEBUG(SSL_PLATFORM_DEBUG_LEVEL, "%s handshake takes %u ms",
+                  ssl_pm->resumed ? "resumed" : "full", ssl_pm->handshake_ms);
+
+#if CONFIG_OPENSSL_SESSION_CACHE_SIZE > 0
+        if (ssl_pm->ssl.conf->endpoint == MBEDTLS_SSL_IS_CLIENT && ssl_pm->ssl.hostname && !ssl_pm->resumed)
+            ssl_pm_cache_save(ctx_pm, &ssl_pm->ssl);
+#endif
         ret = 1;
     }
 
     return ret;
 }
 
+int ssl_pm_get_session(SSL *ssl, SSL_SESSION *session)
+{
+    int ret;
+    mbedtls_ssl_session *session_pm;
+    struct ssl_pm *ssl_pm = (struct ssl_pm *)ssl->ssl_pm;
+
+    session_pm = ssl_mem_malloc(sizeof(mbedtls_ssl_session));
+    if (!session_pm) {
+        SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "no enough memory > (session_pm)");
+        return -1;
+    }
+
+    mbedtls_ssl_session_init(session_pm);
+    ret = mbedtls_ssl_get_session(&ssl_pm->ssl, session_pm);
+    if (ret) {
+        SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "mbedtls_ssl_get_session() return -0x%x", -ret);
+        mbedtls_ssl_session_free(session_pm);
+        ssl_mem_free(session_pm);
+        return -1;
+    }
+
+    session->session_pm = session_pm;
+
+    return 0;
+}
+
+int ssl_pm_set_session(SSL *ssl, SSL_SESSION *session)
+{
+    int ret;
+    struct ssl_pm *ssl_pm = (struct ssl_pm *)ssl->ssl_pm;
+
+    ret = mbedtls_ssl_set_session(&ssl_pm->ssl, (mbedtls_ssl_session *)session->session_pm);
+    if (ret) {
+        SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "mbedtls_ssl_set_session() return -0x%x", -ret);
+        return -1;
+    }
+
+    ssl_pm->session_set = 1;
+
+    return 0;
+}
+
+void ssl_pm_session_free(SSL_SESSION *session)
+{
+    mbedtls_ssl_session_free((mbedtls_ssl_session *)session->session_pm);
+
+    ssl_mem_free(session->session_pm);
+    session->session_pm = NULL;
+}
+
+int ssl_pm_session_reused(const SSL *ssl)
+{
+    struct ssl_pm *ssl_pm = (struct ssl_pm *)ssl->ssl_pm;
+
+    return ssl_pm->resumed;
+}
+
+int ssl_pm_set_hostname(SSL *ssl, const char *hostname)
+{
+    int ret;
+    struct ssl_pm *ssl_pm = (struct ssl_pm *)ssl->ssl_pm;
+
+    ret = mbedtls_ssl_set_hostname(&ssl_pm->ssl, hostname);
+    if (ret) {
+        SSL_DEBUG(SSL_PLATFORM_ERROR_LEVEL, "mbedtls_ssl_set_hostname() return -0x%x", -ret);
+        return -1;
+    }
+
+    return 0;
+}
+
 int ssl_pm_shutdown(SSL *ssl)
 {
     int ret;
@@ -431,10 +1092,10 @@ int x509_pm_show_info(X509 *x)
 
     buf[ret] = 0;
 
-    ssl_mem_free(buf);
-
     SSL_DEBUG(SSL_DEBUG_ON, "%s", buf);
 
+    ssl_mem_free(buf);
+
     return 0;
 
 mbedtls_err1:
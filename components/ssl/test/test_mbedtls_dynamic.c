@@ -0,0 +1,194 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <unity.h>
+#include "sdkconfig.h"
+#include "esp_system.h"
+
+#ifdef CONFIG_MBEDTLS_DYNAMIC_BUFFER
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/esp_mbedtls_dynamic.h"
+
+#define TEST_PIPE_LEN   2048
+#define TEST_DATA_LEN   1000
+/* record header and explicit IV of both idle buffers */
+#define TEST_IDLE_MAX   100
+
+extern const char test_crt_start[] asm("_binary_test_crt_start");
+extern const char test_key_start[] asm("_binary_test_key_start");
+
+/* One direction of a connection in memory */
+typedef struct {
+    unsigned char buf[TEST_PIPE_LEN];
+    size_t len;
+} test_pipe_t;
+
+typedef struct {
+    test_pipe_t *rx;
+    test_pipe_t *tx;
+} test_bio_t;
+
+static int test_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    test_pipe_t *tx = ((test_bio_t *)ctx)->tx;
+
+    if (len > TEST_PIPE_LEN - tx->len)
+        len = TEST_PIPE_LEN - tx->len;
+    if (!len)
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+
+    memcpy(tx->buf + tx->len, buf, len);
+    tx->len += len;
+
+    return len;
+}
+
+static int test_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    test_pipe_t *rx = ((test_bio_t *)ctx)->rx;
+
+    if (len > rx->len)
+        len = rx->len;
+    if (!len)
+        return MBEDTLS_ERR_SSL_WANT_READ;
+
+    memcpy(buf, rx->buf, len);
+    memmove(rx->buf, rx->buf + len, rx->len - len);
+    rx->len -= len;
+
+    return len;
+}
+
+static int test_done(int ret)
+{
+    return ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE;
+}
+
+static size_t test_idle_len(const mbedtls_ssl_context *ssl, size_t *peak)
+{
+    esp_mbedtls_dynamic_stats_t stats;
+
+    TEST_ASSERT_EQUAL(0, esp_mbedtls_dynamic_get_stats(ssl, &stats));
+    if (peak)
+        *peak = stats.peak;
+
+    return stats.rx_len + stats.tx_len;
+}
+
+TEST_CASE("mbedtls dynamic buffers shrink on an idle connection", "[mbedtls]")
+{
+    static test_pipe_t c2s, s2c;
+    static unsigned char data[TEST_DATA_LEN], received[TEST_DATA_LEN];
+    test_bio_t client_bio = { &s2c, &c2s }, server_bio = { &c2s, &s2c };
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context drbg;
+    mbedtls_x509_crt crt;
+    mbedtls_pk_context pkey;
+    mbedtls_ssl_config client_conf, server_conf;
+    mbedtls_ssl_context client, server;
+    int client_ret = MBEDTLS_ERR_SSL_WANT_READ, server_ret = MBEDTLS_ERR_SSL_WANT_READ;
+    uint32_t heap_start, heap_idle;
+    size_t len, peak;
+
+    c2s.len = s2c.len = 0;
+    for (int i = 0; i < sizeof(data); i++)
+        data[i] = i * 3;
+
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&drbg);
+    mbedtls_x509_crt_init(&crt);
+    mbedtls_pk_init(&pkey);
+    mbedtls_ssl_config_init(&client_conf);
+    mbedtls_ssl_config_init(&server_conf);
+    mbedtls_ssl_init(&client);
+    mbedtls_ssl_init(&server);
+
+    TEST_ASSERT_EQUAL(0, mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy, NULL, 0));
+    TEST_ASSERT_EQUAL(0, mbedtls_x509_crt_parse(&crt, (const unsigned char *)test_crt_start, strlen(test_crt_start) + 1));
+    TEST_ASSERT_EQUAL(0, mbedtls_pk_parse_key(&pkey, (const unsigned char *)test_key_start, strlen(test_key_start) + 1, NULL, 0));
+
+    TEST_ASSERT_EQUAL(0, mbedtls_ssl_config_defaults(&client_conf, MBEDTLS_SSL_IS_CLIENT,
+                                                     MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT));
+    mbedtls_ssl_conf_authmode(&client_conf, MBEDTLS_SSL_VERIFY_NONE);
+    mbedtls_ssl_conf_rng(&client_conf, mbedtls_ctr_drbg_random, &drbg);
+
+    TEST_ASSERT_EQUAL(0, mbedtls_ssl_config_defaults(&server_conf, MBEDTLS_SSL_IS_SERVER,
+                                                     MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT));
+    mbedtls_ssl_conf_rng(&server_conf, mbedtls_ctr_drbg_random, &drbg);
+    TEST_ASSERT_EQUAL(0, mbedtls_ssl_conf_own_cert(&server_conf, &crt, &pkey));
+
+    heap_start = esp_get_free_heap_size();
+
+    TEST_ASSERT_EQUAL(0, mbedtls_ssl_setup(&client, &client_conf));
+    TEST_ASSERT_EQUAL(0, mbedtls_ssl_setup(&server, &server_conf));
+    mbedtls_ssl_set_bio(&client, &client_bio, test_send, test_recv, NULL);
+    mbedtls_ssl_set_bio(&server, &server_bio, test_send, test_recv, NULL);
+
+    /* shrunk as soon as they are set up */
+    TEST_ASSERT_TRUE(test_idle_len(&client, NULL) < TEST_IDLE_MAX);
+    TEST_ASSERT_TRUE(test_idle_len(&server, NULL) < TEST_IDLE_MAX);
+
+    for (int i = 0; i < 100 && (!test_done(client_ret) || !test_done(server_ret)); i++) {
+        if (!test_done(client_ret))
+            client_ret = mbedtls_ssl_handshake(&client);
+        if (!test_done(server_ret))
+            server_ret = mbedtls_ssl_handshake(&server);
+    }
+    TEST_ASSERT_EQUAL(0, client_ret);
+    TEST_ASSERT_EQUAL(0, server_ret);
+
+    /* idle again once the handshake is over */
+    TEST_ASSERT_TRUE(test_idle_len(&client, NULL) < TEST_IDLE_MAX);
+    TEST_ASSERT_TRUE(test_idle_len(&server, NULL) < TEST_IDLE_MAX);
+
+    for (len = 0; len < sizeof(data); ) {
+        int ret = mbedtls_ssl_write(&client, data + len, sizeof(data) - len);
+
+        TEST_ASSERT_TRUE(ret > 0);
+        len += ret;
+    }
+    for (len = 0; len < sizeof(received); ) {
+        int ret = mbedtls_ssl_read(&server, received + len, sizeof(received) - len);
+
+        TEST_ASSERT_TRUE(ret > 0);
+        len += ret;
+    }
+    TEST_ASSERT_EQUAL_MEMORY(data, received, sizeof(data));
+
+    /* and after the data */
+    len = test_idle_len(&client, &peak);
+    TEST_ASSERT_TRUE(len < TEST_IDLE_MAX);
+    TEST_ASSERT_TRUE(test_idle_len(&server, NULL) < TEST_IDLE_MAX);
+    heap_idle = esp_get_free_heap_size();
+
+    printf("record buffers of a connection: %u bytes idle, %u bytes peak\n", len, peak);
+    printf("heap held by both ends of an idle connection: %u bytes\n", heap_start - heap_idle);
+
+    mbedtls_ssl_free(&client);
+    mbedtls_ssl_free(&server);
+    mbedtls_ssl_config_free(&client_conf);
+    mbedtls_ssl_config_free(&server_conf);
+    mbedtls_pk_free(&pkey);
+    mbedtls_x509_crt_free(&crt);
+    mbedtls_ctr_drbg_free(&drbg);
+    mbedtls_entropy_free(&entropy);
+}
+
+#endif
@@ -0,0 +1,270 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <unity.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+
+#if defined(CONFIG_SSL_USING_MBEDTLS) && CONFIG_OPENSSL_SESSION_CACHE_SIZE > 0 && defined(CONFIG_LWIP_NETIF_LOOPBACK)
+
+#include "lwip/sockets.h"
+#include "tcpip_adapter.h"
+#include "openssl/ssl.h"
+
+#define TEST_PORT       4433
+#define TEST_HOST       "test.local"
+#define TEST_STACK      8192
+
+/* self-signed RSA-2048 certification of test.local, used by both ends */
+extern const char test_crt_start[] asm("_binary_test_crt_start");
+extern const char test_key_start[] asm("_binary_test_key_start");
+
+/* the X509 show_info method, 0 if the object holds a certification */
+int __X509_show_info(X509 *x);
+
+typedef struct {
+    SSL_CTX *ctx;
+    SSL_SESSION *session;   /* offered by the client with SSL_set_session */
+    const char *host;       /* set by the client with SSL_set_tlsext_host_name */
+    int verify;             /* set by the client with SSL_set_verify */
+    int fd;
+    int ok;
+    int reused;
+    int peer_cert;
+    SSL_SESSION *saved;     /* client session got with SSL_get1_session */
+    uint32_t handshake_us;  /* time the client spent in SSL_connect */
+    SemaphoreHandle_t done;
+} test_end_t;
+
+static SSL_CTX *new_ctx(const SSL_METHOD *method)
+{
+    SSL_CTX *ctx = SSL_CTX_new(method);
+
+    TEST_ASSERT_NOT_NULL(ctx);
+    TEST_ASSERT_EQUAL(1, SSL_CTX_use_certificate_ASN1(ctx, strlen(test_crt_start), (const unsigned char *)test_crt_start));
+    TEST_ASSERT_EQUAL(1, SSL_CTX_use_PrivateKey_ASN1(0, ctx, (const unsigned char *)test_key_start, strlen(test_key_start)));
+
+    return ctx;
+}
+
+static void server_task(void *arg)
+{
+    test_end_t *end = (test_end_t *)arg;
+    int fd = accept(end->fd, NULL, NULL);
+    SSL *ssl = SSL_new(end->ctx);
+
+    if (fd >= 0 && ssl) {
+        SSL_set_fd(ssl, fd);
+        if (SSL_accept(ssl) == 1) {
+            end->ok = 1;
+            end->reused = SSL_session_reused(ssl);
+            end->peer_cert = !__X509_show_info(SSL_get_peer_certificate(ssl));
+        }
+    }
+
+    if (ssl)
+        SSL_free(ssl);
+    if (fd >= 0)
+        close(fd);
+
+    xSemaphoreGive(end->done);
+    vTaskDelete(NULL);
+}
+
+static void client_task(void *arg)
+{
+    test_end_t *end = (test_end_t *)arg;
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(TEST_PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    SSL *ssl = SSL_new(end->ctx);
+    int64_t start;
+    int ret;
+
+    if (fd >= 0 && ssl && !connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+        SSL_set_fd(ssl, fd);
+        if (end->host)
+            SSL_set_tlsext_host_name(ssl, end->host);
+        if (end->session)
+            SSL_set_session(ssl, end->session);
+        if (end->verify)
+            SSL_set_verify(ssl, end->verify, NULL);
+
+        start = esp_timer_get_time();
+        ret = SSL_connect(ssl);
+        end->handshake_us = esp_timer_get_time() - start;
+
+        if (ret == 1) {
+            end->ok = 1;
+            end->reused = SSL_session_reused(ssl);
+            end->saved = SSL_get1_session(ssl);
+            SSL_shutdown(ssl);
+        }
+    }
+
+    if (ssl)
+        SSL_free(ssl);
+    if (fd >= 0)
+        close(fd);
+
+    xSemaphoreGive(end->done);
+    vTaskDelete(NULL);
+}
+
+/* One connection between the two contexts over the loopback interface */
+static void run_connection(test_end_t *client, test_end_t *server)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(TEST_PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    int opt = 1;
+
+    client->ok = client->reused = 0;
+    client->saved = NULL;
+    client->handshake_us = 0;
+    server->ok = server->reused = server->peer_cert = 0;
+    client->done = xSemaphoreCreateBinary();
+    server->done = xSemaphoreCreateBinary();
+
+    server->fd = socket(AF_INET, SOCK_STREAM, 0);
+    TEST_ASSERT(server->fd >= 0);
+    setsockopt(server->fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    TEST_ASSERT_EQUAL(0, bind(server->fd, (struct sockaddr *)&addr, sizeof(addr)));
+    TEST_ASSERT_EQUAL(0, listen(server->fd, 1));
+
+    TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(server_task, "ssl_server", TEST_STACK, server, 5, NULL));
+    TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(client_task, "ssl_client", TEST_STACK, client, 5, NULL));
+
+    TEST_ASSERT_TRUE(xSemaphoreTake(client->done, 30000 / portTICK_PERIOD_MS));
+    TEST_ASSERT_TRUE(xSemaphoreTake(server->done, 30000 / portTICK_PERIOD_MS));
+
+    close(server->fd);
+    vSemaphoreDelete(client->done);
+    vSemaphoreDelete(server->done);
+
+    TEST_ASSERT_TRUE(client->ok);
+    TEST_ASSERT_TRUE(server->ok);
+    TEST_ASSERT_NOT_NULL(client->saved);
+}
+
+TEST_CASE("openssl resumes a session set with SSL_set_session", "[openssl]")
+{
+    test_end_t client = { 0 }, server = { 0 };
+    uint32_t full_us;
+
+    tcpip_adapter_init();
+
+    client.ctx = new_ctx(TLSv1_2_client_method());
+    server.ctx = new_ctx(TLSv1_2_server_method());
+    /* ask for the client certification, without failing on its verification */
+    SSL_CTX_set_verify(server.ctx, SSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL);
+
+    run_connection(&client, &server);
+    TEST_ASSERT_FALSE(client.reused);
+    TEST_ASSERT_FALSE(server.reused);
+    TEST_ASSERT_TRUE(server.peer_cert);
+    full_us = client.handshake_us;
+
+    /* without a host name the client cache is not used */
+    client.session = client.saved;
+    run_connection(&client, &server);
+    SSL_SESSION_free(client.session);
+    client.session = NULL;
+    TEST_ASSERT_TRUE(client.reused);
+    TEST_ASSERT_TRUE(server.reused);
+    /* the server cache keeps the client certification of the session */
+    TEST_ASSERT_TRUE(server.peer_cert);
+    printf("full handshake %u us, resumed handshake %u us\n", full_us, client.handshake_us);
+
+    /* settings of the SSL differing from its context take another configuration, the session set is kept */
+    client.session = client.saved;
+    client.verify = SSL_VERIFY_FAIL_IF_NO_PEER_CERT;
+    run_connection(&client, &server);
+    SSL_SESSION_free(client.session);
+    client.session = NULL;
+    client.verify = 0;
+    TEST_ASSERT_TRUE(client.reused);
+    TEST_ASSERT_TRUE(server.reused);
+    SSL_SESSION_free(client.saved);
+
+    /* a full handshake again without a session */
+    run_connection(&client, &server);
+    TEST_ASSERT_FALSE(client.reused);
+    TEST_ASSERT_FALSE(server.reused);
+    SSL_SESSION_free(client.saved);
+
+    SSL_CTX_free(client.ctx);
+    SSL_CTX_free(server.ctx);
+}
+
+TEST_CASE("openssl client cache resumes sessions by host name", "[openssl]")
+{
+    test_end_t client = { 0 }, server = { 0 };
+    uint32_t full_us;
+
+    tcpip_adapter_init();
+
+    client.ctx = new_ctx(TLSv1_2_client_method());
+    server.ctx = new_ctx(TLSv1_2_server_method());
+    client.host = TEST_HOST;
+
+    run_connection(&client, &server);
+    TEST_ASSERT_FALSE(client.reused);
+    SSL_SESSION_free(client.saved);
+    full_us = client.handshake_us;
+
+    run_connection(&client, &server);
+    TEST_ASSERT_TRUE(client.reused);
+    TEST_ASSERT_TRUE(server.reused);
+    SSL_SESSION_free(client.saved);
+    printf("full handshake %u us, resumed handshake %u us\n", full_us, client.handshake_us);
+
+    /* changed server settings give it a new configuration, its cache is the one of the context */
+    SSL_CTX_set_verify(server.ctx, SSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL);
+    run_connection(&client, &server);
+    TEST_ASSERT_TRUE(client.reused);
+    TEST_ASSERT_TRUE(server.reused);
+    SSL_SESSION_free(client.saved);
+
+    /* so do changed client settings, the host name is kept */
+    client.verify = SSL_VERIFY_FAIL_IF_NO_PEER_CERT;
+    run_connection(&client, &server);
+    client.verify = 0;
+    TEST_ASSERT_TRUE(client.reused);
+    TEST_ASSERT_TRUE(server.reused);
+    SSL_SESSION_free(client.saved);
+
+    /* another host name is not resumed */
+    client.host = "other.local";
+    run_connection(&client, &server);
+    TEST_ASSERT_FALSE(client.reused);
+    TEST_ASSERT_FALSE(server.reused);
+    SSL_SESSION_free(client.saved);
+
+    SSL_CTX_free(client.ctx);
+    SSL_CTX_free(server.ctx);
+}
+
+#endif
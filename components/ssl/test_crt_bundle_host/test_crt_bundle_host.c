@@ -0,0 +1,317 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Verifies certificate chains against a bundle of tools/make_crt_bundle.py.
+ *
+ * "test_crt_bundle gen" writes the certificates as DER files, the bundle is
+ * made of the CAs among them, then "test_crt_bundle bundle.bin" verifies
+ * chains of the others against it, see the Makefile. Every intermediate is
+ * named "Test Intermediate" and has the same key, so the same leaf is
+ * verified through each of them.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/esp_crt_bundle.h"
+
+#define TEST_DER_LEN    1024
+
+static int s_failed;
+
+#define CHECK(cond)     do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            s_failed++; \
+        } \
+    } while (0)
+
+typedef struct {
+    const char *file;
+    const char *subject;
+    const char *issuer;     /* NULL if self-signed */
+    int subject_key;
+    int issuer_key;
+    int version;
+    int ca;                 /* basicConstraints CA flag, -1 without the extension */
+    unsigned int key_usage;
+} test_cert_t;
+
+enum {
+    KEY_ROOT,
+    KEY_ROOT2,
+    KEY_FORGED,
+    KEY_NOCA,
+    KEY_NOSIGN,
+    KEY_V1,
+    KEY_INTER,
+    KEY_LEAF,
+    KEY_MAX
+};
+
+#define CA_USAGE        (MBEDTLS_X509_KU_KEY_CERT_SIGN | MBEDTLS_X509_KU_CRL_SIGN)
+#define V3              MBEDTLS_X509_CRT_VERSION_3
+
+static const test_cert_t s_certs[] = {
+    /* the bundle, two roots share a name */
+    { "root.der", "CN=Test Root CA", NULL, KEY_ROOT, KEY_ROOT, V3, 1, CA_USAGE },
+    { "root2.der", "CN=Test Root CA", NULL, KEY_ROOT2, KEY_ROOT2, V3, 1, CA_USAGE },
+    { "noca.der", "CN=Test Not A CA", NULL, KEY_NOCA, KEY_NOCA, V3, 0, CA_USAGE },
+    { "nosign.der", "CN=Test No Cert Sign", NULL, KEY_NOSIGN, KEY_NOSIGN, V3, 1,
+      MBEDTLS_X509_KU_DIGITAL_SIGNATURE },
+    { "v1.der", "CN=Test V1 Root", NULL, KEY_V1, KEY_V1, MBEDTLS_X509_CRT_VERSION_1, -1, 0 },
+
+    /* the peer chains */
+    { "inter_root.der", "CN=Test Intermediate", "CN=Test Root CA", KEY_INTER, KEY_ROOT, V3, 1, CA_USAGE },
+    { "inter_root2.der", "CN=Test Intermediate", "CN=Test Root CA", KEY_INTER, KEY_ROOT2, V3, 1, CA_USAGE },
+    { "inter_forged.der", "CN=Test Intermediate", "CN=Test Root CA", KEY_INTER, KEY_FORGED, V3, 1, CA_USAGE },
+    { "inter_noca.der", "CN=Test Intermediate", "CN=Test Not A CA", KEY_INTER, KEY_NOCA, V3, 1, CA_USAGE },
+    { "inter_nosign.der", "CN=Test Intermediate", "CN=Test No Cert Sign", KEY_INTER, KEY_NOSIGN, V3, 1, CA_USAGE },
+    { "inter_v1.der", "CN=Test Intermediate", "CN=Test V1 Root", KEY_INTER, KEY_V1, V3, 1, CA_USAGE },
+    { "leaf.der", "CN=test.local", "CN=Test Intermediate", KEY_LEAF, KEY_INTER, V3, -1,
+      MBEDTLS_X509_KU_DIGITAL_SIGNATURE },
+};
+
+static int test_rng(void *ctx, unsigned char *buf, size_t len)
+{
+    while (len--)
+        *buf++ = rand();
+
+    return 0;
+}
+
+static void write_cert(const test_cert_t *cert, mbedtls_pk_context *keys, int serial)
+{
+    static unsigned char der[TEST_DER_LEN];
+    mbedtls_x509write_cert crt;
+    mbedtls_mpi sn;
+    FILE *f;
+    int len;
+
+    mbedtls_x509write_crt_init(&crt);
+    mbedtls_mpi_init(&sn);
+
+    mbedtls_x509write_crt_set_version(&crt, cert->version);
+    mbedtls_x509write_crt_set_md_alg(&crt, MBEDTLS_MD_SHA256);
+    mbedtls_x509write_crt_set_subject_key(&crt, &keys[cert->subject_key]);
+    mbedtls_x509write_crt_set_issuer_key(&crt, &keys[cert->issuer_key]);
+    CHECK(mbedtls_x509write_crt_set_subject_name(&crt, cert->subject) == 0);
+    CHECK(mbedtls_x509write_crt_set_issuer_name(&crt, cert->issuer ? cert->issuer : cert->subject) == 0);
+    CHECK(mbedtls_mpi_lset(&sn, serial) == 0);
+    CHECK(mbedtls_x509write_crt_set_serial(&crt, &sn) == 0);
+    CHECK(mbedtls_x509write_crt_set_validity(&crt, "20190101000000", "20491231235959") == 0);
+    if (cert->ca >= 0)
+        CHECK(mbedtls_x509write_crt_set_basic_constraints(&crt, cert->ca, -1) == 0);
+    if (cert->key_usage)
+        CHECK(mbedtls_x509write_crt_set_key_usage(&crt, cert->key_usage) == 0);
+
+    /* written at the end of the buffer */
+    len = mbedtls_x509write_crt_der(&crt, der, sizeof(der), test_rng, NULL);
+    CHECK(len > 0);
+
+    f = fopen(cert->file, "wb");
+    CHECK(f != NULL);
+    if (f && len > 0) {
+        CHECK(fwrite(der + sizeof(der) - len, 1, len, f) == len);
+        fclose(f);
+    }
+
+    mbedtls_mpi_free(&sn);
+    mbedtls_x509write_crt_free(&crt);
+}
+
+static void gen_certs(void)
+{
+    mbedtls_pk_context keys[KEY_MAX];
+
+    for (int i = 0; i < KEY_MAX; i++) {
+        mbedtls_pk_init(&keys[i]);
+        CHECK(mbedtls_pk_setup(&keys[i], mbedtls_pk_info_from_type(MBEDTLS_PK_ECKEY)) == 0);
+        CHECK(mbedtls_ecp_gen_key(MBEDTLS_ECP_DP_SECP256R1, mbedtls_pk_ec(keys[i]), test_rng, NULL) == 0);
+    }
+
+    for (int i = 0; i < sizeof(s_certs) / sizeof(s_certs[0]); i++)
+        write_cert(&s_certs[i], keys, i + 1);
+
+    for (int i = 0; i < KEY_MAX; i++)
+        mbedtls_pk_free(&keys[i]);
+}
+
+/* Verification flags of the chain of the leaf and the given certificates */
+static uint32_t verify(const uint8_t *bundle, const char *inter, const char *top)
+{
+    mbedtls_ssl_config conf;
+    mbedtls_x509_crt chain;
+    uint32_t flags = 0;
+    int ret;
+
+    mbedtls_ssl_config_init(&conf);
+    mbedtls_x509_crt_init(&chain);
+
+    CHECK(esp_crt_bundle_attach(&conf, bundle) == 0);
+    CHECK(mbedtls_x509_crt_parse_file(&chain, "leaf.der") == 0);
+    if (inter)
+        CHECK(mbedtls_x509_crt_parse_file(&chain, inter) == 0);
+    if (top)
+        CHECK(mbedtls_x509_crt_parse_file(&chain, top) == 0);
+
+    ret = mbedtls_x509_crt_verify(&chain, conf.ca_chain, conf.ca_crl, NULL, &flags, conf.f_vrfy, conf.p_vrfy);
+    CHECK(flags ? ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED : ret == 0);
+
+    mbedtls_x509_crt_free(&chain);
+    mbedtls_ssl_config_free(&conf);
+
+    return flags;
+}
+
+static void test_chains(const uint8_t *bundle)
+{
+    CHECK(verify(bundle, "inter_root.der", NULL) == 0);
+    /* the root itself sent by the peer */
+    CHECK(verify(bundle, "inter_root.der", "root.der") == 0);
+    /* the second root of the same name */
+    CHECK(verify(bundle, "inter_root2.der", NULL) == 0);
+
+    /* a root of the same name that is not in the bundle */
+    CHECK(verify(bundle, "inter_forged.der", NULL) == MBEDTLS_X509_BADCERT_NOT_TRUSTED);
+    /* the intermediate missing */
+    CHECK(verify(bundle, NULL, NULL) == MBEDTLS_X509_BADCERT_NOT_TRUSTED);
+
+    /* bundled certificates that may not sign certificates */
+    CHECK(verify(bundle, "inter_noca.der", NULL) == MBEDTLS_X509_BADCERT_NOT_TRUSTED);
+    CHECK(verify(bundle, "inter_nosign.der", NULL) == MBEDTLS_X509_BADCERT_NOT_TRUSTED);
+    CHECK(verify(bundle, "inter_v1.der", NULL) == MBEDTLS_X509_BADCERT_NOT_TRUSTED);
+}
+
+static void test_alignment(const uint8_t *bundle, size_t len)
+{
+    uint8_t *buf = malloc(len + 3);
+
+    CHECK(buf != NULL);
+    for (int offset = 1; buf && offset < 4; offset++) {
+        memcpy(buf + offset, bundle, len);
+        CHECK(verify(buf + offset, "inter_root.der", NULL) == 0);
+        CHECK(verify(buf + offset, "inter_forged.der", NULL) == MBEDTLS_X509_BADCERT_NOT_TRUSTED);
+    }
+    free(buf);
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+/* Attach a copy of the bundle with the word at pos set to v */
+static int attach_modified(const uint8_t *bundle, size_t len, size_t pos, uint32_t v)
+{
+    mbedtls_ssl_config conf;
+    uint8_t *buf = malloc(len);
+    int ret;
+
+    CHECK(buf != NULL);
+    if (!buf)
+        return 0;
+    memcpy(buf, bundle, len);
+    put_u32(buf + pos, v);
+
+    mbedtls_ssl_config_init(&conf);
+    ret = esp_crt_bundle_attach(&conf, buf);
+    mbedtls_ssl_config_free(&conf);
+    free(buf);
+
+    return ret;
+}
+
+static void test_bad_bundles(const uint8_t *bundle, size_t len)
+{
+    /* header: magic, count, size; then entries: name hash, offset, length */
+    uint32_t count = get_u32(bundle + 4), size = get_u32(bundle + 8);
+    size_t last = 12 + 12 * (count - 1);
+    mbedtls_ssl_config conf;
+
+    CHECK(count == 5 && size == len);
+
+    mbedtls_ssl_config_init(&conf);
+    CHECK(esp_crt_bundle_attach(&conf, NULL) == MBEDTLS_ERR_X509_BAD_INPUT_DATA);
+    CHECK(esp_crt_bundle_attach(NULL, bundle) == MBEDTLS_ERR_X509_BAD_INPUT_DATA);
+    mbedtls_ssl_config_free(&conf);
+
+    CHECK(attach_modified(bundle, len, 0, 0x42545244) == MBEDTLS_ERR_X509_BAD_INPUT_DATA);
+    CHECK(attach_modified(bundle, len, 4, count + 1000) == MBEDTLS_ERR_X509_BAD_INPUT_DATA);
+    CHECK(attach_modified(bundle, len, 4, 0xffffffff) == MBEDTLS_ERR_X509_BAD_INPUT_DATA);
+    CHECK(attach_modified(bundle, len, 8, 11) == MBEDTLS_ERR_X509_BAD_INPUT_DATA);
+    CHECK(attach_modified(bundle, len, 8, 12 + 12 * count - 1) == MBEDTLS_ERR_X509_BAD_INPUT_DATA);
+    CHECK(attach_modified(bundle, len, last + 4, size) == MBEDTLS_ERR_X509_BAD_INPUT_DATA);
+    CHECK(attach_modified(bundle, len, last + 8, size) == MBEDTLS_ERR_X509_BAD_INPUT_DATA);
+    CHECK(attach_modified(bundle, len, last + 8, 0xfffffff0) == MBEDTLS_ERR_X509_BAD_INPUT_DATA);
+    /* the index out of order */
+    CHECK(attach_modified(bundle, len, 12, get_u32(bundle + 12 + 12) + 1) == MBEDTLS_ERR_X509_BAD_INPUT_DATA);
+
+    /* the unmodified bundle, and fewer entries */
+    CHECK(attach_modified(bundle, len, 0, get_u32(bundle)) == 0);
+    CHECK(attach_modified(bundle, len, 4, 0) == 0);
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t *bundle;
+    long len;
+    FILE *f;
+
+    srand(1);
+
+    if (argc != 2) {
+        printf("usage: %s gen | %s bundle.bin\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    if (!strcmp(argv[1], "gen")) {
+        gen_certs();
+        return s_failed ? 1 : 0;
+    }
+
+    f = fopen(argv[1], "rb");
+    if (!f) {
+        printf("cannot open %s\n", argv[1]);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    bundle = malloc(len);
+    CHECK(bundle && fread(bundle, 1, len, f) == len);
+    fclose(f);
+
+    if (!s_failed) {
+        test_chains(bundle);
+        test_alignment(bundle, len);
+        test_bad_bundles(bundle, len);
+    }
+    free(bundle);
+
+    printf("%s\n", s_failed ? "FAILED" : "OK");
+    return s_failed ? 1 : 0;
+}
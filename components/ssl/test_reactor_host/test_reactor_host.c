@@ -0,0 +1,465 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Serves TLS connections over socket pairs with esp_mbedtls_reactor, both ends
+ * of every pair in the same reactor.
+ *
+ * A connection removed by a callback is filled with a poison pattern, so that
+ * the dispatch loop crashes or calls the wrong callback if it touches it
+ * again, as it would if the storage had been freed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/esp_mbedtls_reactor.h"
+
+#define TEST_PAIRS      3
+#define TEST_POLLS      200
+#define TEST_BULK_LEN   (64 * 1024)
+#define TEST_CHUNK_LEN  4096
+#define TEST_POISON     0xa5
+
+static int s_failed;
+
+#define CHECK(cond)     do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            s_failed++; \
+        } \
+    } while (0)
+
+/* The mbedtls_net_* functions of net_sockets.c the reactor uses */
+
+int mbedtls_net_set_nonblock(mbedtls_net_context *ctx)
+{
+    int flags = fcntl(ctx->fd, F_GETFL);
+
+    return flags < 0 || fcntl(ctx->fd, F_SETFL, flags | O_NONBLOCK) < 0 ? -1 : 0;
+}
+
+int mbedtls_net_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    int ret = send(((mbedtls_net_context *)ctx)->fd, buf, len, MSG_NOSIGNAL);
+
+    if (ret < 0)
+        return errno == EAGAIN || errno == EINTR ? MBEDTLS_ERR_SSL_WANT_WRITE : MBEDTLS_ERR_NET_SEND_FAILED;
+
+    return ret;
+}
+
+int mbedtls_net_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    int ret = recv(((mbedtls_net_context *)ctx)->fd, buf, len, 0);
+
+    if (ret < 0)
+        return errno == EAGAIN || errno == EINTR ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_RECV_FAILED;
+
+    return ret;
+}
+
+typedef struct test_end test_end_t;
+
+struct test_end {
+    esp_mbedtls_conn_t conn;
+    mbedtls_ssl_context ssl;
+    mbedtls_net_context net;
+    int removed;
+
+    /* events seen */
+    int connected;
+    int readable;
+    int writable;
+    int errors;
+
+    /* what the callback does */
+    int remove_on;              /* event on which it removes its own connection, -1 never */
+    test_end_t *remove_other;   /* connection it removes on READABLE */
+    int no_read;                /* leave the data of READABLE in the socket */
+
+    /* data sent with write_bulk, and received */
+    size_t sent;
+    size_t received;
+    int bad_data;
+};
+
+static esp_mbedtls_reactor_t s_reactor;
+static mbedtls_ssl_config s_client_conf, s_server_conf;
+static mbedtls_x509_crt s_crt;
+static mbedtls_pk_context s_key;
+
+static test_end_t s_clients[TEST_PAIRS], s_servers[TEST_PAIRS];
+
+static int test_rng(void *ctx, unsigned char *buf, size_t len)
+{
+    while (len--)
+        *buf++ = rand();
+
+    return 0;
+}
+
+static unsigned char bulk_byte(size_t i)
+{
+    return i * 7 + (i >> 10);
+}
+
+/* Remove a connection and poison it */
+static void remove_end(test_end_t *end)
+{
+    esp_mbedtls_reactor_remove(&s_reactor, &end->conn);
+    memset(&end->conn, TEST_POISON, sizeof(end->conn));
+    end->removed = 1;
+}
+
+/* Send the bulk data until it is all sent or the socket is full */
+static void write_bulk(test_end_t *end)
+{
+    static unsigned char chunk[TEST_CHUNK_LEN];
+
+    while (end->sent < TEST_BULK_LEN) {
+        int ret;
+
+        for (int i = 0; i < TEST_CHUNK_LEN; i++)
+            chunk[i] = bulk_byte(end->sent + i);
+
+        /* the same data again after MBEDTLS_ERR_SSL_WANT_WRITE */
+        ret = mbedtls_ssl_write(&end->ssl, chunk, TEST_CHUNK_LEN);
+        if (ret == MBEDTLS_ERR_SSL_WANT_WRITE)
+            return;
+        CHECK(ret > 0);
+        if (ret <= 0)
+            return;
+        end->sent += ret;
+    }
+}
+
+static void read_all(test_end_t *end)
+{
+    unsigned char buf[1024];
+    int ret;
+
+    while ((ret = mbedtls_ssl_read(&end->ssl, buf, sizeof(buf))) > 0) {
+        for (int i = 0; i < ret; i++) {
+            if (buf[i] != bulk_byte(end->received + i))
+                end->bad_data = 1;
+        }
+        end->received += ret;
+    }
+    CHECK(ret == MBEDTLS_ERR_SSL_WANT_READ);
+}
+
+static void test_cb(esp_mbedtls_conn_t *conn, esp_mbedtls_event_t event, int err, void *arg)
+{
+    test_end_t *end = arg;
+
+    CHECK(conn == &end->conn);
+    CHECK(!end->removed);
+
+    switch (event) {
+    case ESP_MBEDTLS_EVENT_CONNECTED:
+        end->connected++;
+        break;
+    case ESP_MBEDTLS_EVENT_READABLE:
+        end->readable++;
+        if (end->remove_other)
+            remove_end(end->remove_other);
+        if (!end->no_read)
+            read_all(end);
+        break;
+    case ESP_MBEDTLS_EVENT_WRITABLE:
+        end->writable++;
+        write_bulk(end);
+        break;
+    case ESP_MBEDTLS_EVENT_ERROR:
+        end->errors++;
+        break;
+    }
+
+    if (event == end->remove_on)
+        remove_end(end);
+}
+
+static void init_end(test_end_t *end, mbedtls_ssl_config *conf, int fd)
+{
+    memset(end, 0, sizeof(*end));
+    end->remove_on = -1;
+    end->net.fd = fd;
+
+    mbedtls_ssl_init(&end->ssl);
+    CHECK(mbedtls_ssl_setup(&end->ssl, conf) == 0);
+    CHECK(esp_mbedtls_reactor_add(&s_reactor, &end->conn, &end->ssl, &end->net, test_cb, end) == 0);
+}
+
+static void free_end(test_end_t *end)
+{
+    if (!end->removed)
+        esp_mbedtls_reactor_remove(&s_reactor, &end->conn);
+    mbedtls_ssl_free(&end->ssl);
+    close(end->net.fd);
+}
+
+/*
+ * Pairs of connections, added clients first: the reactor visits the last
+ * added first, so the servers from s_servers[TEST_PAIRS - 1] down, then the
+ * clients.
+ */
+static void open_pairs(void)
+{
+    esp_mbedtls_reactor_init(&s_reactor);
+
+    for (int i = 0; i < TEST_PAIRS; i++) {
+        int fds[2];
+
+        CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        init_end(&s_clients[i], &s_client_conf, fds[0]);
+        s_servers[i].net.fd = fds[1];
+    }
+    for (int i = 0; i < TEST_PAIRS; i++)
+        init_end(&s_servers[i], &s_server_conf, s_servers[i].net.fd);
+}
+
+static void close_pairs(void)
+{
+    for (int i = 0; i < TEST_PAIRS; i++) {
+        free_end(&s_clients[i]);
+        free_end(&s_servers[i]);
+    }
+    CHECK(s_reactor.conns == NULL);
+}
+
+static int all_connected(void)
+{
+    for (int i = 0; i < TEST_PAIRS; i++) {
+        if (!s_clients[i].connected || !s_servers[i].connected)
+            return 0;
+    }
+    return 1;
+}
+
+static void connect_pairs(void)
+{
+    /* handshake steps are not events, only their end is */
+    for (int i = 0; i < TEST_POLLS && !all_connected(); i++)
+        CHECK(esp_mbedtls_reactor_poll(&s_reactor, 100) >= 0);
+
+    /* the other tests would only wait for the polls to time out */
+    if (!all_connected()) {
+        printf("handshakes not done\nFAILED\n");
+        exit(1);
+    }
+
+    for (int i = 0; i < TEST_PAIRS; i++) {
+        CHECK(s_clients[i].connected == 1 && s_servers[i].connected == 1);
+        CHECK(!s_clients[i].errors && !s_servers[i].errors);
+    }
+
+    /* nothing to report once connected, writability is not waited for */
+    CHECK(esp_mbedtls_reactor_poll(&s_reactor, 0) == 0);
+}
+
+static void send_hello(test_end_t *end)
+{
+    unsigned char hello[16];
+
+    for (int i = 0; i < sizeof(hello); i++)
+        hello[i] = bulk_byte(end->sent + i);
+    CHECK(mbedtls_ssl_write(&end->ssl, hello, sizeof(hello)) == sizeof(hello));
+    end->sent += sizeof(hello);
+}
+
+static void test_handshake(void)
+{
+    open_pairs();
+    connect_pairs();
+    close_pairs();
+}
+
+/* A server removes itself on CONNECTED, and another one on READABLE */
+static void test_remove_current(void)
+{
+    open_pairs();
+    s_servers[0].remove_on = ESP_MBEDTLS_EVENT_CONNECTED;
+    s_servers[1].remove_on = ESP_MBEDTLS_EVENT_READABLE;
+
+    connect_pairs();
+    CHECK(s_servers[0].removed);
+
+    /* the data sent to the removed server is not reported */
+    for (int i = 0; i < TEST_PAIRS; i++)
+        send_hello(&s_clients[i]);
+    for (int i = 0; i < 10 && !s_servers[2].received; i++)
+        esp_mbedtls_reactor_poll(&s_reactor, 100);
+
+    CHECK(s_servers[0].readable == 0);
+    CHECK(s_servers[1].readable == 1 && s_servers[1].removed);
+    CHECK(s_servers[2].readable == 1 && s_servers[2].received == 16);
+    CHECK(!s_servers[2].bad_data);
+
+    /* the clients left are still served */
+    CHECK(esp_mbedtls_reactor_poll(&s_reactor, 0) == 0);
+    send_hello(&s_servers[2]);
+    CHECK(esp_mbedtls_reactor_poll(&s_reactor, 1000) == 1);
+    CHECK(s_clients[2].readable == 1 && s_clients[2].received == 16);
+
+    close_pairs();
+}
+
+/* A server removes the next one to visit, the one after it is still served */
+static void test_remove_cursor(void)
+{
+    open_pairs();
+    connect_pairs();
+
+    s_servers[2].remove_other = &s_servers[1];
+    for (int i = 0; i < TEST_PAIRS; i++)
+        send_hello(&s_clients[i]);
+    /* all ready in one poll, socket pairs deliver at once */
+    CHECK(esp_mbedtls_reactor_poll(&s_reactor, 1000) == 2);
+
+    CHECK(s_servers[2].readable == 1 && s_servers[2].received == 16);
+    CHECK(s_servers[1].readable == 0 && s_servers[1].removed);
+    CHECK(s_servers[0].readable == 1 && s_servers[0].received == 16);
+
+    /* and one already visited, then the first of the list */
+    s_servers[2].remove_other = NULL;
+    s_servers[0].remove_other = &s_servers[2];
+    send_hello(&s_clients[0]);
+    send_hello(&s_clients[2]);
+    CHECK(esp_mbedtls_reactor_poll(&s_reactor, 1000) == 2);
+    CHECK(s_servers[2].readable == 2 && s_servers[2].received == 32);
+    CHECK(s_servers[0].readable == 2 && s_servers[2].removed);
+
+    s_servers[0].remove_other = NULL;
+    s_servers[0].remove_on = ESP_MBEDTLS_EVENT_READABLE;
+    send_hello(&s_clients[0]);
+    CHECK(esp_mbedtls_reactor_poll(&s_reactor, 1000) == 1);
+    CHECK(s_servers[0].removed);
+    CHECK(s_reactor.conns == &s_clients[2].conn);
+
+    close_pairs();
+}
+
+/* Writes that fill the socket are resumed by WRITABLE until all data is sent */
+static void test_want_write(void)
+{
+    int size = 4096, polls;
+
+    open_pairs();
+    connect_pairs();
+
+    CHECK(setsockopt(s_clients[0].net.fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)) == 0);
+    CHECK(setsockopt(s_servers[0].net.fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) == 0);
+
+    write_bulk(&s_clients[0]);
+    CHECK(s_clients[0].sent < TEST_BULK_LEN);
+    CHECK(s_clients[0].conn.want_write);
+
+    for (polls = 0; polls < TEST_POLLS && s_servers[0].received < TEST_BULK_LEN; polls++)
+        CHECK(esp_mbedtls_reactor_poll(&s_reactor, 1000) > 0);
+
+    printf("%d bytes sent in %d polls, %d WRITABLE events\n", TEST_BULK_LEN, polls, s_clients[0].writable);
+    CHECK(s_clients[0].sent == TEST_BULK_LEN);
+    CHECK(s_servers[0].received == TEST_BULK_LEN);
+    CHECK(!s_servers[0].bad_data);
+    /* re-armed after every write that filled the socket */
+    CHECK(s_clients[0].writable > 1);
+    CHECK(!s_clients[0].conn.want_write);
+
+    /* no WRITABLE without a write that filled the socket */
+    polls = s_clients[0].writable;
+    CHECK(esp_mbedtls_reactor_poll(&s_reactor, 0) == 0);
+    CHECK(s_clients[0].writable == polls);
+
+    close_pairs();
+}
+
+/* WRITABLE and READABLE ready together, the connection removed by WRITABLE */
+static void test_remove_on_writable(void)
+{
+    int size = 4096;
+
+    open_pairs();
+    connect_pairs();
+
+    CHECK(setsockopt(s_clients[0].net.fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)) == 0);
+    CHECK(setsockopt(s_servers[0].net.fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) == 0);
+    s_clients[0].no_read = 1;
+    s_clients[0].remove_on = ESP_MBEDTLS_EVENT_WRITABLE;
+
+    write_bulk(&s_clients[0]);
+    CHECK(s_clients[0].conn.want_write);
+    send_hello(&s_servers[0]);
+
+    for (int i = 0; i < TEST_POLLS && !s_clients[0].writable; i++)
+        esp_mbedtls_reactor_poll(&s_reactor, 1000);
+
+    /* a READABLE of the same poll would have found the connection poisoned */
+    CHECK(s_clients[0].writable == 1 && s_clients[0].removed);
+    size = s_clients[0].readable;
+    CHECK(esp_mbedtls_reactor_poll(&s_reactor, 100) >= 0);
+    CHECK(s_clients[0].readable == size);
+
+    close_pairs();
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 3) {
+        printf("usage: %s certification key\n", argv[0]);
+        return 2;
+    }
+
+    srand(1);
+
+    mbedtls_x509_crt_init(&s_crt);
+    mbedtls_pk_init(&s_key);
+    CHECK(mbedtls_x509_crt_parse_file(&s_crt, argv[1]) == 0);
+    CHECK(mbedtls_pk_parse_keyfile(&s_key, argv[2], NULL) == 0);
+
+    mbedtls_ssl_config_init(&s_client_conf);
+    CHECK(mbedtls_ssl_config_defaults(&s_client_conf, MBEDTLS_SSL_IS_CLIENT,
+                                      MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT) == 0);
+    mbedtls_ssl_conf_authmode(&s_client_conf, MBEDTLS_SSL_VERIFY_NONE);
+    mbedtls_ssl_conf_rng(&s_client_conf, test_rng, NULL);
+
+    mbedtls_ssl_config_init(&s_server_conf);
+    CHECK(mbedtls_ssl_config_defaults(&s_server_conf, MBEDTLS_SSL_IS_SERVER,
+                                      MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT) == 0);
+    mbedtls_ssl_conf_rng(&s_server_conf, test_rng, NULL);
+    CHECK(mbedtls_ssl_conf_own_cert(&s_server_conf, &s_crt, &s_key) == 0);
+
+    if (!s_failed) {
+        test_handshake();
+        test_remove_current();
+        test_remove_cursor();
+        test_want_write();
+        test_remove_on_writable();
+    }
+
+    mbedtls_ssl_config_free(&s_client_conf);
+    mbedtls_ssl_config_free(&s_server_conf);
+    mbedtls_pk_free(&s_key);
+    mbedtls_x509_crt_free(&s_crt);
+
+    printf("%s\n", s_failed ? "FAILED" : "OK");
+    return s_failed ? 1 : 0;
+}
@@ -0,0 +1,114 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _ESP_AES_H_
+#define _ESP_AES_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Software AES which mbedTLS and axTLS (CONFIG_SSL_AES_CONSTANT_TIME) and
+ * wpa_supplicant (CONFIG_WPA_AES_CONSTANT_TIME) can use instead of their own.
+ *
+ * The cipher is computed on bit planes ("bitsliced") with logic operations
+ * only: there are no lookup tables, so the timing does not depend on the key
+ * or the data and nothing is read from flash. This makes it up to 6 times
+ * slower than table-based AES. Two blocks are processed by each pass, which
+ * the CBC decryption and CTR functions use to handle two blocks at a time.
+ */
+
+#define ESP_AES_BLOCK_SIZE 16
+
+/**
+ * @brief AES key schedule, used for both encryption and decryption
+ */
+typedef struct esp_aes {
+    uint32_t nr;                    /*!< number of rounds */
+    uint32_t skey[120];             /*!< bitsliced round keys */
+} esp_aes_t;
+
+/**
+  * @brief Set the AES key
+  *
+  * @param aes     AES context
+  * @param key     key
+  * @param keybits key length in bits: 128, 192 or 256
+  *
+  * @return 0 on success, -1 if the key length is not supported
+  */
+int esp_aes_set_key(esp_aes_t *aes, const void *key, size_t keybits);
+
+/**
+  * @brief Clear the key schedule
+  */
+void esp_aes_clear(esp_aes_t *aes);
+
+/**
+  * @brief Encrypt one block
+  */
+void esp_aes_encrypt(const esp_aes_t *aes, const void *in, void *out);
+
+/**
+  * @brief Decrypt one block
+  */
+void esp_aes_decrypt(const esp_aes_t *aes, const void *in, void *out);
+
+/**
+  * @brief Encrypt data in CBC mode
+  *
+  * @param aes AES context
+  * @param iv  IV, updated for the next call
+  * @param in  input data, may be the same as out
+  * @param out output data
+  * @param len data length, a multiple of ESP_AES_BLOCK_SIZE
+  *
+  * @return 0 on success, -1 if the length is not a multiple of the block size
+  */
+int esp_aes_encrypt_cbc(const esp_aes_t *aes, uint8_t iv[ESP_AES_BLOCK_SIZE], const void *in, void *out, size_t len);
+
+/**
+  * @brief Decrypt data in CBC mode
+  *
+  * Same parameters as esp_aes_encrypt_cbc.
+  */
+int esp_aes_decrypt_cbc(const esp_aes_t *aes, uint8_t iv[ESP_AES_BLOCK_SIZE], const void *in, void *out, size_t len);
+
+/**
+  * @brief Encrypt or decrypt data in CTR mode
+  *
+  * The 128-bit counter is big endian and is incremented for every block. Data
+  * does not have to be a multiple of the block size: the unused key stream of
+  * the last block is kept in stream and *offset for the next call.
+  *
+  * @param aes     AES context
+  * @param offset  offset in stream of the next key stream byte, 0 to start
+  * @param counter counter of the next block, updated
+  * @param stream  key stream of the current block
+  * @param in      input data, may be the same as out
+  * @param out     output data
+  * @param len     data length
+  */
+void esp_aes_crypt_ctr(const esp_aes_t *aes, size_t *offset, uint8_t counter[ESP_AES_BLOCK_SIZE],
+                       uint8_t stream[ESP_AES_BLOCK_SIZE], const void *in, void *out, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ESP_AES_H_ */
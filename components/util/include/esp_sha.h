@@ -0,0 +1,124 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _ESP_SHA_H_
+#define _ESP_SHA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * SHA-1 and SHA-256 shared by mbedTLS, axTLS, wpa_supplicant and the
+ * bootloader.
+ *
+ * Whole blocks are hashed straight from the caller's buffer. When it is word
+ * aligned it is only read with 32-bit loads, so data in IRAM or in the flash
+ * cache can be hashed without copying it first.
+ */
+
+#define ESP_SHA_BLOCK_SIZE      64
+#define ESP_SHA1_DIGEST_LEN     20
+#define ESP_SHA224_DIGEST_LEN   28
+#define ESP_SHA256_DIGEST_LEN   32
+
+typedef enum {
+    ESP_SHA1 = 0,
+    ESP_SHA224,
+    ESP_SHA256,
+} esp_sha_type_t;
+
+/**
+ * @brief Hash context, may be copied to fork a computation
+ */
+typedef struct esp_sha {
+    uint32_t state[8];                  /*!< intermediate hash, 5 words for SHA-1 */
+    uint64_t total;                     /*!< number of bytes hashed */
+    uint32_t buffer[16];                /*!< partial block, as bytes */
+    esp_sha_type_t type;                /*!< algorithm */
+} esp_sha_t;
+
+/**
+  * @brief Start a hash computation
+  *
+  * @param sha  hash context
+  * @param type algorithm
+  */
+void esp_sha_init(esp_sha_t *sha, esp_sha_type_t type);
+
+/**
+  * @brief Hash more data
+  *
+  * @param sha  hash context
+  * @param data data
+  * @param len  data length
+  */
+void esp_sha_update(esp_sha_t *sha, const void *data, size_t len);
+
+/**
+  * @brief Finish a hash computation
+  *
+  * The context has to be initialized again before it is reused.
+  *
+  * @param sha    hash context
+  * @param digest 20, 28 or 32 bytes digest, depending on the algorithm
+  */
+void esp_sha_finish(esp_sha_t *sha, void *digest);
+
+/**
+  * @brief Hash a buffer
+  *
+  * @param type   algorithm
+  * @param data   data
+  * @param len    data length
+  * @param digest 20, 28 or 32 bytes digest, depending on the algorithm
+  */
+void esp_sha(esp_sha_type_t type, const void *data, size_t len, void *digest);
+
+/**
+  * @brief Run the SHA-1 compression function on whole blocks
+  *
+  * @param state  intermediate hash
+  * @param data   blocks
+  * @param blocks number of blocks
+  */
+void esp_sha1_blocks(uint32_t state[5], const void *data, size_t blocks);
+
+/**
+  * @brief Run the SHA-1 compression function on one block given as words
+  *
+  * This is for callers building blocks in registers, as HMAC chains do.
+  *
+  * @param state intermediate hash
+  * @param w     block as 16 big endian words in host order, clobbered
+  */
+void esp_sha1_words(uint32_t state[5], uint32_t w[16]);
+
+/**
+  * @brief Run the SHA-256 compression function on whole blocks
+  *
+  * @param state  intermediate hash
+  * @param data   blocks
+  * @param blocks number of blocks
+  */
+void esp_sha256_blocks(uint32_t state[8], const void *data, size_t blocks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ESP_SHA_H_ */
@@ -0,0 +1,616 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "esp_aes.h"
+
+/*
+ * Constant-time AES on 32-bit words, after the "aes_ct" design of BearSSL.
+ *
+ * The state of two blocks is held in eight words q[0..7]: q[i] holds bit i of
+ * all 32 bytes. ortho() converts between that layout and four little endian
+ * words per block, loaded into the even (first block) and odd (second block)
+ * words. The S-box is the Boyar-Peralta circuit, the inverse S-box is derived
+ * from it through the inverse affine transform, and InvMixColumns is computed
+ * as MixColumns after a multiplication by {04}x^2 + {05}.
+ *
+ * The round keys are expanded in the same layout, eight words per round, and
+ * serve both directions.
+ */
+
+static inline uint32_t load_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void store_le32(uint8_t *p, uint32_t x)
+{
+    p[0] = x;
+    p[1] = x >> 8;
+    p[2] = x >> 16;
+    p[3] = x >> 24;
+}
+
+static inline uint32_t rotr16(uint32_t x)
+{
+    return (x << 16) | (x >> 16);
+}
+
+#define SWAPN(cl, ch, s, x, y)  do { \
+        uint32_t a = (x), b = (y); \
+        (x) = (a & (cl)) | ((b & (cl)) << (s)); \
+        (y) = ((a & (ch)) >> (s)) | (b & (ch)); \
+    } while (0)
+
+#define SWAP2(x, y) SWAPN(0x55555555, 0xAAAAAAAA, 1, x, y)
+#define SWAP4(x, y) SWAPN(0x33333333, 0xCCCCCCCC, 2, x, y)
+#define SWAP8(x, y) SWAPN(0x0F0F0F0F, 0xF0F0F0F0, 4, x, y)
+
+static void ortho(uint32_t *q)
+{
+    SWAP2(q[0], q[1]);
+    SWAP2(q[2], q[3]);
+    SWAP2(q[4], q[5]);
+    SWAP2(q[6], q[7]);
+
+    SWAP4(q[0], q[2]);
+    SWAP4(q[1], q[3]);
+    SWAP4(q[4], q[6]);
+    SWAP4(q[5], q[7]);
+
+    SWAP8(q[0], q[4]);
+    SWAP8(q[1], q[5]);
+    SWAP8(q[2], q[6]);
+    SWAP8(q[3], q[7]);
+}
+
+static void sbox(uint32_t *q)
+{
+    uint32_t x0, x1, x2, x3, x4, x5, x6, x7;
+    uint32_t y1, y2, y3, y4, y5, y6, y7, y8, y9, y10, y11;
+    uint32_t y12, y13, y14, y15, y16, y17, y18, y19, y20, y21;
+    uint32_t z0, z1, z2, z3, z4, z5, z6, z7, z8, z9, z10, z11;
+    uint32_t z12, z13, z14, z15, z16, z17;
+    uint32_t t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11;
+    uint32_t t12, t13, t14, t15, t16, t17, t18, t19, t20, t21, t22;
+    uint32_t t23, t24, t25, t26, t27, t28, t29, t30, t31, t32, t33;
+    uint32_t t34, t35, t36, t37, t38, t39, t40, t41, t42, t43, t44;
+    uint32_t t45, t46, t47, t48, t49, t50, t51, t52, t53, t54, t55;
+    uint32_t t56, t57, t58, t59, t60, t61, t62, t63, t64, t65, t66, t67;
+    uint32_t s0, s1, s2, s3, s4, s5, s6, s7;
+
+    x0 = q[7];
+    x1 = q[6];
+    x2 = q[5];
+    x3 = q[4];
+    x4 = q[3];
+    x5 = q[2];
+    x6 = q[1];
+    x7 = q[0];
+
+    /* top linear transform */
+    y14 = x3 ^ x5;
+    y13 = x0 ^ x6;
+    y9 = x0 ^ x3;
+    y8 = x0 ^ x5;
+    t0 = x1 ^ x2;
+    y1 = t0 ^ x7;
+    y4 = y1 ^ x3;
+    y12 = y13 ^ y14;
+    y2 = y1 ^ x0;
+    y5 = y1 ^ x6;
+    y3 = y5 ^ y8;
+    t1 = x4 ^ y12;
+    y15 = t1 ^ x5;
+    y20 = t1 ^ x1;
+    y6 = y15 ^ x7;
+    y10 = y15 ^ t0;
+    y11 = y20 ^ y9;
+    y7 = x7 ^ y11;
+    y17 = y10 ^ y11;
+    y19 = y10 ^ y8;
+    y16 = t0 ^ y11;
+    y21 = y13 ^ y16;
+    y18 = x0 ^ y16;
+
+    /* non-linear section */
+    t2 = y12 & y15;
+    t3 = y3 & y6;
+    t4 = t3 ^ t2;
+    t5 = y4 & x7;
+    t6 = t5 ^ t2;
+    t7 = y13 & y16;
+    t8 = y5 & y1;
+    t9 = t8 ^ t7;
+    t10 = y2 & y7;
+    t11 = t10 ^ t7;
+    t12 = y9 & y11;
+    t13 = y14 & y17;
+    t14 = t13 ^ t12;
+    t15 = y8 & y10;
+    t16 = t15 ^ t12;
+    t17 = t4 ^ t14;
+    t18 = t6 ^ t16;
+    t19 = t9 ^ t14;
+    t20 = t11 ^ t16;
+    t21 = t17 ^ y20;
+    t22 = t18 ^ y19;
+    t23 = t19 ^ y21;
+    t24 = t20 ^ y18;
+
+    t25 = t21 ^ t22;
+    t26 = t21 & t23;
+    t27 = t24 ^ t26;
+    t28 = t25 & t27;
+    t29 = t28 ^ t22;
+    t30 = t23 ^ t24;
+    t31 = t22 ^ t26;
+    t32 = t31 & t30;
+    t33 = t32 ^ t24;
+    t34 = t23 ^ t33;
+    t35 = t27 ^ t33;
+    t36 = t24 & t35;
+    t37 = t36 ^ t34;
+    t38 = t27 ^ t36;
+    t39 = t29 & t38;
+    t40 = t25 ^ t39;
+
+    t41 = t40 ^ t37;
+    t42 = t29 ^ t33;
+    t43 = t29 ^ t40;
+    t44 = t33 ^ t37;
+    t45 = t42 ^ t41;
+    z0 = t44 & y15;
+    z1 = t37 & y6;
+    z2 = t33 & x7;
+    z3 = t43 & y16;
+    z4 = t40 & y1;
+    z5 = t29 & y7;
+    z6 = t42 & y11;
+    z7 = t45 & y17;
+    z8 = t41 & y10;
+    z9 = t44 & y12;
+    z10 = t37 & y3;
+    z11 = t33 & y4;
+    z12 = t43 & y13;
+    z13 = t40 & y5;
+    z14 = t29 & y2;
+    z15 = t42 & y9;
+    z16 = t45 & y14;
+    z17 = t41 & y8;
+
+    /* bottom linear transform */
+    t46 = z15 ^ z16;
+    t47 = z10 ^ z11;
+    t48 = z5 ^ z13;
+    t49 = z9 ^ z10;
+    t50 = z2 ^ z12;
+    t51 = z2 ^ z5;
+    t52 = z7 ^ z8;
+    t53 = z0 ^ z3;
+    t54 = z6 ^ z7;
+    t55 = z16 ^ z17;
+    t56 = z12 ^ t48;
+    t57 = t50 ^ t53;
+    t58 = z4 ^ t46;
+    t59 = z3 ^ t54;
+    t60 = t46 ^ t57;
+    t61 = z14 ^ t57;
+    t62 = t52 ^ t58;
+    t63 = t49 ^ t58;
+    t64 = z4 ^ t59;
+    t65 = t61 ^ t62;
+    t66 = z1 ^ t63;
+    s0 = t59 ^ t63;
+    s6 = t56 ^ ~t62;
+    s7 = t48 ^ ~t60;
+    t67 = t64 ^ t65;
+    s3 = t53 ^ t66;
+    s4 = t51 ^ t66;
+    s5 = t47 ^ t65;
+    s1 = t64 ^ ~s3;
+    s2 = t55 ^ ~t67;
+
+    q[7] = s0;
+    q[6] = s1;
+    q[5] = s2;
+    q[4] = s3;
+    q[3] = s4;
+    q[2] = s5;
+    q[1] = s6;
+    q[0] = s7;
+}
+
+/* inverse of the S-box affine transform, including the 0x63 constant */
+static void inv_affine(uint32_t *q)
+{
+    uint32_t q0, q1, q2, q3, q4, q5, q6, q7;
+
+    q0 = ~q[0];
+    q1 = ~q[1];
+    q2 = q[2];
+    q3 = q[3];
+    q4 = q[4];
+    q5 = ~q[5];
+    q6 = ~q[6];
+    q7 = q[7];
+    q[7] = q1 ^ q4 ^ q6;
+    q[6] = q0 ^ q3 ^ q5;
+    q[5] = q7 ^ q2 ^ q4;
+    q[4] = q6 ^ q1 ^ q3;
+    q[3] = q5 ^ q0 ^ q2;
+    q[2] = q4 ^ q7 ^ q1;
+    q[1] = q3 ^ q6 ^ q0;
+    q[0] = q2 ^ q5 ^ q7;
+}
+
+/* S(x) = A(I(x)) ^ 0x63 and inversion is an involution, so iS = B o S o B */
+static void inv_sbox(uint32_t *q)
+{
+    inv_affine(q);
+    sbox(q);
+    inv_affine(q);
+}
+
+static void add_round_key(uint32_t *q, const uint32_t *sk)
+{
+    for (int i = 0; i < 8; i++)
+        q[i] ^= sk[i];
+}
+
+static void shift_rows(uint32_t *q)
+{
+    for (int i = 0; i < 8; i++) {
+        uint32_t x = q[i];
+
+        q[i] = (x & 0x000000FF)
+               | ((x & 0x0000FC00) >> 2) | ((x & 0x00000300) << 6)
+               | ((x & 0x00F00000) >> 4) | ((x & 0x000F0000) << 4)
+               | ((x & 0xC0000000) >> 6) | ((x & 0x3F000000) << 2);
+    }
+}
+
+static void inv_shift_rows(uint32_t *q)
+{
+    for (int i = 0; i < 8; i++) {
+        uint32_t x = q[i];
+
+        q[i] = (x & 0x000000FF)
+               | ((x & 0x00003F00) << 2) | ((x & 0x0000C000) >> 6)
+               | ((x & 0x000F0000) << 4) | ((x & 0x00F00000) >> 4)
+               | ((x & 0x03000000) << 6) | ((x & 0xFC000000) >> 2);
+    }
+}
+
+static void mix_columns(uint32_t *q)
+{
+    uint32_t q0, q1, q2, q3, q4, q5, q6, q7;
+    uint32_t r0, r1, r2, r3, r4, r5, r6, r7;
+
+    q0 = q[0];
+    q1 = q[1];
+    q2 = q[2];
+    q3 = q[3];
+    q4 = q[4];
+    q5 = q[5];
+    q6 = q[6];
+    q7 = q[7];
+    r0 = (q0 >> 8) | (q0 << 24);
+    r1 = (q1 >> 8) | (q1 << 24);
+    r2 = (q2 >> 8) | (q2 << 24);
+    r3 = (q3 >> 8) | (q3 << 24);
+    r4 = (q4 >> 8) | (q4 << 24);
+    r5 = (q5 >> 8) | (q5 << 24);
+    r6 = (q6 >> 8) | (q6 << 24);
+    r7 = (q7 >> 8) | (q7 << 24);
+
+    q[0] = q7 ^ r7 ^ r0 ^ rotr16(q0 ^ r0);
+    q[1] = q0 ^ r0 ^ q7 ^ r7 ^ r1 ^ rotr16(q1 ^ r1);
+    q[2] = q1 ^ r1 ^ r2 ^ rotr16(q2 ^ r2);
+    q[3] = q2 ^ r2 ^ q7 ^ r7 ^ r3 ^ rotr16(q3 ^ r3);
+    q[4] = q3 ^ r3 ^ q7 ^ r7 ^ r4 ^ rotr16(q4 ^ r4);
+    q[5] = q4 ^ r4 ^ r5 ^ rotr16(q5 ^ r5);
+    q[6] = q5 ^ r5 ^ r6 ^ rotr16(q6 ^ r6);
+    q[7] = q6 ^ r6 ^ r7 ^ rotr16(q7 ^ r7);
+}
+
+static void inv_mix_columns(uint32_t *q)
+{
+    uint32_t t[8], u[8];
+
+    /* a[i] ^= {04} * (a[i] ^ a[i + 2]) */
+    for (int i = 0; i < 8; i++)
+        t[i] = q[i] ^ rotr16(q[i]);
+
+    /* {02} * t */
+    u[0] = t[7];
+    u[1] = t[0] ^ t[7];
+    u[2] = t[1];
+    u[3] = t[2] ^ t[7];
+    u[4] = t[3] ^ t[7];
+    u[5] = t[4];
+    u[6] = t[5];
+    u[7] = t[6];
+
+    /* {02} * u */
+    q[0] ^= u[7];
+    q[1] ^= u[0] ^ u[7];
+    q[2] ^= u[1];
+    q[3] ^= u[2] ^ u[7];
+    q[4] ^= u[3] ^ u[7];
+    q[5] ^= u[4];
+    q[6] ^= u[5];
+    q[7] ^= u[6];
+
+    mix_columns(q);
+}
+
+static void aes_encrypt_ct(const esp_aes_t *aes, uint32_t *q)
+{
+    const uint32_t *sk = aes->skey;
+
+    add_round_key(q, sk);
+    for (uint32_t u = 1; u < aes->nr; u++) {
+        sbox(q);
+        shift_rows(q);
+        mix_columns(q);
+        add_round_key(q, sk + (u << 3));
+    }
+    sbox(q);
+    shift_rows(q);
+    add_round_key(q, sk + (aes->nr << 3));
+}
+
+static void aes_decrypt_ct(const esp_aes_t *aes, uint32_t *q)
+{
+    const uint32_t *sk = aes->skey;
+
+    add_round_key(q, sk + (aes->nr << 3));
+    for (uint32_t u = aes->nr - 1; u > 0; u--) {
+        inv_shift_rows(q);
+        inv_sbox(q);
+        add_round_key(q, sk + (u << 3));
+        inv_mix_columns(q);
+    }
+    inv_shift_rows(q);
+    inv_sbox(q);
+    add_round_key(q, sk);
+}
+
+/* Load one or two blocks, the second one may be NULL */
+static void aes_load(uint32_t *q, const uint8_t *b0, const uint8_t *b1)
+{
+    for (int i = 0; i < 4; i++) {
+        q[i << 1] = load_le32(b0 + (i << 2));
+        q[(i << 1) + 1] = b1 ? load_le32(b1 + (i << 2)) : 0;
+    }
+    ortho(q);
+}
+
+static void aes_store(uint32_t *q, uint8_t *b0, uint8_t *b1)
+{
+    ortho(q);
+    for (int i = 0; i < 4; i++) {
+        store_le32(b0 + (i << 2), q[i << 1]);
+        if (b1)
+            store_le32(b1 + (i << 2), q[(i << 1) + 1]);
+    }
+}
+
+static uint32_t sub_word(uint32_t x)
+{
+    uint32_t q[8];
+
+    memset(q, 0, sizeof(q));
+    q[0] = x;
+    ortho(q);
+    sbox(q);
+    ortho(q);
+
+    return q[0];
+}
+
+int esp_aes_set_key(esp_aes_t *aes, const void *key, size_t keybits)
+{
+    static const uint8_t rcon[] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36 };
+    const uint8_t *k = key;
+    uint32_t *sk = aes->skey;
+    uint32_t nk, nkf, tmp = 0;
+
+    switch (keybits) {
+    case 128:
+        aes->nr = 10;
+        break;
+    case 192:
+        aes->nr = 12;
+        break;
+    case 256:
+        aes->nr = 14;
+        break;
+    default:
+        return -1;
+    }
+
+    nk = keybits >> 5;
+    nkf = (aes->nr + 1) << 2;
+
+    for (uint32_t i = 0; i < nk; i++) {
+        tmp = load_le32(k + (i << 2));
+        sk[(i << 1)] = tmp;
+        sk[(i << 1) + 1] = tmp;
+    }
+
+    for (uint32_t i = nk, j = 0, r = 0; i < nkf; i++) {
+        if (j == 0) {
+            tmp = (tmp << 24) | (tmp >> 8);
+            tmp = sub_word(tmp) ^ rcon[r];
+        } else if (nk > 6 && j == 4) {
+            tmp = sub_word(tmp);
+        }
+        tmp ^= sk[(i - nk) << 1];
+        sk[(i << 1)] = tmp;
+        sk[(i << 1) + 1] = tmp;
+        if (++j == nk) {
+            j = 0;
+            r++;
+        }
+    }
+
+    for (uint32_t i = 0; i < nkf; i += 4)
+        ortho(sk + (i << 1));
+
+    return 0;
+}
+
+void esp_aes_clear(esp_aes_t *aes)
+{
+    volatile uint8_t *p = (volatile uint8_t *)aes;
+
+    for (size_t i = 0; i < sizeof(*aes); i++)
+        p[i] = 0;
+}
+
+void esp_aes_encrypt(const esp_aes_t *aes, const void *in, void *out)
+{
+    uint32_t q[8];
+
+    aes_load(q, in, NULL);
+    aes_encrypt_ct(aes, q);
+    aes_store(q, out, NULL);
+}
+
+void esp_aes_decrypt(const esp_aes_t *aes, const void *in, void *out)
+{
+    uint32_t q[8];
+
+    aes_load(q, in, NULL);
+    aes_decrypt_ct(aes, q);
+    aes_store(q, out, NULL);
+}
+
+int esp_aes_encrypt_cbc(const esp_aes_t *aes, uint8_t iv[ESP_AES_BLOCK_SIZE], const void *in, void *out, size_t len)
+{
+    const uint8_t *src = in;
+    uint8_t *dst = out;
+    uint32_t q[8];
+
+    if (len % ESP_AES_BLOCK_SIZE)
+        return -1;
+
+    /* each block depends on the previous one, only one lane is used */
+    for (; len; len -= ESP_AES_BLOCK_SIZE) {
+        for (int i = 0; i < ESP_AES_BLOCK_SIZE; i++)
+            iv[i] ^= src[i];
+        aes_load(q, iv, NULL);
+        aes_encrypt_ct(aes, q);
+        aes_store(q, iv, NULL);
+        memcpy(dst, iv, ESP_AES_BLOCK_SIZE);
+        src += ESP_AES_BLOCK_SIZE;
+        dst += ESP_AES_BLOCK_SIZE;
+    }
+
+    return 0;
+}
+
+int esp_aes_decrypt_cbc(const esp_aes_t *aes, uint8_t iv[ESP_AES_BLOCK_SIZE], const void *in, void *out, size_t len)
+{
+    const uint8_t *src = in;
+    uint8_t *dst = out;
+    uint8_t buf[2 * ESP_AES_BLOCK_SIZE], next_iv[ESP_AES_BLOCK_SIZE];
+    uint32_t q[8];
+
+    if (len % ESP_AES_BLOCK_SIZE)
+        return -1;
+
+    while (len) {
+        size_t n = len >= 2 * ESP_AES_BLOCK_SIZE ? 2 * ESP_AES_BLOCK_SIZE : ESP_AES_BLOCK_SIZE;
+
+        aes_load(q, src, n > ESP_AES_BLOCK_SIZE ? src + ESP_AES_BLOCK_SIZE : NULL);
+        memcpy(next_iv, src + n - ESP_AES_BLOCK_SIZE, ESP_AES_BLOCK_SIZE);
+        aes_decrypt_ct(aes, q);
+        aes_store(q, buf, n > ESP_AES_BLOCK_SIZE ? buf + ESP_AES_BLOCK_SIZE : NULL);
+
+        /* src may be dst, the second block is chained to the first ciphertext */
+        for (int i = 0; i < ESP_AES_BLOCK_SIZE; i++)
+            buf[i] ^= iv[i];
+        for (size_t i = ESP_AES_BLOCK_SIZE; i < n; i++)
+            buf[i] ^= src[i - ESP_AES_BLOCK_SIZE];
+        memcpy(dst, buf, n);
+        memcpy(iv, next_iv, ESP_AES_BLOCK_SIZE);
+
+        src += n;
+        dst += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+static void ctr_increment(uint8_t counter[ESP_AES_BLOCK_SIZE])
+{
+    for (int i = ESP_AES_BLOCK_SIZE - 1; i >= 0; i--) {
+        if (++counter[i])
+            break;
+    }
+}
+
+void esp_aes_crypt_ctr(const esp_aes_t *aes, size_t *offset, uint8_t counter[ESP_AES_BLOCK_SIZE],
+                       uint8_t stream[ESP_AES_BLOCK_SIZE], const void *in, void *out, size_t len)
+{
+    const uint8_t *src = in;
+    uint8_t *dst = out;
+    uint8_t ctr2[ESP_AES_BLOCK_SIZE], ks[2 * ESP_AES_BLOCK_SIZE];
+    size_t n = *offset & (ESP_AES_BLOCK_SIZE - 1);
+    uint32_t q[8];
+
+    /* key stream left over by the previous call */
+    while (n && len) {
+        *dst++ = *src++ ^ stream[n];
+        n = (n + 1) & (ESP_AES_BLOCK_SIZE - 1);
+        len--;
+    }
+
+    /* two full blocks per pass */
+    while (len >= 2 * ESP_AES_BLOCK_SIZE) {
+        memcpy(ctr2, counter, ESP_AES_BLOCK_SIZE);
+        ctr_increment(ctr2);
+        aes_load(q, counter, ctr2);
+        aes_encrypt_ct(aes, q);
+        aes_store(q, ks, ks + ESP_AES_BLOCK_SIZE);
+        memcpy(counter, ctr2, ESP_AES_BLOCK_SIZE);
+        ctr_increment(counter);
+
+        for (int i = 0; i < 2 * ESP_AES_BLOCK_SIZE; i++)
+            dst[i] = src[i] ^ ks[i];
+        src += 2 * ESP_AES_BLOCK_SIZE;
+        dst += 2 * ESP_AES_BLOCK_SIZE;
+        len -= 2 * ESP_AES_BLOCK_SIZE;
+    }
+
+    /* last one or two blocks, keep the key stream of the partial one */
+    while (len) {
+        aes_load(q, counter, NULL);
+        aes_encrypt_ct(aes, q);
+        aes_store(q, stream, NULL);
+        ctr_increment(counter);
+
+        for (n = 0; n < ESP_AES_BLOCK_SIZE && len; n++, len--)
+            *dst++ = *src++ ^ stream[n];
+        n &= ESP_AES_BLOCK_SIZE - 1;
+    }
+
+    *offset = n;
+}
@@ -0,0 +1,312 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "esp_sha.h"
+
+/*
+ * The message schedule is kept in a ring of 16 words and computed during the
+ * rounds. SHA-1 is fully unrolled; SHA-256 is unrolled by 8 rounds, which
+ * brings the working variables back in place at the end of each loop pass.
+ */
+
+#define ROL(x, n)   (((x) << (n)) | ((x) >> (32 - (n))))
+#define ROR(x, n)   (((x) >> (n)) | ((x) << (32 - (n))))
+
+static inline uint32_t be32_to_host(uint32_t x)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return x;
+#else
+    x = ((x & 0x00ff00ff) << 8) | ((x >> 8) & 0x00ff00ff);
+    return (x << 16) | (x >> 16);
+#endif
+}
+
+static inline uint32_t load_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline void store_be32(uint8_t *p, uint32_t x)
+{
+    p[0] = x >> 24;
+    p[1] = x >> 16;
+    p[2] = x >> 8;
+    p[3] = x;
+}
+
+static inline void load_block(uint32_t w[16], const uint8_t *p)
+{
+    int i;
+
+    if (((uintptr_t)p & 3) == 0) {
+        const uint32_t *q = (const uint32_t *)p;
+
+        for (i = 0; i < 16; i++)
+            w[i] = be32_to_host(q[i]);
+    } else {
+        for (i = 0; i < 16; i++)
+            w[i] = load_be32(p + i * 4);
+    }
+}
+
+/* SHA-1 */
+
+#define SHA1_F1(b, c, d)    ((d) ^ ((b) & ((c) ^ (d))))
+#define SHA1_F2(b, c, d)    ((b) ^ (c) ^ (d))
+#define SHA1_F3(b, c, d)    (((b) & (c)) | ((d) & ((b) | (c))))
+
+#define SHA1_W(i)           ((i) < 16 ? w[i] : \
+                             (w[(i) & 15] = ROL(w[((i) + 13) & 15] ^ w[((i) + 8) & 15] ^ \
+                                                w[((i) + 2) & 15] ^ w[(i) & 15], 1)))
+
+#define SHA1_ROUND(a, b, c, d, e, f, k, i)  do { \
+        e += ROL(a, 5) + f(b, c, d) + (k) + SHA1_W(i); \
+        b = ROL(b, 30); \
+    } while (0)
+
+#define SHA1_R5(f, k, i)    do { \
+        SHA1_ROUND(a, b, c, d, e, f, k, (i)); \
+        SHA1_ROUND(e, a, b, c, d, f, k, (i) + 1); \
+        SHA1_ROUND(d, e, a, b, c, f, k, (i) + 2); \
+        SHA1_ROUND(c, d, e, a, b, f, k, (i) + 3); \
+        SHA1_ROUND(b, c, d, e, a, f, k, (i) + 4); \
+    } while (0)
+
+void esp_sha1_words(uint32_t state[5], uint32_t w[16])
+{
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+    SHA1_R5(SHA1_F1, 0x5a827999, 0);
+    SHA1_R5(SHA1_F1, 0x5a827999, 5);
+    SHA1_R5(SHA1_F1, 0x5a827999, 10);
+    SHA1_R5(SHA1_F1, 0x5a827999, 15);
+
+    SHA1_R5(SHA1_F2, 0x6ed9eba1, 20);
+    SHA1_R5(SHA1_F2, 0x6ed9eba1, 25);
+    SHA1_R5(SHA1_F2, 0x6ed9eba1, 30);
+    SHA1_R5(SHA1_F2, 0x6ed9eba1, 35);
+
+    SHA1_R5(SHA1_F3, 0x8f1bbcdc, 40);
+    SHA1_R5(SHA1_F3, 0x8f1bbcdc, 45);
+    SHA1_R5(SHA1_F3, 0x8f1bbcdc, 50);
+    SHA1_R5(SHA1_F3, 0x8f1bbcdc, 55);
+
+    SHA1_R5(SHA1_F2, 0xca62c1d6, 60);
+    SHA1_R5(SHA1_F2, 0xca62c1d6, 65);
+    SHA1_R5(SHA1_F2, 0xca62c1d6, 70);
+    SHA1_R5(SHA1_F2, 0xca62c1d6, 75);
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+void esp_sha1_blocks(uint32_t state[5], const void *data, size_t blocks)
+{
+    const uint8_t *p = data;
+    uint32_t w[16];
+
+    for (; blocks; blocks--, p += ESP_SHA_BLOCK_SIZE) {
+        load_block(w, p);
+        esp_sha1_words(state, w);
+    }
+}
+
+/* SHA-256 */
+
+static const uint32_t s_sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define SHA256_S0(x)        (ROR(x, 2) ^ ROR(x, 13) ^ ROR(x, 22))
+#define SHA256_S1(x)        (ROR(x, 6) ^ ROR(x, 11) ^ ROR(x, 25))
+#define SHA256_G0(x)        (ROR(x, 7) ^ ROR(x, 18) ^ ((x) >> 3))
+#define SHA256_G1(x)        (ROR(x, 17) ^ ROR(x, 19) ^ ((x) >> 10))
+#define SHA256_CH(e, f, g)  ((g) ^ ((e) & ((f) ^ (g))))
+#define SHA256_MAJ(a, b, c) (((a) & (b)) | ((c) & ((a) | (b))))
+
+#define SHA256_W0(i)        (w[i])
+#define SHA256_W(i)         (w[(i) & 15] += SHA256_G1(w[((i) + 14) & 15]) + w[((i) + 9) & 15] + \
+                                            SHA256_G0(w[((i) + 1) & 15]))
+
+#define SHA256_ROUND(a, b, c, d, e, f, g, h, W, i)  do { \
+        uint32_t t = h + SHA256_S1(e) + SHA256_CH(e, f, g) + s_sha256_k[i] + W(i); \
+        d += t; \
+        h = t + SHA256_S0(a) + SHA256_MAJ(a, b, c); \
+    } while (0)
+
+#define SHA256_R8(W, i)     do { \
+        SHA256_ROUND(a, b, c, d, e, f, g, h, W, (i)); \
+        SHA256_ROUND(h, a, b, c, d, e, f, g, W, (i) + 1); \
+        SHA256_ROUND(g, h, a, b, c, d, e, f, W, (i) + 2); \
+        SHA256_ROUND(f, g, h, a, b, c, d, e, W, (i) + 3); \
+        SHA256_ROUND(e, f, g, h, a, b, c, d, W, (i) + 4); \
+        SHA256_ROUND(d, e, f, g, h, a, b, c, W, (i) + 5); \
+        SHA256_ROUND(c, d, e, f, g, h, a, b, W, (i) + 6); \
+        SHA256_ROUND(b, c, d, e, f, g, h, a, W, (i) + 7); \
+    } while (0)
+
+void esp_sha256_blocks(uint32_t state[8], const void *data, size_t blocks)
+{
+    const uint8_t *p = data;
+    uint32_t w[16];
+    uint32_t a, b, c, d, e, f, g, h;
+    int i;
+
+    for (; blocks; blocks--, p += ESP_SHA_BLOCK_SIZE) {
+        load_block(w, p);
+
+        a = state[0];
+        b = state[1];
+        c = state[2];
+        d = state[3];
+        e = state[4];
+        f = state[5];
+        g = state[6];
+        h = state[7];
+
+        SHA256_R8(SHA256_W0, 0);
+        SHA256_R8(SHA256_W0, 8);
+        for (i = 16; i < 64; i += 8)
+            SHA256_R8(SHA256_W, i);
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+/* Streaming interface */
+
+static const uint32_t s_sha1_init[5] = {
+    0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+};
+
+static const uint32_t s_sha224_init[8] = {
+    0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939, 0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4
+};
+
+static const uint32_t s_sha256_init[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static void sha_blocks(esp_sha_t *sha, const void *data, size_t blocks)
+{
+    if (sha->type == ESP_SHA1)
+        esp_sha1_blocks(sha->state, data, blocks);
+    else
+        esp_sha256_blocks(sha->state, data, blocks);
+}
+
+void esp_sha_init(esp_sha_t *sha, esp_sha_type_t type)
+{
+    if (type == ESP_SHA1)
+        memcpy(sha->state, s_sha1_init, sizeof(s_sha1_init));
+    else if (type == ESP_SHA224)
+        memcpy(sha->state, s_sha224_init, sizeof(s_sha224_init));
+    else
+        memcpy(sha->state, s_sha256_init, sizeof(s_sha256_init));
+
+    sha->total = 0;
+    sha->type = type;
+}
+
+void esp_sha_update(esp_sha_t *sha, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    size_t used = sha->total & (ESP_SHA_BLOCK_SIZE - 1);
+    size_t blocks;
+
+    sha->total += len;
+
+    if (used) {
+        size_t fill = ESP_SHA_BLOCK_SIZE - used;
+
+        if (len < fill) {
+            memcpy((uint8_t *)sha->buffer + used, p, len);
+            return;
+        }
+
+        memcpy((uint8_t *)sha->buffer + used, p, fill);
+        sha_blocks(sha, sha->buffer, 1);
+        p += fill;
+        len -= fill;
+    }
+
+    blocks = len / ESP_SHA_BLOCK_SIZE;
+    if (blocks) {
+        sha_blocks(sha, p, blocks);
+        p += blocks * ESP_SHA_BLOCK_SIZE;
+        len -= blocks * ESP_SHA_BLOCK_SIZE;
+    }
+
+    if (len)
+        memcpy(sha->buffer, p, len);
+}
+
+void esp_sha_finish(esp_sha_t *sha, void *digest)
+{
+    uint8_t *buf = (uint8_t *)sha->buffer;
+    size_t used = sha->total & (ESP_SHA_BLOCK_SIZE - 1);
+    uint64_t bits = sha->total << 3;
+    int i, words;
+
+    buf[used++] = 0x80;
+    if (used > ESP_SHA_BLOCK_SIZE - 8) {
+        memset(buf + used, 0, ESP_SHA_BLOCK_SIZE - used);
+        sha_blocks(sha, buf, 1);
+        used = 0;
+    }
+    memset(buf + used, 0, ESP_SHA_BLOCK_SIZE - 8 - used);
+    sha->buffer[14] = be32_to_host(bits >> 32);
+    sha->buffer[15] = be32_to_host(bits);
+    sha_blocks(sha, buf, 1);
+
+    if (sha->type == ESP_SHA1)
+        words = ESP_SHA1_DIGEST_LEN / 4;
+    else if (sha->type == ESP_SHA224)
+        words = ESP_SHA224_DIGEST_LEN / 4;
+    else
+        words = ESP_SHA256_DIGEST_LEN / 4;
+
+    for (i = 0; i < words; i++)
+        store_be32((uint8_t *)digest + i * 4, sha->state[i]);
+}
+
+void esp_sha(esp_sha_type_t type, const void *data, size_t len, void *digest)
+{
+    esp_sha_t sha;
+
+    esp_sha_init(&sha, type);
+    esp_sha_update(&sha, data, len);
+    esp_sha_finish(&sha, digest);
+}
@@ -0,0 +1,171 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <unity.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_aes.h"
+
+#define TEST_BUF_LEN    1024
+
+/* FIPS-197 appendix C: key 000102..., plaintext 00112233... */
+static const uint8_t s_plain[16] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+};
+
+static const uint8_t s_cipher_128[16] = {
+    0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+};
+
+static const uint8_t s_cipher_192[16] = {
+    0xdd, 0xa9, 0x7c, 0xa4, 0x86, 0x4c, 0xdf, 0xe0, 0x6e, 0xaf, 0x70, 0xa0, 0xec, 0x0d, 0x71, 0x91
+};
+
+static const uint8_t s_cipher_256[16] = {
+    0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf, 0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89
+};
+
+static void fill_random(uint8_t *buf, size_t len)
+{
+    for (int i = 0; i < len; i++)
+        buf[i] = rand();
+}
+
+TEST_CASE("esp_aes FIPS-197 known answers", "[util]")
+{
+    const uint8_t *cipher[3] = { s_cipher_128, s_cipher_192, s_cipher_256 };
+    uint8_t key[32], buf[16];
+    esp_aes_t aes;
+
+    for (int i = 0; i < sizeof(key); i++)
+        key[i] = i;
+
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL(0, esp_aes_set_key(&aes, key, 128 + 64 * i));
+
+        esp_aes_encrypt(&aes, s_plain, buf);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(cipher[i], buf, 16);
+        esp_aes_decrypt(&aes, buf, buf);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(s_plain, buf, 16);
+    }
+
+    TEST_ASSERT_EQUAL(-1, esp_aes_set_key(&aes, key, 64));
+}
+
+TEST_CASE("esp_aes CBC and CTR match the block functions", "[util]")
+{
+    uint8_t *buf = malloc(4 * TEST_BUF_LEN);
+    uint8_t *plain = buf, *out = plain + TEST_BUF_LEN, *ref = out + TEST_BUF_LEN, *back = ref + TEST_BUF_LEN;
+    uint8_t key[32], iv[16], cbc[16], counter[16], stream[16], block[16];
+    size_t offset;
+    esp_aes_t aes;
+
+    TEST_ASSERT_NOT_NULL(buf);
+    fill_random(key, sizeof(key));
+    fill_random(iv, sizeof(iv));
+    fill_random(plain, TEST_BUF_LEN);
+    TEST_ASSERT_EQUAL(0, esp_aes_set_key(&aes, key, 256));
+
+    /* CBC reference built from single block encryption */
+    memcpy(cbc, iv, 16);
+    for (int i = 0; i < TEST_BUF_LEN; i += 16) {
+        for (int j = 0; j < 16; j++)
+            block[j] = plain[i + j] ^ cbc[j];
+        esp_aes_encrypt(&aes, block, ref + i);
+        memcpy(cbc, ref + i, 16);
+    }
+
+    memcpy(cbc, iv, 16);
+    TEST_ASSERT_EQUAL(0, esp_aes_encrypt_cbc(&aes, cbc, plain, out, TEST_BUF_LEN));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(ref, out, TEST_BUF_LEN);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(ref + TEST_BUF_LEN - 16, cbc, 16);
+
+    /* odd block counts go through the single block path of the 2-block decryption */
+    memcpy(cbc, iv, 16);
+    TEST_ASSERT_EQUAL(0, esp_aes_decrypt_cbc(&aes, cbc, out, back, 48));
+    TEST_ASSERT_EQUAL(0, esp_aes_decrypt_cbc(&aes, cbc, out + 48, back + 48, TEST_BUF_LEN - 48));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(plain, back, TEST_BUF_LEN);
+
+    /* in place */
+    memcpy(cbc, iv, 16);
+    TEST_ASSERT_EQUAL(0, esp_aes_decrypt_cbc(&aes, cbc, out, out, TEST_BUF_LEN));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(plain, out, TEST_BUF_LEN);
+
+    TEST_ASSERT_EQUAL(-1, esp_aes_encrypt_cbc(&aes, cbc, plain, out, 15));
+    TEST_ASSERT_EQUAL(-1, esp_aes_decrypt_cbc(&aes, cbc, plain, out, 17));
+
+    /* CTR reference: big endian counter incremented for every block */
+    memcpy(counter, iv, 16);
+    for (int i = 0; i < TEST_BUF_LEN; i += 16) {
+        esp_aes_encrypt(&aes, counter, block);
+        for (int j = 0; j < 16; j++)
+            ref[i + j] = plain[i + j] ^ block[j];
+        for (int j = 15; j >= 0 && !++counter[j]; j--)
+            ;
+    }
+
+    /* chunks which do not end on block boundaries */
+    memcpy(counter, iv, 16);
+    offset = 0;
+    for (int i = 0, n = 1; i < TEST_BUF_LEN; i += n, n = n * 3 + 1) {
+        if (n > TEST_BUF_LEN - i)
+            n = TEST_BUF_LEN - i;
+        esp_aes_crypt_ctr(&aes, &offset, counter, stream, plain + i, out + i, n);
+    }
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(ref, out, TEST_BUF_LEN);
+
+    esp_aes_clear(&aes);
+    free(buf);
+}
+
+TEST_CASE("esp_aes performance", "[util][timeout=60]")
+{
+    uint8_t *buf = malloc(TEST_BUF_LEN);
+    uint8_t key[16], iv[16], stream[16];
+    TickType_t start, enc_ticks, dec_ticks, ctr_ticks;
+    const int rounds = 64;
+    size_t offset = 0;
+    esp_aes_t aes;
+
+    TEST_ASSERT_NOT_NULL(buf);
+    fill_random(key, sizeof(key));
+    fill_random(iv, sizeof(iv));
+    fill_random(buf, TEST_BUF_LEN);
+    esp_aes_set_key(&aes, key, 128);
+
+    start = xTaskGetTickCount();
+    for (int i = 0; i < rounds; i++)
+        esp_aes_encrypt_cbc(&aes, iv, buf, buf, TEST_BUF_LEN);
+    enc_ticks = xTaskGetTickCount() - start;
+
+    start = xTaskGetTickCount();
+    for (int i = 0; i < rounds; i++)
+        esp_aes_decrypt_cbc(&aes, iv, buf, buf, TEST_BUF_LEN);
+    dec_ticks = xTaskGetTickCount() - start;
+
+    start = xTaskGetTickCount();
+    for (int i = 0; i < rounds; i++)
+        esp_aes_crypt_ctr(&aes, &offset, iv, stream, buf, buf, TEST_BUF_LEN);
+    ctr_ticks = xTaskGetTickCount() - start;
+
+    printf("AES-128 %u KB: CBC encrypt %u ms, CBC decrypt %u ms, CTR %u ms\n", rounds * TEST_BUF_LEN / 1024,
+           enc_ticks * portTICK_PERIOD_MS, dec_ticks * portTICK_PERIOD_MS, ctr_ticks * portTICK_PERIOD_MS);
+
+    free(buf);
+}
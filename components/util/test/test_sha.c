@@ -0,0 +1,126 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <unity.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_sha.h"
+
+#define TEST_BUF_LEN    4096
+
+/* FIPS 180-2 examples */
+static const char s_msg1[] = "abc";
+static const char s_msg2[] = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+
+static const uint8_t s_sha1[2][20] = {
+    { 0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81, 0x6a, 0xba, 0x3e, 0x25, 0x71, 0x78, 0x50, 0xc2, 0x6c,
+      0x9c, 0xd0, 0xd8, 0x9d },
+    { 0x84, 0x98, 0x3e, 0x44, 0x1c, 0x3b, 0xd2, 0x6e, 0xba, 0xae, 0x4a, 0xa1, 0xf9, 0x51, 0x29, 0xe5,
+      0xe5, 0x46, 0x70, 0xf1 },
+};
+
+static const uint8_t s_sha224[2][28] = {
+    { 0x23, 0x09, 0x7d, 0x22, 0x34, 0x05, 0xd8, 0x22, 0x86, 0x42, 0xa4, 0x77, 0xbd, 0xa2, 0x55, 0xb3,
+      0x2a, 0xad, 0xbc, 0xe4, 0xbd, 0xa0, 0xb3, 0xf7, 0xe3, 0x6c, 0x9d, 0xa7 },
+    { 0x75, 0x38, 0x8b, 0x16, 0x51, 0x27, 0x76, 0xcc, 0x5d, 0xba, 0x5d, 0xa1, 0xfd, 0x89, 0x01, 0x50,
+      0xb0, 0xc6, 0x45, 0x5c, 0xb4, 0xf5, 0x8b, 0x19, 0x52, 0x52, 0x25, 0x25 },
+};
+
+static const uint8_t s_sha256[2][32] = {
+    { 0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+      0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad },
+    { 0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39,
+      0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1 },
+};
+
+TEST_CASE("esp_sha known answers", "[util]")
+{
+    const char *msg[2] = { s_msg1, s_msg2 };
+    uint8_t digest[32];
+
+    for (int i = 0; i < 2; i++) {
+        esp_sha(ESP_SHA1, msg[i], strlen(msg[i]), digest);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(s_sha1[i], digest, ESP_SHA1_DIGEST_LEN);
+        esp_sha(ESP_SHA224, msg[i], strlen(msg[i]), digest);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(s_sha224[i], digest, ESP_SHA224_DIGEST_LEN);
+        esp_sha(ESP_SHA256, msg[i], strlen(msg[i]), digest);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(s_sha256[i], digest, ESP_SHA256_DIGEST_LEN);
+    }
+}
+
+TEST_CASE("esp_sha gives the same digest for any split and alignment", "[util]")
+{
+    uint8_t *buf = malloc(TEST_BUF_LEN + 4);
+    uint8_t digest[32], ref[32];
+    esp_sha_t sha;
+
+    TEST_ASSERT_NOT_NULL(buf);
+    for (int i = 0; i < TEST_BUF_LEN + 4; i++)
+        buf[i] = rand();
+
+    for (esp_sha_type_t type = ESP_SHA1; type <= ESP_SHA256; type++) {
+        int len = type == ESP_SHA1 ? ESP_SHA1_DIGEST_LEN :
+                  type == ESP_SHA224 ? ESP_SHA224_DIGEST_LEN : ESP_SHA256_DIGEST_LEN;
+
+        esp_sha(type, buf, TEST_BUF_LEN, ref);
+
+        for (int offset = 1; offset < 4; offset++) {
+            memmove(buf + offset, buf + offset - 1, TEST_BUF_LEN);
+            esp_sha(type, buf + offset, TEST_BUF_LEN, digest);
+            TEST_ASSERT_EQUAL_HEX8_ARRAY(ref, digest, len);
+        }
+        memmove(buf, buf + 3, TEST_BUF_LEN);
+
+        for (int chunk = 1; chunk < 200; chunk += 13) {
+            esp_sha_init(&sha, type);
+            for (int done = 0; done < TEST_BUF_LEN; done += chunk)
+                esp_sha_update(&sha, buf + done, chunk < TEST_BUF_LEN - done ? chunk : TEST_BUF_LEN - done);
+            esp_sha_finish(&sha, digest);
+            TEST_ASSERT_EQUAL_HEX8_ARRAY(ref, digest, len);
+        }
+    }
+
+    free(buf);
+}
+
+TEST_CASE("esp_sha performance", "[util][timeout=60]")
+{
+    uint8_t *buf = malloc(TEST_BUF_LEN);
+    uint8_t digest[32];
+    TickType_t start, sha1_ticks, sha256_ticks;
+    const int rounds = 64;
+
+    TEST_ASSERT_NOT_NULL(buf);
+    memset(buf, 0x5a, TEST_BUF_LEN);
+
+    start = xTaskGetTickCount();
+    for (int i = 0; i < rounds; i++)
+        esp_sha(ESP_SHA1, buf, TEST_BUF_LEN, digest);
+    sha1_ticks = xTaskGetTickCount() - start;
+
+    start = xTaskGetTickCount();
+    for (int i = 0; i < rounds; i++)
+        esp_sha(ESP_SHA256, buf, TEST_BUF_LEN, digest);
+    sha256_ticks = xTaskGetTickCount() - start;
+
+    printf("%u KB: SHA-1 %u ms, SHA-256 %u ms\n", rounds * TEST_BUF_LEN / 1024,
+           sha1_ticks * portTICK_PERIOD_MS, sha256_ticks * portTICK_PERIOD_MS);
+
+    free(buf);
+}
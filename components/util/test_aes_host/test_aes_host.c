@@ -0,0 +1,246 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Checks esp_aes against the FIPS-197 and SP 800-38A known answers and against
+ * the table-based AES of mbedTLS, and compares their speed, which is what the
+ * CONFIG_SSL_AES_CONSTANT_TIME and CONFIG_WPA_AES_CONSTANT_TIME options trade
+ * for a timing that does not depend on the data.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_aes.h"
+#include "mbedtls/aes.h"
+
+#define TEST_BUF_LEN    (16 * 1024)
+#define TEST_CASES      2000
+#define SPEED_ROUNDS    256
+
+static int s_failed;
+
+#define CHECK(cond)     do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            s_failed++; \
+        } \
+    } while (0)
+
+/* FIPS-197 appendix C: key 000102..., plaintext 00112233... */
+static const uint8_t s_fips_plain[16] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+};
+
+static const uint8_t s_fips_cipher[3][16] = {
+    { 0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a },
+    { 0xdd, 0xa9, 0x7c, 0xa4, 0x86, 0x4c, 0xdf, 0xe0, 0x6e, 0xaf, 0x70, 0xa0, 0xec, 0x0d, 0x71, 0x91 },
+    { 0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf, 0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89 },
+};
+
+/* SP 800-38A F.2.1 and F.5.1: CBC-AES128 and CTR-AES128 */
+static const uint8_t s_sp_key[16] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+static const uint8_t s_sp_iv[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+
+static const uint8_t s_sp_counter[16] = {
+    0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff
+};
+
+static const uint8_t s_sp_plain[64] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10,
+};
+
+static const uint8_t s_sp_cbc[64] = {
+    0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46, 0xce, 0xe9, 0x8e, 0x9b, 0x12, 0xe9, 0x19, 0x7d,
+    0x50, 0x86, 0xcb, 0x9b, 0x50, 0x72, 0x19, 0xee, 0x95, 0xdb, 0x11, 0x3a, 0x91, 0x76, 0x78, 0xb2,
+    0x73, 0xbe, 0xd6, 0xb8, 0xe3, 0xc1, 0x74, 0x3b, 0x71, 0x16, 0xe6, 0x9e, 0x22, 0x22, 0x95, 0x16,
+    0x3f, 0xf1, 0xca, 0xa1, 0x68, 0x1f, 0xac, 0x09, 0x12, 0x0e, 0xca, 0x30, 0x75, 0x86, 0xe1, 0xa7,
+};
+
+static const uint8_t s_sp_ctr[64] = {
+    0x87, 0x4d, 0x61, 0x91, 0xb6, 0x20, 0xe3, 0x26, 0x1b, 0xef, 0x68, 0x64, 0x99, 0x0d, 0xb6, 0xce,
+    0x98, 0x06, 0xf6, 0x6b, 0x79, 0x70, 0xfd, 0xff, 0x86, 0x17, 0x18, 0x7b, 0xb9, 0xff, 0xfd, 0xff,
+    0x5a, 0xe4, 0xdf, 0x3e, 0xdb, 0xd5, 0xd3, 0x5e, 0x5b, 0x4f, 0x09, 0x02, 0x0d, 0xb0, 0x3e, 0xab,
+    0x1e, 0x03, 0x1d, 0xda, 0x2f, 0xbe, 0x03, 0xd1, 0x79, 0x21, 0x70, 0xa0, 0xf3, 0x00, 0x9c, 0xee,
+};
+
+static void test_known_answers(void)
+{
+    uint8_t key[32], buf[64], iv[16], stream[16];
+    size_t offset = 0;
+    esp_aes_t aes;
+
+    for (int i = 0; i < sizeof(key); i++)
+        key[i] = i;
+
+    for (int i = 0; i < 3; i++) {
+        CHECK(esp_aes_set_key(&aes, key, 128 + 64 * i) == 0);
+        esp_aes_encrypt(&aes, s_fips_plain, buf);
+        CHECK(!memcmp(buf, s_fips_cipher[i], 16));
+        esp_aes_decrypt(&aes, buf, buf);
+        CHECK(!memcmp(buf, s_fips_plain, 16));
+    }
+    CHECK(esp_aes_set_key(&aes, key, 64) == -1);
+
+    CHECK(esp_aes_set_key(&aes, s_sp_key, 128) == 0);
+
+    memcpy(iv, s_sp_iv, 16);
+    CHECK(esp_aes_encrypt_cbc(&aes, iv, s_sp_plain, buf, 64) == 0);
+    CHECK(!memcmp(buf, s_sp_cbc, 64));
+    memcpy(iv, s_sp_iv, 16);
+    CHECK(esp_aes_decrypt_cbc(&aes, iv, s_sp_cbc, buf, 64) == 0);
+    CHECK(!memcmp(buf, s_sp_plain, 64));
+
+    memcpy(iv, s_sp_counter, 16);
+    esp_aes_crypt_ctr(&aes, &offset, iv, stream, s_sp_plain, buf, 64);
+    CHECK(!memcmp(buf, s_sp_ctr, 64));
+
+    esp_aes_clear(&aes);
+}
+
+/* Random keys, IVs, lengths and alignments against mbedTLS */
+static void test_equivalence(const uint8_t *buf)
+{
+    static uint8_t out[TEST_BUF_LEN], ref[TEST_BUF_LEN];
+
+    for (int i = 0; i < TEST_CASES; i++) {
+        size_t keybits = 128 + 64 * (rand() % 3), len = rand() % (TEST_BUF_LEN / 4 - 8);
+        size_t in_offset = rand() % 8, offset = 0, ref_offset = 0;
+        uint8_t key[32], iv[16], ref_iv[16], stream[16], ref_stream[16];
+        mbedtls_aes_context ctx;
+        esp_aes_t aes;
+
+        for (int j = 0; j < sizeof(key); j++)
+            key[j] = rand();
+        for (int j = 0; j < sizeof(iv); j++)
+            iv[j] = rand();
+        /* counters about to carry into the upper words */
+        if (i % 8 == 0)
+            memset(iv + 8, 0xff, 8);
+
+        CHECK(esp_aes_set_key(&aes, key, keybits) == 0);
+        mbedtls_aes_init(&ctx);
+
+        /* CTR, any length */
+        memcpy(ref_iv, iv, 16);
+        mbedtls_aes_setkey_enc(&ctx, key, keybits);
+        mbedtls_aes_crypt_ctr(&ctx, len, &ref_offset, ref_iv, ref_stream, buf + in_offset, ref);
+        esp_aes_crypt_ctr(&aes, &offset, iv, stream, buf + in_offset, out, len);
+        CHECK(!memcmp(out, ref, len));
+        CHECK(offset == ref_offset && !memcmp(iv, ref_iv, 16));
+
+        /* CBC, whole blocks */
+        len &= ~15;
+        memcpy(ref_iv, iv, 16);
+        mbedtls_aes_crypt_cbc(&ctx, MBEDTLS_AES_ENCRYPT, len, ref_iv, buf + in_offset, ref);
+        CHECK(esp_aes_encrypt_cbc(&aes, iv, buf + in_offset, out, len) == 0);
+        CHECK(!memcmp(out, ref, len) && !memcmp(iv, ref_iv, 16));
+
+        memcpy(ref_iv, iv, 16);
+        mbedtls_aes_setkey_dec(&ctx, key, keybits);
+        mbedtls_aes_crypt_cbc(&ctx, MBEDTLS_AES_DECRYPT, len, ref_iv, buf + in_offset, ref);
+        CHECK(esp_aes_decrypt_cbc(&aes, iv, buf + in_offset, out, len) == 0);
+        CHECK(!memcmp(out, ref, len) && !memcmp(iv, ref_iv, 16));
+
+        mbedtls_aes_free(&ctx);
+        esp_aes_clear(&aes);
+
+        if (s_failed) {
+            printf("mismatch with a %u-bit key, %u bytes\n", (unsigned)keybits, (unsigned)len);
+            break;
+        }
+    }
+}
+
+static double seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void test_speed(uint8_t *buf)
+{
+    const double mb = (double)SPEED_ROUNDS * TEST_BUF_LEN / (1024 * 1024);
+    uint8_t key[16] = { 0 }, iv[16] = { 0 }, stream[16];
+    size_t offset = 0;
+    mbedtls_aes_context enc, dec;
+    double t[7];
+    esp_aes_t aes;
+
+    esp_aes_set_key(&aes, key, 128);
+    mbedtls_aes_init(&enc);
+    mbedtls_aes_init(&dec);
+    mbedtls_aes_setkey_enc(&enc, key, 128);
+    mbedtls_aes_setkey_dec(&dec, key, 128);
+
+    t[0] = seconds();
+    for (int i = 0; i < SPEED_ROUNDS; i++)
+        esp_aes_encrypt_cbc(&aes, iv, buf, buf, TEST_BUF_LEN);
+    t[1] = seconds();
+    for (int i = 0; i < SPEED_ROUNDS; i++)
+        mbedtls_aes_crypt_cbc(&enc, MBEDTLS_AES_ENCRYPT, TEST_BUF_LEN, iv, buf, buf);
+    t[2] = seconds();
+    for (int i = 0; i < SPEED_ROUNDS; i++)
+        esp_aes_decrypt_cbc(&aes, iv, buf, buf, TEST_BUF_LEN);
+    t[3] = seconds();
+    for (int i = 0; i < SPEED_ROUNDS; i++)
+        mbedtls_aes_crypt_cbc(&dec, MBEDTLS_AES_DECRYPT, TEST_BUF_LEN, iv, buf, buf);
+    t[4] = seconds();
+    for (int i = 0; i < SPEED_ROUNDS; i++)
+        esp_aes_crypt_ctr(&aes, &offset, iv, stream, buf, buf, TEST_BUF_LEN);
+    t[5] = seconds();
+    for (int i = 0; i < SPEED_ROUNDS; i++)
+        mbedtls_aes_crypt_ctr(&enc, TEST_BUF_LEN, &offset, iv, stream, buf, buf);
+    t[6] = seconds();
+
+    printf("AES-128 CBC encrypt: esp_aes %.1f MB/s, mbedTLS %.1f MB/s\n", mb / (t[1] - t[0]), mb / (t[2] - t[1]));
+    printf("AES-128 CBC decrypt: esp_aes %.1f MB/s, mbedTLS %.1f MB/s\n", mb / (t[3] - t[2]), mb / (t[4] - t[3]));
+    printf("AES-128 CTR:         esp_aes %.1f MB/s, mbedTLS %.1f MB/s\n", mb / (t[5] - t[4]), mb / (t[6] - t[5]));
+
+    mbedtls_aes_free(&enc);
+    mbedtls_aes_free(&dec);
+}
+
+int main(void)
+{
+    uint8_t *buf = malloc(TEST_BUF_LEN);
+
+    if (!buf)
+        return 1;
+
+    srand(1);
+    for (int i = 0; i < TEST_BUF_LEN; i++)
+        buf[i] = rand();
+
+    test_known_answers();
+    test_equivalence(buf);
+    test_speed(buf);
+
+    free(buf);
+
+    printf("%s\n", s_failed ? "FAILED" : "OK");
+    return s_failed ? 1 : 0;
+}
@@ -0,0 +1,148 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Checks esp_sha against the SHA-1 and SHA-256 of mbedTLS, which were the
+ * reference for the code it replaced in axTLS and wpa_supplicant, and compares
+ * their speed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_sha.h"
+#include "mbedtls/sha1.h"
+#include "mbedtls/sha256.h"
+
+#define TEST_BUF_LEN    (64 * 1024)
+#define TEST_CASES      5000
+#define SPEED_ROUNDS    256
+
+static int s_failed;
+
+#define CHECK(cond)     do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            s_failed++; \
+        } \
+    } while (0)
+
+static size_t digest_len(esp_sha_type_t type)
+{
+    return type == ESP_SHA1 ? ESP_SHA1_DIGEST_LEN : type == ESP_SHA224 ? ESP_SHA224_DIGEST_LEN : ESP_SHA256_DIGEST_LEN;
+}
+
+static void reference(esp_sha_type_t type, const uint8_t *data, size_t len, uint8_t *digest)
+{
+    if (type == ESP_SHA1)
+        mbedtls_sha1_ret(data, len, digest);
+    else
+        mbedtls_sha256_ret(data, len, digest, type == ESP_SHA224);
+}
+
+/* Random lengths, alignments and update sizes */
+static void test_equivalence(const uint8_t *buf)
+{
+    static const size_t lens[] = { 0, 1, 55, 56, 63, 64, 65, 119, 120, 128 };
+    uint8_t digest[32], ref[32];
+
+    for (int i = 0; i < TEST_CASES; i++) {
+        esp_sha_type_t type = rand() % 3;
+        size_t len = i < 100 ? lens[i % 10] : rand() % (TEST_BUF_LEN - 8);
+        size_t offset = rand() % 8, chunk = 1 + rand() % 200, done;
+        esp_sha_t sha;
+
+        if (rand() & 1)
+            chunk *= 64;
+
+        esp_sha_init(&sha, type);
+        for (done = 0; done < len; done += chunk)
+            esp_sha_update(&sha, buf + offset + done, chunk < len - done ? chunk : len - done);
+        esp_sha_finish(&sha, digest);
+
+        reference(type, buf + offset, len, ref);
+        CHECK(!memcmp(digest, ref, digest_len(type)));
+
+        esp_sha(type, buf + offset, len, digest);
+        CHECK(!memcmp(digest, ref, digest_len(type)));
+    }
+}
+
+/* SHA-1 of one block given as words, the way the PBKDF2 of wpa_supplicant does */
+static void test_sha1_words(const uint8_t *buf)
+{
+    uint32_t state[5] = { 1, 2, 3, 4, 5 }, ref[5] = { 1, 2, 3, 4, 5 }, w[16];
+
+    for (int i = 0; i < 16; i++)
+        w[i] = ((uint32_t)buf[i * 4] << 24) | (buf[i * 4 + 1] << 16) | (buf[i * 4 + 2] << 8) | buf[i * 4 + 3];
+
+    esp_sha1_words(state, w);
+    esp_sha1_blocks(ref, buf, 1);
+    CHECK(!memcmp(state, ref, sizeof(state)));
+}
+
+static double seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void test_speed(const uint8_t *buf)
+{
+    const double mb = (double)SPEED_ROUNDS * TEST_BUF_LEN / (1024 * 1024);
+    uint8_t digest[32];
+    double t0, t1, t2, t3, t4;
+
+    t0 = seconds();
+    for (int i = 0; i < SPEED_ROUNDS; i++)
+        esp_sha(ESP_SHA1, buf, TEST_BUF_LEN, digest);
+    t1 = seconds();
+    for (int i = 0; i < SPEED_ROUNDS; i++)
+        mbedtls_sha1_ret(buf, TEST_BUF_LEN, digest);
+    t2 = seconds();
+    for (int i = 0; i < SPEED_ROUNDS; i++)
+        esp_sha(ESP_SHA256, buf, TEST_BUF_LEN, digest);
+    t3 = seconds();
+    for (int i = 0; i < SPEED_ROUNDS; i++)
+        mbedtls_sha256_ret(buf, TEST_BUF_LEN, digest, 0);
+    t4 = seconds();
+
+    printf("SHA-1:   esp_sha %.1f MB/s, mbedTLS %.1f MB/s\n", mb / (t1 - t0), mb / (t2 - t1));
+    printf("SHA-256: esp_sha %.1f MB/s, mbedTLS %.1f MB/s\n", mb / (t3 - t2), mb / (t4 - t3));
+}
+
+int main(void)
+{
+    uint8_t *buf = malloc(TEST_BUF_LEN);
+
+    if (!buf)
+        return 1;
+
+    srand(1);
+    for (int i = 0; i < TEST_BUF_LEN; i++)
+        buf[i] = rand();
+
+    test_equivalence(buf);
+    test_sha1_words(buf);
+    test_speed(buf);
+
+    free(buf);
+
+    printf("%s\n", s_failed ? "FAILED" : "OK");
+    return s_failed ? 1 : 0;
+}
@@ -1,4 +1,16 @@
 COMPONENT_ADD_INCLUDEDIRS := include port/include
 COMPONENT_SRCDIRS := src/crypto port
 
-CFLAGS += -DEMBEDDED_SUPP -D__ets__ -DESPRESSIF_USE
\ No newline at end of file
+ifdef CONFIG_WPA_AES_CONSTANT_TIME
+# AES comes from the util component, see port/esp_aes_internal.c
+COMPONENT_OBJEXCLUDE := src/crypto/aes-internal.o src/crypto/aes-internal-enc.o \
+                        src/crypto/aes-internal-dec.o src/crypto/aes-cbc.o
+else
+COMPONENT_OBJEXCLUDE := port/esp_aes_internal.o
+endif
+
+CFLAGS += -DEMBEDDED_SUPP -D__ets__ -DESPRESSIF_USE
+
+ifdef CONFIG_WPA_PMK_CACHE
+COMPONENT_ADD_LDFLAGS += -Wl,--wrap=pbkdf2_sha1
+endif
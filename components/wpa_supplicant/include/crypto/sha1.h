@@ -17,6 +17,26 @@
 
 #define SHA1_MAC_LEN 20
 
+/**
+ * struct hmac_sha1_ctx - HMAC-SHA1 key schedule
+ * @istate: SHA-1 state after hashing the K XOR ipad block
+ * @ostate: SHA-1 state after hashing the K XOR opad block
+ *
+ * Computing these once per key saves two of the four SHA-1 compressions of
+ * every HMAC over a short message.
+ */
+struct hmac_sha1_ctx {
+	uint32_t istate[5];
+	uint32_t ostate[5];
+};
+
+int hmac_sha1_ctx_init(struct hmac_sha1_ctx *ctx, const uint8_t *key,
+		       size_t key_len);
+int hmac_sha1_ctx_vector(const struct hmac_sha1_ctx *ctx, size_t num_elem,
+			 const uint8_t *addr[], const size_t *len,
+			 uint8_t *mac);
+void hmac_sha1_ctx_chain(const struct hmac_sha1_ctx *ctx, uint32_t u[5]);
+
 int hmac_sha1_vector(const uint8_t *key, size_t key_len, size_t num_elem,
 		     const uint8_t *addr[], const size_t *len, uint8_t *mac);
 int hmac_sha1(const uint8_t *key, size_t key_len, const uint8_t *data, size_t data_len,
@@ -15,10 +15,11 @@
 #ifndef SHA1_I_H
 #define SHA1_I_H
 
+#include "esp_sha.h"
+
+/* SHA-1 is computed by the shared implementation of the util component */
 struct SHA1Context {
-	u32 state[5];
-	u32 count[2];
-	unsigned char buffer[64];
+	esp_sha_t sha;
 };
 
 void SHA1Init(struct SHA1Context *context);
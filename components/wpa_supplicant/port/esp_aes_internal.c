@@ -0,0 +1,103 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "crypto/includes.h"
+#include "crypto/common.h"
+#include "crypto/aes.h"
+#include "crypto/aes_wrap.h"
+
+#include "esp_aes.h"
+
+/*
+ * With CONFIG_WPA_AES_CONSTANT_TIME, aes-internal*.c and aes-cbc.c are
+ * replaced by the shared AES of the util component (see component.mk). The
+ * same key schedule serves encryption and decryption.
+ */
+
+static void *aes_init(const u8 *key, size_t len)
+{
+    esp_aes_t *aes = os_malloc(sizeof(*aes));
+
+    if (aes == NULL)
+        return NULL;
+
+    if (esp_aes_set_key(aes, key, len * 8)) {
+        os_free(aes);
+        return NULL;
+    }
+
+    return aes;
+}
+
+static void aes_deinit(void *ctx)
+{
+    esp_aes_clear(ctx);
+    os_free(ctx);
+}
+
+void *aes_encrypt_init(const u8 *key, size_t len)
+{
+    return aes_init(key, len);
+}
+
+void aes_encrypt(void *ctx, const u8 *plain, u8 *crypt)
+{
+    esp_aes_encrypt(ctx, plain, crypt);
+}
+
+void aes_encrypt_deinit(void *ctx)
+{
+    aes_deinit(ctx);
+}
+
+void *aes_decrypt_init(const u8 *key, size_t len)
+{
+    return aes_init(key, len);
+}
+
+void aes_decrypt(void *ctx, const u8 *crypt, u8 *plain)
+{
+    esp_aes_decrypt(ctx, crypt, plain);
+}
+
+void aes_decrypt_deinit(void *ctx)
+{
+    aes_deinit(ctx);
+}
+
+int aes_128_cbc_encrypt(const u8 *key, const u8 *iv, u8 *data, size_t data_len)
+{
+    esp_aes_t aes;
+    u8 cbc[AES_BLOCK_SIZE];
+
+    esp_aes_set_key(&aes, key, 128);
+    os_memcpy(cbc, iv, AES_BLOCK_SIZE);
+    esp_aes_encrypt_cbc(&aes, cbc, data, data, data_len & ~(AES_BLOCK_SIZE - 1));
+    esp_aes_clear(&aes);
+
+    return 0;
+}
+
+int aes_128_cbc_decrypt(const u8 *key, const u8 *iv, u8 *data, size_t data_len)
+{
+    esp_aes_t aes;
+    u8 cbc[AES_BLOCK_SIZE];
+
+    esp_aes_set_key(&aes, key, 128);
+    os_memcpy(cbc, iv, AES_BLOCK_SIZE);
+    esp_aes_decrypt_cbc(&aes, cbc, data, data, data_len & ~(AES_BLOCK_SIZE - 1));
+    esp_aes_clear(&aes);
+
+    return 0;
+}
@@ -0,0 +1,136 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sdkconfig.h"
+
+#ifdef CONFIG_WPA_PMK_CACHE
+
+#include "crypto/includes.h"
+#include "crypto/common.h"
+#include "crypto/sha1.h"
+#include "crypto/crypto.h"
+
+#include "esp_log.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_pmk_cache.h"
+
+#define PMK_CACHE_NAMESPACE     "wpa_pmk"
+#define PMK_CACHE_KEY           "cache"
+
+#define PMK_LEN                 32
+#define PMK_ITERATIONS          4096
+
+/*
+ * The whole cache is one NVS blob, newest entry first. An entry is matched by
+ * a SHA-1 over the SSID and passphrase so that the passphrase itself is never
+ * written to flash by this module.
+ */
+typedef struct {
+    u8 id[SHA1_MAC_LEN];
+    u8 pmk[PMK_LEN];
+} pmk_cache_entry_t;
+
+static const char *TAG = "pmk_cache";
+
+int __real_pbkdf2_sha1(const char *passphrase, const char *ssid, size_t ssid_len,
+                       int iterations, u8 *buf, size_t buflen);
+
+static void pmk_cache_id(const char *passphrase, const char *ssid, size_t ssid_len, u8 *id)
+{
+    u8 len = ssid_len;
+    const u8 *addr[3] = { &len, (const u8 *)ssid, (const u8 *)passphrase };
+    size_t lens[3] = { 1, ssid_len, os_strlen(passphrase) };
+
+    sha1_vector(3, addr, lens, id);
+}
+
+/*
+ * The closed Wi-Fi libraries derive the station PMK through pbkdf2_sha1, which
+ * is wrapped at link time. Only the WPA2-PSK derivation goes through the cache,
+ * any other use of PBKDF2 is passed on unchanged.
+ */
+int __wrap_pbkdf2_sha1(const char *passphrase, const char *ssid, size_t ssid_len,
+                       int iterations, u8 *buf, size_t buflen)
+{
+    pmk_cache_entry_t cache[CONFIG_WPA_PMK_CACHE_SIZE];
+    u8 id[SHA1_MAC_LEN];
+    size_t size = sizeof(cache);
+    nvs_handle handle;
+    TickType_t start;
+    int ret;
+
+    if (iterations != PMK_ITERATIONS || buflen != PMK_LEN)
+        return __real_pbkdf2_sha1(passphrase, ssid, ssid_len, iterations, buf, buflen);
+
+    if (nvs_open(PMK_CACHE_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        ESP_LOGD(TAG, "NVS is not available");
+        return __real_pbkdf2_sha1(passphrase, ssid, ssid_len, iterations, buf, buflen);
+    }
+
+    pmk_cache_id(passphrase, ssid, ssid_len, id);
+
+    if (nvs_get_blob(handle, PMK_CACHE_KEY, cache, &size) != ESP_OK || size != sizeof(cache))
+        os_memset(cache, 0, sizeof(cache));
+
+    for (int i = 0; i < CONFIG_WPA_PMK_CACHE_SIZE; i++) {
+        if (!os_memcmp(cache[i].id, id, SHA1_MAC_LEN)) {
+            os_memcpy(buf, cache[i].pmk, PMK_LEN);
+            ESP_LOGI(TAG, "hit for \"%.*s\"", (int)ssid_len, ssid);
+            ret = 0;
+            goto out;
+        }
+    }
+
+    start = xTaskGetTickCount();
+    ret = __real_pbkdf2_sha1(passphrase, ssid, ssid_len, iterations, buf, buflen);
+    ESP_LOGI(TAG, "miss for \"%.*s\", PMK derived in %u ms", (int)ssid_len, ssid,
+             (xTaskGetTickCount() - start) * portTICK_PERIOD_MS);
+    if (ret)
+        goto out;
+
+    os_memmove(&cache[1], &cache[0], sizeof(cache) - sizeof(cache[0]));
+    os_memcpy(cache[0].id, id, SHA1_MAC_LEN);
+    os_memcpy(cache[0].pmk, buf, PMK_LEN);
+
+    if (nvs_set_blob(handle, PMK_CACHE_KEY, cache, sizeof(cache)) != ESP_OK || nvs_commit(handle) != ESP_OK)
+        ESP_LOGW(TAG, "failed to store PMK");
+
+out:
+    os_memset(cache, 0, sizeof(cache));
+    nvs_close(handle);
+
+    return ret;
+}
+
+esp_err_t esp_pmk_cache_clear(void)
+{
+    nvs_handle handle;
+    esp_err_t ret;
+
+    if ((ret = nvs_open(PMK_CACHE_NAMESPACE, NVS_READWRITE, &handle)) != ESP_OK)
+        return ret;
+
+    ret = nvs_erase_key(handle, PMK_CACHE_KEY);
+    if (ret == ESP_ERR_NVS_NOT_FOUND)
+        ret = ESP_OK;
+    if (ret == ESP_OK)
+        ret = nvs_commit(handle);
+    nvs_close(handle);
+
+    return ret;
+}
+
+#endif /* CONFIG_WPA_PMK_CACHE */
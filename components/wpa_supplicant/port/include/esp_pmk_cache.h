@@ -0,0 +1,42 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _ESP_PMK_CACHE_H_
+#define _ESP_PMK_CACHE_H_
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Drop all PMKs cached in NVS
+ *
+ * With CONFIG_WPA_PMK_CACHE the station PMK is derived once per SSID and
+ * passphrase and then read back from NVS. A changed passphrase already misses
+ * the cache, so this is only needed to wipe the stored keys, e.g. on a
+ * factory reset.
+ *
+ * @return
+ *    - ESP_OK: the cache is empty
+ *    - others: failed to open or erase the NVS namespace
+ */
+esp_err_t esp_pmk_cache_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ESP_PMK_CACHE_H_ */
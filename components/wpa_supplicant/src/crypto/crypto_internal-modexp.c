@@ -19,6 +19,296 @@
 #include "crypto/crypto.h"
 
 
+/*
+ * Montgomery exponentiation on 32-bit words
+ *
+ * libtommath works on 28-bit digits (55 of them for 1536 bits against 48
+ * full words) and allocates every intermediate value. For the odd moduli
+ * used by Diffie-Hellman (WPS uses the 1536-bit group 5 prime) the
+ * exponentiation below keeps everything in plain u32 arrays, interleaves
+ * the multiplication with the Montgomery reduction, computes the cross
+ * products of a squaring only once, and scans the exponent in fixed 4-bit
+ * windows, which map directly onto the nibbles of the big endian exponent.
+ *
+ * With the DH generator 2 the window table is implicit: multiplying by 2^d
+ * is d modular doublings, which cost a few word operations each instead of
+ * a full Montgomery multiplication.
+ *
+ * This is not a constant time exponentiation, no more than libtommath's:
+ * leading zero nibbles of the exponent are skipped, each nibble selects a
+ * table entry or a number of doublings, and the final subtractions depend
+ * on the values. The time of one exponentiation leaks the exponent, which
+ * is acceptable for the ephemeral DH private values of WPS only.
+ */
+
+#define MONT_WINDOW		4
+#define MONT_TABLE_SIZE		(1 << MONT_WINDOW)
+#define MONT_MAX_WORDS		128	/* 4096-bit moduli */
+
+struct mont_ctx {
+	const u32 *m;
+	u32 minv;	/* -m^-1 mod 2^32 */
+	size_t n;
+	u32 *t;		/* quotient digits, n words */
+};
+
+
+static int
+mont_set_bytes(u32 *a, size_t n, const u8 *buf, size_t len)
+{
+	size_t i;
+
+	os_memset(a, 0, n * sizeof(u32));
+	for (i = 0; i < len; i++) {
+		size_t pos = len - 1 - i;
+
+		if (i / 4 >= n) {
+			if (buf[pos])
+				return -1;
+			continue;
+		}
+		a[i / 4] |= (u32) buf[pos] << (8 * (i % 4));
+	}
+	return 0;
+}
+
+
+static int
+mont_get_bytes(const u32 *a, size_t n, u8 *buf, size_t *len)
+{
+	size_t need = n * 4, i;
+
+	while (need && !((a[(need - 1) / 4] >> (8 * ((need - 1) % 4))) & 0xff))
+		need--;
+	if (need > *len) {
+		*len = need;
+		return -1;
+	}
+	for (i = 0; i < need; i++)
+		buf[need - 1 - i] = a[i / 4] >> (8 * (i % 4));
+	*len = need;
+	return 0;
+}
+
+
+static int
+mont_cmp(const u32 *a, const u32 *b, size_t n)
+{
+	while (n--) {
+		if (a[n] != b[n])
+			return a[n] > b[n] ? 1 : -1;
+	}
+	return 0;
+}
+
+
+static u32
+mont_sub(u32 *r, const u32 *a, const u32 *b, size_t n)
+{
+	u64 c = 0;
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		c = (u64) a[i] - b[i] - c;
+		r[i] = (u32) c;
+		c = (c >> 32) & 1;
+	}
+	return (u32) c;
+}
+
+
+/* a = 2 * a mod m, a < m */
+static void
+mont_double(struct mont_ctx *ctx, u32 *a)
+{
+	u32 top = a[ctx->n - 1] >> 31;
+	size_t i;
+
+	for (i = ctx->n - 1; i > 0; i--)
+		a[i] = (a[i] << 1) | (a[i - 1] >> 31);
+	a[0] <<= 1;
+	if (top || mont_cmp(a, ctx->m, ctx->n) >= 0)
+		mont_sub(a, a, ctx->m, ctx->n);
+}
+
+
+/* 96-bit column accumulator: hi:lo += x * y */
+#define MONT_MAC(x, y)						\
+	do {							\
+		u64 p = (u64) (x) * (y);			\
+		lo += p;					\
+		hi += lo < p;					\
+	} while (0)
+
+/*
+ * r = a * b * R^-1 mod m, r may alias a or b
+ *
+ * The product and the reduction are interleaved column by column (product
+ * scanning), so the only scratch memory is the n words of quotient digits.
+ * When a == b the cross products a[j] * a[i - j] are only computed once and
+ * doubled.
+ */
+static void
+mont_mul(struct mont_ctx *ctx, u32 *r, const u32 *a, const u32 *b)
+{
+	const u32 *m = ctx->m;
+	u32 *q = ctx->t, hi = 0;
+	size_t n = ctx->n, i, j;
+	u64 lo = 0;
+
+	for (i = 0; i < 2 * n - 1; i++) {
+		size_t first = i < n ? 0 : i - n + 1;
+		size_t last = i < n ? i : n - 1;
+
+		if (a == b) {
+			u64 lo2 = lo;
+			u32 hi2 = hi;
+
+			lo = 0;
+			hi = 0;
+			for (j = first; j < i - j; j++)
+				MONT_MAC(a[j], a[i - j]);
+			hi = (hi << 1) | (u32) (lo >> 63);
+			lo <<= 1;
+			lo += lo2;
+			hi += hi2 + (lo < lo2);
+			if (!(i & 1))
+				MONT_MAC(a[i / 2], a[i / 2]);
+		} else {
+			for (j = first; j <= last; j++)
+				MONT_MAC(a[j], b[i - j]);
+		}
+
+		for (j = first; j < (i < n ? i : n); j++)
+			MONT_MAC(q[j], m[i - j]);
+		if (i < n) {
+			/* choose q[i] so that the low word of the column is zero */
+			q[i] = (u32) lo * ctx->minv;
+			MONT_MAC(q[i], m[0]);
+		} else {
+			r[i - n] = (u32) lo;
+		}
+
+		lo = (lo >> 32) | ((u64) hi << 32);
+		hi = 0;
+	}
+	r[n - 1] = (u32) lo;
+
+	/* a * b * R^-1 < 2m */
+	if ((lo >> 32) || mont_cmp(r, m, n) >= 0)
+		mont_sub(r, r, m, n);
+}
+
+
+/* one = R mod m */
+static void
+mont_one(struct mont_ctx *ctx, u32 *one)
+{
+	size_t n = ctx->n, bits = 32 * n, i;
+
+	/* start from the top bit of m, 2^(bits(m) - 1) < m */
+	while (!((ctx->m[(bits - 1) / 32] >> ((bits - 1) % 32)) & 1))
+		bits--;
+	os_memset(one, 0, n * sizeof(u32));
+	one[(bits - 1) / 32] = (u32) 1 << ((bits - 1) % 32);
+	for (i = bits - 1; i < 32 * n; i++)
+		mont_double(ctx, one);
+}
+
+
+static int
+mont_exp(const u8 *base, size_t base_len, const u8 *power, size_t power_len,
+	 const u8 *modulus, size_t modulus_len, u8 *result,
+	 size_t *result_len)
+{
+	struct mont_ctx ctx;
+	u32 *m, *acc, *tmp, *table = NULL;
+	size_t n = (modulus_len + 3) / 4, i;
+	int generator2, started = 0, ret = -1;
+	u32 x;
+
+	m = os_malloc(4 * n * sizeof(u32));
+	if (m == NULL)
+		return -1;
+	acc = m + n;
+	tmp = acc + n;
+	ctx.t = tmp + n;
+	ctx.m = m;
+	ctx.n = n;
+
+	mont_set_bytes(m, n, modulus, modulus_len);
+	while (ctx.n > 1 && !m[ctx.n - 1])
+		ctx.n--;
+	n = ctx.n;
+
+	/* Newton iteration for m[0]^-1 mod 2^32, each step doubles the bits */
+	x = m[0];
+	for (i = 0; i < 4; i++)
+		x *= 2 - m[0] * x;
+	ctx.minv = -x;
+
+	/* base in acc, the base must already be reduced */
+	if (mont_set_bytes(acc, n, base, base_len) < 0 ||
+	    mont_cmp(acc, m, n) >= 0)
+		goto out;
+	generator2 = acc[0] == 2;
+	for (i = 1; generator2 && i < n; i++)
+		generator2 = !acc[i];
+
+	if (!generator2) {
+		/* table[d] = base^d * R mod m */
+		table = os_malloc(MONT_TABLE_SIZE * n * sizeof(u32));
+		if (table == NULL)
+			goto out;
+		mont_one(&ctx, table);
+
+		/* base * R mod m = base * (R^2 mod m) * R^-1 */
+		os_memcpy(table + n, table, n * sizeof(u32));
+		for (i = 0; i < 32 * n; i++)
+			mont_double(&ctx, table + n);
+		mont_mul(&ctx, table + n, acc, table + n);
+		for (i = 2; i < MONT_TABLE_SIZE; i++)
+			mont_mul(&ctx, table + i * n, table + (i - 1) * n,
+				 table + n);
+	}
+
+	mont_one(&ctx, acc);
+	for (i = 0; i < 2 * power_len; i++) {
+		u32 d = (power[i / 2] >> (i % 2 ? 0 : 4)) & 0xf, k;
+
+		if (!started && !d)
+			continue;
+		if (started) {
+			for (k = 0; k < MONT_WINDOW; k++)
+				mont_mul(&ctx, acc, acc, acc);
+		}
+		started = 1;
+
+		if (generator2) {
+			for (k = 0; k < d; k++)
+				mont_double(&ctx, acc);
+		} else {
+			mont_mul(&ctx, acc, acc, table + d * n);
+		}
+	}
+
+	/* leave the Montgomery domain: acc * 1 * R^-1 */
+	os_memset(tmp, 0, n * sizeof(u32));
+	tmp[0] = 1;
+	mont_mul(&ctx, acc, acc, tmp);
+
+	ret = mont_get_bytes(acc, n, result, result_len);
+
+out:
+	if (table) {
+		os_memset(table, 0, MONT_TABLE_SIZE * n * sizeof(u32));
+		os_free(table);
+	}
+	os_memset(m, 0, 4 * n * sizeof(u32));
+	os_free(m);
+	return ret;
+}
+
 int 
 crypto_mod_exp(const u8 *base, size_t base_len,
 		   const u8 *power, size_t power_len,
@@ -28,6 +318,19 @@ crypto_mod_exp(const u8 *base, size_t base_len,
 	struct bignum *bn_base, *bn_exp, *bn_modulus, *bn_result;
 	int ret = -1;
 
+	if (modulus_len && modulus_len <= MONT_MAX_WORDS * 4 &&
+	    (modulus[modulus_len - 1] & 1)) {
+		size_t len = *result_len;
+
+		ret = mont_exp(base, base_len, power, power_len, modulus,
+			       modulus_len, result, &len);
+		if (ret == 0 || len > *result_len) {
+			*result_len = len;
+			return ret;
+		}
+		/* base not reduced modulo the modulus */
+	}
+
 	bn_base = bignum_init();
 	bn_exp = bignum_init();
 	bn_modulus = bignum_init();
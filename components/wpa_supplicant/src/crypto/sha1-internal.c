@@ -23,6 +23,7 @@
 typedef struct SHA1Context SHA1_CTX;
 
 void SHA1Transform(u32 state[5], const unsigned char buffer[64]);
+static void SHA1TransformWords(u32 state[5], u32 block[16]);
 
 
 /**
@@ -47,267 +48,162 @@ sha1_vector(size_t num_elem, const u8 *addr[], const size_t *len, u8 *mac)
 }
 
 
-/* ===== start - public domain SHA1 implementation ===== */
+/**
+ * hmac_sha1_ctx_init - Precompute the HMAC-SHA1 pads for a key (RFC 2104)
+ * @ctx: Context to initialize
+ * @key: Key for HMAC operations
+ * @key_len: Length of the key in bytes
+ * Returns: 0 on success, -1 on failure
+ */
+int
+hmac_sha1_ctx_init(struct hmac_sha1_ctx *ctx, const u8 *key, size_t key_len)
+{
+	SHA1_CTX sha1;
+	unsigned char k_ipad[64], k_opad[64];
+	unsigned char tk[20];
+	size_t i;
 
-/*
-SHA-1 in C
-By Steve Reid <sreid@sea-to-sky.net>
-100% Public Domain
-
------------------
-Modified 7/98 
-By James H. Brown <jbrown@burgoyne.com>
-Still 100% Public Domain
-
-Corrected a problem which generated improper hash values on 16 bit machines
-Routine SHA1Update changed from
-	void SHA1Update(SHA1_CTX* context, unsigned char* data, unsigned int
-len)
-to
-	void SHA1Update(SHA1_CTX* context, unsigned char* data, unsigned
-long len)
-
-The 'len' parameter was declared an int which works fine on 32 bit machines.
-However, on 16 bit machines an int is too small for the shifts being done
-against
-it.  This caused the hash function to generate incorrect values if len was
-greater than 8191 (8K - 1) due to the 'len << 3' on line 3 of SHA1Update().
-
-Since the file IO in main() reads 16K at a time, any file 8K or larger would
-be guaranteed to generate the wrong hash (e.g. Test Vector #3, a million
-"a"s).
-
-I also changed the declaration of variables i & j in SHA1Update to 
-unsigned long from unsigned int for the same reason.
-
-These changes should make no difference to any 32 bit implementations since
-an
-int and a long are the same size in those environments.
-
---
-I also corrected a few compiler warnings generated by Borland C.
-1. Added #include <process.h> for exit() prototype
-2. Removed unused variable 'j' in SHA1Final
-3. Changed exit(0) to return(0) at end of main.
-
-ALL changes I made can be located by searching for comments containing 'JHB'
------------------
-Modified 8/98
-By Steve Reid <sreid@sea-to-sky.net>
-Still 100% public domain
-
-1- Removed #include <process.h> and used return() instead of exit()
-2- Fixed overwriting of finalcount in SHA1Final() (discovered by Chris Hall)
-3- Changed email address from steve@edmweb.com to sreid@sea-to-sky.net
-
------------------
-Modified 4/01
-By Saul Kravitz <Saul.Kravitz@celera.com>
-Still 100% PD
-Modified to run on Compaq Alpha hardware.  
-
------------------
-Modified 4/01
-By Jouni Malinen <j@w1.fi>
-Minor changes to match the coding style used in Dynamics.
-
-Modified September 24, 2004
-By Jouni Malinen <j@w1.fi>
-Fixed alignment issue in SHA1Transform when SHA1HANDSOFF is defined.
-
-*/
+	/* if key is longer than 64 bytes reset it to key = SHA1(key) */
+	if (key_len > 64) {
+		if (sha1_vector(1, &key, &key_len, tk))
+			return -1;
+		key = tk;
+		key_len = 20;
+	}
 
-/*
-Test Vectors (from FIPS PUB 180-1)
-"abc"
-  A9993E36 4706816A BA3E2571 7850C26C 9CD0D89D
-"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"
-  84983E44 1C3BD26E BAAE4AA1 F95129E5 E54670F1
-A million repetitions of "a"
-  34AA973C D4C4DAA4 F61EEB2B DBAD2731 6534016F
-*/
-
-#define SHA1HANDSOFF
-
-#define rol(value, bits) (((value) << (bits)) | ((value) >> (32 - (bits))))
-
-/* blk0() and blk() perform the initial expand. */
-/* I got the idea of expanding during the round function from SSLeay */
-#ifndef WORDS_BIGENDIAN
-#define blk0(i) (block->l[i] = (rol(block->l[i], 24) & 0xFF00FF00) | \
-	(rol(block->l[i], 8) & 0x00FF00FF))
-#else
-#define blk0(i) block->l[i]
-#endif
-#define blk(i) (block->l[i & 15] = rol(block->l[(i + 13) & 15] ^ \
-	block->l[(i + 8) & 15] ^ block->l[(i + 2) & 15] ^ block->l[i & 15], 1))
-
-/* (R0+R1), R2, R3, R4 are the different operations used in SHA1 */
-#define R0(v,w,x,y,z,i) \
-	z += ((w & (x ^ y)) ^ y) + blk0(i) + 0x5A827999 + rol(v, 5); \
-	w = rol(w, 30);
-#define R1(v,w,x,y,z,i) \
-	z += ((w & (x ^ y)) ^ y) + blk(i) + 0x5A827999 + rol(v, 5); \
-	w = rol(w, 30);
-#define R2(v,w,x,y,z,i) \
-	z += (w ^ x ^ y) + blk(i) + 0x6ED9EBA1 + rol(v, 5); w = rol(w, 30);
-#define R3(v,w,x,y,z,i) \
-	z += (((w | x) & y) | (w & x)) + blk(i) + 0x8F1BBCDC + rol(v, 5); \
-	w = rol(w, 30);
-#define R4(v,w,x,y,z,i) \
-	z += (w ^ x ^ y) + blk(i) + 0xCA62C1D6 + rol(v, 5); \
-	w=rol(w, 30);
-
-
-#ifdef VERBOSE  /* SAK */
-void SHAPrintContext(SHA1_CTX *context, char *msg)
-{
-	printf("%s (%d,%d) %x %x %x %x %x\n",
-	       msg,
-	       context->count[0], context->count[1], 
-	       context->state[0],
-	       context->state[1],
-	       context->state[2],
-	       context->state[3],
-	       context->state[4]);
+	os_memset(k_ipad, 0, sizeof(k_ipad));
+	os_memcpy(k_ipad, key, key_len);
+	os_memcpy(k_opad, k_ipad, sizeof(k_opad));
+	for (i = 0; i < 64; i++) {
+		k_ipad[i] ^= 0x36;
+		k_opad[i] ^= 0x5c;
+	}
+
+	SHA1Init(&sha1);
+	os_memcpy(ctx->istate, sha1.sha.state, sizeof(ctx->istate));
+	os_memcpy(ctx->ostate, sha1.sha.state, sizeof(ctx->ostate));
+	SHA1Transform(ctx->istate, k_ipad);
+	SHA1Transform(ctx->ostate, k_opad);
+
+	os_memset(k_ipad, 0, sizeof(k_ipad));
+	os_memset(k_opad, 0, sizeof(k_opad));
+	os_memset(tk, 0, sizeof(tk));
+	return 0;
 }
-#endif
 
-/* Hash a single 512-bit block. This is the core of the algorithm. */
 
-void 
-SHA1Transform(u32 state[5], const unsigned char buffer[64])
+/* Start a SHA-1 computation from a state that has hashed one block */
+static void
+hmac_sha1_ctx_start(SHA1_CTX *sha1, const u32 state[5])
 {
-	u32 a, b, c, d, e;
-	typedef union {
-		unsigned char c[64];
-		u32 l[16];
-	} CHAR64LONG16;
-	CHAR64LONG16* block;
-#ifdef SHA1HANDSOFF
-	CHAR64LONG16 workspace;
-	block = &workspace;
-	os_memcpy(block, buffer, 64);
-#else
-	block = (CHAR64LONG16 *) buffer;
-#endif
-	/* Copy context->state[] to working vars */
-	a = state[0];
-	b = state[1];
-	c = state[2];
-	d = state[3];
-	e = state[4];
-	/* 4 rounds of 20 operations each. Loop unrolled. */
-	R0(a,b,c,d,e, 0); R0(e,a,b,c,d, 1); R0(d,e,a,b,c, 2); R0(c,d,e,a,b, 3);
-	R0(b,c,d,e,a, 4); R0(a,b,c,d,e, 5); R0(e,a,b,c,d, 6); R0(d,e,a,b,c, 7);
-	R0(c,d,e,a,b, 8); R0(b,c,d,e,a, 9); R0(a,b,c,d,e,10); R0(e,a,b,c,d,11);
-	R0(d,e,a,b,c,12); R0(c,d,e,a,b,13); R0(b,c,d,e,a,14); R0(a,b,c,d,e,15);
-	R1(e,a,b,c,d,16); R1(d,e,a,b,c,17); R1(c,d,e,a,b,18); R1(b,c,d,e,a,19);
-	R2(a,b,c,d,e,20); R2(e,a,b,c,d,21); R2(d,e,a,b,c,22); R2(c,d,e,a,b,23);
-	R2(b,c,d,e,a,24); R2(a,b,c,d,e,25); R2(e,a,b,c,d,26); R2(d,e,a,b,c,27);
-	R2(c,d,e,a,b,28); R2(b,c,d,e,a,29); R2(a,b,c,d,e,30); R2(e,a,b,c,d,31);
-	R2(d,e,a,b,c,32); R2(c,d,e,a,b,33); R2(b,c,d,e,a,34); R2(a,b,c,d,e,35);
-	R2(e,a,b,c,d,36); R2(d,e,a,b,c,37); R2(c,d,e,a,b,38); R2(b,c,d,e,a,39);
-	R3(a,b,c,d,e,40); R3(e,a,b,c,d,41); R3(d,e,a,b,c,42); R3(c,d,e,a,b,43);
-	R3(b,c,d,e,a,44); R3(a,b,c,d,e,45); R3(e,a,b,c,d,46); R3(d,e,a,b,c,47);
-	R3(c,d,e,a,b,48); R3(b,c,d,e,a,49); R3(a,b,c,d,e,50); R3(e,a,b,c,d,51);
-	R3(d,e,a,b,c,52); R3(c,d,e,a,b,53); R3(b,c,d,e,a,54); R3(a,b,c,d,e,55);
-	R3(e,a,b,c,d,56); R3(d,e,a,b,c,57); R3(c,d,e,a,b,58); R3(b,c,d,e,a,59);
-	R4(a,b,c,d,e,60); R4(e,a,b,c,d,61); R4(d,e,a,b,c,62); R4(c,d,e,a,b,63);
-	R4(b,c,d,e,a,64); R4(a,b,c,d,e,65); R4(e,a,b,c,d,66); R4(d,e,a,b,c,67);
-	R4(c,d,e,a,b,68); R4(b,c,d,e,a,69); R4(a,b,c,d,e,70); R4(e,a,b,c,d,71);
-	R4(d,e,a,b,c,72); R4(c,d,e,a,b,73); R4(b,c,d,e,a,74); R4(a,b,c,d,e,75);
-	R4(e,a,b,c,d,76); R4(d,e,a,b,c,77); R4(c,d,e,a,b,78); R4(b,c,d,e,a,79);
-	/* Add the working vars back into context.state[] */
-	state[0] += a;
-	state[1] += b;
-	state[2] += c;
-	state[3] += d;
-	state[4] += e;
-	/* Wipe variables */
-	a = b = c = d = e = 0;
-#ifdef SHA1HANDSOFF
-	os_memset(block, 0, 64);
-#endif
+	esp_sha_init(&sha1->sha, ESP_SHA1);
+	os_memcpy(sha1->sha.state, state, 5 * sizeof(u32));
+	sha1->sha.total = 64;
 }
 
 
-/* SHA1Init - Initialize new context */
+/**
+ * hmac_sha1_ctx_vector - HMAC-SHA1 over data vector with precomputed pads
+ * @ctx: Context from hmac_sha1_ctx_init()
+ * @num_elem: Number of elements in the data vector
+ * @addr: Pointers to the data areas
+ * @len: Lengths of the data blocks
+ * @mac: Buffer for the hash (20 bytes)
+ * Returns: 0 on success, -1 on failure
+ */
+int
+hmac_sha1_ctx_vector(const struct hmac_sha1_ctx *ctx, size_t num_elem,
+		     const u8 *addr[], const size_t *len, u8 *mac)
+{
+	SHA1_CTX sha1;
+	size_t i;
+
+	hmac_sha1_ctx_start(&sha1, ctx->istate);
+	for (i = 0; i < num_elem; i++)
+		SHA1Update(&sha1, addr[i], len[i]);
+	SHA1Final(mac, &sha1);
 
-void 
-SHA1Init(SHA1_CTX* context)
+	hmac_sha1_ctx_start(&sha1, ctx->ostate);
+	SHA1Update(&sha1, mac, SHA1_MAC_LEN);
+	SHA1Final(mac, &sha1);
+	return 0;
+}
+
+
+/**
+ * hmac_sha1_ctx_chain - HMAC-SHA1 over a previous HMAC-SHA1 value
+ * @ctx: Context from hmac_sha1_ctx_init()
+ * @u: 20-byte message as five big endian words, replaced with its HMAC
+ *
+ * This is the inner loop of PBKDF2. Both the message and the inner hash fit
+ * in one padded block, so it takes exactly two compressions and no byte
+ * order conversion.
+ */
+void
+hmac_sha1_ctx_chain(const struct hmac_sha1_ctx *ctx, u32 u[5])
 {
-	/* SHA1 initialization constants */
-	context->state[0] = 0x67452301;
-	context->state[1] = 0xEFCDAB89;
-	context->state[2] = 0x98BADCFE;
-	context->state[3] = 0x10325476;
-	context->state[4] = 0xC3D2E1F0;
-	context->count[0] = context->count[1] = 0;
+	u32 block[16];
+	u32 state[5];
+	int i;
+
+	for (i = 0; i < 5; i++) {
+		block[i] = u[i];
+		state[i] = ctx->istate[i];
+	}
+	block[5] = 0x80000000;
+	for (i = 6; i < 15; i++)
+		block[i] = 0;
+	block[15] = (64 + SHA1_MAC_LEN) * 8;
+	SHA1TransformWords(state, block);
+
+	for (i = 0; i < 5; i++) {
+		block[i] = state[i];
+		u[i] = ctx->ostate[i];
+	}
+	block[5] = 0x80000000;
+	for (i = 6; i < 15; i++)
+		block[i] = 0;
+	block[15] = (64 + SHA1_MAC_LEN) * 8;
+	SHA1TransformWords(u, block);
 }
 
 
-/* Run your data through this. */
+/* ===== start - SHA1 on top of the util component ===== */
 
-void 
-SHA1Update(SHA1_CTX* context, const void *_data, u32 len)
+void
+SHA1Init(SHA1_CTX *context)
 {
-	u32 i, j;
-	const unsigned char *data = _data;
-
-#ifdef VERBOSE
-	SHAPrintContext(context, "before");
-#endif
-	j = (context->count[0] >> 3) & 63;
-	if ((context->count[0] += len << 3) < (len << 3))
-		context->count[1]++;
-	context->count[1] += (len >> 29);
-	if ((j + len) > 63) {
-		os_memcpy(&context->buffer[j], data, (i = 64-j));
-		SHA1Transform(context->state, context->buffer);
-		for ( ; i + 63 < len; i += 64) {
-			SHA1Transform(context->state, &data[i]);
-		}
-		j = 0;
-	}
-	else i = 0;
-	os_memcpy(&context->buffer[j], &data[i], len - i);
-#ifdef VERBOSE
-	SHAPrintContext(context, "after ");
-#endif
+	esp_sha_init(&context->sha, ESP_SHA1);
 }
 
 
-/* Add padding and return the message digest. */
+void
+SHA1Update(SHA1_CTX *context, const void *data, u32 len)
+{
+	esp_sha_update(&context->sha, data, len);
+}
+
 
-void 
-SHA1Final(unsigned char digest[20], SHA1_CTX* context)
+void
+SHA1Final(unsigned char digest[20], SHA1_CTX *context)
 {
-	u32 i;
-	unsigned char finalcount[8];
+	esp_sha_finish(&context->sha, digest);
+	os_memset(context, 0, sizeof(*context));
+}
 
-	for (i = 0; i < 8; i++) {
-		finalcount[i] = (unsigned char)
-			((context->count[(i >= 4 ? 0 : 1)] >>
-			  ((3-(i & 3)) * 8) ) & 255);  /* Endian independent */
-	}
-	SHA1Update(context, (unsigned char *) "\200", 1);
-	while ((context->count[0] & 504) != 448) {
-		SHA1Update(context, (unsigned char *) "\0", 1);
-	}
-	SHA1Update(context, finalcount, 8);  /* Should cause a SHA1Transform()
-					      */
-	for (i = 0; i < 20; i++) {
-		digest[i] = (unsigned char)
-			((context->state[i >> 2] >> ((3 - (i & 3)) * 8)) &
-			 255);
-	}
-	/* Wipe variables */
-	i = 0;
-	os_memset(context->buffer, 0, 64);
-	os_memset(context->state, 0, 20);
-	os_memset(context->count, 0, 8);
-	os_memset(finalcount, 0, 8);
+
+void
+SHA1Transform(u32 state[5], const unsigned char buffer[64])
+{
+	esp_sha1_blocks(state, buffer, 1);
+}
+
+
+/* Hash a single block given as 16 host order words, the block is clobbered */
+static void
+SHA1TransformWords(u32 state[5], u32 words[16])
+{
+	esp_sha1_words(state, words);
 }
 
-/* ===== end - public domain SHA1 implementation ===== */
+/* ===== end - SHA1 on top of the util component ===== */
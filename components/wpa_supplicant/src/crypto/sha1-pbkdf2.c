@@ -19,16 +19,16 @@
 #include "crypto/crypto.h"
 
 static int 
-pbkdf2_sha1_f(const char *passphrase, const char *ssid,
-			 size_t ssid_len, int iterations, unsigned int count,
-			 u8 *digest)
+pbkdf2_sha1_f(const struct hmac_sha1_ctx *ctx, const char *ssid,
+	      size_t ssid_len, int iterations, unsigned int count,
+	      u8 *digest)
 {
-	unsigned char tmp[SHA1_MAC_LEN], tmp2[SHA1_MAC_LEN];
+	unsigned char tmp[SHA1_MAC_LEN];
+	u32 u[5], sum[5];
 	int i, j;
 	unsigned char count_buf[4];
 	const u8 *addr[2];
 	size_t len[2];
-	size_t passphrase_len = os_strlen(passphrase);
 
 	addr[0] = (u8 *) ssid;
 	len[0] = ssid_len;
@@ -45,20 +45,22 @@ pbkdf2_sha1_f(const char *passphrase, const char *ssid,
 	count_buf[1] = (count >> 16) & 0xff;
 	count_buf[2] = (count >> 8) & 0xff;
 	count_buf[3] = count & 0xff;
-	if (hmac_sha1_vector((u8 *) passphrase, passphrase_len, 2, addr, len,
-			     tmp))
+	if (hmac_sha1_ctx_vector(ctx, 2, addr, len, tmp))
 		return -1;
-	os_memcpy(digest, tmp, SHA1_MAC_LEN);
+
+	/* U2..Uc are kept as words, each one costs two compressions */
+	for (j = 0; j < 5; j++)
+		sum[j] = u[j] = WPA_GET_BE32(tmp + j * 4);
 
 	for (i = 1; i < iterations; i++) {
-		if (hmac_sha1((u8 *) passphrase, passphrase_len, tmp,
-			      SHA1_MAC_LEN, tmp2))
-			return -1;
-		os_memcpy(tmp, tmp2, SHA1_MAC_LEN);
-		for (j = 0; j < SHA1_MAC_LEN; j++)
-			digest[j] ^= tmp2[j];
+		hmac_sha1_ctx_chain(ctx, u);
+		for (j = 0; j < 5; j++)
+			sum[j] ^= u[j];
 	}
 
+	for (j = 0; j < 5; j++)
+		WPA_PUT_BE32(digest + j * 4, sum[j]);
+
 	return 0;
 }
 
@@ -85,17 +87,27 @@ pbkdf2_sha1(const char *passphrase, const char *ssid, size_t ssid_len,
 	unsigned char *pos = buf;
 	size_t left = buflen, plen;
 	unsigned char digest[SHA1_MAC_LEN];
+	struct hmac_sha1_ctx ctx;
+	int ret = 0;
+
+	/* the passphrase is the HMAC key of every iteration, pad it once */
+	if (hmac_sha1_ctx_init(&ctx, (const u8 *) passphrase,
+			       os_strlen(passphrase)))
+		return -1;
 
 	while (left > 0) {
 		count++;
-		if (pbkdf2_sha1_f(passphrase, ssid, ssid_len, iterations,
-				  count, digest))
-			return -1;
+		if (pbkdf2_sha1_f(&ctx, ssid, ssid_len, iterations, count,
+				  digest)) {
+			ret = -1;
+			break;
+		}
 		plen = left > SHA1_MAC_LEN ? SHA1_MAC_LEN : left;
 		os_memcpy(pos, digest, plen);
 		pos += plen;
 		left -= plen;
 	}
 
-	return 0;
+	os_memset(&ctx, 0, sizeof(ctx));
+	return ret;
 }
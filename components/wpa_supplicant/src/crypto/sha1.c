@@ -33,65 +33,14 @@ int
 hmac_sha1_vector(const u8 *key, size_t key_len, size_t num_elem,
 		     const u8 *addr[], const size_t *len, u8 *mac)
 {
-	unsigned char k_pad[64]; /* padding - key XORd with ipad/opad */
-	unsigned char tk[20];
-	const u8 *_addr[6];
-	size_t _len[6], i;
+	struct hmac_sha1_ctx ctx;
+	int ret;
 
-	if (num_elem > 5) {
-		/*
-		 * Fixed limit on the number of fragments to avoid having to
-		 * allocate memory (which could fail).
-		 */
+	if (hmac_sha1_ctx_init(&ctx, key, key_len))
 		return -1;
-	}
-
-        /* if key is longer than 64 bytes reset it to key = SHA1(key) */
-        if (key_len > 64) {
-		if (sha1_vector(1, &key, &key_len, tk))
-			return -1;
-		key = tk;
-		key_len = 20;
-        }
-
-	/* the HMAC_SHA1 transform looks like:
-	 *
-	 * SHA1(K XOR opad, SHA1(K XOR ipad, text))
-	 *
-	 * where K is an n byte key
-	 * ipad is the byte 0x36 repeated 64 times
-	 * opad is the byte 0x5c repeated 64 times
-	 * and text is the data being protected */
-
-	/* start out by storing key in ipad */
-	os_memset(k_pad, 0, sizeof(k_pad));
-	os_memcpy(k_pad, key, key_len);
-	/* XOR key with ipad values */
-	for (i = 0; i < 64; i++)
-		k_pad[i] ^= 0x36;
-
-	/* perform inner SHA1 */
-	_addr[0] = k_pad;
-	_len[0] = 64;
-	for (i = 0; i < num_elem; i++) {
-		_addr[i + 1] = addr[i];
-		_len[i + 1] = len[i];
-	}
-	if (sha1_vector(1 + num_elem, _addr, _len, mac))
-		return -1;
-
-	os_memset(k_pad, 0, sizeof(k_pad));
-	os_memcpy(k_pad, key, key_len);
-	/* XOR key with opad values */
-	for (i = 0; i < 64; i++)
-		k_pad[i] ^= 0x5c;
-
-	/* perform outer SHA1 */
-	_addr[0] = k_pad;
-	_len[0] = 64;
-	_addr[1] = mac;
-	_len[1] = SHA1_MAC_LEN;
-	return sha1_vector(2, _addr, _len, mac);
+	ret = hmac_sha1_ctx_vector(&ctx, num_elem, addr, len, mac);
+	os_memset(&ctx, 0, sizeof(ctx));
+	return ret;
 }
 
 
@@ -135,6 +84,8 @@ sha1_prf(const u8 *key, size_t key_len, const char *label,
 	size_t label_len = os_strlen(label) + 1;
 	const unsigned char *addr[3];
 	size_t len[3];
+	struct hmac_sha1_ctx ctx;
+	int ret = 0;
 
 	addr[0] = (u8 *) label;
 	len[0] = label_len;
@@ -143,24 +94,31 @@ sha1_prf(const u8 *key, size_t key_len, const char *label,
 	addr[2] = &counter;
 	len[2] = 1;
 
+	if (hmac_sha1_ctx_init(&ctx, key, key_len))
+		return -1;
+
 	pos = 0;
 	while (pos < buf_len) {
 		plen = buf_len - pos;
 		if (plen >= SHA1_MAC_LEN) {
-			if (hmac_sha1_vector(key, key_len, 3, addr, len,
-					     &buf[pos]))
-				return -1;
+			if (hmac_sha1_ctx_vector(&ctx, 3, addr, len,
+						 &buf[pos])) {
+				ret = -1;
+				break;
+			}
 			pos += SHA1_MAC_LEN;
 		} else {
-			if (hmac_sha1_vector(key, key_len, 3, addr, len,
-					     hash))
-				return -1;
+			if (hmac_sha1_ctx_vector(&ctx, 3, addr, len, hash)) {
+				ret = -1;
+				break;
+			}
 			os_memcpy(&buf[pos], hash, plen);
 			break;
 		}
 		counter++;
 	}
 
-	return 0;
+	os_memset(&ctx, 0, sizeof(ctx));
+	return ret;
 }
 
@@ -0,0 +1,176 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <unity.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "crypto/includes.h"
+#include "crypto/common.h"
+#include "crypto/crypto.h"
+#include "crypto/dh_groups.h"
+#include "../src/crypto/bignum.h"
+
+#define DH5_LEN     192
+
+/* the libtommath exponentiation crypto_mod_exp used before */
+static int mod_exp_bignum(const u8 *base, size_t base_len, const u8 *power, size_t power_len,
+                          const u8 *modulus, size_t modulus_len, u8 *result, size_t *result_len)
+{
+    struct bignum *b = bignum_init(), *e = bignum_init(), *m = bignum_init(), *r = bignum_init();
+    int ret = -1;
+
+    if (b && e && m && r &&
+        !bignum_set_unsigned_bin(b, base, base_len) &&
+        !bignum_set_unsigned_bin(e, power, power_len) &&
+        !bignum_set_unsigned_bin(m, modulus, modulus_len) &&
+        !bignum_exptmod(b, e, m, r))
+        ret = bignum_get_unsigned_bin(r, result, result_len);
+
+    bignum_deinit(b);
+    bignum_deinit(e);
+    bignum_deinit(m);
+    bignum_deinit(r);
+    return ret;
+}
+
+static void random_below(u8 *buf, const u8 *limit, size_t len)
+{
+    for (int i = 0; i < len; i++)
+        buf[i] = rand();
+    if (memcmp(buf, limit, len) >= 0)
+        buf[0] = 0;
+}
+
+TEST_CASE("crypto_mod_exp known answers", "[wpa_supplicant]")
+{
+    const struct dh_group *dh = dh_groups_get(5);
+    const u8 four = 4, thirteen = 13, m497[2] = { 0x01, 0xf1 };
+    u8 exp[DH5_LEN], base[DH5_LEN], result[DH5_LEN];
+    size_t len;
+
+    TEST_ASSERT_NOT_NULL(dh);
+    TEST_ASSERT_EQUAL(DH5_LEN, dh->prime_len);
+
+    /* 4^13 mod 497 = 445 */
+    len = sizeof(result);
+    TEST_ASSERT_EQUAL(0, crypto_mod_exp(&four, 1, &thirteen, 1, m497, sizeof(m497), result, &len));
+    TEST_ASSERT_EQUAL(2, len);
+    TEST_ASSERT_EQUAL(445, WPA_GET_BE16(result));
+
+    /* Fermat: x^(p - 1) mod p = 1, for the generator and for any other base */
+    memcpy(exp, dh->prime, DH5_LEN);
+    exp[DH5_LEN - 1]--;
+
+    len = sizeof(result);
+    TEST_ASSERT_EQUAL(0, crypto_mod_exp(dh->generator, dh->generator_len, exp, DH5_LEN,
+                                        dh->prime, DH5_LEN, result, &len));
+    TEST_ASSERT_EQUAL(1, len);
+    TEST_ASSERT_EQUAL(1, result[0]);
+
+    random_below(base, dh->prime, DH5_LEN);
+    len = sizeof(result);
+    TEST_ASSERT_EQUAL(0, crypto_mod_exp(base, DH5_LEN, exp, DH5_LEN, dh->prime, DH5_LEN, result, &len));
+    TEST_ASSERT_EQUAL(1, len);
+    TEST_ASSERT_EQUAL(1, result[0]);
+
+    /* a result buffer that is too small reports the needed length */
+    len = 1;
+    TEST_ASSERT_EQUAL(-1, crypto_mod_exp(dh->generator, dh->generator_len, &thirteen, 1,
+                                         dh->prime, DH5_LEN, result, &len));
+    TEST_ASSERT_EQUAL(2, len);
+}
+
+TEST_CASE("crypto_mod_exp matches libtommath and agrees on a DH group 5 key", "[wpa_supplicant][timeout=60]")
+{
+    const struct dh_group *dh = dh_groups_get(5);
+    u8 *buf = malloc(6 * DH5_LEN);
+    u8 *a = buf, *b = a + DH5_LEN, *pub_a = b + DH5_LEN, *pub_b = pub_a + DH5_LEN;
+    u8 *shared = pub_b + DH5_LEN, *ref = shared + DH5_LEN;
+    size_t pub_a_len = DH5_LEN, pub_b_len = DH5_LEN, len, ref_len;
+
+    TEST_ASSERT_NOT_NULL(buf);
+    random_below(a, dh->prime, DH5_LEN);
+    random_below(b, dh->prime, DH5_LEN);
+
+    TEST_ASSERT_EQUAL(0, crypto_mod_exp(dh->generator, dh->generator_len, a, DH5_LEN,
+                                        dh->prime, DH5_LEN, pub_a, &pub_a_len));
+    ref_len = DH5_LEN;
+    TEST_ASSERT_EQUAL(0, mod_exp_bignum(dh->generator, dh->generator_len, a, DH5_LEN,
+                                        dh->prime, DH5_LEN, ref, &ref_len));
+    TEST_ASSERT_EQUAL(ref_len, pub_a_len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(ref, pub_a, pub_a_len);
+
+    TEST_ASSERT_EQUAL(0, crypto_mod_exp(dh->generator, dh->generator_len, b, DH5_LEN,
+                                        dh->prime, DH5_LEN, pub_b, &pub_b_len));
+
+    /* (g^b)^a == (g^a)^b */
+    len = DH5_LEN;
+    TEST_ASSERT_EQUAL(0, crypto_mod_exp(pub_b, pub_b_len, a, DH5_LEN, dh->prime, DH5_LEN, shared, &len));
+    ref_len = DH5_LEN;
+    TEST_ASSERT_EQUAL(0, crypto_mod_exp(pub_a, pub_a_len, b, DH5_LEN, dh->prime, DH5_LEN, ref, &ref_len));
+    TEST_ASSERT_EQUAL(ref_len, len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(ref, shared, len);
+
+    ref_len = DH5_LEN;
+    TEST_ASSERT_EQUAL(0, mod_exp_bignum(pub_b, pub_b_len, a, DH5_LEN, dh->prime, DH5_LEN, ref, &ref_len));
+    TEST_ASSERT_EQUAL(ref_len, len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(ref, shared, len);
+
+    free(buf);
+}
+
+TEST_CASE("crypto_mod_exp DH group 5 performance", "[wpa_supplicant][timeout=60]")
+{
+    const struct dh_group *dh = dh_groups_get(5);
+    u8 *buf = malloc(3 * DH5_LEN);
+    u8 *priv = buf, *pub = priv + DH5_LEN, *shared = pub + DH5_LEN;
+    TickType_t start, pub_ticks, shared_ticks, ref_pub_ticks, ref_shared_ticks;
+    size_t pub_len = DH5_LEN, len;
+
+    TEST_ASSERT_NOT_NULL(buf);
+    random_below(priv, dh->prime, DH5_LEN);
+
+    start = xTaskGetTickCount();
+    TEST_ASSERT_EQUAL(0, crypto_mod_exp(dh->generator, dh->generator_len, priv, DH5_LEN,
+                                        dh->prime, DH5_LEN, pub, &pub_len));
+    pub_ticks = xTaskGetTickCount() - start;
+
+    start = xTaskGetTickCount();
+    len = DH5_LEN;
+    TEST_ASSERT_EQUAL(0, crypto_mod_exp(pub, pub_len, priv, DH5_LEN, dh->prime, DH5_LEN, shared, &len));
+    shared_ticks = xTaskGetTickCount() - start;
+
+    start = xTaskGetTickCount();
+    len = DH5_LEN;
+    TEST_ASSERT_EQUAL(0, mod_exp_bignum(dh->generator, dh->generator_len, priv, DH5_LEN,
+                                        dh->prime, DH5_LEN, shared, &len));
+    ref_pub_ticks = xTaskGetTickCount() - start;
+
+    start = xTaskGetTickCount();
+    len = DH5_LEN;
+    TEST_ASSERT_EQUAL(0, mod_exp_bignum(pub, pub_len, priv, DH5_LEN, dh->prime, DH5_LEN, shared, &len));
+    ref_shared_ticks = xTaskGetTickCount() - start;
+
+    printf("DH group 5 public value: %u ms, libtommath %u ms\n",
+           pub_ticks * portTICK_PERIOD_MS, ref_pub_ticks * portTICK_PERIOD_MS);
+    printf("DH group 5 shared secret: %u ms, libtommath %u ms\n",
+           shared_ticks * portTICK_PERIOD_MS, ref_shared_ticks * portTICK_PERIOD_MS);
+
+    free(buf);
+}
@@ -0,0 +1,109 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <unity.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "crypto/includes.h"
+#include "crypto/common.h"
+#include "crypto/sha1.h"
+
+typedef struct {
+    const char *passphrase;
+    const char *salt;
+    int iterations;
+    size_t len;
+    uint8_t key[32];
+} pbkdf2_vector_t;
+
+/* RFC 6070, plus the IEEE 802.11i-2004 H.4 passphrase to PSK vector */
+static const pbkdf2_vector_t s_vectors[] = {
+    { "password", "salt", 1, 20,
+      { 0x0c, 0x60, 0xc8, 0x0f, 0x96, 0x1f, 0x0e, 0x71, 0xf3, 0xa9,
+        0xb5, 0x24, 0xaf, 0x60, 0x12, 0x06, 0x2f, 0xe0, 0x37, 0xa6 } },
+    { "password", "salt", 2, 20,
+      { 0xea, 0x6c, 0x01, 0x4d, 0xc7, 0x2d, 0x6f, 0x8c, 0xcd, 0x1e,
+        0xd9, 0x2a, 0xce, 0x1d, 0x41, 0xf0, 0xd8, 0xde, 0x89, 0x57 } },
+    { "password", "salt", 4096, 20,
+      { 0x4b, 0x00, 0x79, 0x01, 0xb7, 0x65, 0x48, 0x9a, 0xbe, 0xad,
+        0x49, 0xd9, 0x26, 0xf7, 0x21, 0xd0, 0x65, 0xa4, 0x29, 0xc1 } },
+    { "passwordPASSWORDpassword", "saltSALTsaltSALTsaltSALTsaltSALTsalt", 4096, 25,
+      { 0x3d, 0x2e, 0xec, 0x4f, 0xe4, 0x1c, 0x84, 0x9b, 0x80, 0xc8,
+        0xd8, 0x36, 0x62, 0xc0, 0xe4, 0x4a, 0x8b, 0x29, 0x1a, 0x96,
+        0x4c, 0xf2, 0xf0, 0x70, 0x38 } },
+    { "password", "IEEE", 4096, 32,
+      { 0xf4, 0x2c, 0x6f, 0xc5, 0x2d, 0xf0, 0xeb, 0xef, 0x9e, 0xbb,
+        0x4b, 0x90, 0xb3, 0x8a, 0x5f, 0x90, 0x2e, 0x83, 0xfe, 0x1b,
+        0x13, 0x5a, 0x70, 0xe2, 0x3a, 0xed, 0x76, 0x2e, 0x97, 0x10,
+        0xa1, 0x2e } },
+};
+
+/* PBKDF2 as it was done before: a full HMAC-SHA1 per iteration */
+static void pbkdf2_sha1_reference(const char *passphrase, const char *ssid, int iterations,
+                                  uint8_t *buf, size_t buflen)
+{
+    size_t ssid_len = strlen(ssid);
+    uint8_t salt[64], u[SHA1_MAC_LEN], digest[SHA1_MAC_LEN];
+
+    for (uint32_t count = 1; buflen; count++) {
+        size_t plen = buflen > SHA1_MAC_LEN ? SHA1_MAC_LEN : buflen;
+
+        memcpy(salt, ssid, ssid_len);
+        WPA_PUT_BE32(salt + ssid_len, count);
+        hmac_sha1((const uint8_t *)passphrase, strlen(passphrase), salt, ssid_len + 4, u);
+        memcpy(digest, u, SHA1_MAC_LEN);
+        for (int i = 1; i < iterations; i++) {
+            hmac_sha1((const uint8_t *)passphrase, strlen(passphrase), u, SHA1_MAC_LEN, u);
+            for (int j = 0; j < SHA1_MAC_LEN; j++)
+                digest[j] ^= u[j];
+        }
+        memcpy(buf, digest, plen);
+        buf += plen;
+        buflen -= plen;
+    }
+}
+
+TEST_CASE("pbkdf2_sha1 matches the RFC 6070 test vectors", "[wpa_supplicant]")
+{
+    uint8_t key[32];
+
+    for (int i = 0; i < sizeof(s_vectors) / sizeof(s_vectors[0]); i++) {
+        const pbkdf2_vector_t *v = &s_vectors[i];
+
+        TEST_ASSERT_EQUAL(0, pbkdf2_sha1(v->passphrase, v->salt, strlen(v->salt), v->iterations, key, v->len));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(v->key, key, v->len);
+    }
+}
+
+TEST_CASE("pbkdf2_sha1 passphrase to PMK performance", "[wpa_supplicant][timeout=60]")
+{
+    uint8_t pmk[32], ref[32];
+    TickType_t start, fast_ticks, ref_ticks;
+
+    start = xTaskGetTickCount();
+    TEST_ASSERT_EQUAL(0, pbkdf2_sha1("mysecretpassphrase", "MyHomeNetwork", 13, 4096, pmk, sizeof(pmk)));
+    fast_ticks = xTaskGetTickCount() - start;
+
+    start = xTaskGetTickCount();
+    pbkdf2_sha1_reference("mysecretpassphrase", "MyHomeNetwork", 4096, ref, sizeof(ref));
+    ref_ticks = xTaskGetTickCount() - start;
+
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(ref, pmk, sizeof(pmk));
+    printf("PMK derivation: %u ms, with a full HMAC per iteration: %u ms\n",
+           fast_ticks * portTICK_PERIOD_MS, ref_ticks * portTICK_PERIOD_MS);
+}
@@ -0,0 +1,154 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <unity.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#ifdef CONFIG_WPA_PMK_CACHE
+
+#include "nvs_flash.h"
+#include "esp_wifi.h"
+#include "esp_event_loop.h"
+#include "esp_timer.h"
+#include "tcpip_adapter.h"
+#include "esp_pmk_cache.h"
+
+#include "crypto/includes.h"
+#include "crypto/common.h"
+#include "crypto/sha1.h"
+
+/* the WPA2-PSK AP of the boot-to-IP test, given in the CFLAGS of the unit test app */
+#ifndef TEST_PMK_AP_SSID
+#define TEST_PMK_AP_SSID        "MyHomeNetwork"
+#endif
+#ifndef TEST_PMK_AP_PASSWORD
+#define TEST_PMK_AP_PASSWORD    "mysecretpassphrase"
+#endif
+
+static SemaphoreHandle_t s_got_ip;
+static volatile bool s_connect;
+
+static esp_err_t test_event_handler(void *ctx, system_event_t *event)
+{
+    switch (event->event_id) {
+    case SYSTEM_EVENT_STA_START:
+    case SYSTEM_EVENT_STA_DISCONNECTED:
+        if (s_connect)
+            esp_wifi_connect();
+        break;
+    case SYSTEM_EVENT_STA_GOT_IP:
+        xSemaphoreGive(s_got_ip);
+        break;
+    default:
+        break;
+    }
+
+    return ESP_OK;
+}
+
+/*
+ * Bring the station up as at boot and return the ms from esp_wifi_init to
+ * SYSTEM_EVENT_STA_GOT_IP. The time is taken from esp_wifi_init because the
+ * Wi-Fi library may derive the PMK before esp_wifi_start returns.
+ */
+static uint32_t wifi_init_to_got_ip(void)
+{
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    wifi_config_t wifi_config = {
+        .sta = {
+            .ssid = TEST_PMK_AP_SSID,
+            .password = TEST_PMK_AP_PASSWORD
+        },
+    };
+    int64_t start;
+    uint32_t ms;
+
+    s_connect = true;
+    xSemaphoreTake(s_got_ip, 0);
+
+    start = esp_timer_get_time();
+    TEST_ASSERT_EQUAL(ESP_OK, esp_wifi_init(&cfg));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_wifi_set_storage(WIFI_STORAGE_RAM));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_wifi_set_mode(WIFI_MODE_STA));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_wifi_set_config(ESP_IF_WIFI_STA, &wifi_config));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_wifi_start());
+    TEST_ASSERT_TRUE(xSemaphoreTake(s_got_ip, 30000 / portTICK_PERIOD_MS));
+    ms = (esp_timer_get_time() - start) / 1000;
+
+    s_connect = false;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_wifi_stop());
+    TEST_ASSERT_EQUAL(ESP_OK, esp_wifi_deinit());
+
+    return ms;
+}
+
+TEST_CASE("PMK cache derives once per SSID and passphrase", "[wpa_supplicant][timeout=60]")
+{
+    uint8_t pmk[32], cached[32], other[32];
+    TickType_t start, miss_ticks, hit_ticks;
+
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_flash_init());
+    TEST_ASSERT_EQUAL(ESP_OK, esp_pmk_cache_clear());
+
+    start = xTaskGetTickCount();
+    TEST_ASSERT_EQUAL(0, pbkdf2_sha1("mysecretpassphrase", "MyHomeNetwork", 13, 4096, pmk, sizeof(pmk)));
+    miss_ticks = xTaskGetTickCount() - start;
+
+    start = xTaskGetTickCount();
+    TEST_ASSERT_EQUAL(0, pbkdf2_sha1("mysecretpassphrase", "MyHomeNetwork", 13, 4096, cached, sizeof(cached)));
+    hit_ticks = xTaskGetTickCount() - start;
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(pmk, cached, sizeof(pmk));
+
+    /* a new passphrase for the same SSID must not be served from the cache */
+    TEST_ASSERT_EQUAL(0, pbkdf2_sha1("anotherpassphrase", "MyHomeNetwork", 13, 4096, other, sizeof(other)));
+    TEST_ASSERT(memcmp(pmk, other, sizeof(pmk)));
+
+    printf("PMK: derived in %u ms, read from NVS in %u ms\n",
+           miss_ticks * portTICK_PERIOD_MS, hit_ticks * portTICK_PERIOD_MS);
+
+    TEST_ASSERT_EQUAL(ESP_OK, esp_pmk_cache_clear());
+}
+
+/* needs the AP above, run by name */
+TEST_CASE("PMK cache shortens the time to GOT_IP", "[wpa_supplicant][ignore][timeout=120]")
+{
+    uint32_t derived_ms, cached_ms;
+
+    TEST_ASSERT_EQUAL(ESP_OK, nvs_flash_init());
+    tcpip_adapter_init();
+    s_got_ip = xSemaphoreCreateBinary();
+    TEST_ASSERT_NOT_NULL(s_got_ip);
+    if (esp_event_loop_init(test_event_handler, NULL) != ESP_OK)
+        esp_event_loop_set_cb(test_event_handler, NULL);
+
+    /* an empty cache derives the PMK as without CONFIG_WPA_PMK_CACHE, then also stores it */
+    TEST_ASSERT_EQUAL(ESP_OK, esp_pmk_cache_clear());
+    derived_ms = wifi_init_to_got_ip();
+
+    cached_ms = wifi_init_to_got_ip();
+
+    printf("esp_wifi_init to GOT_IP: PMK derived %u ms, PMK from the cache %u ms\n", derived_ms, cached_ms);
+
+    esp_event_loop_set_cb(NULL, NULL);
+    vSemaphoreDelete(s_got_ip);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_pmk_cache_clear());
+}
+
+#endif /* CONFIG_WPA_PMK_CACHE */
@@ -0,0 +1,96 @@
+#!/usr/bin/env python
+#
+# Write the known answers of test_modexp_host.c, computed with pow():
+#
+#   base, exponent and modulus as big endian hex strings, with the leading
+#   zero bytes the test passes to crypto_mod_exp, the expected result, and
+#   whether the Montgomery path (odd modulus up to 4096 bits, reduced base)
+#   computes it
+#
+# Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+from __future__ import print_function
+import random
+import sys
+
+# RFC 3526 1536-bit MODP group, the DH group 5 of WPS
+GROUP5_PRIME = int(
+    "FFFFFFFFFFFFFFFFC90FDAA22168C234C4C6628B80DC1CD129024E088A67CC74"
+    "020BBEA63B139B22514A08798E3404DDEF9519B3CD3A431B302B0A6DF25F1437"
+    "4FE1356D6D51C245E485B576625E7EC6F44C42E9A637ED6B0BFF5CB6F406B7ED"
+    "EE386BFB5A899FA5AE9F24117C4B1FE649286651ECE45B3DC2007CB8A163BF05"
+    "98DA48361C55D39A69163FA8FD24CF5F83655D23DCA3AD961C62F356208552BB"
+    "9ED529077096966D670C354E4ABC9804F1746C08CA237327FFFFFFFFFFFFFFFF", 16)
+GROUP5_LEN = 192
+
+
+def to_hex(x, length=0):
+    # zero is no bytes at all, as crypto_mod_exp returns it
+    s = '%x' % x if x else ''
+    if len(s) % 2:
+        s = '0' + s
+    return s.rjust(2 * length, '0')
+
+
+def c_string(s, indent):
+    chunks = [s[i:i + 64] for i in range(0, len(s), 64)] or ['']
+    return ('\n' + indent).join('"%s"' % c for c in chunks)
+
+
+def odd_modulus(bits):
+    return random.getrandbits(bits) | (1 << (bits - 1)) | 1
+
+
+def main():
+    random.seed(8266)
+    vectors = []
+
+    def add(name, base, exp, mod, base_len=0, exp_len=0, mod_len=0):
+        mod_hex = to_hex(mod, mod_len)
+        mont = mod % 2 == 1 and base < mod and len(mod_hex) <= 2 * 512
+        vectors.append((name, to_hex(base, base_len), to_hex(exp, exp_len), mod_hex,
+                        to_hex(pow(base, exp, mod)), mont))
+
+    x = random.getrandbits(1536) % GROUP5_PRIME
+    y = random.getrandbits(1536) % GROUP5_PRIME
+    add('4^13 mod 497', 4, 13, 497)
+    add('group 5 public value', 2, x, GROUP5_PRIME, exp_len=GROUP5_LEN)
+    add('group 5 shared secret', y, x, GROUP5_PRIME, GROUP5_LEN, GROUP5_LEN)
+    add('group 5 Fermat', y, GROUP5_PRIME - 1, GROUP5_PRIME, GROUP5_LEN, GROUP5_LEN)
+    m = odd_modulus(4096)
+    add('4096-bit modulus', random.getrandbits(4096) % m, random.getrandbits(256), m)
+    m = odd_modulus(4104)
+    add('modulus over 4096 bits', random.getrandbits(4096), random.getrandbits(64), m)
+    add('modulus with leading zero bytes', random.getrandbits(60), random.getrandbits(64),
+        odd_modulus(64), mod_len=12)
+    add('exponent with leading zero bytes', random.getrandbits(999), random.getrandbits(80),
+        odd_modulus(1000), exp_len=40)
+    add('one word modulus', 0xfffffffa, 0xffffffff, 0xfffffffb)
+    add('zero exponent', 12345, 0, 1000003)
+    add('zero base', 0, 77, 1000003)
+    add('modulus one', 0, 3, 1)
+    add('modulus one, zero exponent', 0, 0, 1)
+    add('base not reduced', 1000003 * 5 + 7, 1001, 1000003)
+    add('even modulus', 123456789, 65537, 2 ** 64 - 2)
+
+    with open(sys.argv[1], 'w') as f:
+        print('/* Generated by gen_test_vectors.py */', file=f)
+        for v in vectors:
+            print('{\n    "%s",\n    %s,\n    %s,\n    %s,\n    %s,\n    %d\n},' % (
+                v[0], c_string(v[1], '    '), c_string(v[2], '    '), c_string(v[3], '    '),
+                c_string(v[4], '    '), v[5]), file=f)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,34 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+
+#define os_malloc(s)            malloc(s)
+#define os_zalloc(s)            calloc(1, (s))
+#define os_realloc(p, s)        realloc((p), (s))
+#define os_free(p)              free(p)
+
+#define os_memcpy(d, s, n)      memcpy((d), (s), (n))
+#define os_memmove(d, s, n)     memmove((d), (s), (n))
+#define os_memset(s, c, n)      memset(s, c, n)
+#define os_memcmp(s1, s2, n)    memcmp((s1), (s2), (n))
+#define os_strlen(s)            strlen(s)
+
+/* the libtommath allocator of port/os_xtensa.c */
+#define _xmalloc(n)             malloc(n)
+#define _xrealloc(p, n)         realloc((p), (n))
+#define _xfree(p)               free(p)
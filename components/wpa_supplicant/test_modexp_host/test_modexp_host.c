@@ -0,0 +1,219 @@
+// Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Checks the Montgomery exponentiation of crypto_mod_exp against known
+ * answers written by gen_test_vectors.py, and against the libtommath
+ * exponentiation of bignum.c it replaced for odd moduli, and compares their
+ * speed on the DH group 5 prime.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/crypto/crypto_internal-modexp.c"
+
+#define TEST_MAX_LEN    (MONT_MAX_WORDS * 4 + 8)
+#define TEST_CASES      2000
+#define SPEED_ROUNDS    20
+
+typedef struct {
+    const char *name;
+    const char *base;
+    const char *exp;
+    const char *mod;
+    const char *result;
+    int mont;
+} test_vector_t;
+
+static const test_vector_t s_vectors[] = {
+#include "test_vectors.h"
+};
+
+static int s_failed;
+
+#define CHECK(cond)     do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            s_failed++; \
+        } \
+    } while (0)
+
+static size_t from_hex(u8 *buf, const char *hex)
+{
+    size_t len = strlen(hex) / 2;
+
+    for (size_t i = 0; i < len; i++) {
+        unsigned int byte;
+
+        sscanf(hex + 2 * i, "%2x", &byte);
+        buf[i] = byte;
+    }
+    return len;
+}
+
+/* the libtommath exponentiation crypto_mod_exp used before */
+static int mod_exp_bignum(const u8 *base, size_t base_len, const u8 *power, size_t power_len,
+                          const u8 *modulus, size_t modulus_len, u8 *result, size_t *result_len)
+{
+    struct bignum *b = bignum_init(), *e = bignum_init(), *m = bignum_init(), *r = bignum_init();
+    int ret = -1;
+
+    if (b && e && m && r &&
+        !bignum_set_unsigned_bin(b, base, base_len) &&
+        !bignum_set_unsigned_bin(e, power, power_len) &&
+        !bignum_set_unsigned_bin(m, modulus, modulus_len) &&
+        !bignum_exptmod(b, e, m, r))
+        ret = bignum_get_unsigned_bin(r, result, result_len);
+
+    bignum_deinit(b);
+    bignum_deinit(e);
+    bignum_deinit(m);
+    bignum_deinit(r);
+    return ret;
+}
+
+static void test_vectors(void)
+{
+    static u8 base[TEST_MAX_LEN], exp[TEST_MAX_LEN], mod[TEST_MAX_LEN], expected[TEST_MAX_LEN];
+    static u8 result[TEST_MAX_LEN];
+
+    for (int i = 0; i < sizeof(s_vectors) / sizeof(s_vectors[0]); i++) {
+        const test_vector_t *v = &s_vectors[i];
+        size_t base_len = from_hex(base, v->base), exp_len = from_hex(exp, v->exp);
+        size_t mod_len = from_hex(mod, v->mod), expected_len = from_hex(expected, v->result);
+        size_t len = sizeof(result);
+        int ret;
+
+        ret = crypto_mod_exp(base, base_len, exp, exp_len, mod, mod_len, result, &len);
+        if (ret || len != expected_len || memcmp(result, expected, len))
+            printf("%s: wrong result\n", v->name);
+        CHECK(ret == 0);
+        CHECK(len == expected_len && !memcmp(result, expected, len));
+
+        /* the Montgomery path serves odd moduli up to 4096 bits, with a reduced base */
+        len = sizeof(result);
+        if (v->mont) {
+            CHECK(mont_exp(base, base_len, exp, exp_len, mod, mod_len, result, &len) == 0);
+            CHECK(len == expected_len && !memcmp(result, expected, len));
+        } else if (mod_len <= MONT_MAX_WORDS * 4 && (mod[mod_len - 1] & 1)) {
+            CHECK(mont_exp(base, base_len, exp, exp_len, mod, mod_len, result, &len) < 0);
+        }
+
+        /* a result buffer that is too small reports the needed length */
+        if (expected_len) {
+            len = expected_len - 1;
+            CHECK(crypto_mod_exp(base, base_len, exp, exp_len, mod, mod_len, result, &len) < 0);
+            CHECK(len == expected_len);
+        }
+    }
+}
+
+/* Random odd moduli of every size, random or generator 2 bases and random exponents */
+static void test_equivalence(void)
+{
+    static u8 base[TEST_MAX_LEN], exp[TEST_MAX_LEN], mod[TEST_MAX_LEN];
+    static u8 result[TEST_MAX_LEN], ref[TEST_MAX_LEN];
+
+    for (int i = 0; i < TEST_CASES; i++) {
+        size_t top = i < MONT_MAX_WORDS * 4 ? i : rand() % (MONT_MAX_WORDS * 4), mod_len = top + 1;
+        size_t exp_len = rand() % 64 == 0 ? 0 : 1 + rand() % (i < 1000 ? 16 : mod_len);
+        size_t base_len = mod_len, len = sizeof(result), ref_len = sizeof(ref);
+        int ret;
+
+        for (size_t j = 0; j < mod_len; j++)
+            mod[j] = rand();
+        mod[0] |= 0x80;
+        mod[top] |= 1;
+        for (size_t j = 0; j < exp_len; j++)
+            exp[j] = rand() % 8 ? rand() : 0;
+
+        switch (rand() % 4) {
+        case 0:
+            base[0] = 2;
+            base_len = 1;
+            break;
+        case 1:
+            memset(base, 0, mod_len);
+            break;
+        default:
+            for (size_t j = 0; j < mod_len; j++)
+                base[j] = rand();
+            base[0] &= 0x7f;
+            break;
+        }
+        if (mod_len == 1 && base_len == 1 && base[0] >= mod[0])
+            base[0] = 0;
+
+        ret = crypto_mod_exp(base, base_len, exp, exp_len, mod, mod_len, result, &len);
+        CHECK(ret == 0);
+        CHECK(mod_exp_bignum(base, base_len, exp, exp_len, mod, mod_len, ref, &ref_len) == 0);
+        CHECK(len == ref_len && !memcmp(result, ref, len));
+        if (ret || len != ref_len || memcmp(result, ref, len)) {
+            printf("mismatch with a %u byte modulus, a %u byte exponent\n", (unsigned)mod_len, (unsigned)exp_len);
+            break;
+        }
+    }
+}
+
+static double speed(int mont, const u8 *base, size_t base_len, const u8 *exp, const u8 *mod, size_t len)
+{
+    u8 result[TEST_MAX_LEN];
+    size_t result_len;
+    clock_t start = clock();
+
+    for (int i = 0; i < SPEED_ROUNDS; i++) {
+        result_len = sizeof(result);
+        if (mont)
+            mont_exp(base, base_len, exp, len, mod, len, result, &result_len);
+        else
+            mod_exp_bignum(base, base_len, exp, len, mod, len, result, &result_len);
+    }
+    return (double)(clock() - start) * 1000 / CLOCKS_PER_SEC / SPEED_ROUNDS;
+}
+
+static void test_speed(void)
+{
+    u8 base[TEST_MAX_LEN], exp[TEST_MAX_LEN], mod[TEST_MAX_LEN], gen = 2;
+    size_t len = 0;
+
+    /* the group 5 shared secret vector */
+    for (int i = 0; i < sizeof(s_vectors) / sizeof(s_vectors[0]); i++) {
+        if (!strcmp(s_vectors[i].name, "group 5 shared secret")) {
+            from_hex(base, s_vectors[i].base);
+            from_hex(exp, s_vectors[i].exp);
+            len = from_hex(mod, s_vectors[i].mod);
+        }
+    }
+    CHECK(len == 192);
+
+    printf("DH group 5 public value: %.2f ms, libtommath %.2f ms\n",
+           speed(1, &gen, 1, exp, mod, len), speed(0, &gen, 1, exp, mod, len));
+    printf("DH group 5 shared secret: %.2f ms, libtommath %.2f ms\n",
+           speed(1, base, len, exp, mod, len), speed(0, base, len, exp, mod, len));
+}
+
+int main(void)
+{
+    srand(1);
+
+    test_vectors();
+    test_equivalence();
+    test_speed();
+
+    printf("%s\n", s_failed ? "FAILED" : "OK");
+    return s_failed ? 1 : 0;
+}
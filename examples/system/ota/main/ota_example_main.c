@@ -92,6 +92,17 @@ static void initialise_wifi(void)
 }
 
 /*read buffer by byte still delim ,return read bytes counts*/
+static esp_err_t ota_write(esp_ota_handle_t update_handle, const void *data, size_t size)
+{
+#if defined(CONFIG_EXAMPLE_OTA_COMPRESSED)
+    return esp_ota_write_compressed(update_handle, data, size);
+#elif defined(CONFIG_EXAMPLE_OTA_DELTA)
+    return esp_ota_write_delta(update_handle, data, size);
+#else
+    return esp_ota_write(update_handle, data, size);
+#endif
+}
+
 static int read_until(char *buffer, char delim, int len)
 {
 //  /*TODO: delim check,buffer check,further: do an buffer length limited*/
@@ -119,7 +130,7 @@ static bool read_past_http_header(char text[], int total_len, esp_ota_handle_t u
             /*copy first http packet body to write buffer*/
             memcpy(ota_write_data, &(text[i + 2]), i_write_len);
 
-            esp_err_t err = esp_ota_write( update_handle, (const void *)ota_write_data, i_write_len);
+            esp_err_t err = ota_write( update_handle, (const void *)ota_write_data, i_write_len);
             if (err != ESP_OK) {
                 ESP_LOGE(TAG, "Error: esp_ota_write failed! err=0x%x", err);
                 return false;
@@ -239,7 +250,7 @@ static void ota_example_task(void *pvParameter)
              update_partition->subtype, update_partition->address);
     assert(update_partition != NULL);
 
-    err = esp_ota_begin(update_partition, OTA_SIZE_UNKNOWN, &update_handle);
+    err = esp_ota_begin(update_partition, OTA_WITH_SEQUENTIAL_WRITES, &update_handle);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "esp_ota_begin failed, error=%d", err);
         task_fatal_error();
@@ -260,7 +271,7 @@ static void ota_example_task(void *pvParameter)
             resp_body_start = read_past_http_header(text, buff_len, update_handle);
         } else if (buff_len > 0 && resp_body_start) { /*deal with response body*/
             memcpy(ota_write_data, text, buff_len);
-            err = esp_ota_write( update_handle, (const void *)ota_write_data, buff_len);
+            err = ota_write( update_handle, (const void *)ota_write_data, buff_len);
             if (err != ESP_OK) {
                 ESP_LOGE(TAG, "Error: esp_ota_write failed! err=0x%x", err);
                 task_fatal_error();
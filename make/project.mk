@@ -41,6 +41,8 @@ help:
 	@echo "make app - Build just the app"
 	@echo "make app-flash - Flash just the app"
 	@echo "make app-clean - Clean just the app"
+	@echo "make app-compressed - Build the app compressed for esp_ota_write_compressed()"
+	@echo "make app-delta OTA_DELTA_BASE=<app.bin> - Build the delta from <app.bin> for esp_ota_write_delta()"
 	@echo "make print_flash_cmd - Print the arguments for esptool when flash"
 	@echo ""
 	@echo "See also 'make bootloader', 'make bootloader-flash', 'make bootloader-clean', "
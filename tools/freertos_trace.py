@@ -0,0 +1,264 @@
+#!/usr/bin/env python
+#
+# Convert a FreeRTOS event trace dump, written by esp_freertos_trace_dump(),
+# to a Chrome trace JSON file, which chrome://tracing and https://ui.perfetto.dev
+# display as a timeline.
+#
+# The input can be the dump itself, a file written on SPIFFS, or a serial log
+# containing it: the lines between "--- freertos trace begin" and
+# "--- freertos trace end" are used. Each task and each interrupt gets a track,
+# with its run slices, and the queue events are marked on the track of the task
+# or interrupt which made them.
+#
+# Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+from __future__ import print_function, division
+
+import argparse
+import json
+import re
+import sys
+
+TRACE_VERSION = 1
+
+# esp_freertos_trace_event_t
+TASK_SWITCH = 1
+TASK_CREATE = 2
+TASK_DELETE = 3
+QUEUE_CREATE = 4
+QUEUE_DELETE = 5
+QUEUE_SEND = 6
+QUEUE_SEND_FAILED = 7
+QUEUE_RECEIVE = 8
+QUEUE_RECEIVE_FAILED = 9
+QUEUE_BLOCK_SEND = 10
+QUEUE_BLOCK_RECEIVE = 11
+ISR_ENTER = 12
+ISR_EXIT = 13
+START = 14
+
+QUEUE_EVENTS = {
+    QUEUE_CREATE: "create",
+    QUEUE_DELETE: "delete",
+    QUEUE_SEND: "send",
+    QUEUE_SEND_FAILED: "send failed",
+    QUEUE_RECEIVE: "receive",
+    QUEUE_RECEIVE_FAILED: "receive failed",
+    QUEUE_BLOCK_SEND: "block on send",
+    QUEUE_BLOCK_RECEIVE: "block on receive",
+}
+
+# queueQUEUE_TYPE_xxx
+QUEUE_TYPES = ["queue", "mutex", "counting semaphore", "binary semaphore", "recursive mutex"]
+
+# ETS_xxx_INUM
+ISR_NAMES = {
+    2: "SPI",
+    4: "GPIO",
+    5: "UART",
+    7: "SOFT",
+    8: "WDT",
+    9: "FRC1",
+}
+
+PID = 1
+ISR_TID_BASE = 1  # interrupt tracks come first, task tracks use the handle
+
+BEGIN_RE = re.compile(r"--- freertos trace begin (\d+) ---")
+END_RE = re.compile(r"--- freertos trace end (\d+) ---")
+TASK_RE = re.compile(r"T ([0-9a-fA-F]{8}) (.*)$")
+EVENT_RE = re.compile(r"E ([0-9a-fA-F]+) ([0-9a-fA-F]+) ([0-9a-fA-F]+) ([0-9a-fA-F]+)\s*$")
+
+
+class TraceError(RuntimeError):
+    pass
+
+
+def parse_dump(lines):
+    """ Return the task names, the events as (time, event, arg, obj) and the
+    number of lost events of the last dump in the lines """
+    dump = None
+    for line in lines:
+        line = line.rstrip("\r\n")
+        m = BEGIN_RE.search(line)
+        if m:
+            version = int(m.group(1))
+            if version != TRACE_VERSION:
+                raise TraceError("Unsupported trace version %d" % version)
+            dump = ({}, [], None)
+            continue
+        if dump is None or dump[2] is not None:
+            continue
+        m = END_RE.search(line)
+        if m:
+            dump = (dump[0], dump[1], int(m.group(1)))
+            continue
+        m = TASK_RE.search(line)
+        if m:
+            dump[0][int(m.group(1), 16)] = m.group(2)
+            continue
+        m = EVENT_RE.search(line)
+        if m:
+            dump[1].append(tuple(int(g, 16) for g in m.groups()))
+
+    if dump is None:
+        raise TraceError("No trace found")
+    if dump[2] is None:
+        raise TraceError("Trace not terminated, it is incomplete")
+    return dump
+
+
+def unwrap_times(events):
+    """ Turn the 32-bit microsecond times, which wrap after 71 minutes, into
+    increasing times starting at 0 """
+    times = []
+    offset = 0
+    prev = None
+    for e in events:
+        if prev is not None and e[0] < prev:
+            offset += 1 << 32
+        prev = e[0]
+        times.append(e[0] + offset)
+    start = times[0] if times else 0
+    return [t - start for t in times]
+
+
+class Converter(object):
+    def __init__(self, task_names):
+        self.task_names = task_names
+        self.out = []
+        self.tracks = {}
+        self.task = None        # running task and the start of its slice
+        self.task_start = None
+        self.isr = None         # running interrupt and the start of its slice
+        self.isr_start = None
+
+    def track(self, tid, name):
+        if tid not in self.tracks:
+            self.tracks[tid] = name
+
+    def task_track(self, task):
+        name = self.task_names.get(task, "task %08x" % task)
+        self.track(task, name)
+        return task
+
+    def isr_track(self, inum):
+        tid = ISR_TID_BASE + inum
+        self.track(tid, "ISR %d %s" % (inum, ISR_NAMES.get(inum, "")))
+        return tid
+
+    def slice(self, tid, name, start, end):
+        self.out.append({"name": name, "ph": "X", "pid": PID, "tid": tid,
+                         "ts": start, "dur": max(end - start, 0)})
+
+    def instant(self, tid, name, ts, args=None):
+        e = {"name": name, "ph": "i", "s": "t", "pid": PID, "tid": tid, "ts": ts}
+        if args:
+            e["args"] = args
+        self.out.append(e)
+
+    def end_task(self, ts):
+        if self.task is not None:
+            tid = self.task_track(self.task)
+            self.slice(tid, self.tracks[tid], self.task_start, ts)
+        self.task = None
+
+    def begin_task(self, task, ts):
+        self.end_task(ts)
+        self.task = task
+        self.task_start = ts
+
+    def end_isr(self, ts):
+        if self.isr is not None:
+            self.slice(self.isr_track(self.isr), "ISR %d" % self.isr, self.isr_start, ts)
+        self.isr = None
+
+    def current_tid(self):
+        if self.isr is not None:
+            return self.isr_track(self.isr)
+        if self.task is not None:
+            return self.task_track(self.task)
+        return None
+
+    def convert(self, events, lost):
+        times = unwrap_times(events)
+        last = 0
+        for ts, (_, event, arg, obj) in zip(times, events):
+            last = ts
+            if event == TASK_SWITCH:
+                self.begin_task(obj, ts)
+            elif event == START:
+                # Events are missing before: close the slices where they end
+                self.end_isr(ts)
+                self.begin_task(obj, ts)
+            elif event == ISR_ENTER:
+                self.end_isr(ts)
+                self.isr = arg
+                self.isr_start = ts
+            elif event == ISR_EXIT:
+                if self.isr == arg:
+                    self.end_isr(ts)
+            elif event in (TASK_CREATE, TASK_DELETE):
+                tid = self.current_tid()
+                if tid is not None:
+                    name = "create" if event == TASK_CREATE else "delete"
+                    self.instant(tid, "%s %s" % (name, self.task_names.get(obj, "task %08x" % obj)), ts)
+            elif event in QUEUE_EVENTS:
+                tid = self.current_tid()
+                if tid is None:
+                    continue
+                args = {"queue": "%08x" % obj}
+                if event == QUEUE_CREATE and arg < len(QUEUE_TYPES):
+                    args["type"] = QUEUE_TYPES[arg]
+                self.instant(tid, QUEUE_EVENTS[event], ts, args)
+            else:
+                print("Unknown event %d at %d us" % (event, ts), file=sys.stderr)
+
+        self.end_isr(last)
+        self.end_task(last)
+
+        meta = [{"name": "process_name", "ph": "M", "pid": PID, "args": {"name": "ESP8266"}}]
+        for tid, name in sorted(self.tracks.items()):
+            meta.append({"name": "thread_name", "ph": "M", "pid": PID, "tid": tid, "args": {"name": name}})
+            meta.append({"name": "thread_sort_index", "ph": "M", "pid": PID, "tid": tid, "args": {"sort_index": tid}})
+
+        return {"traceEvents": meta + self.out,
+                "displayTimeUnit": "ns",
+                "otherData": {"lost events": lost}}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert a FreeRTOS trace dump to Chrome trace JSON")
+    parser.add_argument("input", type=argparse.FileType("r"),
+                        help="Trace dump, or serial log containing it, - for stdin")
+    parser.add_argument("-o", "--output", type=argparse.FileType("w"), default=sys.stdout,
+                        help="JSON file to write, stdout by default")
+    args = parser.parse_args()
+
+    try:
+        task_names, events, lost = parse_dump(args.input)
+    except TraceError as e:
+        print("Error: %s" % e, file=sys.stderr)
+        sys.exit(2)
+
+    if lost:
+        print("Warning: %d events lost in the NMI" % lost, file=sys.stderr)
+
+    json.dump(Converter(task_names).convert(events, lost), args.output, indent=1)
+    args.output.write("\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,168 @@
+#!/usr/bin/env python
+#
+# Generate a CA certificate bundle for esp_crt_bundle_attach()
+#
+# The bundle holds DER certificates indexed by a hash of their subject name,
+# so that the device only parses the CA that issued the presented chain:
+#
+#   header   u32 magic "CRTB", u32 number of certificates, u32 total size
+#   index    u32 name hash, u32 offset, u32 length; sorted by name hash
+#   data     DER certificates, each padded to 4 bytes
+#
+# All values are little endian. The name hash is the 32-bit FNV-1a hash of
+# the DER encoded subject name.
+#
+# Usage:
+#   make_crt_bundle.py -o ca_bundle.bin cacert.pem my_root.der certs_dir/
+#
+# then embed ca_bundle.bin with COMPONENT_EMBED_FILES and pass it to
+# esp_crt_bundle_attach().
+#
+# Copyright 2018-2019 Espressif Systems (Shanghai) PTE LTD
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+from __future__ import print_function, division
+import argparse
+import base64
+import os
+import re
+import struct
+import sys
+
+BUNDLE_MAGIC = 0x42545243  # "CRTB"
+HEADER_FMT = "<III"
+ENTRY_FMT = "<III"
+
+PEM_RE = re.compile(b"-----BEGIN CERTIFICATE-----(.+?)-----END CERTIFICATE-----", re.DOTALL)
+
+
+class InputError(RuntimeError):
+    pass
+
+
+def der_tlv(data, pos):
+    """ Return (tag, start of the value, end of the element) of the DER element at pos """
+    if pos + 2 > len(data):
+        raise InputError("truncated DER element")
+    tag = bytearray(data[pos:pos + 1])[0]
+    length = bytearray(data[pos + 1:pos + 2])[0]
+    pos += 2
+    if length & 0x80:
+        num = length & 0x7f
+        if num == 0 or num > 4 or pos + num > len(data):
+            raise InputError("bad DER length")
+        length = 0
+        for b in bytearray(data[pos:pos + num]):
+            length = (length << 8) | b
+        pos += num
+    if pos + length > len(data):
+        raise InputError("truncated DER element")
+    return tag, pos, pos + length
+
+
+def subject_name(der):
+    """ Raw DER subject Name of a certificate, as mbedTLS keeps it in subject_raw """
+    tag, pos, end = der_tlv(der, 0)           # Certificate
+    if tag != 0x30:
+        raise InputError("not a certificate")
+    tag, pos, end = der_tlv(der, pos)         # TBSCertificate
+    if tag != 0x30:
+        raise InputError("not a certificate")
+    fields = []
+    while pos < end:
+        tag, value, nxt = der_tlv(der, pos)
+        fields.append((tag, pos, nxt))
+        pos = nxt
+    if fields and fields[0][0] == 0xa0:       # [0] version
+        fields = fields[1:]
+    # serialNumber, signature, issuer, validity, subject
+    if len(fields) < 5 or fields[4][0] != 0x30:
+        raise InputError("no subject name")
+    return der[fields[4][1]:fields[4][2]]
+
+
+def name_hash(name):
+    h = 2166136261
+    for b in bytearray(name):
+        h = ((h ^ b) * 16777619) & 0xffffffff
+    return h
+
+
+def load_certs(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    pems = PEM_RE.findall(data)
+    if pems:
+        return [base64.b64decode(b"".join(p.split())) for p in pems]
+    return [data]
+
+
+def collect(paths):
+    files = []
+    for path in paths:
+        if os.path.isdir(path):
+            files += [os.path.join(path, f) for f in sorted(os.listdir(path))
+                      if os.path.splitext(f)[1].lower() in (".pem", ".crt", ".cer", ".der")]
+        else:
+            files.append(path)
+
+    certs = []
+    seen = set()
+    for path in files:
+        for der in load_certs(path):
+            try:
+                name = subject_name(der)
+            except InputError as e:
+                raise InputError("%s: %s" % (path, e))
+            if der in seen:
+                continue
+            seen.add(der)
+            certs.append((name_hash(name), der))
+    return certs
+
+
+def make_bundle(certs):
+    certs = sorted(certs, key=lambda c: c[0])
+    header_len = struct.calcsize(HEADER_FMT) + len(certs) * struct.calcsize(ENTRY_FMT)
+
+    index = b""
+    data = b""
+    for h, der in certs:
+        index += struct.pack(ENTRY_FMT, h, header_len + len(data), len(der))
+        data += der + b"\0" * (-len(der) % 4)
+
+    return struct.pack(HEADER_FMT, BUNDLE_MAGIC, len(certs), header_len + len(data)) + index + data
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate a CA certificate bundle for esp_crt_bundle_attach()")
+    parser.add_argument("-o", "--output", required=True, help="bundle file to write")
+    parser.add_argument("input", nargs="+", help="PEM or DER certificate files, PEM files with several "
+                        "certificates, or directories of them")
+    args = parser.parse_args()
+
+    try:
+        certs = collect(args.input)
+    except (IOError, InputError) as e:
+        print("make_crt_bundle.py: %s" % e, file=sys.stderr)
+        sys.exit(1)
+
+    bundle = make_bundle(certs)
+    with open(args.output, "wb") as f:
+        f.write(bundle)
+    print("%d certificates, %d bytes" % (len(certs), len(bundle)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,80 @@
+#!/usr/bin/env python
+#
+# Tests of freertos_trace.py, run from this directory:
+#
+#     python test_freertos_trace.py
+#
+# trace.txt is a serial log holding a dump which wraps the 32-bit time, has
+# interrupt slices, an interrupt left open by a START and events of unknown
+# tasks. expected.json is its conversion, checked by hand.
+#
+from __future__ import print_function, division
+
+import json
+import os
+import re
+import sys
+import unittest
+
+sys.path.append("..")
+import freertos_trace  # noqa: E402
+
+TEST_DIR = os.path.dirname(os.path.abspath(__file__))
+TRACE_HEADER = os.path.join(TEST_DIR, "..", "..", "components", "freertos", "port", "esp8266",
+                            "include", "freertos", "esp_freertos_trace.h")
+
+
+def load_trace():
+    with open(os.path.join(TEST_DIR, "trace.txt")) as f:
+        return freertos_trace.parse_dump(f)
+
+
+class ConvertTests(unittest.TestCase):
+
+    def test_expected_json(self):
+        task_names, events, lost = load_trace()
+        with open(os.path.join(TEST_DIR, "expected.json")) as f:
+            expected = json.load(f)
+        self.assertEqual(expected, freertos_trace.Converter(task_names).convert(events, lost))
+
+    def test_parse(self):
+        task_names, events, lost = load_trace()
+        self.assertEqual({0x3ffef000: "IDLE", 0x3ffef100: "main"}, task_names)
+        self.assertEqual(12, len(events))
+        self.assertEqual(2, lost)
+
+    def test_unwrap(self):
+        events = [(0xfffffff0, 0, 0, 0), (0xfffffffa, 0, 0, 0), (0x5, 0, 0, 0), (0x10, 0, 0, 0)]
+        self.assertEqual([0, 10, 21, 32], freertos_trace.unwrap_times(events))
+
+    def test_last_dump(self):
+        lines = ["--- freertos trace begin 1 ---", "E 00000001 1 0 3ffef000", "--- freertos trace end 0 ---",
+                 "--- freertos trace begin 1 ---", "E 00000002 1 0 3ffef100", "--- freertos trace end 3 ---"]
+        task_names, events, lost = freertos_trace.parse_dump(lines)
+        self.assertEqual([(2, 1, 0, 0x3ffef100)], events)
+        self.assertEqual(3, lost)
+
+    def test_errors(self):
+        with self.assertRaises(freertos_trace.TraceError):
+            freertos_trace.parse_dump(["nothing"])
+        with self.assertRaises(freertos_trace.TraceError):
+            freertos_trace.parse_dump(["--- freertos trace begin 1 ---", "E 00000001 1 0 3ffef000"])
+        with self.assertRaises(freertos_trace.TraceError):
+            freertos_trace.parse_dump(["--- freertos trace begin 2 ---", "--- freertos trace end 0 ---"])
+
+
+class FormatTests(unittest.TestCase):
+
+    def test_events_match_header(self):
+        """ The event numbers of the tool are the ones of esp_freertos_trace_event_t """
+        with open(TRACE_HEADER) as f:
+            header = f.read()
+        body = re.search(r"typedef enum \{(.*?)\} esp_freertos_trace_event_t;", header, re.S).group(1)
+        value = 0
+        for name, init in re.findall(r"ESP_FREERTOS_TRACE_(\w+)\s*(= *\d+)?,", body):
+            value = int(init.strip("= ")) if init else value + 1
+            self.assertEqual(value, getattr(freertos_trace, name), name)
+
+
+if __name__ == "__main__":
+    unittest.main()